@@ -0,0 +1,11 @@
+#!/bin/sh
+
+CompilerFlags="-O2 -g -msse2 -Wall -Werror -Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable -Wno-write-strings -fno-rtti -fno-exceptions -DRAYC_INTERNAL=1 -DRAYC_SLOW=1"
+LinkLibs="-lm -lpthread -lrt"
+
+cd "$(dirname "$0")"
+mkdir -p ../build
+
+c++ $CompilerFlags linux_rayc.cpp -o ../build/linux_rayc $LinkLibs
+c++ $CompilerFlags linux_rayc_bench.cpp -o ../build/linux_rayc_bench $LinkLibs
+c++ $CompilerFlags linux_rayc_batch.cpp -o ../build/linux_rayc_batch $LinkLibs
@@ -0,0 +1,849 @@
+#include "rayc.cpp"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#include <pthread.h>
+
+// NOTE: Headless platform layer. There is no window or input device here; it
+// runs the same game loop as win32_rayc.cpp against an offscreen buffer, which
+// is what shared build/soak machines need.
+
+// NOTE: Only the main thread reads or writes it; the sim thread stops on the
+// pipeline's own quit word
+global_variable u32 volatile GlobalRunning;
+global_variable bool32 GlobalVerbose;
+global_variable game_input GlobalGameInput;
+
+internal void
+DEBUGPrintString(const char *Format, ...)
+{
+    if (GlobalVerbose)
+    {
+        va_list Args;
+        va_start(Args, Format);
+        char CharBuffer[256];
+        vsnprintf(CharBuffer, 256, Format, Args);
+        va_end(Args);
+
+        fputs(CharBuffer, stderr);
+    }
+}
+
+#include "linux_rayc_file.cpp"
+
+inline u64
+LinuxGetWallClock()
+{
+    timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    u64 Result = (u64)Time.tv_sec*1000000000ull + (u64)Time.tv_nsec;
+    return Result;
+}
+
+inline f32
+LinuxGetSecondsElapsed(u64 Start, u64 End)
+{
+    f32 Result = (f32)((f64)(End - Start) / 1000000000.0);
+    return Result;
+}
+
+// NOTE: Frame pacing. clock_nanosleep to an absolute deadline does most of the
+// waiting with the core idle; only the last stretch, sized by how late the
+// kernel has actually been waking us up, is spun. The spin threshold tracks an
+// exponential average of wake-up latency plus a few deviations of margin, so on
+// a quiet machine it settles at tens of microseconds and on a loaded one it
+// backs off instead of missing frames.
+struct linux_frame_pacer
+{
+    u64 TargetNanoseconds;
+
+    i64 SpinThresholdNanoseconds;
+    i64 WakeLatencyAverage;
+    i64 WakeLatencyDeviation;
+
+    u32 MissedFrames;
+};
+
+#define PACER_MIN_SPIN_NS 20000
+#define PACER_MAX_SPIN_NS 4000000
+
+internal void
+LinuxInitFramePacer(linux_frame_pacer *Pacer, f32 TargetSeconds)
+{
+    Pacer->TargetNanoseconds = (u64)((f64)TargetSeconds * 1000000000.0);
+    Pacer->WakeLatencyAverage = 100000;
+    Pacer->WakeLatencyDeviation = 50000;
+    Pacer->SpinThresholdNanoseconds = 200000;
+    Pacer->MissedFrames = 0;
+}
+
+internal void
+LinuxPauseUntilFrameTime(linux_frame_pacer *Pacer, u64 LastCounter)
+{
+    u64 Deadline = LastCounter + Pacer->TargetNanoseconds;
+    u64 Now = LinuxGetWallClock();
+    if (Now < Deadline)
+    {
+        i64 SleepUntil = (i64)Deadline - Pacer->SpinThresholdNanoseconds;
+        if ((i64)Now < SleepUntil)
+        {
+            timespec WakeTime;
+            WakeTime.tv_sec = (time_t)(SleepUntil / 1000000000ll);
+            WakeTime.tv_nsec = (long)(SleepUntil % 1000000000ll);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &WakeTime, 0) == EINTR) {}
+
+            Now = LinuxGetWallClock();
+
+            // NOTE: Adapt the spin threshold to observed wake-up latency.
+            // Average and deviation are kept in 1/8 fixed steps (Jacobson/Karels).
+            i64 Latency = (i64)Now - SleepUntil;
+            if (Latency < 0) Latency = 0;
+            i64 Error = Latency - Pacer->WakeLatencyAverage;
+            Pacer->WakeLatencyAverage += Error / 8;
+            Pacer->WakeLatencyDeviation += (((Error < 0) ? -Error : Error) - Pacer->WakeLatencyDeviation) / 8;
+
+            i64 Threshold = Pacer->WakeLatencyAverage + 4*Pacer->WakeLatencyDeviation;
+            if (Threshold < PACER_MIN_SPIN_NS) Threshold = PACER_MIN_SPIN_NS;
+            if (Threshold > PACER_MAX_SPIN_NS) Threshold = PACER_MAX_SPIN_NS;
+            Pacer->SpinThresholdNanoseconds = Threshold;
+
+            if (Now > Deadline)
+            {
+                ++Pacer->MissedFrames;
+                LogPrint("Missed frame - sleep.\n");
+            }
+        }
+
+        while (Now < Deadline)
+        {
+            // NOTE: Spin
+            CPUPause();
+            Now = LinuxGetWallClock();
+        }
+    }
+    else
+    {
+        ++Pacer->MissedFrames;
+        LogPrint("Missed frame - work.\n");
+    }
+}
+
+// NOTE: Waiting on a pipeline counter. Spin for a short while since the other
+// stage is usually close to done, then park on a futex so an idle stage costs
+// no CPU.
+internal void
+LinuxWaitWhileEqual(u32 volatile *Address, u32 Value)
+{
+    for (i32 SpinIndex = 0;
+         SpinIndex < 1024;
+         ++SpinIndex)
+    {
+        if (AtomicLoadU32(Address) != Value)
+        {
+            return;
+        }
+        CPUPause();
+    }
+
+    while (AtomicLoadU32(Address) == Value)
+    {
+        syscall(SYS_futex, (u32 *)Address, FUTEX_WAIT_PRIVATE, Value, 0, 0, 0);
+    }
+}
+
+inline void
+LinuxWakeWaiters(u32 volatile *Address)
+{
+    syscall(SYS_futex, (u32 *)Address, FUTEX_WAKE_PRIVATE, INT_MAX, 0, 0, 0);
+}
+
+struct linux_sim_thread_context
+{
+    frame_pipeline *Pipeline;
+    game_state *State;
+};
+
+internal void *
+LinuxSimThreadProc(void *Parameter)
+{
+    linux_sim_thread_context *Context = (linux_sim_thread_context *)Parameter;
+    frame_pipeline *Pipeline = Context->Pipeline;
+
+    while (!PipelineQuitRequested(Pipeline))
+    {
+        LinuxWaitWhileEqual(&Pipeline->SimFramesRequested, Pipeline->SimFramesCompleted);
+        if (PipelineRunSimStage(Pipeline, Context->State))
+        {
+            LinuxWakeWaiters(&Pipeline->SimFramesCompleted);
+        }
+    }
+
+    return 0;
+}
+
+internal void
+LinuxSubmitSimFrame(frame_pipeline *Pipeline, game_input *Input)
+{
+    PipelineSubmitSimFrame(Pipeline, Input);
+    LinuxWakeWaiters(&Pipeline->SimFramesRequested);
+}
+
+internal void
+LinuxWaitForSimFrame(frame_pipeline *Pipeline)
+{
+    LinuxWaitWhileEqual(&Pipeline->SimFramesCompleted, Pipeline->SimFramesRequested - 1);
+}
+
+// NOTE: Log writer. Wakes every couple of milliseconds, formats whatever the
+// main and sim threads have appended and writes it out, so a log line costs
+// the threads that matter one ring append and nothing else.
+#define LINUX_LOG_MAX_RINGS 16
+#define LINUX_LOG_TEXT_SIZE Kilobytes(64)
+#define LINUX_LOG_POLL_NS 2000000
+
+struct linux_log_writer
+{
+    log_state Log;
+    int FileHandle;
+    u32 volatile Running;
+    pthread_t Thread;
+
+    char Text[LINUX_LOG_TEXT_SIZE];
+};
+
+internal void
+LinuxFlushLog(linux_log_writer *Writer)
+{
+    for (;;)
+    {
+        memory_index Size = LogFormatPending(&Writer->Log, Writer->Text, sizeof(Writer->Text));
+        if (Size == 0)
+        {
+            break;
+        }
+
+        char *At = Writer->Text;
+        while (Size > 0)
+        {
+            ssize_t BytesWritten = write(Writer->FileHandle, At, Size);
+            if (BytesWritten > 0)
+            {
+                At += BytesWritten;
+                Size -= (memory_index)BytesWritten;
+            }
+            else if ((BytesWritten < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            else
+            {
+                // NOTE: Nowhere left to report it; the text is dropped
+                break;
+            }
+        }
+    }
+}
+
+internal void *
+LinuxLogThreadProc(void *Parameter)
+{
+    linux_log_writer *Writer = (linux_log_writer *)Parameter;
+
+    timespec PollTime;
+    PollTime.tv_sec = 0;
+    PollTime.tv_nsec = LINUX_LOG_POLL_NS;
+    while (AtomicLoadU32(&Writer->Running))
+    {
+        LinuxFlushLog(Writer);
+        nanosleep(&PollTime, 0);
+    }
+    LinuxFlushLog(Writer);
+
+    return 0;
+}
+
+internal bool32
+LinuxStartLogWriter(linux_log_writer *Writer, int FileHandle)
+{
+    bool32 Result = false;
+
+    memory_index RingsSize = LINUX_LOG_MAX_RINGS*sizeof(log_ring) + 64;
+    void *RingsMemory = mmap(0, RingsSize, PROT_READ|PROT_WRITE,
+                             MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (RingsMemory != MAP_FAILED)
+    {
+        memory_arena Arena;
+        InitializeArena(&Arena, RingsSize, RingsMemory);
+        InitializeLog(&Writer->Log, LINUX_LOG_MAX_RINGS, &Arena);
+
+        Writer->FileHandle = FileHandle;
+        Writer->Running = true;
+        if (pthread_create(&Writer->Thread, 0, LinuxLogThreadProc, Writer) == 0)
+        {
+            Result = true;
+        }
+        else
+        {
+            GlobalLog = 0;
+            munmap(RingsMemory, RingsSize);
+        }
+    }
+
+    return Result;
+}
+
+internal void
+LinuxStopLogWriter(linux_log_writer *Writer)
+{
+    AtomicStoreU32(&Writer->Running, false);
+    pthread_join(Writer->Thread, 0);
+    GlobalLog = 0;
+}
+
+// NOTE: Headless audio device. Drains the mixer's ring at the real sample
+// rate by wall clock, as a sound card would, and writes what it gets to a WAV
+// file. When the ring runs dry it writes silence and counts the underrun, so
+// the file stays in step with time and gaps are audible.
+#define LINUX_AUDIO_POLL_NS 5000000
+#define LINUX_AUDIO_READ_FRAMES 1024
+
+struct linux_audio_writer
+{
+    audio_ring *Ring;
+    int FileHandle;
+    u32 volatile Running;
+    pthread_t Thread;
+
+    u64 FramesWritten;
+    u64 UnderrunFrames;
+
+    i16 Samples[2*LINUX_AUDIO_READ_FRAMES];
+};
+
+internal void
+LinuxWriteWAVHeader(int FileHandle, u32 FrameCount)
+{
+    u32 DataSize = FrameCount*2*sizeof(i16);
+    wav_format Format = {};
+    Format.FormatTag = 1;
+    Format.ChannelCount = 2;
+    Format.SamplesPerSecond = AUDIO_SAMPLES_PER_SECOND;
+    Format.BytesPerSecond = AUDIO_SAMPLES_PER_SECOND*2*sizeof(i16);
+    Format.BlockAlign = 2*sizeof(i16);
+    Format.BitsPerSample = 16;
+
+    u8 Header[12 + sizeof(wav_chunk_header) + sizeof(wav_format) + sizeof(wav_chunk_header)];
+    u32 *Riff = (u32 *)Header;
+    Riff[0] = RIFF_CODE('R', 'I', 'F', 'F');
+    Riff[1] = (u32)(sizeof(Header) - 8) + DataSize;
+    Riff[2] = RIFF_CODE('W', 'A', 'V', 'E');
+    wav_chunk_header *FormatChunk = (wav_chunk_header *)(Header + 12);
+    FormatChunk->Id = RIFF_CODE('f', 'm', 't', ' ');
+    FormatChunk->Size = sizeof(wav_format);
+    memcpy(FormatChunk + 1, &Format, sizeof(Format));
+    wav_chunk_header *DataChunk = (wav_chunk_header *)(Header + 12 + sizeof(wav_chunk_header) + sizeof(wav_format));
+    DataChunk->Id = RIFF_CODE('d', 'a', 't', 'a');
+    DataChunk->Size = DataSize;
+
+    pwrite(FileHandle, Header, sizeof(Header), 0);
+}
+
+internal void
+LinuxWriteAudioFrames(linux_audio_writer *Writer, u32 FrameCount, bool32 PadWithSilence)
+{
+    while (FrameCount)
+    {
+        u32 ChunkFrames = (FrameCount < LINUX_AUDIO_READ_FRAMES) ? FrameCount : LINUX_AUDIO_READ_FRAMES;
+        u32 FramesRead = AudioRingRead(Writer->Ring, Writer->Samples, ChunkFrames);
+        if (FramesRead < ChunkFrames)
+        {
+            if (!PadWithSilence)
+            {
+                ChunkFrames = FramesRead;
+                FrameCount = ChunkFrames;
+            }
+            memset(Writer->Samples + 2*FramesRead, 0, (ChunkFrames - FramesRead)*2*sizeof(i16));
+            Writer->UnderrunFrames += ChunkFrames - FramesRead;
+        }
+
+        ssize_t BytesWritten = write(Writer->FileHandle, Writer->Samples, ChunkFrames*2*sizeof(i16));
+        if (BytesWritten > 0)
+        {
+            Writer->FramesWritten += (u64)BytesWritten / (2*sizeof(i16));
+        }
+        FrameCount -= ChunkFrames;
+    }
+}
+
+internal void *
+LinuxAudioThreadProc(void *Parameter)
+{
+    linux_audio_writer *Writer = (linux_audio_writer *)Parameter;
+
+    timespec PollTime;
+    PollTime.tv_sec = 0;
+    PollTime.tv_nsec = LINUX_AUDIO_POLL_NS;
+
+    // NOTE: The clock starts with the first mixed audio, not thread start
+    while (AtomicLoadU32(&Writer->Running) && (AudioRingQueuedFrames(Writer->Ring) == 0))
+    {
+        nanosleep(&PollTime, 0);
+    }
+    u64 StartClock = LinuxGetWallClock();
+
+    while (AtomicLoadU32(&Writer->Running))
+    {
+        u64 FramesDue = (LinuxGetWallClock() - StartClock)*AUDIO_SAMPLES_PER_SECOND / 1000000000ull;
+        if (FramesDue > Writer->FramesWritten)
+        {
+            LinuxWriteAudioFrames(Writer, (u32)(FramesDue - Writer->FramesWritten), true);
+        }
+        nanosleep(&PollTime, 0);
+    }
+
+    // NOTE: Whatever was mixed ahead still plays out
+    LinuxWriteAudioFrames(Writer, AudioRingQueuedFrames(Writer->Ring), false);
+    LinuxWriteWAVHeader(Writer->FileHandle, (u32)Writer->FramesWritten);
+
+    return 0;
+}
+
+internal bool32
+LinuxStartAudioWriter(linux_audio_writer *Writer, char *Path)
+{
+    bool32 Result = false;
+
+    Writer->Ring = (audio_ring *)calloc(1, sizeof(audio_ring));
+    Writer->FileHandle = open(Path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (Writer->Ring && (Writer->FileHandle >= 0))
+    {
+        LinuxWriteWAVHeader(Writer->FileHandle, 0);
+        lseek(Writer->FileHandle, 0, SEEK_END);
+
+        Writer->Running = true;
+        if (pthread_create(&Writer->Thread, 0, LinuxAudioThreadProc, Writer) == 0)
+        {
+            Result = true;
+        }
+    }
+
+    return Result;
+}
+
+internal void
+LinuxStopAudioWriter(linux_audio_writer *Writer)
+{
+    AtomicStoreU32(&Writer->Running, false);
+    pthread_join(Writer->Thread, 0);
+    close(Writer->FileHandle);
+}
+
+// NOTE: Appends Count numbers and a newline to Text, Stride apart
+inline char *
+LinuxFormatHeatmapRow(char *Text, void *Values, i32 Count, i32 Stride, bool32 Wide)
+{
+    for (i32 Index = 0;
+         Index < Count;
+         ++Index)
+    {
+        u32 Value = Wide ? ((u16 *)Values)[Index*Stride] : ((u8 *)Values)[Index*Stride];
+        Text += sprintf(Text, (Index + 1 < Count) ? "%u " : "%u\n", Value);
+    }
+    return Text;
+}
+
+// NOTE: The last frame's heatmap as plain text arrays: PREFIX.steps.txt is
+// one line of ray steps per screen column, PREFIX.writes.txt a line of
+// pixel write counts per screen row
+internal bool32
+LinuxWriteHeatmapDump(render_heatmap *Heatmap, char *Prefix)
+{
+    bool32 Result = false;
+    if (Heatmap->PixelWrites)
+    {
+        i32 Width = Heatmap->Width;
+        i32 Height = Heatmap->Height;
+        // NOTE: At most five digits and a separator a number
+        char *Text = (char *)malloc((memory_index)Width*(Height + 1)*6 + 1);
+        if (Text)
+        {
+            char Filename[PATH_MAX];
+            snprintf(Filename, sizeof(Filename), "%s.steps.txt", Prefix);
+            char *End = LinuxFormatHeatmapRow(Text, Heatmap->ColumnSteps, Width, 1, true);
+            Result = PLATFORMWriteEntireFile(Filename, (u32)(End - Text), Text);
+
+            End = Text;
+            for (i32 Y = 0;
+                 Y < Height;
+                 ++Y)
+            {
+                End = LinuxFormatHeatmapRow(End, Heatmap->PixelWrites + (memory_index)Y*Width, Width, 1, false);
+            }
+            snprintf(Filename, sizeof(Filename), "%s.writes.txt", Prefix);
+            Result = PLATFORMWriteEntireFile(Filename, (u32)(End - Text), Text) && Result;
+            free(Text);
+        }
+    }
+    return Result;
+}
+
+#include "linux_rayc_output.cpp"
+#include "linux_rayc_work_queue.cpp"
+#include "linux_rayc_snapshot.cpp"
+
+int
+main(int ArgCount, char **Args)
+{
+    int ClientWidth = 1600;
+    int ClientHeight = 900;
+    i32 FrameCount = 600;
+    f32 TargetFramesPerSecond = 60.0f;
+    bool32 Pipelined = true;
+    render_engine Engine = RenderEngine_Raycast;
+    bool32 UseShmOutput = false;
+    char *ShmName = 0;
+    char *RecordPath = 0;
+    char *LogPath = 0;
+    char *AudioPath = 0;
+    heatmap_mode Heatmap = HeatmapMode_Off;
+    char *HeatmapDumpPrefix = 0;
+
+    for (int ArgIndex = 1;
+         ArgIndex < ArgCount;
+         ++ArgIndex)
+    {
+        char *Arg = Args[ArgIndex];
+        bool32 HasValue = (ArgIndex + 1 < ArgCount);
+        if (strcmp(Arg, "-frames") == 0 && HasValue)
+        {
+            FrameCount = atoi(Args[++ArgIndex]);
+        }
+        else if (strcmp(Arg, "-fps") == 0 && HasValue)
+        {
+            TargetFramesPerSecond = (f32)atof(Args[++ArgIndex]);
+        }
+        else if (strcmp(Arg, "-shm") == 0 && HasValue)
+        {
+            UseShmOutput = true;
+            ShmName = Args[++ArgIndex];
+        }
+        else if (strcmp(Arg, "-memfd") == 0)
+        {
+            UseShmOutput = true;
+            ShmName = 0;
+        }
+        else if (strcmp(Arg, "-record") == 0 && HasValue)
+        {
+            RecordPath = Args[++ArgIndex];
+        }
+        else if (strcmp(Arg, "-log") == 0 && HasValue)
+        {
+            LogPath = Args[++ArgIndex];
+        }
+        else if (strcmp(Arg, "-audio") == 0 && HasValue)
+        {
+            AudioPath = Args[++ArgIndex];
+        }
+        else if (strcmp(Arg, "-serial") == 0)
+        {
+            Pipelined = false;
+        }
+        else if (strcmp(Arg, "-faces") == 0)
+        {
+            Engine = RenderEngine_Faces;
+        }
+        else if (strcmp(Arg, "-heatmap") == 0 && HasValue)
+        {
+            char *Mode = Args[++ArgIndex];
+            Heatmap = ((strcmp(Mode, "overdraw") == 0) ? HeatmapMode_Overdraw :
+                       (strcmp(Mode, "cost") == 0) ? HeatmapMode_ColumnCost : HeatmapMode_Off);
+        }
+        else if (strcmp(Arg, "-heatdump") == 0 && HasValue)
+        {
+            HeatmapDumpPrefix = Args[++ArgIndex];
+        }
+        else if (strcmp(Arg, "-v") == 0)
+        {
+            GlobalVerbose = true;
+        }
+        else
+        {
+            fprintf(stderr,
+                    "Usage: %s [-frames N] [-fps N] [-serial] [-faces] [-v] [-log FILE] [-audio FILE.wav]\n"
+                    "          [-heatmap cost|overdraw] [-heatdump PREFIX]\n"
+                    "          [-shm NAME | -memfd | -record FILE.y4m|FILE.ppm|-|\"|command\"]\n",
+                    Args[0]);
+            return 1;
+        }
+    }
+
+    // NOTE: -log sends the log to a file, -v alone sends it to stderr. With
+    // neither there's no writer and LogPrint returns straight away.
+    local_persist linux_log_writer LogWriter;
+    bool32 Logging = false;
+    if (LogPath || GlobalVerbose)
+    {
+        int LogHandle = LogPath ? open(LogPath, O_WRONLY|O_CREAT|O_TRUNC, 0644) : STDERR_FILENO;
+        if (LogHandle >= 0)
+        {
+            Logging = LinuxStartLogWriter(&LogWriter, LogHandle);
+        }
+        if (!Logging)
+        {
+            fprintf(stderr, "Could not start logging to %s\n", LogPath ? LogPath : "stderr");
+        }
+    }
+
+    game_offscreen_buffer GameBuffer = {};
+    GameBuffer.Width = ClientWidth;
+    GameBuffer.Height = ClientHeight;
+    GameBuffer.BytesPerPixel = 4;
+    GameBuffer.Pitch = GameBuffer.Width * GameBuffer.BytesPerPixel;
+    int GameBufferSize = (GameBuffer.Width * GameBuffer.Height) * GameBuffer.BytesPerPixel;
+    GameBuffer.Data = mmap(0, GameBufferSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (GameBuffer.Data == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not allocate the game buffer\n");
+        return 1;
+    }
+
+    output_sink *Sink = 0;
+    if (UseShmOutput)
+    {
+        Sink = LinuxOpenShmOutputSink(ShmName, ClientWidth, ClientHeight);
+    }
+    else if (RecordPath)
+    {
+        Sink = LinuxOpenStreamOutputSink(RecordPath, ClientWidth, ClientHeight, TargetFramesPerSecond);
+    }
+
+    // NOTE: Anonymous mappings come back zeroed and are only committed as
+    // they're touched, so reserving generously costs nothing up front.
+    game_memory GameMemory = {};
+    GameMemory.PermanentStorageSize = Gigabytes(1);
+    GameMemory.TransientStorageSize = Megabytes(256);
+    u64 TotalStorageSize = GameMemory.PermanentStorageSize + GameMemory.TransientStorageSize;
+    GameMemory.PermanentStorage = mmap(0, TotalStorageSize, PROT_READ|PROT_WRITE,
+                                       MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (GameMemory.PermanentStorage == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not allocate game memory\n");
+        return 1;
+    }
+    GameMemory.TransientStorage = (u8 *)GameMemory.PermanentStorage + GameMemory.PermanentStorageSize;
+
+    LinuxStartWorkQueue(&GlobalWorkQueue, LinuxGetSpareCoreCount());
+
+    game_state *GameState = GameStateInit(&GameMemory);
+    render_state *RenderState = RenderStateInit(&GameMemory);
+    RenderState->Engine = Engine;
+    RenderState->Heatmap.Mode = Heatmap;
+    RenderState->Heatmap.Record = (HeatmapDumpPrefix != 0);
+
+    local_persist linux_audio_writer AudioWriter;
+    bool32 Audio = false;
+    if (AudioPath)
+    {
+        Audio = LinuxStartAudioWriter(&AudioWriter, AudioPath);
+        if (!Audio)
+        {
+            fprintf(stderr, "Could not start audio output to %s\n", AudioPath);
+        }
+    }
+
+    f32 TargetSecondsPerFrame = 1.0f / TargetFramesPerSecond;
+    GlobalGameInput.SecondsElapsed = TargetSecondsPerFrame;
+
+    linux_frame_pacer Pacer;
+    LinuxInitFramePacer(&Pacer, TargetSecondsPerFrame);
+
+    u64 StartCounter = LinuxGetWallClock();
+    u64 LastCounter = StartCounter;
+    f32 TotalWorkSeconds = 0.0f;
+
+    AtomicStoreU32(&GlobalRunning, true);
+
+    frame_pipeline *Pipeline = (frame_pipeline *)calloc(1, sizeof(frame_pipeline));
+    InitializeFramePipeline(Pipeline, GameState, RenderState);
+
+    // NOTE: Taken once everything the sim allocates exists; getting caught
+    // puts the whole simulation back to exactly this point
+    linux_state_snapshot StateSnapshot;
+    bool32 CanRestart = LinuxCaptureStateSnapshot(&StateSnapshot, GameState, GameStateSnapshotSize(GameState));
+    if (!CanRestart)
+    {
+        fprintf(stderr, "Could not snapshot the game state, restarts are off\n");
+    }
+    u32 RestartCount = 0;
+    u64 MaxRestartNanoseconds = 0;
+    linux_sim_thread_context SimThreadContext = {Pipeline, GameState};
+    pthread_t SimThread;
+    if (Pipelined)
+    {
+        if (pthread_create(&SimThread, 0, LinuxSimThreadProc, &SimThreadContext) == 0)
+        {
+            // NOTE: Prime the pipeline so there's a snapshot to draw on frame 0
+            LinuxSubmitSimFrame(Pipeline, &GlobalGameInput);
+            LinuxWaitForSimFrame(Pipeline);
+        }
+        else
+        {
+            fprintf(stderr, "Could not start the sim thread, running serially\n");
+            Pipelined = false;
+        }
+    }
+
+    for (i32 FrameIndex = 0;
+         AtomicLoadU32(&GlobalRunning) && (FrameIndex < FrameCount);
+         ++FrameIndex)
+    {
+        GlobalGameInput.MouseDX = 0;
+        GlobalGameInput.MouseDY = 0;
+        GlobalGameInput.MouseDZ = 0;
+
+        if (Sink)
+        {
+            GameBuffer = Sink->AcquireFrame(Sink);
+        }
+
+        if (Pipelined)
+        {
+            LinuxSubmitSimFrame(Pipeline, &GlobalGameInput);
+            render_snapshot *Snapshot = PipelineGetRenderSnapshot(Pipeline);
+            GameRender(GameState, RenderState, &Snapshot->View, &GameBuffer);
+            if (Audio)
+            {
+                GameMixAudio(GameState, RenderState, &Snapshot->View, AudioWriter.Ring);
+            }
+            LinuxWaitForSimFrame(Pipeline);
+        }
+        else
+        {
+            GameUpdateAndRender(GameState, RenderState, &GlobalGameInput, &GameBuffer);
+            if (Audio)
+            {
+                GameMixAudio(GameState, RenderState, &GameState->View, AudioWriter.Ring);
+            }
+        }
+
+        // NOTE: The sim stage is idle here, in either mode
+        if (CanRestart && GameState->PlayerCaught)
+        {
+            u64 RestartStart = LinuxGetWallClock();
+            if (LinuxRestoreStateSnapshot(&StateSnapshot))
+            {
+                u64 RestartNanoseconds = LinuxGetWallClock() - RestartStart;
+                if (RestartNanoseconds > MaxRestartNanoseconds)
+                {
+                    MaxRestartNanoseconds = RestartNanoseconds;
+                }
+                ++RestartCount;
+                if (Pipelined)
+                {
+                    PipelineRefreshRenderSnapshot(Pipeline, GameState);
+                }
+                LogPrint("Caught; restarted in %.1fus\n", (f32)RestartNanoseconds / 1000.0f);
+            }
+            else
+            {
+                fprintf(stderr, "Could not restore the game state snapshot\n");
+                AtomicStoreU32(&GlobalRunning, false);
+            }
+        }
+
+        u64 WorkCounter = LinuxGetWallClock();
+        f32 WorkSecondsElapsed = LinuxGetSecondsElapsed(LastCounter, WorkCounter);
+        TotalWorkSeconds += WorkSecondsElapsed;
+        LinuxPauseUntilFrameTime(&Pacer, LastCounter);
+        u64 EndCounter = LinuxGetWallClock();
+        f32 SecondsElapsedForFrame = LinuxGetSecondsElapsed(LastCounter, EndCounter);
+        LastCounter = EndCounter;
+        GlobalGameInput.SecondsElapsed = SecondsElapsedForFrame;
+
+        if (Sink)
+        {
+            Sink->SubmitFrame(Sink);
+        }
+
+        LogPrint("Frame=%.2fms; Work=%.2fms; Spin=%.0fus\n",
+                 SecondsElapsedForFrame * 1000.0f,
+                 WorkSecondsElapsed * 1000.0f,
+                 (f32)Pacer.SpinThresholdNanoseconds / 1000.0f);
+    }
+
+    if (Pipelined)
+    {
+        PipelineRequestQuit(Pipeline);
+        LinuxWakeWaiters(&Pipeline->SimFramesRequested);
+        pthread_join(SimThread, 0);
+    }
+
+    if (RestartCount)
+    {
+        fprintf(stderr, "%u restarts, slowest %.1fus\n",
+                RestartCount, (f32)MaxRestartNanoseconds / 1000.0f);
+    }
+
+    if (Audio)
+    {
+        LinuxStopAudioWriter(&AudioWriter);
+        fprintf(stderr, "audio: %.2fs written, %llu frames of underrun\n",
+                (f32)AudioWriter.FramesWritten / (f32)AUDIO_SAMPLES_PER_SECOND,
+                (unsigned long long)AudioWriter.UnderrunFrames);
+    }
+
+    if (Logging)
+    {
+        LinuxStopLogWriter(&LogWriter);
+        if (LogWriter.FileHandle != STDERR_FILENO)
+        {
+            close(LogWriter.FileHandle);
+        }
+    }
+
+    f32 TotalSeconds = LinuxGetSecondsElapsed(StartCounter, LastCounter);
+    fprintf(stderr, "%d frames in %.2fs; work %.2fms/frame; %u ticks; %u missed\n",
+            FrameCount, TotalSeconds,
+            TotalWorkSeconds * 1000.0f / (f32)FrameCount,
+            (u32)GameState->SimTickCount, Pacer.MissedFrames);
+
+    if (HeatmapDumpPrefix)
+    {
+        render_heatmap *LastHeatmap = &RenderState->Heatmap;
+        if (LinuxWriteHeatmapDump(LastHeatmap, HeatmapDumpPrefix))
+        {
+            fprintf(stderr, "heatmap: %dx%d; ray steps avg %.1f max %u; writes avg %.2f max %u\n",
+                    LastHeatmap->Width, LastHeatmap->Height,
+                    (f64)LastHeatmap->TotalSteps / (f64)LastHeatmap->Width, LastHeatmap->MaxSteps,
+                    (f64)LastHeatmap->TotalWrites / (f64)(LastHeatmap->Width*LastHeatmap->Height),
+                    LastHeatmap->MaxWrites);
+        }
+        else
+        {
+            fprintf(stderr, "Could not write the heatmap to %s.*\n", HeatmapDumpPrefix);
+        }
+    }
+
+    if (Sink)
+    {
+        output_sink_totals Totals = Sink->Close(Sink);
+        if (RecordPath)
+        {
+            fprintf(stderr, "%llu frames submitted, %llu written\n",
+                    (unsigned long long)Totals.FramesSubmitted,
+                    (unsigned long long)Totals.FramesConsumed);
+        }
+    }
+
+    return 0;
+}
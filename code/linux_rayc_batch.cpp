@@ -0,0 +1,471 @@
+#include "rayc.cpp"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <limits.h>
+#include <pthread.h>
+
+// NOTE: Headless batch runner for balancing and bot testing. Steps many
+// independent matches, each a complete game_state in its own memory, across
+// worker threads. Nothing is shared between instances: each has its own
+// storage, its own input (a scripted bot or its own slice of an input stream)
+// and, when rendering, each worker has its own render state and buffer.
+//
+//   linux_rayc_batch [-instances N] [-ticks N] [-threads N] [-robots N]
+//                    [-inputs FILE] [-dump-inputs FILE] [-render N] [-scaling]
+//
+// -inputs replays a file of raw game_input records, one per tick; instance I
+// starts I*INPUT_STREAM_PHASE records in so matches don't move in lockstep.
+// -dump-inputs writes instance 0's bot input in that format. -render N draws
+// every Nth tick of every instance. -scaling reruns the batch with 1, 2, 4...
+// up to -threads workers.
+
+#define BATCH_INSTANCE_STORAGE_SIZE Megabytes(4)
+#define BATCH_RENDER_STORAGE_SIZE Megabytes(64)
+#define BATCH_INSTANCES_PER_CLAIM 4
+#define INPUT_STREAM_PHASE 7919
+
+internal void
+DEBUGPrintString(const char *Format, ...)
+{
+}
+
+#include "linux_rayc_file.cpp"
+
+// NOTE: Each batch worker builds its own render state, so startup jobs just
+// run on the thread that asks for them
+internal void
+PLATFORMAddWork(platform_work_callback *Callback, void *Data)
+{
+    Callback(Data);
+}
+
+internal void
+PLATFORMCompleteAllWork(void)
+{
+}
+
+inline u64
+BatchGetWallClock(void)
+{
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    u64 Result = (u64)Now.tv_sec*1000000000ULL + (u64)Now.tv_nsec;
+    return Result;
+}
+
+inline u32
+BatchRandom(u32 *Seed)
+{
+    // NOTE: xorshift32
+    u32 X = *Seed;
+    X ^= X << 13;
+    X ^= X >> 17;
+    X ^= X << 5;
+    *Seed = X;
+    return X;
+}
+
+struct batch_bot
+{
+    u32 Seed;
+    i32 TurnCounts;
+    u32 TurnTicksLeft;
+};
+
+internal void
+BatchBotInput(game_state *State, batch_bot *Bot, game_input *Input)
+{
+    // NOTE: Wanders. Walks forward, turns away for a while when a wall is
+    // ahead, now and then turns or jumps on its own.
+    *Input = {};
+    Input->SecondsElapsed = SIM_SECONDS_PER_TICK;
+    Input->Forward = true;
+
+    f32 ProbeDistance = 0.5f;
+    i32 AheadX = TruncateF32ToI32(State->PlayerX + ProbeDistance*cosf(State->PlayerAngle));
+    i32 AheadY = TruncateF32ToI32(State->PlayerY - ProbeDistance*sinf(State->PlayerAngle));
+    u32 Roll = BatchRandom(&Bot->Seed);
+    if ((Bot->TurnTicksLeft == 0) &&
+        (IsTileBlockedForPlayer(State, AheadX, AheadY) || ((Roll % 200) == 0)))
+    {
+        Bot->TurnCounts = (Roll & 0x100) ? 60 : -60;
+        Bot->TurnTicksLeft = 20 + ((Roll >> 9) % 40);
+    }
+
+    if (Bot->TurnTicksLeft)
+    {
+        Input->MouseDX = Bot->TurnCounts;
+        --Bot->TurnTicksLeft;
+    }
+    Input->Jump = (((Roll >> 16) % 300) == 0);
+}
+
+internal void
+SpawnBatchRobots(game_state *State, u32 RobotCount, u32 *Seed)
+{
+    // NOTE: On open cells other than the player's, on top of the one
+    // GameStateInit places
+    game_map *Map = &State->Map;
+    i32 PlayerTileX = TruncateF32ToI32(State->PlayerX);
+    i32 PlayerTileY = TruncateF32ToI32(State->PlayerY);
+    u32 Attempts = 0;
+    while ((State->Entities.Count < RobotCount) &&
+           (State->Entities.Count < State->Entities.Capacity) &&
+           (Attempts++ < 1000*RobotCount))
+    {
+        i32 TileX = (i32)(BatchRandom(Seed) % (u32)Map->Width);
+        i32 TileY = (i32)(BatchRandom(Seed) % (u32)Map->Height);
+        if (!IsTileSolid(Map, TileX, TileY) && ((TileX != PlayerTileX) || (TileY != PlayerTileY)))
+        {
+            AddEntity(&State->Entities, (f32)TileX + 0.5f, (f32)TileY + 0.5f);
+        }
+    }
+}
+
+struct batch_instance_result
+{
+    // NOTE: First tick a robot got within PLAYER_CATCH_DISTANCE, or the tick
+    // count if none did
+    u32 CaughtTick;
+    bool32 Caught;
+    u32 FramesRendered;
+};
+
+struct batch
+{
+    u32 InstanceCount;
+    u32 TickCount;
+    u32 RobotCount;
+    u32 RenderEvery;
+
+    u8 *InstanceStorage;
+    batch_instance_result *Results;
+
+    game_input *InputStream;
+    u32 InputStreamCount;
+    game_input *DumpedInputs;
+
+    // NOTE: Workers claim BATCH_INSTANCES_PER_CLAIM at a time
+    volatile u32 NextInstance;
+};
+
+struct batch_worker
+{
+    batch *Batch;
+    pthread_t Thread;
+
+    // NOTE: Only set up when rendering
+    game_memory RenderMemory;
+    render_state *Render;
+    game_offscreen_buffer Buffer;
+};
+
+internal void
+RunBatchInstance(batch *Batch, batch_worker *Worker, u32 InstanceIndex)
+{
+    game_memory Memory = {};
+    Memory.PermanentStorageSize = BATCH_INSTANCE_STORAGE_SIZE;
+    Memory.PermanentStorage = Batch->InstanceStorage + (memory_index)InstanceIndex*BATCH_INSTANCE_STORAGE_SIZE;
+    // NOTE: Storage is reused across -scaling runs, and GameStateInit expects it zeroed
+    memset(Memory.PermanentStorage, 0, sizeof(game_state));
+
+    game_state *State = GameStateInit(&Memory);
+    u32 Seed = 0x9E3779B9u ^ (InstanceIndex*0x85EBCA6Bu + 1);
+    SpawnBatchRobots(State, Batch->RobotCount, &Seed);
+
+    batch_bot Bot = {};
+    Bot.Seed = Seed;
+    batch_instance_result *Result = &Batch->Results[InstanceIndex];
+    *Result = {};
+    Result->CaughtTick = Batch->TickCount;
+
+    f32 dt = SIM_SECONDS_PER_TICK;
+    for (u32 Tick = 0;
+         Tick < Batch->TickCount;
+         ++Tick)
+    {
+        game_input Input;
+        if (Batch->InputStream)
+        {
+            u64 StreamIndex = ((u64)InstanceIndex*INPUT_STREAM_PHASE + Tick) % Batch->InputStreamCount;
+            Input = Batch->InputStream[StreamIndex];
+        }
+        else
+        {
+            BatchBotInput(State, &Bot, &Input);
+        }
+        if (Batch->DumpedInputs && (InstanceIndex == 0))
+        {
+            Batch->DumpedInputs[Tick] = Input;
+        }
+
+        ProcessMouseLook(State, &Input);
+        SimulateTick(State, &Input, dt);
+
+        if (!Result->Caught && State->PlayerCaught)
+        {
+            Result->Caught = true;
+            Result->CaughtTick = Tick;
+        }
+
+        if (Worker->Render && ((Tick % Batch->RenderEvery) == 0))
+        {
+            FillRenderView(State, &State->View, 1.0f);
+            GameRender(State, Worker->Render, &State->View, &Worker->Buffer);
+            ++Result->FramesRendered;
+        }
+    }
+}
+
+internal void *
+BatchWorkerProc(void *Parameter)
+{
+    batch_worker *Worker = (batch_worker *)Parameter;
+    batch *Batch = Worker->Batch;
+    for (;;)
+    {
+        u32 FirstInstance = __sync_fetch_and_add(&Batch->NextInstance, BATCH_INSTANCES_PER_CLAIM);
+        if (FirstInstance >= Batch->InstanceCount)
+        {
+            break;
+        }
+
+        u32 EndInstance = FirstInstance + BATCH_INSTANCES_PER_CLAIM;
+        if (EndInstance > Batch->InstanceCount) EndInstance = Batch->InstanceCount;
+        for (u32 InstanceIndex = FirstInstance;
+             InstanceIndex < EndInstance;
+             ++InstanceIndex)
+        {
+            RunBatchInstance(Batch, Worker, InstanceIndex);
+        }
+    }
+
+    return 0;
+}
+
+internal bool32
+InitializeBatchWorkerRender(batch_worker *Worker)
+{
+    Worker->RenderMemory.TransientStorageSize = BATCH_RENDER_STORAGE_SIZE;
+    Worker->RenderMemory.TransientStorage = mmap(0, BATCH_RENDER_STORAGE_SIZE, PROT_READ|PROT_WRITE,
+                                                 MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    Worker->Buffer.Width = 1600;
+    Worker->Buffer.Height = 900;
+    Worker->Buffer.BytesPerPixel = 4;
+    Worker->Buffer.Pitch = Worker->Buffer.Width*Worker->Buffer.BytesPerPixel;
+    Worker->Buffer.Data = mmap(0, Worker->Buffer.Pitch*Worker->Buffer.Height, PROT_READ|PROT_WRITE,
+                               MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+
+    bool32 Result = ((Worker->RenderMemory.TransientStorage != MAP_FAILED) &&
+                     (Worker->Buffer.Data != MAP_FAILED));
+    if (Result)
+    {
+        Worker->Render = RenderStateInit(&Worker->RenderMemory);
+    }
+    return Result;
+}
+
+internal f64
+RunBatch(batch *Batch, batch_worker *Workers, u32 ThreadCount)
+{
+    // NOTE: Returns wall-clock seconds. The calling thread is worker 0.
+    Batch->NextInstance = 0;
+    u64 Start = BatchGetWallClock();
+    for (u32 WorkerIndex = 1;
+         WorkerIndex < ThreadCount;
+         ++WorkerIndex)
+    {
+        pthread_create(&Workers[WorkerIndex].Thread, 0, BatchWorkerProc, &Workers[WorkerIndex]);
+    }
+    BatchWorkerProc(&Workers[0]);
+    for (u32 WorkerIndex = 1;
+         WorkerIndex < ThreadCount;
+         ++WorkerIndex)
+    {
+        pthread_join(Workers[WorkerIndex].Thread, 0);
+    }
+    f64 Result = (f64)(BatchGetWallClock() - Start) / 1000000000.0;
+    return Result;
+}
+
+int
+main(int ArgCount, char **Args)
+{
+    batch Batch = {};
+    Batch.InstanceCount = 1000;
+    Batch.TickCount = 120*60;
+    Batch.RobotCount = 1;
+    u32 ThreadCount = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    char *InputPath = 0;
+    char *DumpPath = 0;
+    bool32 Scaling = false;
+    for (int ArgIndex = 1;
+         ArgIndex < ArgCount;
+         ++ArgIndex)
+    {
+        char *Arg = Args[ArgIndex];
+        bool32 HasValue = (ArgIndex + 1 < ArgCount);
+        if ((strcmp(Arg, "-instances") == 0) && HasValue)
+        {
+            Batch.InstanceCount = (u32)atoi(Args[++ArgIndex]);
+        }
+        else if ((strcmp(Arg, "-ticks") == 0) && HasValue)
+        {
+            Batch.TickCount = (u32)atoi(Args[++ArgIndex]);
+        }
+        else if ((strcmp(Arg, "-threads") == 0) && HasValue)
+        {
+            ThreadCount = (u32)atoi(Args[++ArgIndex]);
+        }
+        else if ((strcmp(Arg, "-robots") == 0) && HasValue)
+        {
+            Batch.RobotCount = (u32)atoi(Args[++ArgIndex]);
+        }
+        else if ((strcmp(Arg, "-inputs") == 0) && HasValue)
+        {
+            InputPath = Args[++ArgIndex];
+        }
+        else if ((strcmp(Arg, "-dump-inputs") == 0) && HasValue)
+        {
+            DumpPath = Args[++ArgIndex];
+        }
+        else if ((strcmp(Arg, "-render") == 0) && HasValue)
+        {
+            Batch.RenderEvery = (u32)atoi(Args[++ArgIndex]);
+        }
+        else if (strcmp(Arg, "-scaling") == 0)
+        {
+            Scaling = true;
+        }
+        else
+        {
+            fprintf(stderr,
+                    "Usage: %s [-instances N] [-ticks N] [-threads N] [-robots N]\n"
+                    "          [-inputs FILE] [-dump-inputs FILE] [-render N] [-scaling]\n",
+                    Args[0]);
+            return 1;
+        }
+    }
+    if (ThreadCount < 1) ThreadCount = 1;
+    if ((Batch.InstanceCount == 0) || (Batch.TickCount == 0))
+    {
+        fprintf(stderr, "Nothing to run\n");
+        return 1;
+    }
+
+    if (InputPath)
+    {
+        platform_read_file_result InputFile = PLATFORMReadEntireFile(InputPath);
+        Batch.InputStream = (game_input *)InputFile.Contents;
+        Batch.InputStreamCount = InputFile.ContentsSize / sizeof(game_input);
+        if (Batch.InputStreamCount == 0)
+        {
+            fprintf(stderr, "Could not read any input records from %s\n", InputPath);
+            return 1;
+        }
+    }
+    if (DumpPath)
+    {
+        Batch.DumpedInputs = (game_input *)calloc(Batch.TickCount, sizeof(game_input));
+    }
+
+    // NOTE: Reserved, not committed; each instance only touches the few
+    // hundred KB its game_state actually uses
+    memory_index InstanceStorageSize = (memory_index)Batch.InstanceCount*BATCH_INSTANCE_STORAGE_SIZE;
+    Batch.InstanceStorage = (u8 *)mmap(0, InstanceStorageSize, PROT_READ|PROT_WRITE,
+                                       MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    Batch.Results = (batch_instance_result *)calloc(Batch.InstanceCount, sizeof(batch_instance_result));
+    batch_worker *Workers = (batch_worker *)calloc(ThreadCount, sizeof(batch_worker));
+    if ((Batch.InstanceStorage == MAP_FAILED) || !Batch.Results || !Workers)
+    {
+        fprintf(stderr, "Could not allocate %u instances\n", Batch.InstanceCount);
+        return 1;
+    }
+
+    for (u32 WorkerIndex = 0;
+         WorkerIndex < ThreadCount;
+         ++WorkerIndex)
+    {
+        batch_worker *Worker = &Workers[WorkerIndex];
+        Worker->Batch = &Batch;
+        if (Batch.RenderEvery && !InitializeBatchWorkerRender(Worker))
+        {
+            fprintf(stderr, "Could not allocate render memory\n");
+            return 1;
+        }
+    }
+
+    printf("%u instances, %u ticks each, %u robots, %s input%s\n",
+           Batch.InstanceCount, Batch.TickCount, Batch.RobotCount,
+           InputPath ? "stream" : "bot", Batch.RenderEvery ? ", rendering" : "");
+    printf("%8s %10s %14s %14s\n", "threads", "seconds", "ticks/s", "per thread");
+
+    u32 FirstThreadCount = Scaling ? 1 : ThreadCount;
+    for (u32 RunThreadCount = FirstThreadCount;
+         ;
+         RunThreadCount *= 2)
+    {
+        if (RunThreadCount > ThreadCount) RunThreadCount = ThreadCount;
+
+        f64 Seconds = RunBatch(&Batch, Workers, RunThreadCount);
+        f64 TicksPerSecond = (f64)Batch.InstanceCount*(f64)Batch.TickCount / Seconds;
+        printf("%8u %10.2f %14.0f %14.0f\n", RunThreadCount, Seconds,
+               TicksPerSecond, TicksPerSecond / (f64)RunThreadCount);
+
+        if (RunThreadCount == ThreadCount)
+        {
+            break;
+        }
+    }
+
+    u32 CaughtCount = 0;
+    u64 CaughtTicks = 0;
+    u64 FramesRendered = 0;
+    for (u32 InstanceIndex = 0;
+         InstanceIndex < Batch.InstanceCount;
+         ++InstanceIndex)
+    {
+        batch_instance_result *Result = &Batch.Results[InstanceIndex];
+        if (Result->Caught)
+        {
+            ++CaughtCount;
+            CaughtTicks += Result->CaughtTick;
+        }
+        FramesRendered += Result->FramesRendered;
+    }
+    printf("caught in %u of %u matches", CaughtCount, Batch.InstanceCount);
+    if (CaughtCount)
+    {
+        printf(", after %.2fs on average", (f64)CaughtTicks / (f64)CaughtCount * SIM_SECONDS_PER_TICK);
+    }
+    printf("\n");
+    if (Batch.RenderEvery)
+    {
+        printf("%llu frames rendered\n", (unsigned long long)FramesRendered);
+    }
+
+    if (DumpPath)
+    {
+        FILE *DumpFile = fopen(DumpPath, "wb");
+        if (!DumpFile ||
+            (fwrite(Batch.DumpedInputs, sizeof(game_input), Batch.TickCount, DumpFile) != Batch.TickCount))
+        {
+            fprintf(stderr, "Could not write %s\n", DumpPath);
+        }
+        if (DumpFile)
+        {
+            fclose(DumpFile);
+        }
+    }
+
+    return 0;
+}
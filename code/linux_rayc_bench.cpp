@@ -0,0 +1,2807 @@
+#include "rayc.cpp"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#include <pthread.h>
+#include <ftw.h>
+
+#include "linux_rayc_snapshot.cpp"
+
+// NOTE: Offline benchmarks. Not part of the game; builds against the same
+// unity file with its own copy of the platform calls.
+//
+//   linux_rayc_bench [-suite entities|primitives|restart|pvs|render|textures|occupancy|lighting|scheduler|levelgen|all] [-ticks N] [-map SIZE]
+//                    [-level maze|cave|arena] [-seed N] [-csv]
+//
+// entities: robot counts from 1k to 1M, all chasing across a large open map
+// with a finished flow field. Times the SIMD steer+move kernels against a
+// straight scalar version of the same logic and reports ns per robot per tick.
+//
+// primitives: each drawing primitive and the ray caster on its own, over a
+// spread of sizes, clipping cases, textures and ray angles. Reports ns per
+// call, ns per pixel written and bytes moved per TSC cycle. Run it with -csv
+// on two commits and diff to see which kernel moved.
+//
+// restart: a whole game state (SIZE map, up to 1M robots, flow field) put
+// back to a snapshot after some ticks, by memcpy and by remapping the memfd
+// snapshot the game uses. Reports the restore itself and the first tick after
+// it, which should cost about a steady tick either way: the remap pre-faults
+// the pages the sim writes inside the restore.
+//
+// pvs: potentially visible sets on mazes of rooms and doorways: build time
+// and size, then robot perception over 100k robots with and without them.
+//
+// render: the walls of the 3D view drawn by the ray caster and by the face
+// sweep, from the same random views of an open map and of mazes with and
+// without steps and grates, and lit, each at 1/8 up to all of the game's
+// columns. Reports time per frame for each engine, the ray caster's cells
+// walked against the sweep's cells, faces and column draws, and how many
+// pixels and rays came out different (should be none).
+//
+// textures: startup texture loading over a couple of thousand BMP and PNG
+// files, cold (decode everything) and warm (all from the decoded cache), on
+// one thread and then on the work queue. Checks every texture against its
+// source's pixels. Run it from data/.
+//
+// occupancy: grid walks to the first wall along rows, columns, diagonals and
+// random angles on maps up to 16k square, asking the byte tiles and then the
+// packed occupancy grid. Reports ns per cell stepped and checks both stop on
+// the same cell.
+//
+// lighting: face lightmaps for 16 lights on a 256 maze. A full bake, then
+// lights toggled, moved and recoloured and walls opened and closed, each
+// relit incrementally and checked luxel for luxel against a full rebake.
+//
+// scheduler: the timing wheel with 1k to 64k pending timers. Reports insert
+// and cancel cost, then ticks where nothing fires and ticks draining a mix of
+// one-shot and repeating timers, each against scanning a flat list of fire
+// ticks every tick. Checks every timer fires on its tick, exactly once.
+//
+// levelgen: generated maze, cave and arena levels from 1k to 8k square with
+// 100k robot spawns, built as one job and then a strip a job on the work
+// queue. Checks both come out identical and that a full flow field from the
+// player reaches every open cell, then times some ticks of the robots
+// chasing across it.
+//
+// -level has the entities and restart suites run on a generated level of
+// that kind, seeded with -seed, instead of the open pillar map.
+
+internal void
+DEBUGPrintString(const char *Format, ...)
+{
+}
+
+#include "linux_rayc_file.cpp"
+
+#include "linux_rayc_work_queue.cpp"
+
+inline u64
+BenchGetWallClock(void)
+{
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    u64 Result = (u64)Now.tv_sec*1000000000ULL + (u64)Now.tv_nsec;
+    return Result;
+}
+
+inline u32
+BenchRandom(u32 *Seed)
+{
+    // NOTE: xorshift32
+    u32 X = *Seed;
+    X ^= X << 13;
+    X ^= X >> 17;
+    X ^= X << 5;
+    *Seed = X;
+    return X;
+}
+
+//
+// NOTE: Scalar reference, one robot at a time, same results as the kernels
+//
+
+internal void
+SteerRobotsScalar(entity_store *Store, flow_field *Field,
+                  f32 PlayerX, f32 PlayerY, f32 Speed, f32 StopDistance)
+{
+    i32 PlayerTileX = TruncateF32ToI32(PlayerX);
+    i32 PlayerTileY = TruncateF32ToI32(PlayerY);
+    for (u32 Index = 0;
+         Index < Store->Count;
+         ++Index)
+    {
+        f32 X = Store->X[Index];
+        f32 Y = Store->Y[Index];
+        i32 TileX = TruncateF32ToI32(X);
+        i32 TileY = TruncateF32ToI32(Y);
+
+        bool32 HasTarget = true;
+        f32 TargetX = PlayerX;
+        f32 TargetY = PlayerY;
+        if ((TileX != PlayerTileX) || (TileY != PlayerTileY))
+        {
+            u32 Direction = GetFlowDirection(Field, TileX, TileY);
+            HasTarget = (Direction != FLOW_FIELD_NO_DIRECTION);
+            if (HasTarget)
+            {
+                TargetX = (f32)(TileX + FlowDirectionDX[Direction]) + 0.5f;
+                TargetY = (f32)(TileY + FlowDirectionDY[Direction]) + 0.5f;
+            }
+        }
+
+        f32 ToPlayerX = PlayerX - X;
+        f32 ToPlayerY = PlayerY - Y;
+        f32 DX = TargetX - X;
+        f32 DY = TargetY - Y;
+        f32 LengthSq = DX*DX + DY*DY;
+
+        f32 VelocityX = 0.0f;
+        f32 VelocityY = 0.0f;
+        if ((Store->AIState[Index] == EntityAI_Chasing) && HasTarget &&
+            (ToPlayerX*ToPlayerX + ToPlayerY*ToPlayerY >= StopDistance*StopDistance) &&
+            (LengthSq > 1.0e-8f))
+        {
+            f32 Scale = Speed / sqrtf(LengthSq);
+            VelocityX = DX*Scale;
+            VelocityY = DY*Scale;
+            Store->Heading[Index] = atan2f(-DY, DX);
+        }
+        Store->VelocityX[Index] = VelocityX;
+        Store->VelocityY[Index] = VelocityY;
+    }
+}
+
+internal void
+MoveEntitiesScalar(entity_store *Store, game_map *Map, f32 dt, f32 CollisionRadius)
+{
+    for (u32 Index = 0;
+         Index < Store->Count;
+         ++Index)
+    {
+        f32 X = Store->X[Index];
+        f32 Y = Store->Y[Index];
+        f32 VelocityX = Store->VelocityX[Index];
+        f32 VelocityY = Store->VelocityY[Index];
+        Store->PrevX[Index] = X;
+        Store->PrevY[Index] = Y;
+
+        f32 NewX = X + VelocityX*dt;
+        f32 TestX = NewX + ((VelocityX > 0.0f) ? CollisionRadius : -CollisionRadius);
+        if (IsTileSolid(Map, TruncateF32ToI32(TestX), TruncateF32ToI32(Y)))
+        {
+            NewX = X;
+        }
+
+        f32 NewY = Y + VelocityY*dt;
+        f32 TestY = NewY + ((VelocityY > 0.0f) ? CollisionRadius : -CollisionRadius);
+        if (IsTileSolid(Map, TruncateF32ToI32(NewX), TruncateF32ToI32(TestY)))
+        {
+            NewY = Y;
+        }
+
+        Store->X[Index] = NewX;
+        Store->Y[Index] = NewY;
+    }
+}
+
+internal void
+BuildBenchMap(game_map *Map, i32 Size, memory_arena *Arena)
+{
+    // NOTE: Open floor with a border and a pillar every 6 cells, so robots
+    // actually collide and the flow field isn't a straight line
+    Map->Width = Size;
+    Map->Height = Size;
+    Map->Tiles = PushArray(Arena, Size*Size, u8);
+    Map->Colors = PushArray(Arena, Size*Size, u32);
+    for (i32 Y = 0;
+         Y < Size;
+         ++Y)
+    {
+        for (i32 X = 0;
+             X < Size;
+             ++X)
+        {
+            bool32 Border = ((X == 0) || (Y == 0) || (X == Size - 1) || (Y == Size - 1));
+            bool32 Pillar = (((X % 6) == 3) && ((Y % 6) == 3));
+            Map->Tiles[Y*Size + X] = (Border || Pillar) ? 1 : 0;
+            Map->Colors[Y*Size + X] = 0xFF808080;
+        }
+    }
+    InitializeMapOccupancy(Map, Arena);
+    UpdateMapOccupancy(Map);
+}
+
+internal void
+SpawnBenchRobots(entity_store *Store, game_map *Map, u32 RobotCount, u32 Seed)
+{
+    while (Store->Count < RobotCount)
+    {
+        f32 X = 1.0f + (f32)(BenchRandom(&Seed) % (u32)((Map->Width - 2)*256)) / 256.0f;
+        f32 Y = 1.0f + (f32)(BenchRandom(&Seed) % (u32)((Map->Height - 2)*256)) / 256.0f;
+        if (!IsTileSolid(Map, TruncateF32ToI32(X), TruncateF32ToI32(Y)))
+        {
+            AddEntity(Store, X, Y);
+            Store->AIState[Store->Count - 1] = EntityAI_Chasing;
+        }
+    }
+}
+
+internal void
+BuildBenchMaze(game_map *Map, i32 Size, u32 Seed, memory_arena *Arena)
+{
+    // NOTE: 7x7 rooms on an 8-cell grid, most walls with a two-cell doorway
+    BuildBenchMap(Map, Size, Arena);
+    for (i32 Y = 0;
+         Y < Size;
+         ++Y)
+    {
+        for (i32 X = 0;
+             X < Size;
+             ++X)
+        {
+            if (((X % 8) == 0) || ((Y % 8) == 0))
+            {
+                Map->Tiles[Y*Size + X] = 1;
+            }
+            else if (!((X == Size - 1) || (Y == Size - 1)))
+            {
+                Map->Tiles[Y*Size + X] = 0;
+            }
+        }
+    }
+
+    for (i32 RoomY = 0;
+         RoomY + 8 < Size - 1;
+         RoomY += 8)
+    {
+        for (i32 RoomX = 0;
+             RoomX + 8 < Size - 1;
+             RoomX += 8)
+        {
+            i32 Offset = 1 + (i32)(BenchRandom(&Seed) % 5);
+            if ((BenchRandom(&Seed) % 10) < 7)
+            {
+                Map->Tiles[(RoomY + Offset)*Size + RoomX + 8] = 0;
+                Map->Tiles[(RoomY + Offset + 1)*Size + RoomX + 8] = 0;
+            }
+            Offset = 1 + (i32)(BenchRandom(&Seed) % 5);
+            if ((BenchRandom(&Seed) % 10) < 7)
+            {
+                Map->Tiles[(RoomY + 8)*Size + RoomX + Offset] = 0;
+                Map->Tiles[(RoomY + 8)*Size + RoomX + Offset + 1] = 0;
+            }
+        }
+    }
+    UpdateMapOccupancy(Map);
+}
+
+// NOTE: Set by -level and -seed
+global_variable bool32 GlobalBenchUseLevel;
+global_variable level_kind GlobalBenchLevelKind;
+global_variable u32 GlobalBenchLevelSeed = 1;
+global_variable char *BenchLevelNames[LevelKind_Count] = {"maze", "cave", "arena"};
+
+internal void
+BuildBenchStressMap(game_map *Map, i32 Size, memory_arena *Arena)
+{
+    // NOTE: The pillar map, or a generated level if -level asked for one. The
+    // player's cell in the middle is open either way.
+    if (GlobalBenchUseLevel)
+    {
+        level_params Params = {};
+        Params.Kind = GlobalBenchLevelKind;
+        Params.Width = Size;
+        Params.Height = Size;
+        Params.Seed = GlobalBenchLevelSeed;
+        GenerateLevel(Map, &Params, Arena);
+    }
+    else
+    {
+        BuildBenchMap(Map, Size, Arena);
+    }
+}
+
+internal int
+RunEntityBench(u32 TickCount, i32 MapSize, bool32 Csv)
+{
+    memory_index StorageSize = Gigabytes(1);
+    void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (Storage == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not reserve bench memory\n");
+        return 1;
+    }
+
+    memory_arena MapArena;
+    InitializeArena(&MapArena, StorageSize, Storage);
+    game_map Map;
+    BuildBenchStressMap(&Map, MapSize, &MapArena);
+
+    f32 PlayerX = (f32)(MapSize/2) + 0.5f;
+    f32 PlayerY = (f32)(MapSize/2) + 0.5f;
+    flow_field FlowField;
+    InitializeFlowField(&FlowField, &Map, &MapArena);
+    UpdateFlowField(&FlowField, &Map, TruncateF32ToI32(PlayerX), TruncateF32ToI32(PlayerY), 0xFFFFFFFF);
+
+    f32 dt = SIM_SECONDS_PER_TICK;
+    f32 Speed = 1.5f;
+    f32 StopDistance = 0.6f;
+    f32 CollisionRadius = 0.2f;
+
+    if (Csv)
+    {
+        printf("robots,hot_kb,scalar_ns,simd_ns,speedup,max_diff\n");
+    }
+    else
+    {
+        printf("entity scaling, %dx%d map, %u ticks\n", MapSize, MapSize, TickCount);
+        printf("%10s %12s %12s %12s %8s %12s\n",
+               "robots", "hot KB", "scalar ns", "simd ns", "speedup", "max diff");
+    }
+
+    u32 RobotCounts[] = {1000, 10000, 100000, 1000000};
+    for (u32 CountIndex = 0;
+         CountIndex < sizeof(RobotCounts)/sizeof(RobotCounts[0]);
+         ++CountIndex)
+    {
+        u32 RobotCount = RobotCounts[CountIndex];
+
+        memory_arena EntityArenas[2];
+        entity_store Stores[2];
+        memory_index EntityStorageOffset = MapArena.Used;
+        memory_index EntityStorageSize = (StorageSize - EntityStorageOffset) / 2;
+        for (u32 StoreIndex = 0;
+             StoreIndex < 2;
+             ++StoreIndex)
+        {
+            InitializeArena(&EntityArenas[StoreIndex], EntityStorageSize,
+                            (u8 *)Storage + EntityStorageOffset + StoreIndex*EntityStorageSize);
+            InitializeEntityStore(&Stores[StoreIndex], RobotCount, &EntityArenas[StoreIndex]);
+            SpawnBenchRobots(&Stores[StoreIndex], &Map, RobotCount, 0x1234567);
+        }
+
+        // NOTE: Warm both stores once so neither pays for first-touch faults
+        SteerRobotsScalar(&Stores[0], &FlowField, PlayerX, PlayerY, Speed, StopDistance);
+        MoveEntitiesScalar(&Stores[0], &Map, 0.0f, CollisionRadius);
+        SteerRobots(&Stores[1], &FlowField, PlayerX, PlayerY, Speed, StopDistance);
+        MoveEntities(&Stores[1], &Map, 0.0f, CollisionRadius);
+
+        u64 ScalarStart = BenchGetWallClock();
+        for (u32 Tick = 0;
+             Tick < TickCount;
+             ++Tick)
+        {
+            SteerRobotsScalar(&Stores[0], &FlowField, PlayerX, PlayerY, Speed, StopDistance);
+            MoveEntitiesScalar(&Stores[0], &Map, dt, CollisionRadius);
+        }
+        u64 ScalarNanoseconds = BenchGetWallClock() - ScalarStart;
+
+        u64 SimdStart = BenchGetWallClock();
+        for (u32 Tick = 0;
+             Tick < TickCount;
+             ++Tick)
+        {
+            SteerRobots(&Stores[1], &FlowField, PlayerX, PlayerY, Speed, StopDistance);
+            MoveEntities(&Stores[1], &Map, dt, CollisionRadius);
+        }
+        u64 SimdNanoseconds = BenchGetWallClock() - SimdStart;
+
+        f32 MaxDifference = 0.0f;
+        for (u32 Index = 0;
+             Index < RobotCount;
+             ++Index)
+        {
+            MaxDifference = fmaxf(MaxDifference, fabsf(Stores[0].X[Index] - Stores[1].X[Index]));
+            MaxDifference = fmaxf(MaxDifference, fabsf(Stores[0].Y[Index] - Stores[1].Y[Index]));
+        }
+
+        f64 RobotTicks = (f64)RobotCount*(f64)TickCount;
+        f64 ScalarPerRobot = (f64)ScalarNanoseconds / RobotTicks;
+        f64 SimdPerRobot = (f64)SimdNanoseconds / RobotTicks;
+        f64 HotKilobytes = (f64)RobotCount*7.0*sizeof(f32) / 1024.0;
+        printf(Csv ? "%u,%.0f,%.2f,%.2f,%.2f,%g\n" : "%10u %12.0f %12.2f %12.2f %7.2fx %12g\n",
+               RobotCount, HotKilobytes, ScalarPerRobot, SimdPerRobot,
+               ScalarPerRobot / SimdPerRobot, (f64)MaxDifference);
+    }
+
+    munmap(Storage, StorageSize);
+    return 0;
+}
+
+//
+// NOTE: Primitives
+//
+
+#define BENCH_MIN_BATCH_NANOSECONDS 2000000
+#define BENCH_BATCH_COUNT 5
+#define BENCH_SCREEN_WIDTH 1600
+#define BENCH_SCREEN_HEIGHT 900
+
+enum bench_primitive
+{
+    BenchPrimitive_DrawRectangle,
+    BenchPrimitive_DrawLine,
+    BenchPrimitive_DrawBitmap,
+    BenchPrimitive_DrawWallColumn,
+    BenchPrimitive_FillColumnSpan,
+    BenchPrimitive_DrawSprite,
+    BenchPrimitive_PresentColumnBuffer,
+    BenchPrimitive_CastARay,
+    BenchPrimitive_DrawHud,
+    BenchPrimitive_MixVoices,
+};
+
+global_variable char *BenchPrimitiveNames[] =
+{
+    "DrawRectangle",
+    "DrawLine",
+    "DrawBitmap",
+    "DrawWallColumn",
+    "FillColumnSpan",
+    "DrawSprite",
+    "PresentColumnBuffer",
+    "CastARay",
+    "DrawHud",
+    "MixVoices",
+};
+
+global_variable volatile i32 BenchSink;
+
+struct bench_targets
+{
+    game_offscreen_buffer Rows;
+    column_buffer Columns;
+    wall_atlas Atlas;
+    u8 *Coverage;
+    game_state *State;
+    glyph_atlas *Glyphs;
+    hud_batch *Hud;
+    audio_mixer *Mixer;
+};
+
+struct primitive_case
+{
+    bench_primitive Primitive;
+    char Name[64];
+
+    // NOTE: Screen rectangle, line end points, or wall column extents
+    f32 MinX;
+    f32 MinY;
+    f32 MaxX;
+    f32 MaxY;
+
+    texture *Texture;
+    sprite *Sprite;
+    bool32 Masked;
+    bool32 Lit;
+    f32 RayAngle;
+    u32 VoiceCount;
+    i32 Width;
+    i32 Height;
+
+    // NOTE: Memory traffic per pixel written: 4 for fills, 8 when every
+    // pixel also reads a texel or source pixel
+    u32 BytesPerPixel;
+};
+
+internal void
+RunPrimitiveOnce(primitive_case *Case, bench_targets *Targets)
+{
+    switch (Case->Primitive)
+    {
+        case BenchPrimitive_DrawRectangle:
+        {
+            DrawRectangle(&Targets->Rows, Case->MinX, Case->MinY, Case->MaxX, Case->MaxY,
+                          0xFF336699, 0xFFFFFFFF);
+        } break;
+
+        case BenchPrimitive_DrawLine:
+        {
+            DrawLine(&Targets->Rows, Case->MinX, Case->MinY, Case->MaxX, Case->MaxY, 0xFFFF00FF);
+        } break;
+
+        case BenchPrimitive_DrawBitmap:
+        {
+            DrawBitmap(&Targets->Rows, Case->Texture, Case->MinX, Case->MinY, Case->MaxX, Case->MaxY,
+                       Case->MaxX - Case->MinX, Case->MaxY - Case->MinY, 0.0f, 0.0f);
+        } break;
+
+        case BenchPrimitive_DrawWallColumn:
+        {
+            if (Case->Masked)
+            {
+                // NOTE: Fresh mask every call, or every call after the first
+                // would skip all its rows
+                memset(Targets->Coverage, 0, Targets->Columns.Height);
+            }
+            DrawWallColumn(&Targets->Columns, &Targets->Atlas, 0, 0.3f,
+                           Case->Lit ? 0x80A07050 : LIGHTMAP_UNLIT,
+                           Case->MinX, Case->MaxX, Case->MinY, Case->MaxY,
+                           -1.0f, 0.0f, 0, Targets->Columns.Height,
+                           Case->Masked ? Targets->Coverage : 0, Case->Masked);
+        } break;
+
+        case BenchPrimitive_FillColumnSpan:
+        {
+            FillColumnSpan(&Targets->Columns, Case->MinX, Case->MaxX,
+                           (i32)Case->MinY, (i32)Case->MaxY, 0xFF202020, 0);
+        } break;
+
+        case BenchPrimitive_DrawSprite:
+        {
+            DrawSprite(&Targets->Columns, Case->Sprite, Case->MinX + (Case->MaxX - Case->MinX)/2.0f,
+                       Case->MinY, Case->MaxX - Case->MinX, Case->MaxY - Case->MinY, 1.0f, 0, 0);
+        } break;
+
+        case BenchPrimitive_PresentColumnBuffer:
+        {
+            PresentColumnBuffer(&Targets->Columns, &Targets->Rows);
+        } break;
+
+        case BenchPrimitive_CastARay:
+        {
+            game_state *State = Targets->State;
+            ray_data Ray = CastARay(State, State->PlayerX, State->PlayerY, State->PlayerAngle, Case->RayAngle);
+            // NOTE: Keeps the call from being thrown away
+            BenchSink += Ray.TileX;
+        } break;
+
+        case BenchPrimitive_DrawHud:
+        {
+            // NOTE: Queues and draws what the stats overlay shows each frame
+            hud_batch *Hud = Targets->Hud;
+            BeginHud(Hud);
+            HudPrint(Hud, 8, 8, 0xFFFFFFFF, "frame  %6.2f ms  %5.1f fps", 16.67f, 60.0f);
+            HudPrint(Hud, 8, 20, 0xFFFFFFFF, "rays   %u  steps %u  avg %.1f  max %u", 1600, 7492, 4.7f, 8);
+            HudPrint(Hud, 8, 32, 0xFFFFFFFF, "robots %u  drawn %u", 1, 1);
+            HudPrint(Hud, 8, 44, 0xFFFFFFFF, "tick   %llu", 123456ULL);
+            DrawHud(Hud, Targets->Glyphs, &Targets->Rows);
+        } break;
+
+        case BenchPrimitive_MixVoices:
+        {
+            // NOTE: One 60Hz frame of audio with every voice audible and
+            // ramping, the worst case
+            audio_mixer *Mixer = Targets->Mixer;
+            Mixer->VoiceCount = Case->VoiceCount;
+            for (u32 VoiceIndex = 0;
+                 VoiceIndex < Mixer->VoiceCount;
+                 ++VoiceIndex)
+            {
+                audio_voice *Voice = &Mixer->Voices[VoiceIndex];
+                Voice->TargetLeft = 0.25f - Voice->GainLeft;
+                Voice->TargetRight = 0.2f - Voice->GainRight;
+            }
+
+            u32 FramesToMix = AUDIO_SAMPLES_PER_SECOND / 60;
+            while (FramesToMix)
+            {
+                u32 FrameCount = (FramesToMix < AUDIO_MIX_CHUNK) ? FramesToMix : AUDIO_MIX_CHUNK;
+                MixVoices(Mixer, Mixer->Output, FrameCount);
+                FramesToMix -= FrameCount;
+            }
+        } break;
+    }
+}
+
+internal u64
+CountPixelsWritten(primitive_case *Case, bench_targets *Targets)
+{
+    // NOTE: Runs the case once over a cleared target and counts what changed.
+    // Every colour the primitives draw here is non-zero.
+    u64 Result = 0;
+    if (Case->Primitive == BenchPrimitive_PresentColumnBuffer)
+    {
+        Result = (u64)Case->Width*(u64)Case->Height;
+    }
+    else if (Case->Primitive != BenchPrimitive_CastARay)
+    {
+        bool32 ColumnTarget = ((Case->Primitive == BenchPrimitive_DrawWallColumn) ||
+                               (Case->Primitive == BenchPrimitive_FillColumnSpan) ||
+                               (Case->Primitive == BenchPrimitive_DrawSprite));
+        game_offscreen_buffer *Rows = &Targets->Rows;
+        column_buffer *Columns = &Targets->Columns;
+        if (ColumnTarget)
+        {
+            memset(Columns->Data, 0, (memory_index)Columns->ColumnPitch*Columns->Width);
+        }
+        else
+        {
+            memset(Rows->Data, 0, (memory_index)Rows->Pitch*Rows->Height);
+        }
+
+        RunPrimitiveOnce(Case, Targets);
+
+        for (i32 X = 0;
+             X < Rows->Width;
+             ++X)
+        {
+            for (i32 Y = 0;
+                 Y < Rows->Height;
+                 ++Y)
+            {
+                u32 Pixel = ColumnTarget ? GetColumn(Columns, X)[Y] :
+                    *(u32 *)((u8 *)Rows->Data + Y*Rows->Pitch + X*sizeof(u32));
+                Result += (Pixel != 0);
+            }
+        }
+    }
+
+    return Result;
+}
+
+internal void
+RunPrimitiveCase(primitive_case *Case, bench_targets *Targets, bool32 Csv)
+{
+    i32 Width = Case->Width ? Case->Width : BENCH_SCREEN_WIDTH;
+    i32 Height = Case->Height ? Case->Height : BENCH_SCREEN_HEIGHT;
+    Case->Width = Width;
+    Case->Height = Height;
+    Targets->Rows.Width = Width;
+    Targets->Rows.Height = Height;
+    Targets->Rows.Pitch = Width*Targets->Rows.BytesPerPixel;
+    ResizeColumnBuffer(&Targets->Columns, Width, Height);
+
+    u64 Pixels = CountPixelsWritten(Case, Targets);
+
+    // NOTE: Double the batch until it runs long enough to time, then keep
+    // the best of a few batches
+    u64 CallsPerBatch = 1;
+    for (;;)
+    {
+        u64 Start = BenchGetWallClock();
+        for (u64 Call = 0;
+             Call < CallsPerBatch;
+             ++Call)
+        {
+            RunPrimitiveOnce(Case, Targets);
+        }
+        if ((BenchGetWallClock() - Start) >= BENCH_MIN_BATCH_NANOSECONDS)
+        {
+            break;
+        }
+        CallsPerBatch *= 2;
+    }
+
+    u64 BestNanoseconds = ~0ULL;
+    u64 BestCycles = ~0ULL;
+    for (u32 Batch = 0;
+         Batch < BENCH_BATCH_COUNT;
+         ++Batch)
+    {
+        u64 Start = BenchGetWallClock();
+        u64 StartCycles = __rdtsc();
+        for (u64 Call = 0;
+             Call < CallsPerBatch;
+             ++Call)
+        {
+            RunPrimitiveOnce(Case, Targets);
+        }
+        u64 Cycles = __rdtsc() - StartCycles;
+        u64 Nanoseconds = BenchGetWallClock() - Start;
+        if (Nanoseconds < BestNanoseconds)
+        {
+            BestNanoseconds = Nanoseconds;
+            BestCycles = Cycles;
+        }
+    }
+
+    f64 NanosecondsPerCall = (f64)BestNanoseconds / (f64)CallsPerBatch;
+    f64 CyclesPerCall = (f64)BestCycles / (f64)CallsPerBatch;
+    char *Primitive = BenchPrimitiveNames[Case->Primitive];
+    if (Pixels)
+    {
+        f64 NanosecondsPerPixel = NanosecondsPerCall / (f64)Pixels;
+        f64 BytesPerCycle = (f64)(Pixels*Case->BytesPerPixel) / CyclesPerCall;
+        printf(Csv ? "%s,%s,%llu,%.2f,%.4f,%.3f\n" : "%-20s %-28s %10llu %12.2f %10.4f %10.3f\n",
+               Primitive, Case->Name, (unsigned long long)Pixels,
+               NanosecondsPerCall, NanosecondsPerPixel, BytesPerCycle);
+    }
+    else
+    {
+        if (Csv)
+        {
+            printf("%s,%s,0,%.2f,,\n", Primitive, Case->Name, NanosecondsPerCall);
+        }
+        else
+        {
+            printf("%-20s %-28s %10s %12.2f %10s %10s\n",
+                   Primitive, Case->Name, "-", NanosecondsPerCall, "-", "-");
+        }
+    }
+}
+
+internal texture
+MakeBenchTexture(i32 Size)
+{
+    // NOTE: Opaque checker, top-down like a loaded BMP would be bottom-up; the
+    // primitives don't care which
+    texture Result = {};
+    Result.Width = Size;
+    Result.Height = Size;
+    Result.BytesPerPixel = 4;
+    Result.Pitch = Size*4;
+    Result.Pixels = malloc((memory_index)Size*Size*4);
+    u32 *Pixel = (u32 *)Result.Pixels;
+    for (i32 Y = 0;
+         Y < Size;
+         ++Y)
+    {
+        for (i32 X = 0;
+             X < Size;
+             ++X)
+        {
+            *Pixel++ = (((X ^ Y) & 8) ? 0xFF8040C0 : 0xFF40C080);
+        }
+    }
+    return Result;
+}
+
+internal texture
+MakeBenchSpriteTexture(i32 Size)
+{
+    // NOTE: Opaque disc on a transparent background, so there are runs to skip
+    texture Result = MakeBenchTexture(Size);
+    u32 *Pixel = (u32 *)Result.Pixels;
+    f32 Radius = (f32)Size/2.0f;
+    for (i32 Y = 0;
+         Y < Size;
+         ++Y)
+    {
+        for (i32 X = 0;
+             X < Size;
+             ++X)
+        {
+            f32 DX = (f32)X + 0.5f - Radius;
+            f32 DY = (f32)Y + 0.5f - Radius;
+            if (DX*DX + DY*DY > Radius*Radius)
+            {
+                *Pixel = 0;
+            }
+            ++Pixel;
+        }
+    }
+    return Result;
+}
+
+internal int
+RunPrimitiveBench(bool32 Csv)
+{
+    memory_index StorageSize = Megabytes(512);
+    void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (Storage == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not reserve bench memory\n");
+        return 1;
+    }
+    memory_arena Arena;
+    InitializeArena(&Arena, StorageSize, Storage);
+
+    bench_targets Targets = {};
+    Targets.Rows.BytesPerPixel = 4;
+    Targets.Rows.Data = PushArray(&Arena, RENDER_MAX_BUFFER_WIDTH*RENDER_MAX_BUFFER_HEIGHT, u32);
+    InitializeColumnBuffer(&Targets.Columns, RENDER_MAX_BUFFER_WIDTH, RENDER_MAX_BUFFER_HEIGHT, &Arena);
+    Targets.Coverage = PushArray(&Arena, RENDER_MAX_BUFFER_HEIGHT, u8);
+
+    texture Textures[4];
+    i32 TextureSizes[4] = {16, 64, 256, 1024};
+    for (u32 TextureIndex = 0;
+         TextureIndex < 4;
+         ++TextureIndex)
+    {
+        Textures[TextureIndex] = MakeBenchTexture(TextureSizes[TextureIndex]);
+    }
+    InitializeWallAtlas(&Targets.Atlas, WALL_ATLAS_TILE_SIZE_LOG2, 1, &Arena);
+    AddWallTexture(&Targets.Atlas, &Textures[1]);
+    texture SpriteTexture = MakeBenchSpriteTexture(128);
+    sprite Sprite = LoadSprite(&SpriteTexture, &Arena);
+
+    // NOTE: Every glyph fully inked, the worst case for the blit
+    texture FontTexture = MakeBenchTexture(HUD_ATLAS_COLUMNS*HUD_GLYPH_WIDTH);
+    Targets.Glyphs = PushStruct(&Arena, glyph_atlas);
+    LoadGlyphAtlas(Targets.Glyphs, &FontTexture);
+    Targets.Hud = PushStruct(&Arena, hud_batch);
+
+    // NOTE: Half a second of noise, looping, on every voice
+    sound BenchSound = {};
+    BenchSound.SampleCount = AUDIO_SAMPLES_PER_SECOND / 2;
+    BenchSound.Samples = PushArray(&Arena, BenchSound.SampleCount, i16);
+    u32 RandomState = 12345;
+    for (u32 SampleIndex = 0;
+         SampleIndex < BenchSound.SampleCount;
+         ++SampleIndex)
+    {
+        BenchSound.Samples[SampleIndex] = (i16)(BenchRandom(&RandomState) & 0x3FFF);
+    }
+    Targets.Mixer = PushStruct(&Arena, audio_mixer);
+    InitializeAudioMixer(Targets.Mixer, BenchSound);
+    for (u32 VoiceIndex = 0;
+         VoiceIndex < AUDIO_MAX_VOICES;
+         ++VoiceIndex)
+    {
+        audio_voice *Voice = &Targets.Mixer->Voices[VoiceIndex];
+        Voice->Sound = &Targets.Mixer->RobotSound;
+        Voice->Position = (VoiceIndex*7919) % BenchSound.SampleCount;
+        Voice->Looping = true;
+    }
+
+    // NOTE: Rays start mid-map and run until a border or pillar
+    Targets.State = PushStruct(&Arena, game_state);
+    BuildBenchMap(&Targets.State->Map, 64, &Arena);
+    Targets.State->PlayerX = 31.5f;
+    Targets.State->PlayerY = 31.5f;
+
+    primitive_case Cases[64];
+    u32 CaseCount = 0;
+    f32 W = (f32)BENCH_SCREEN_WIDTH;
+    f32 H = (f32)BENCH_SCREEN_HEIGHT;
+
+#define ADD_CASE(PrimitiveName, CaseName, Bytes) \
+    primitive_case *Case = &Cases[CaseCount++]; \
+    *Case = {}; \
+    Case->Primitive = PrimitiveName; \
+    snprintf(Case->Name, sizeof(Case->Name), "%s", CaseName); \
+    Case->BytesPerPixel = Bytes;
+
+    f32 ColumnHeights[] = {1.0f, 0.25f*H, 0.5f*H, H, 2.0f*H, 4.0f*H};
+    char *ColumnHeightNames[] = {"1px", "0.25H", "0.5H", "1H", "2H clipped", "4H clipped"};
+    for (u32 HeightIndex = 0;
+         HeightIndex < 6;
+         ++HeightIndex)
+    {
+        ADD_CASE(BenchPrimitive_DrawWallColumn, ColumnHeightNames[HeightIndex], 8);
+        Case->MinX = 800.0f;
+        Case->MaxX = 801.0f;
+        Case->MinY = H/2.0f - ColumnHeights[HeightIndex]/2.0f;
+        Case->MaxY = H/2.0f + ColumnHeights[HeightIndex]/2.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawWallColumn, "1H masked see-through", 8);
+        Case->MinX = 800.0f;
+        Case->MaxX = 801.0f;
+        Case->MinY = 0.0f;
+        Case->MaxY = H;
+        Case->Masked = true;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawWallColumn, "1H lit", 8);
+        Case->MinX = 800.0f;
+        Case->MaxX = 801.0f;
+        Case->MinY = 0.0f;
+        Case->MaxY = H;
+        Case->Lit = true;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawWallColumn, "1H 4px wide", 8);
+        Case->MinX = 800.0f;
+        Case->MaxX = 804.0f;
+        Case->MinY = 0.0f;
+        Case->MaxY = H;
+    }
+    for (u32 HeightIndex = 0;
+         HeightIndex < 4;
+         ++HeightIndex)
+    {
+        ADD_CASE(BenchPrimitive_FillColumnSpan, ColumnHeightNames[HeightIndex], 4);
+        Case->MinX = 800.0f;
+        Case->MaxX = 801.0f;
+        Case->MinY = (f32)(i32)(H/2.0f - ColumnHeights[HeightIndex]/2.0f);
+        Case->MaxY = (f32)(i32)(H/2.0f + ColumnHeights[HeightIndex]/2.0f);
+    }
+
+    {
+        ADD_CASE(BenchPrimitive_DrawRectangle, "16x16", 4);
+        Case->MinX = 100.0f; Case->MinY = 100.0f; Case->MaxX = 116.0f; Case->MaxY = 116.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawRectangle, "256x256", 4);
+        Case->MinX = 100.0f; Case->MinY = 100.0f; Case->MaxX = 356.0f; Case->MaxY = 356.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawRectangle, "full screen", 4);
+        Case->MinX = 0.0f; Case->MinY = 0.0f; Case->MaxX = W; Case->MaxY = H;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawRectangle, "512x512 clipped corner", 4);
+        Case->MinX = -256.0f; Case->MinY = -256.0f; Case->MaxX = 256.0f; Case->MaxY = 256.0f;
+    }
+
+    {
+        ADD_CASE(BenchPrimitive_DrawLine, "horizontal 1000", 4);
+        Case->MinX = 100.0f; Case->MinY = 450.0f; Case->MaxX = 1100.0f; Case->MaxY = 450.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawLine, "vertical 800", 4);
+        Case->MinX = 800.0f; Case->MinY = 50.0f; Case->MaxX = 800.0f; Case->MaxY = 850.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawLine, "diagonal 800", 4);
+        Case->MinX = 100.0f; Case->MinY = 50.0f; Case->MaxX = 900.0f; Case->MaxY = 850.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawLine, "short 16", 4);
+        Case->MinX = 100.0f; Case->MinY = 100.0f; Case->MaxX = 116.0f; Case->MaxY = 108.0f;
+    }
+
+    for (u32 TextureIndex = 0;
+         TextureIndex < 4;
+         ++TextureIndex)
+    {
+        char Name[64];
+        snprintf(Name, sizeof(Name), "%d tex to 256x256", TextureSizes[TextureIndex]);
+        ADD_CASE(BenchPrimitive_DrawBitmap, Name, 8);
+        Case->Texture = &Textures[TextureIndex];
+        Case->MinX = 100.0f; Case->MinY = 100.0f; Case->MaxX = 356.0f; Case->MaxY = 356.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawBitmap, "1024 tex to 900x900", 8);
+        Case->Texture = &Textures[3];
+        Case->MinX = 0.0f; Case->MinY = 0.0f; Case->MaxX = H; Case->MaxY = H;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawBitmap, "256 tex clipped corner", 8);
+        Case->Texture = &Textures[2];
+        Case->MinX = W - 128.0f; Case->MinY = H - 128.0f; Case->MaxX = W + 128.0f; Case->MaxY = H + 128.0f;
+    }
+
+    {
+        ADD_CASE(BenchPrimitive_DrawSprite, "128 unscaled", 8);
+        Case->Sprite = &Sprite;
+        Case->MinX = 400.0f; Case->MinY = 300.0f; Case->MaxX = 528.0f; Case->MaxY = 428.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawSprite, "128 to 450", 8);
+        Case->Sprite = &Sprite;
+        Case->MinX = 400.0f; Case->MinY = 200.0f; Case->MaxX = 850.0f; Case->MaxY = 650.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawSprite, "128 to 32", 8);
+        Case->Sprite = &Sprite;
+        Case->MinX = 400.0f; Case->MinY = 300.0f; Case->MaxX = 432.0f; Case->MaxY = 332.0f;
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawSprite, "128 to 1800 clipped", 8);
+        Case->Sprite = &Sprite;
+        Case->MinX = -100.0f; Case->MinY = -450.0f; Case->MaxX = 1700.0f; Case->MaxY = 1350.0f;
+    }
+
+    i32 PresentSizes[3][2] = {{1600, 900}, {1920, 1080}, {3840, 2160}};
+    for (u32 SizeIndex = 0;
+         SizeIndex < 3;
+         ++SizeIndex)
+    {
+        char Name[64];
+        snprintf(Name, sizeof(Name), "%dx%d", PresentSizes[SizeIndex][0], PresentSizes[SizeIndex][1]);
+        ADD_CASE(BenchPrimitive_PresentColumnBuffer, Name, 8);
+        Case->Width = PresentSizes[SizeIndex][0];
+        Case->Height = PresentSizes[SizeIndex][1];
+    }
+
+    f32 RayAngles[] = {0.0001f, Pi32/2.0f + 0.0001f, Pi32 - 0.0001f, 1.5f*Pi32 + 0.0001f,
+                       Pi32/4.0f, 0.75f*Pi32 + 0.01f, 0.3f, 2.0f};
+    char *RayAngleNames[] = {"near +x axis", "near +y axis", "near -x axis", "near -y axis",
+                             "diagonal", "near diagonal", "shallow 0.3", "steep 2.0"};
+    for (u32 AngleIndex = 0;
+         AngleIndex < sizeof(RayAngles)/sizeof(RayAngles[0]);
+         ++AngleIndex)
+    {
+        ADD_CASE(BenchPrimitive_CastARay, RayAngleNames[AngleIndex], 0);
+        Case->RayAngle = RayAngles[AngleIndex];
+    }
+    {
+        ADD_CASE(BenchPrimitive_DrawHud, "stats overlay", 8);
+    }
+
+    u32 VoiceCounts[] = {1, 64, 256, 512};
+    for (u32 CountIndex = 0;
+         CountIndex < sizeof(VoiceCounts)/sizeof(VoiceCounts[0]);
+         ++CountIndex)
+    {
+        char Name[64];
+        snprintf(Name, sizeof(Name), "%u voices, 1/60s", VoiceCounts[CountIndex]);
+        ADD_CASE(BenchPrimitive_MixVoices, Name, 0);
+        Case->VoiceCount = VoiceCounts[CountIndex];
+    }
+#undef ADD_CASE
+
+    Assert(CaseCount <= sizeof(Cases)/sizeof(Cases[0]));
+
+    if (Csv)
+    {
+        printf("primitive,case,pixels,ns_per_call,ns_per_pixel,bytes_per_cycle\n");
+    }
+    else
+    {
+        printf("primitives (bytes/cycle counts TSC cycles)\n");
+        printf("%-20s %-28s %10s %12s %10s %10s\n",
+               "primitive", "case", "pixels", "ns/call", "ns/pixel", "B/cycle");
+    }
+    for (u32 CaseIndex = 0;
+         CaseIndex < CaseCount;
+         ++CaseIndex)
+    {
+        RunPrimitiveCase(&Cases[CaseIndex], &Targets, Csv);
+    }
+
+    munmap(Storage, StorageSize);
+    return 0;
+}
+
+internal game_state *
+BuildBenchGameState(void *Storage, memory_index StorageSize, i32 MapSize, u32 RobotCount)
+{
+    // NOTE: Same layout GameStateInit makes, with the bench map and a crowd
+    game_state *State = (game_state *)Storage;
+    memset(State, 0, sizeof(game_state));
+    InitializeArena(&State->Arena, StorageSize - sizeof(game_state), (u8 *)Storage + sizeof(game_state));
+
+    BuildBenchStressMap(&State->Map, MapSize, &State->Arena);
+    if (!GlobalBenchUseLevel)
+    {
+        State->Map.FaceTextures = PushArray(&State->Arena, MapSize*MapSize*MapFace_Count, u16);
+        State->Map.FloorHeights = PushArray(&State->Arena, MapSize*MapSize, f32);
+        State->Map.CeilingHeights = PushArray(&State->Arena, MapSize*MapSize, f32);
+        for (i32 MapIndex = 0;
+             MapIndex < MapSize*MapSize;
+             ++MapIndex)
+        {
+            for (u32 Face = 0;
+                 Face < MapFace_Count;
+                 ++Face)
+            {
+                State->Map.FaceTextures[MapIndex*MapFace_Count + Face] = WallTexture_Brick;
+            }
+            State->Map.FloorHeights[MapIndex] = 0.0f;
+            State->Map.CeilingHeights[MapIndex] = 1.0f;
+        }
+    }
+
+    State->PlayerX = (f32)(MapSize/2) + 0.5f;
+    State->PlayerY = (f32)(MapSize/2) + 0.5f;
+    State->PlayerOnGround = true;
+    State->PrevPlayerX = State->PlayerX;
+    State->PrevPlayerY = State->PlayerY;
+
+    InitializeEntityStore(&State->Entities, RobotCount, &State->Arena);
+    SpawnBenchRobots(&State->Entities, &State->Map, RobotCount, 0x1234567);
+    InitializeRenderView(&State->View, State->Entities.Capacity, &State->Arena);
+    InitializeEventScheduler(&State->Events, GAME_MAX_SCHEDULED_EVENTS, State->SimTickCount, &State->Arena);
+
+    InitializeFlowField(&State->FlowField, &State->Map, &State->Arena);
+    UpdateFlowField(&State->FlowField, &State->Map,
+                    TruncateF32ToI32(State->PlayerX), TruncateF32ToI32(State->PlayerY),
+                    0xFFFFFFFF);
+    return State;
+}
+
+struct restart_timing
+{
+    u64 BestRestore;
+    u64 WorstRestore;
+    u64 BestFirstTick;
+};
+
+internal void
+TimeRestart(game_state *State, linux_state_snapshot *Snapshot, void *Copy, memory_index Size,
+            restart_timing *Timing)
+{
+    // NOTE: Snapshot set means restore by remap, otherwise memcpy from Copy.
+    // Every trial plays some ticks first so the restore has real work.
+    u32 TrialCount = 8;
+    u32 DirtyTicks = 30;
+    game_input Input = {};
+    f32 dt = SIM_SECONDS_PER_TICK;
+
+    Timing->BestRestore = 0xFFFFFFFFFFFFFFFFULL;
+    Timing->WorstRestore = 0;
+    Timing->BestFirstTick = 0xFFFFFFFFFFFFFFFFULL;
+    for (u32 Trial = 0;
+         Trial < TrialCount;
+         ++Trial)
+    {
+        for (u32 Tick = 0;
+             Tick < DirtyTicks;
+             ++Tick)
+        {
+            SimulateTick(State, &Input, dt);
+        }
+
+        u64 Start = BenchGetWallClock();
+        if (Snapshot)
+        {
+            LinuxRestoreStateSnapshot(Snapshot);
+        }
+        else
+        {
+            memcpy(State, Copy, Size);
+        }
+        u64 Restored = BenchGetWallClock();
+        SimulateTick(State, &Input, dt);
+        u64 Ticked = BenchGetWallClock();
+
+        u64 Restore = Restored - Start;
+        u64 FirstTick = Ticked - Restored;
+        if (Restore < Timing->BestRestore) Timing->BestRestore = Restore;
+        if (Restore > Timing->WorstRestore) Timing->WorstRestore = Restore;
+        if (FirstTick < Timing->BestFirstTick) Timing->BestFirstTick = FirstTick;
+    }
+}
+
+internal int
+RunRestartBench(i32 MapSize, bool32 Csv)
+{
+    memory_index StorageSize = Gigabytes(1);
+    void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (Storage == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not reserve bench memory\n");
+        return 1;
+    }
+
+    if (Csv)
+    {
+        printf("robots,state_kb,memcpy_us,memcpy_worst_us,memcpy_tick_us,remap_us,remap_worst_us,remap_tick_us,tick_us\n");
+    }
+    else
+    {
+        printf("restart, %dx%d map, best (worst) of 8\n", MapSize, MapSize);
+        printf("%10s %10s %18s %12s %18s %12s %10s\n",
+               "robots", "state KB", "memcpy us", "+tick us", "remap us", "+tick us", "tick us");
+    }
+
+    int Result = 0;
+    u32 RobotCounts[] = {1, 10000, 100000, 1000000};
+    for (u32 CountIndex = 0;
+         CountIndex < sizeof(RobotCounts)/sizeof(RobotCounts[0]);
+         ++CountIndex)
+    {
+        u32 RobotCount = RobotCounts[CountIndex];
+        game_state *State = BuildBenchGameState(Storage, StorageSize, MapSize, RobotCount);
+        memory_index Size = GameStateSnapshotSize(State);
+
+        // NOTE: Steady-state tick, for comparing the first tick after a restore
+        game_input Input = {};
+        u64 BestTick = 0xFFFFFFFFFFFFFFFFULL;
+        for (u32 Tick = 0;
+             Tick < 8;
+             ++Tick)
+        {
+            u64 Start = BenchGetWallClock();
+            SimulateTick(State, &Input, SIM_SECONDS_PER_TICK);
+            u64 Elapsed = BenchGetWallClock() - Start;
+            if (Elapsed < BestTick) BestTick = Elapsed;
+        }
+
+        void *Copy = malloc(Size);
+        memcpy(Copy, State, Size);
+        restart_timing Memcpy;
+        TimeRestart(State, 0, Copy, Size, &Memcpy);
+
+        linux_state_snapshot Snapshot;
+        if (!LinuxCaptureStateSnapshot(&Snapshot, State, Size))
+        {
+            fprintf(stderr, "Could not snapshot the bench state\n");
+            free(Copy);
+            Result = 1;
+            break;
+        }
+        restart_timing Remap;
+        TimeRestart(State, &Snapshot, 0, 0, &Remap);
+
+        if (Csv)
+        {
+            printf("%u,%llu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+                   RobotCount, (unsigned long long)(Size/1024),
+                   (f64)Memcpy.BestRestore/1000.0, (f64)Memcpy.WorstRestore/1000.0,
+                   (f64)Memcpy.BestFirstTick/1000.0,
+                   (f64)Remap.BestRestore/1000.0, (f64)Remap.WorstRestore/1000.0,
+                   (f64)Remap.BestFirstTick/1000.0, (f64)BestTick/1000.0);
+        }
+        else
+        {
+            printf("%10u %10llu %8.1f (%7.1f) %12.1f %8.1f (%7.1f) %12.1f %10.1f\n",
+                   RobotCount, (unsigned long long)(Size/1024),
+                   (f64)Memcpy.BestRestore/1000.0, (f64)Memcpy.WorstRestore/1000.0,
+                   (f64)Memcpy.BestFirstTick/1000.0,
+                   (f64)Remap.BestRestore/1000.0, (f64)Remap.WorstRestore/1000.0,
+                   (f64)Remap.BestFirstTick/1000.0, (f64)BestTick/1000.0);
+        }
+
+        // NOTE: Back to plain anonymous memory for the next size
+        LinuxReleaseStateSnapshot(&Snapshot);
+        mmap(Storage, StorageSize, PROT_READ|PROT_WRITE,
+             MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_FIXED, -1, 0);
+        free(Copy);
+    }
+
+    munmap(Storage, StorageSize);
+    return Result;
+}
+
+internal u64
+TimePerceptionSweep(entity_store *Store, game_map *Map, potentially_visible_sets *PVS,
+                    f32 PlayerX, f32 PlayerY)
+{
+    // NOTE: Ticks of perception until every robot has been looked at once
+    for (u32 Index = 0;
+         Index < Store->Count;
+         ++Index)
+    {
+        Store->AIState[Index] = EntityAI_Idle;
+    }
+    Store->PerceptionCursor = 0;
+
+    u64 Start = BenchGetWallClock();
+    do
+    {
+        UpdateRobotPerception(Store, Map, PVS, PlayerX, PlayerY);
+    } while (Store->PerceptionCursor < Store->Count);
+    u64 Result = BenchGetWallClock() - Start;
+    return Result;
+}
+
+internal int
+RunPVSBench(bool32 Csv)
+{
+    memory_index StorageSize = Gigabytes(1);
+    void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (Storage == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not reserve bench memory\n");
+        return 1;
+    }
+
+    u32 RobotCount = 100000;
+    u32 PlayerSpots = 16;
+    if (Csv)
+    {
+        printf("map,open_cells,build_ms,sets,pvs_kb,avg_visible,robots_in_pvs,none_ns_per_robot,pvs_ns_per_robot,speedup\n");
+    }
+    else
+    {
+        printf("potentially visible sets, 8-cell rooms, %u robots, %u player spots\n", RobotCount, PlayerSpots);
+        printf("%6s %10s %10s %8s %8s %10s %10s %12s %12s %8s\n",
+               "map", "open", "build ms", "sets", "PVS KB", "visible", "in PVS", "ns/robot", "PVS ns/robot", "speedup");
+    }
+
+    i32 MapSizes[] = {64, 128, 256};
+    for (u32 SizeIndex = 0;
+         SizeIndex < sizeof(MapSizes)/sizeof(MapSizes[0]);
+         ++SizeIndex)
+    {
+        i32 MapSize = MapSizes[SizeIndex];
+        memory_arena Arena;
+        InitializeArena(&Arena, StorageSize, Storage);
+        game_map Map;
+        BuildBenchMaze(&Map, MapSize, 0xC0FFEE + MapSize, &Arena);
+
+        potentially_visible_sets PVS = {};
+        u64 BuildStart = BenchGetWallClock();
+        BuildPotentiallyVisibleSets(&PVS, &Map, &Arena);
+        u64 BuildNanoseconds = BenchGetWallClock() - BuildStart;
+
+        u64 OpenCells = 0;
+        u64 VisibleCells = 0;
+        for (i32 Cell = 0;
+             Cell < MapSize*MapSize;
+             ++Cell)
+        {
+            if (PVS.CellSets[Cell] != PVS_NO_SET)
+            {
+                pvs_set *Set = &PVS.Sets[PVS.CellSets[Cell]];
+                for (u32 Block = 0;
+                     Block < Set->BlockCount;
+                     ++Block)
+                {
+                    VisibleCells += (u64)__builtin_popcountll(PVS.Blocks[Set->FirstBlock + Block].Mask);
+                }
+                ++OpenCells;
+            }
+        }
+
+        entity_store Store;
+        InitializeEntityStore(&Store, RobotCount, &Arena);
+        SpawnBenchRobots(&Store, &Map, RobotCount, 0x1234567);
+
+        potentially_visible_sets NoPVS = {};
+        u64 NoneNanoseconds = 0;
+        u64 PVSNanoseconds = 0;
+        u64 RobotsInPVS = 0;
+        u32 Seed = 0xBADC0DE;
+        for (u32 Spot = 0;
+             Spot < PlayerSpots;
+             ++Spot)
+        {
+            f32 PlayerX;
+            f32 PlayerY;
+            do
+            {
+                PlayerX = (f32)(BenchRandom(&Seed) % (u32)MapSize) + 0.5f;
+                PlayerY = (f32)(BenchRandom(&Seed) % (u32)MapSize) + 0.5f;
+            } while (IsTileSolid(&Map, TruncateF32ToI32(PlayerX), TruncateF32ToI32(PlayerY)));
+
+            pvs_set *PlayerSet = GetPotentiallyVisibleSet(&PVS, PlayerX, PlayerY);
+            for (u32 Index = 0;
+                 Index < Store.Count;
+                 ++Index)
+            {
+                RobotsInPVS += IsInPotentiallyVisibleSet(&PVS, PlayerSet, Store.X[Index], Store.Y[Index]) ? 1 : 0;
+            }
+
+            NoneNanoseconds += TimePerceptionSweep(&Store, &Map, &NoPVS, PlayerX, PlayerY);
+            PVSNanoseconds += TimePerceptionSweep(&Store, &Map, &PVS, PlayerX, PlayerY);
+        }
+
+        f64 AverageVisible = (f64)VisibleCells / (f64)OpenCells;
+        f64 InPVSPercent = 100.0*(f64)RobotsInPVS / ((f64)RobotCount*PlayerSpots);
+        f64 NoneNsPerRobot = (f64)NoneNanoseconds / ((f64)RobotCount*PlayerSpots);
+        f64 PVSNsPerRobot = (f64)PVSNanoseconds / ((f64)RobotCount*PlayerSpots);
+        u64 PVSBytes = (u64)PVS.BlockCount*sizeof(pvs_block) + (u64)PVS.SetCount*sizeof(pvs_set) +
+                       (u64)MapSize*MapSize*sizeof(u32);
+        if (Csv)
+        {
+            printf("%d,%llu,%.1f,%u,%llu,%.1f,%.3f,%.2f,%.2f,%.1f\n",
+                   MapSize, (unsigned long long)OpenCells, (f64)BuildNanoseconds/1.0e6, PVS.SetCount,
+                   (unsigned long long)(PVSBytes/1024), AverageVisible, InPVSPercent,
+                   NoneNsPerRobot, PVSNsPerRobot, NoneNsPerRobot / PVSNsPerRobot);
+        }
+        else
+        {
+            printf("%6d %10llu %10.1f %8u %8llu %10.1f %9.3f%% %12.2f %12.2f %7.1fx\n",
+                   MapSize, (unsigned long long)OpenCells, (f64)BuildNanoseconds/1.0e6, PVS.SetCount,
+                   (unsigned long long)(PVSBytes/1024), AverageVisible, InPVSPercent,
+                   NoneNsPerRobot, PVSNsPerRobot, NoneNsPerRobot / PVSNsPerRobot);
+        }
+    }
+
+    munmap(Storage, StorageSize);
+    return 0;
+}
+
+struct bench_grid_walk
+{
+    i32 HitX;
+    i32 HitY;
+    u32 Steps;
+};
+
+inline bool32
+IsBenchTileSolidBytes(game_map *Map, i32 TileX, i32 TileY)
+{
+    // NOTE: What IsTileSolid was before the packed grids, for comparison
+    bool32 Result = true;
+    if (IsTileInMap(Map, TileX, TileY))
+    {
+        Result = (Map->Tiles[TileY*Map->Width + TileX] != 0);
+    }
+    return Result;
+}
+
+internal bench_grid_walk
+WalkBenchGrid(game_map *Map, f32 X, f32 Y, f32 DirX, f32 DirY, bool32 Packed)
+{
+    // NOTE: A plain DDA walk to the first solid cell. Packed picks which
+    // representation is asked; the branch costs both the same.
+    bench_grid_walk Result = {};
+    i32 CellX = TruncateF32ToI32(X);
+    i32 CellY = TruncateF32ToI32(Y);
+    i32 StepX = (DirX < 0.0f) ? -1 : 1;
+    i32 StepY = (DirY < 0.0f) ? -1 : 1;
+    f32 DeltaX = (DirX != 0.0f) ? AbsoluteF32(1.0f/DirX) : 1.0e30f;
+    f32 DeltaY = (DirY != 0.0f) ? AbsoluteF32(1.0f/DirY) : 1.0e30f;
+    f32 SideX = ((DirX < 0.0f) ? (X - (f32)CellX) : ((f32)CellX + 1.0f - X))*DeltaX;
+    f32 SideY = ((DirY < 0.0f) ? (Y - (f32)CellY) : ((f32)CellY + 1.0f - Y))*DeltaY;
+    for (;;)
+    {
+        if (SideX < SideY)
+        {
+            SideX += DeltaX;
+            CellX += StepX;
+        }
+        else
+        {
+            SideY += DeltaY;
+            CellY += StepY;
+        }
+        ++Result.Steps;
+
+        bool32 Solid = (Packed ? IsTileSolid(Map, CellX, CellY) :
+                        IsBenchTileSolidBytes(Map, CellX, CellY));
+        if (Solid)
+        {
+            break;
+        }
+    }
+    Result.HitX = CellX;
+    Result.HitY = CellY;
+    return Result;
+}
+
+enum bench_walk_direction
+{
+    BenchWalk_Row,
+    BenchWalk_Column,
+    BenchWalk_Diagonal,
+    BenchWalk_Random,
+
+    BenchWalk_Count,
+};
+
+internal int
+RunOccupancyBench(bool32 Csv)
+{
+    memory_index StorageSize = Gigabytes(1);
+    void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (Storage == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not reserve bench memory\n");
+        return 1;
+    }
+
+    char *DirectionNames[BenchWalk_Count] = {"row", "column", "diagonal", "random"};
+    u32 WalkCount = 20000;
+    if (Csv)
+    {
+        printf("map,direction,byte_kb,packed_kb,steps_per_walk,byte_ns_per_step,packed_ns_per_step,speedup,mismatches\n");
+    }
+    else
+    {
+        printf("grid walks, 1 wall in 256 cells, %u walks per row, byte tiles vs packed occupancy\n", WalkCount);
+        printf("%6s %9s %10s %10s %10s %12s %12s %8s %10s\n",
+               "map", "walk", "byte KB", "packed KB", "steps", "byte ns", "packed ns", "speedup", "mismatch");
+    }
+
+    int Result = 0;
+    i32 MapSizes[] = {1024, 4096, 16384};
+    for (u32 SizeIndex = 0;
+         SizeIndex < ArrayCount(MapSizes);
+         ++SizeIndex)
+    {
+        // NOTE: Only the tiles and the grids; a full bench map's colours
+        // alone would be a gigabyte at the largest size
+        i32 MapSize = MapSizes[SizeIndex];
+        memory_arena Arena;
+        InitializeArena(&Arena, StorageSize, Storage);
+        game_map Map = {};
+        Map.Width = MapSize;
+        Map.Height = MapSize;
+        Map.Tiles = PushArray(&Arena, (memory_index)MapSize*MapSize, u8);
+        u32 Seed = 0xD1CE + (u32)MapSize;
+        for (memory_index CellIndex = 0;
+             CellIndex < (memory_index)MapSize*MapSize;
+             ++CellIndex)
+        {
+            Map.Tiles[CellIndex] = ((BenchRandom(&Seed) & 255) == 0) ? MapTile_Wall : MapTile_Empty;
+        }
+        InitializeMapOccupancy(&Map, &Arena);
+        UpdateMapOccupancy(&Map);
+
+        u64 ByteKB = ((u64)MapSize*MapSize)/1024;
+        u64 PackedKB = ((u64)Map.Solid.TileCountX*Map.Solid.TileCountY*sizeof(u64))/1024;
+        for (u32 Direction = 0;
+             Direction < BenchWalk_Count;
+             ++Direction)
+        {
+            f32 *StartX = PushArray(&Arena, WalkCount, f32);
+            f32 *StartY = PushArray(&Arena, WalkCount, f32);
+            f32 *DirX = PushArray(&Arena, WalkCount, f32);
+            f32 *DirY = PushArray(&Arena, WalkCount, f32);
+            for (u32 Walk = 0;
+                 Walk < WalkCount;
+                 ++Walk)
+            {
+                StartX[Walk] = (f32)(BenchRandom(&Seed) % (u32)MapSize) + 0.5f;
+                StartY[Walk] = (f32)(BenchRandom(&Seed) % (u32)MapSize) + 0.5f;
+                f32 Sign = (BenchRandom(&Seed) & 1) ? 1.0f : -1.0f;
+                switch (Direction)
+                {
+                    case BenchWalk_Row: {DirX[Walk] = Sign; DirY[Walk] = 0.01f;} break;
+                    case BenchWalk_Column: {DirX[Walk] = 0.01f; DirY[Walk] = Sign;} break;
+                    case BenchWalk_Diagonal: {DirX[Walk] = Sign*0.7071f; DirY[Walk] = 0.7071f;} break;
+                    default:
+                    {
+                        f32 Angle = 2.0f*Pi32*(f32)(BenchRandom(&Seed) % 65536)/65536.0f;
+                        DirX[Walk] = cosf(Angle);
+                        DirY[Walk] = sinf(Angle);
+                    } break;
+                }
+            }
+
+            bench_grid_walk *ByteWalks = PushArray(&Arena, WalkCount, bench_grid_walk);
+            u64 ByteStart = BenchGetWallClock();
+            for (u32 Walk = 0;
+                 Walk < WalkCount;
+                 ++Walk)
+            {
+                ByteWalks[Walk] = WalkBenchGrid(&Map, StartX[Walk], StartY[Walk], DirX[Walk], DirY[Walk], false);
+            }
+            u64 ByteNanoseconds = BenchGetWallClock() - ByteStart;
+
+            u64 PackedStart = BenchGetWallClock();
+            u64 TotalSteps = 0;
+            u32 Mismatches = 0;
+            for (u32 Walk = 0;
+                 Walk < WalkCount;
+                 ++Walk)
+            {
+                bench_grid_walk PackedWalk = WalkBenchGrid(&Map, StartX[Walk], StartY[Walk], DirX[Walk], DirY[Walk], true);
+                TotalSteps += PackedWalk.Steps;
+                if ((PackedWalk.HitX != ByteWalks[Walk].HitX) || (PackedWalk.HitY != ByteWalks[Walk].HitY) ||
+                    (PackedWalk.Steps != ByteWalks[Walk].Steps))
+                {
+                    ++Mismatches;
+                }
+            }
+            u64 PackedNanoseconds = BenchGetWallClock() - PackedStart;
+
+            f64 StepsPerWalk = (f64)TotalSteps / (f64)WalkCount;
+            f64 ByteNsPerStep = (f64)ByteNanoseconds / (f64)TotalSteps;
+            f64 PackedNsPerStep = (f64)PackedNanoseconds / (f64)TotalSteps;
+            if (Csv)
+            {
+                printf("%d,%s,%llu,%llu,%.1f,%.3f,%.3f,%.2f,%u\n",
+                       MapSize, DirectionNames[Direction], (unsigned long long)ByteKB, (unsigned long long)PackedKB,
+                       StepsPerWalk, ByteNsPerStep, PackedNsPerStep, ByteNsPerStep / PackedNsPerStep, Mismatches);
+            }
+            else
+            {
+                printf("%6d %9s %10llu %10llu %10.1f %12.3f %12.3f %7.2fx %10u\n",
+                       MapSize, DirectionNames[Direction], (unsigned long long)ByteKB, (unsigned long long)PackedKB,
+                       StepsPerWalk, ByteNsPerStep, PackedNsPerStep, ByteNsPerStep / PackedNsPerStep, Mismatches);
+            }
+            if (Mismatches)
+            {
+                Result = 1;
+            }
+        }
+    }
+
+    munmap(Storage, StorageSize);
+    return Result;
+}
+
+internal void
+AddBenchHeightsAndGrates(game_map *Map, u32 Seed)
+{
+    // NOTE: Each 8-cell room gets its own floor and ceiling, and some room
+    // walls turn into grates, so the render bench sees steps, lintels and
+    // see-through faces as well as plain walls
+    for (i32 Y = 0;
+         Y < Map->Height;
+         ++Y)
+    {
+        for (i32 X = 0;
+             X < Map->Width;
+             ++X)
+        {
+            u32 CellIndex = (u32)(Y*Map->Width + X);
+            u32 RoomSeed = (u32)((Y/8)*977 + (X/8)*131) ^ Seed;
+            Map->FloorHeights[CellIndex] = 0.05f*(f32)(BenchRandom(&RoomSeed) % 5);
+            Map->CeilingHeights[CellIndex] = 1.0f + 0.1f*(f32)(BenchRandom(&RoomSeed) % 5);
+
+            bool32 Border = ((X == 0) || (Y == 0) || (X == Map->Width - 1) || (Y == Map->Height - 1));
+            if (!Border && (Map->Tiles[CellIndex] == MapTile_Wall) && ((BenchRandom(&Seed) % 4) == 0))
+            {
+                Map->Tiles[CellIndex] = MapTile_Grate;
+                for (u32 Face = 0;
+                     Face < MapFace_Count;
+                     ++Face)
+                {
+                    Map->FaceTextures[CellIndex*MapFace_Count + Face] = WallTexture_Grate;
+                }
+            }
+        }
+    }
+    UpdateMapOccupancy(Map);
+}
+
+internal void
+AddBenchLights(game_state *State, u32 LightCount, u32 Seed)
+{
+    // NOTE: Coloured lights at random open cells, mid-room height
+    game_map *Map = &State->Map;
+    State->AmbientLight = 0.3f;
+    State->LightCount = 0;
+    while (State->LightCount < LightCount)
+    {
+        f32 X = 1.0f + (f32)(BenchRandom(&Seed) % (u32)((Map->Width - 2)*256)) / 256.0f;
+        f32 Y = 1.0f + (f32)(BenchRandom(&Seed) % (u32)((Map->Height - 2)*256)) / 256.0f;
+        if (!IsTileSolid(Map, TruncateF32ToI32(X), TruncateF32ToI32(Y)))
+        {
+            point_light *Light = &State->Lights[State->LightCount++];
+            *Light = {};
+            Light->X = X;
+            Light->Y = Y;
+            Light->Z = 0.7f;
+            Light->Radius = 4.0f + (f32)(BenchRandom(&Seed) % 5);
+            Light->Red = 0.5f + (f32)(BenchRandom(&Seed) % 100) / 100.0f;
+            Light->Green = 0.5f + (f32)(BenchRandom(&Seed) % 100) / 100.0f;
+            Light->Blue = 0.5f + (f32)(BenchRandom(&Seed) % 100) / 100.0f;
+            Light->On = true;
+        }
+    }
+}
+
+internal u64
+TimeRenderWalls(game_state *State, render_state *Render, column_buffer *Buffer, wall_camera *Camera,
+                f32 FirstRayAngle, f32 dAngle, f32 ColumnWidth, i32 ColumnCount)
+{
+    // NOTE: Best of a few, so one page fault or interrupt doesn't decide it
+    u64 Best = 0xFFFFFFFFFFFFFFFFULL;
+    for (u32 Run = 0;
+         Run < 5;
+         ++Run)
+    {
+        u64 Start = BenchGetWallClock();
+        RenderWalls(State, Render, Buffer, Camera, FirstRayAngle, dAngle, ColumnWidth, ColumnCount);
+        u64 Elapsed = BenchGetWallClock() - Start;
+        if (Elapsed < Best)
+        {
+            Best = Elapsed;
+        }
+    }
+    return Best;
+}
+
+struct render_bench_result
+{
+    // NOTE: Per view on average, except the mismatch counts, which are totals
+    u64 Steps;
+    u64 Cells;
+    u64 FacesSwept;
+    u64 FacesDrawn;
+    u64 ColumnsDrawn;
+    f64 RaycastMs;
+    f64 FacesMs;
+    u64 MismatchedPixels;
+    u32 MismatchedRays;
+};
+
+internal render_bench_result
+MeasureRenderScene(game_state *State, render_state *Render, column_buffer *Buffers, ray_data **RaycastData,
+                   u32 ViewCount, u32 Seed, i32 ColumnCount)
+{
+    // NOTE: The same random views for every column count, each drawn by both
+    // engines, with the pictures and rays compared
+    game_map *Map = &State->Map;
+    render_bench_result Result = {};
+    u64 Nanoseconds[RenderEngine_Count] = {};
+    for (u32 ViewIndex = 0;
+         ViewIndex < ViewCount;
+         ++ViewIndex)
+    {
+        wall_camera Camera = {};
+        do
+        {
+            Camera.X = 1.0f + (f32)(BenchRandom(&Seed) % (u32)((Map->Width - 2)*256)) / 256.0f;
+            Camera.Y = 1.0f + (f32)(BenchRandom(&Seed) % (u32)((Map->Height - 2)*256)) / 256.0f;
+        } while (IsTileSolid(Map, TruncateF32ToI32(Camera.X), TruncateF32ToI32(Camera.Y)));
+        Camera.Angle = (f32)(BenchRandom(&Seed) % 3600) * (2.0f*Pi32 / 3600.0f);
+        Camera.EyeZ = Map->FloorHeights[TruncateF32ToI32(Camera.Y)*Map->Width + TruncateF32ToI32(Camera.X)] +
+                      PLAYER_EYE_HEIGHT;
+        Camera.Horizon = (f32)BENCH_SCREEN_HEIGHT / 2.0f;
+        Camera.Scale = 900.0f;
+
+        // NOTE: Same ray spacing GameRender uses
+        f32 FovStart = Camera.Angle - Pi32 / 6.0f;
+        f32 FovEnd = Camera.Angle + Pi32 / 6.0f;
+        f32 dAngle = (FovStart - FovEnd) / (f32)ColumnCount;
+        f32 ColumnWidth = (f32)BENCH_SCREEN_WIDTH / (f32)ColumnCount;
+
+        for (u32 Engine = 0;
+             Engine < RenderEngine_Count;
+             ++Engine)
+        {
+            Render->Engine = (render_engine)Engine;
+            Nanoseconds[Engine] += TimeRenderWalls(State, Render, &Buffers[Engine], &Camera,
+                                                   FovEnd, dAngle, ColumnWidth, ColumnCount);
+            memcpy(RaycastData[Engine], Render->RaycastData, ColumnCount*sizeof(ray_data));
+        }
+
+        for (i32 X = 0;
+             X < BENCH_SCREEN_WIDTH;
+             ++X)
+        {
+            u32 *A = GetColumn(&Buffers[RenderEngine_Raycast], X);
+            u32 *B = GetColumn(&Buffers[RenderEngine_Faces], X);
+            for (i32 Y = 0;
+                 Y < BENCH_SCREEN_HEIGHT;
+                 ++Y)
+            {
+                Result.MismatchedPixels += (A[Y] != B[Y]) ? 1 : 0;
+            }
+        }
+        for (i32 RayIndex = 0;
+             RayIndex < ColumnCount;
+             ++RayIndex)
+        {
+            Result.MismatchedRays += (memcmp(&RaycastData[RenderEngine_Raycast][RayIndex],
+                                             &RaycastData[RenderEngine_Faces][RayIndex], sizeof(ray_data)) != 0) ? 1 : 0;
+            Result.Steps += RaycastData[RenderEngine_Raycast][RayIndex].CellSteps;
+        }
+        Result.Cells += Render->Faces.CellsSwept;
+        Result.FacesSwept += Render->Faces.FacesSwept;
+        Result.FacesDrawn += Render->Faces.FacesDrawn;
+        Result.ColumnsDrawn += Render->Faces.ColumnsDrawn;
+    }
+
+    Result.Steps /= ViewCount;
+    Result.Cells /= ViewCount;
+    Result.FacesSwept /= ViewCount;
+    Result.FacesDrawn /= ViewCount;
+    Result.ColumnsDrawn /= ViewCount;
+    Result.RaycastMs = (f64)Nanoseconds[RenderEngine_Raycast] / (1.0e6*ViewCount);
+    Result.FacesMs = (f64)Nanoseconds[RenderEngine_Faces] / (1.0e6*ViewCount);
+    return Result;
+}
+
+internal void
+PrintRenderBenchResult(char *Name, i32 ColumnCount, render_bench_result *Result, bool32 Csv)
+{
+    if (Csv)
+    {
+        printf("%s,%d,%llu,%llu,%llu,%llu,%llu,%.3f,%.3f,%.2f,%llu,%u\n",
+               Name, ColumnCount, (unsigned long long)Result->Steps, (unsigned long long)Result->Cells,
+               (unsigned long long)Result->FacesSwept, (unsigned long long)Result->FacesDrawn,
+               (unsigned long long)Result->ColumnsDrawn, Result->RaycastMs, Result->FacesMs,
+               Result->RaycastMs / Result->FacesMs, (unsigned long long)Result->MismatchedPixels,
+               Result->MismatchedRays);
+    }
+    else
+    {
+        printf("%-24s %7d %9llu %7llu %7llu %7llu %9llu %10.3f %10.3f %7.2fx %9llu %6u\n",
+               Name, ColumnCount, (unsigned long long)Result->Steps, (unsigned long long)Result->Cells,
+               (unsigned long long)Result->FacesSwept, (unsigned long long)Result->FacesDrawn,
+               (unsigned long long)Result->ColumnsDrawn, Result->RaycastMs, Result->FacesMs,
+               Result->RaycastMs / Result->FacesMs, (unsigned long long)Result->MismatchedPixels,
+               Result->MismatchedRays);
+    }
+}
+
+internal int
+RunRenderBench(bool32 Csv)
+{
+    memory_index StorageSize = Gigabytes(2);
+    void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (Storage == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not reserve bench memory\n");
+        return 1;
+    }
+    memory_arena Arena;
+    InitializeArena(&Arena, StorageSize, Storage);
+
+    // NOTE: Just the parts of a render_state the walls use
+    render_state *Render = PushStruct(&Arena, render_state);
+    memset(Render, 0, sizeof(render_state));
+    memory_index RenderArenaSize = Megabytes(64);
+    InitializeArena(&Render->Arena, RenderArenaSize, (u8 *)PushSize_(&Arena, RenderArenaSize));
+    texture WallTexture = MakeBenchTexture(64);
+    texture GrateTexture = MakeBenchSpriteTexture(64);
+    InitializeWallAtlas(&Render->WallAtlas, WALL_ATLAS_TILE_SIZE_LOG2, WALL_ATLAS_MAX_TILES, &Render->Arena);
+    AddWallTexture(&Render->WallAtlas, &WallTexture);
+    AddWallTexture(&Render->WallAtlas, &WallTexture);
+    AddWallTexture(&Render->WallAtlas, &GrateTexture);
+    Render->TransparentHits = PushArray(&Render->Arena, RAYCAST_NUM*RAYCAST_MAX_TRANSPARENT_HITS,
+                                        transparent_hit);
+
+    column_buffer Buffers[RenderEngine_Count];
+    ray_data *RaycastData[RenderEngine_Count];
+    for (u32 Engine = 0;
+         Engine < RenderEngine_Count;
+         ++Engine)
+    {
+        InitializeColumnBuffer(&Buffers[Engine], BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT, &Arena);
+        ResizeColumnBuffer(&Buffers[Engine], BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT);
+        RaycastData[Engine] = PushArray(&Arena, RAYCAST_NUM, ray_data);
+    }
+
+    char *SceneNames[] = {"open 1024", "rooms 128", "rooms 128 steps+grates", "rooms 128 lit"};
+    // NOTE: Every scene at 1/8, 1/4, 1/2 and all of the game's columns, on
+    // the same screen, so the pixels stay put and only the walk changes
+    i32 ColumnCounts[] = {RAYCAST_NUM / 8, RAYCAST_NUM / 4, RAYCAST_NUM / 2, RAYCAST_NUM};
+    u32 ViewCount = 64;
+    if (Csv)
+    {
+        printf("scene,columns,avg_steps,avg_cells,avg_faces_swept,avg_faces_drawn,avg_column_draws,"
+               "raycast_ms,faces_ms,speedup,mismatched_pixels,mismatched_rays\n");
+    }
+    else
+    {
+        printf("walls only, %dx%d, %u views per scene and column count\n",
+               BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT, ViewCount);
+        printf("steps: ray caster cells walked; cells, faces swept and drawn, column draws: face sweep\n");
+        printf("%-24s %7s %9s %7s %7s %7s %9s %10s %10s %8s %9s %6s\n",
+               "scene", "columns", "steps", "cells", "swept", "drawn", "col draws",
+               "raycast ms", "faces ms", "speedup", "px differ", "rays");
+    }
+
+    int Result = 0;
+    for (u32 SceneIndex = 0;
+         SceneIndex < sizeof(SceneNames)/sizeof(SceneNames[0]);
+         ++SceneIndex)
+    {
+        memory_arena SceneArena;
+        memory_index SceneArenaSize = Megabytes(256);
+        InitializeArena(&SceneArena, SceneArenaSize, (u8 *)PushSize_(&Arena, SceneArenaSize));
+        game_state *State = BuildBenchGameState(SceneArena.Base, SceneArena.Size,
+                                                (SceneIndex == 0) ? 1024 : 128, 0);
+        if (SceneIndex > 0)
+        {
+            BuildBenchMaze(&State->Map, 128, 0xC0FFEE, &State->Arena);
+        }
+        if (SceneIndex >= 2)
+        {
+            AddBenchHeightsAndGrates(&State->Map, 0xFACADE);
+        }
+
+        face_lighting NoLighting = {};
+        Render->Lighting = NoLighting;
+        if (SceneIndex == 3)
+        {
+            AddBenchLights(State, GAME_MAX_LIGHTS, 0x11647);
+            UpdateFaceLighting(&Render->Lighting, &State->Map, State->AmbientLight,
+                               State->Lights, State->LightCount, &Render->Arena);
+        }
+
+        for (u32 CountIndex = 0;
+             CountIndex < sizeof(ColumnCounts)/sizeof(ColumnCounts[0]);
+             ++CountIndex)
+        {
+            render_bench_result SceneResult = MeasureRenderScene(State, Render, Buffers, RaycastData, ViewCount,
+                                                                 0xBEEF + SceneIndex, ColumnCounts[CountIndex]);
+            PrintRenderBenchResult(SceneNames[SceneIndex], ColumnCounts[CountIndex], &SceneResult, Csv);
+            if (SceneResult.MismatchedPixels || SceneResult.MismatchedRays)
+            {
+                Result = 1;
+            }
+        }
+    }
+
+    munmap(Storage, StorageSize);
+    return Result;
+}
+
+enum bench_light_event
+{
+    BenchLightEvent_Toggle,
+    BenchLightEvent_Move,
+    BenchLightEvent_Recolor,
+    BenchLightEvent_Wall,
+
+    BenchLightEvent_Count,
+};
+
+internal int
+RunLightingBench(bool32 Csv)
+{
+    memory_index StorageSize = Gigabytes(1);
+    void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (Storage == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not reserve bench memory\n");
+        return 1;
+    }
+    memory_arena Arena;
+    InitializeArena(&Arena, StorageSize, Storage);
+
+    // NOTE: The scene the render bench lights, on a bigger maze
+    i32 MapSize = 256;
+    memory_arena SceneArena;
+    memory_index SceneArenaSize = Megabytes(256);
+    InitializeArena(&SceneArena, SceneArenaSize, (u8 *)PushSize_(&Arena, SceneArenaSize));
+    game_state *State = BuildBenchGameState(SceneArena.Base, SceneArena.Size, MapSize, 0);
+    BuildBenchMaze(&State->Map, MapSize, 0xC0FFEE, &State->Arena);
+    AddBenchHeightsAndGrates(&State->Map, 0xFACADE);
+    AddBenchLights(State, GAME_MAX_LIGHTS, 0x11647);
+    game_map *Map = &State->Map;
+
+    // NOTE: Incremental lightmaps live on Arena for the whole run; the full
+    // rebakes they're checked against go on a scratch arena reset each time
+    face_lighting *Lighting = PushStruct(&Arena, face_lighting);
+    face_lighting *Reference = PushStruct(&Arena, face_lighting);
+    *Lighting = {};
+    u64 BakeStart = BenchGetWallClock();
+    UpdateFaceLighting(Lighting, Map, State->AmbientLight, State->Lights, State->LightCount, &Arena);
+    u64 BakeNanoseconds = BenchGetWallClock() - BakeStart;
+    u32 BakeFaces = Lighting->FacesRelit;
+    memory_index LuxelCount = (memory_index)MapSize*MapSize*MapFace_Count*LIGHTMAP_LUXELS;
+    memory_arena ScratchArena;
+    memory_index ScratchArenaSize = LuxelCount*sizeof(u32) + Megabytes(1);
+    InitializeArena(&ScratchArena, ScratchArenaSize, (u8 *)PushSize_(&Arena, ScratchArenaSize));
+
+    char *EventNames[BenchLightEvent_Count] = {"toggle", "move", "recolor", "wall"};
+    u32 EventsPerKind = 64;
+    if (Csv)
+    {
+        printf("event,count,faces_relit,relight_us,full_bake_us,speedup,mismatched_luxels\n");
+    }
+    else
+    {
+        printf("face lightmaps, %dx%d maze, %u lights, %u luxels a face\n",
+               MapSize, MapSize, State->LightCount, LIGHTMAP_LUXELS);
+        printf("full bake: %u faces in %.2f ms, %llu KB\n", BakeFaces, (f64)BakeNanoseconds/1.0e6,
+               (unsigned long long)(LuxelCount*sizeof(u32)/1024));
+        printf("%-8s %8s %12s %12s %12s %8s %10s\n",
+               "event", "count", "faces/event", "relight us", "full us", "speedup", "mismatch");
+    }
+
+    int Result = 0;
+    u32 Seed = 0x5EED;
+    for (u32 Kind = 0;
+         Kind < BenchLightEvent_Count;
+         ++Kind)
+    {
+        u64 RelightNanoseconds = 0;
+        u64 FullNanoseconds = 0;
+        u64 FacesRelit = 0;
+        u64 MismatchedLuxels = 0;
+        for (u32 EventIndex = 0;
+             EventIndex < EventsPerKind;
+             ++EventIndex)
+        {
+            point_light *Light = &State->Lights[BenchRandom(&Seed) % State->LightCount];
+            if (Kind == BenchLightEvent_Toggle)
+            {
+                Light->On = !Light->On;
+            }
+            else if (Kind == BenchLightEvent_Move)
+            {
+                f32 NewX = Light->X + 0.25f*(f32)((i32)(BenchRandom(&Seed) % 5) - 2);
+                f32 NewY = Light->Y + 0.25f*(f32)((i32)(BenchRandom(&Seed) % 5) - 2);
+                if (!IsTileSolid(Map, TruncateF32ToI32(NewX), TruncateF32ToI32(NewY)))
+                {
+                    Light->X = NewX;
+                    Light->Y = NewY;
+                }
+            }
+            else if (Kind == BenchLightEvent_Recolor)
+            {
+                Light->Red = 0.5f + (f32)(BenchRandom(&Seed) % 100) / 100.0f;
+            }
+            else
+            {
+                // NOTE: Open or close a doorway cell somewhere some light reaches
+                i32 CellX = TruncateF32ToI32(Light->X) + (i32)(BenchRandom(&Seed) % 7) - 3;
+                i32 CellY = TruncateF32ToI32(Light->Y) + (i32)(BenchRandom(&Seed) % 7) - 3;
+                if ((CellX > 0) && (CellY > 0) && (CellX < MapSize - 1) && (CellY < MapSize - 1) &&
+                    ((CellX != TruncateF32ToI32(Light->X)) || (CellY != TruncateF32ToI32(Light->Y))))
+                {
+                    u8 *Tile = &Map->Tiles[CellY*MapSize + CellX];
+                    *Tile = (*Tile == MapTile_Empty) ? MapTile_Wall : MapTile_Empty;
+                    UpdateMapOccupancy(Map);
+                    lighting_region Changed = {CellX, CellY, CellX, CellY};
+                    MarkLightingCellsChanged(Lighting, Changed);
+                }
+            }
+
+            u64 RelightStart = BenchGetWallClock();
+            UpdateFaceLighting(Lighting, Map, State->AmbientLight, State->Lights, State->LightCount, &Arena);
+            RelightNanoseconds += BenchGetWallClock() - RelightStart;
+            FacesRelit += Lighting->FacesRelit;
+
+            ScratchArena.Used = 0;
+            *Reference = {};
+            u64 FullStart = BenchGetWallClock();
+            UpdateFaceLighting(Reference, Map, State->AmbientLight, State->Lights, State->LightCount, &ScratchArena);
+            FullNanoseconds += BenchGetWallClock() - FullStart;
+            for (memory_index LuxelIndex = 0;
+                 LuxelIndex < LuxelCount;
+                 ++LuxelIndex)
+            {
+                MismatchedLuxels += (Lighting->Luxels[LuxelIndex] != Reference->Luxels[LuxelIndex]) ? 1 : 0;
+            }
+        }
+
+        f64 RelightMicroseconds = (f64)RelightNanoseconds / (1.0e3*EventsPerKind);
+        f64 FullMicroseconds = (f64)FullNanoseconds / (1.0e3*EventsPerKind);
+        if (Csv)
+        {
+            printf("%s,%u,%llu,%.1f,%.1f,%.1f,%llu\n",
+                   EventNames[Kind], EventsPerKind, (unsigned long long)(FacesRelit/EventsPerKind),
+                   RelightMicroseconds, FullMicroseconds, FullMicroseconds / RelightMicroseconds,
+                   (unsigned long long)MismatchedLuxels);
+        }
+        else
+        {
+            printf("%-8s %8u %12llu %12.1f %12.1f %7.1fx %10llu\n",
+                   EventNames[Kind], EventsPerKind, (unsigned long long)(FacesRelit/EventsPerKind),
+                   RelightMicroseconds, FullMicroseconds, FullMicroseconds / RelightMicroseconds,
+                   (unsigned long long)MismatchedLuxels);
+        }
+        if (MismatchedLuxels)
+        {
+            Result = 1;
+        }
+    }
+
+    munmap(Storage, StorageSize);
+    return Result;
+}
+
+// NOTE: Five minutes of sim ticks
+#define BENCH_TIMER_MAX_DELAY (5*60*SIM_TICKS_PER_SECOND)
+
+// NOTE: What one bench timer is still waiting for: the tick it's due, or
+// zero once it's fired for good or been cancelled
+struct bench_timer
+{
+    u64 ExpectedTick;
+    event_handle Handle;
+};
+
+struct bench_flat_timer
+{
+    u64 FireTick;
+    u32 Target;
+};
+
+// NOTE: One in four timers repeat, like a cooldown, a couple of times over
+inline bool32
+ShouldBenchTimerRepeat(u32 Target, u64 Tick)
+{
+    bool32 Result = (((Target & 3) == 0) && (Tick < 3*BENCH_TIMER_MAX_DELAY));
+    return Result;
+}
+
+// NOTE: Runs flat timers to Tick the obvious way: look at every one of them.
+// Returns how many fired.
+internal u32
+TickBenchFlatTimers(bench_flat_timer *Timers, u32 *Count, u64 Tick, u32 *Seed)
+{
+    u32 Result = 0;
+    for (u32 TimerIndex = 0;
+         TimerIndex < *Count;
+         )
+    {
+        bench_flat_timer *Timer = &Timers[TimerIndex];
+        if (Timer->FireTick == Tick)
+        {
+            ++Result;
+            if (ShouldBenchTimerRepeat(Timer->Target, Tick))
+            {
+                Timer->FireTick = Tick + 1 + BenchRandom(Seed) % BENCH_TIMER_MAX_DELAY;
+                ++TimerIndex;
+            }
+            else
+            {
+                *Timer = Timers[--*Count];
+            }
+        }
+        else
+        {
+            ++TimerIndex;
+        }
+    }
+    return Result;
+}
+
+internal int
+RunSchedulerBench(bool32 Csv)
+{
+    memory_index StorageSize = Megabytes(64);
+    void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (Storage == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not reserve bench memory\n");
+        return 1;
+    }
+
+    if (Csv)
+    {
+        printf("pending,insert_ns,cancel_ns,idle_wheel_ns_per_tick,idle_scan_ns_per_tick,"
+               "busy_ticks,fired,busy_wheel_ns_per_tick,busy_scan_ns_per_tick,mismatches\n");
+    }
+    else
+    {
+        printf("timing wheel, %u levels of %u slots, delays up to %u ticks, a quarter cancelled\n",
+               EVENT_WHEEL_LEVELS, EVENT_WHEEL_SLOTS, BENCH_TIMER_MAX_DELAY);
+        printf("%8s %9s %9s %12s %12s %8s %8s %12s %12s %8s\n",
+               "pending", "insert ns", "cancel ns", "idle wheel", "idle scan",
+               "ticks", "fired", "busy wheel", "busy scan", "mismatch");
+    }
+
+    int Result = 0;
+    u32 PendingCounts[] = {1024, 8192, 32768, 65536};
+    for (u32 CountIndex = 0;
+         CountIndex < ArrayCount(PendingCounts);
+         ++CountIndex)
+    {
+        u32 TimerCount = PendingCounts[CountIndex];
+        memory_arena Arena;
+        InitializeArena(&Arena, StorageSize, Storage);
+        event_scheduler *Scheduler = PushStruct(&Arena, event_scheduler);
+        InitializeEventScheduler(Scheduler, TimerCount, 0, &Arena);
+        bench_timer *Timers = PushArray(&Arena, TimerCount, bench_timer);
+        bench_flat_timer *FlatTimers = PushArray(&Arena, TimerCount, bench_flat_timer);
+        u64 Mismatches = 0;
+
+        // NOTE: Idle: everything far off, so no tick in the run fires anything
+        u64 IdleTicks = 100000;
+        u32 Seed = 0x71CC + TimerCount;
+        for (u32 TimerIndex = 0;
+             TimerIndex < TimerCount;
+             ++TimerIndex)
+        {
+            u64 Delay = 2*IdleTicks + BenchRandom(&Seed) % (16*IdleTicks);
+            ScheduleEvent(Scheduler, Delay, GameEvent_None, TimerIndex, 0);
+            FlatTimers[TimerIndex].FireTick = Delay;
+            FlatTimers[TimerIndex].Target = TimerIndex;
+        }
+
+        u64 IdleWheelStart = BenchGetWallClock();
+        u64 IdleFired = 0;
+        scheduled_event Event;
+        for (u64 Tick = 1;
+             Tick <= IdleTicks;
+             ++Tick)
+        {
+            AdvanceEventScheduler(Scheduler, Tick);
+            while (PopDueEvent(Scheduler, &Event))
+            {
+                ++IdleFired;
+            }
+        }
+        u64 IdleWheelNanoseconds = BenchGetWallClock() - IdleWheelStart;
+
+        // NOTE: The scan is slow enough that a slice of the run says as much
+        u64 IdleScanTicks = IdleTicks / 10;
+        u32 FlatCount = TimerCount;
+        u64 IdleScanStart = BenchGetWallClock();
+        for (u64 Tick = 1;
+             Tick <= IdleScanTicks;
+             ++Tick)
+        {
+            IdleFired += TickBenchFlatTimers(FlatTimers, &FlatCount, Tick, &Seed);
+        }
+        u64 IdleScanNanoseconds = BenchGetWallClock() - IdleScanStart;
+        Mismatches += IdleFired;
+
+        // NOTE: Busy: a fresh wheel of timers due within BENCH_TIMER_MAX_DELAY,
+        // a quarter cancelled, the rest run until they're all done
+        Arena.Used = 0;
+        Scheduler = PushStruct(&Arena, event_scheduler);
+        InitializeEventScheduler(Scheduler, TimerCount, 0, &Arena);
+        Timers = PushArray(&Arena, TimerCount, bench_timer);
+        FlatTimers = PushArray(&Arena, TimerCount, bench_flat_timer);
+        Seed = 0xB05C + TimerCount;
+        u64 InsertStart = BenchGetWallClock();
+        for (u32 TimerIndex = 0;
+             TimerIndex < TimerCount;
+             ++TimerIndex)
+        {
+            u64 Delay = 1 + BenchRandom(&Seed) % BENCH_TIMER_MAX_DELAY;
+            Timers[TimerIndex].Handle = ScheduleEvent(Scheduler, Delay, GameEvent_None, TimerIndex, 0);
+            Timers[TimerIndex].ExpectedTick = Delay;
+        }
+        u64 InsertNanoseconds = BenchGetWallClock() - InsertStart;
+
+        FlatCount = 0;
+        u32 CancelCount = 0;
+        u64 CancelStart = BenchGetWallClock();
+        for (u32 TimerIndex = 1;
+             TimerIndex < TimerCount;
+             TimerIndex += 4)
+        {
+            if (CancelEvent(Scheduler, Timers[TimerIndex].Handle))
+            {
+                Timers[TimerIndex].ExpectedTick = 0;
+                ++CancelCount;
+            }
+        }
+        u64 CancelNanoseconds = BenchGetWallClock() - CancelStart;
+        for (u32 TimerIndex = 0;
+             TimerIndex < TimerCount;
+             ++TimerIndex)
+        {
+            // NOTE: A second cancel must find nothing to cancel
+            if (((TimerIndex & 3) == 1) && CancelEvent(Scheduler, Timers[TimerIndex].Handle))
+            {
+                ++Mismatches;
+            }
+            if (Timers[TimerIndex].ExpectedTick)
+            {
+                FlatTimers[FlatCount].FireTick = Timers[TimerIndex].ExpectedTick;
+                FlatTimers[FlatCount].Target = TimerIndex;
+                ++FlatCount;
+            }
+        }
+
+        u64 BusyTicks = 0;
+        u64 Fired = 0;
+        u32 RepeatSeed = 0x4E9E47;
+        u64 BusyWheelStart = BenchGetWallClock();
+        while (Scheduler->PendingCount)
+        {
+            u64 Tick = ++BusyTicks;
+            AdvanceEventScheduler(Scheduler, Tick);
+            while (PopDueEvent(Scheduler, &Event))
+            {
+                bench_timer *Timer = &Timers[Event.Target];
+                if ((Event.FireTick != Tick) || (Timer->ExpectedTick != Tick))
+                {
+                    ++Mismatches;
+                }
+                ++Fired;
+
+                Timer->ExpectedTick = 0;
+                if (ShouldBenchTimerRepeat(Event.Target, Tick))
+                {
+                    u64 Delay = 1 + BenchRandom(&RepeatSeed) % BENCH_TIMER_MAX_DELAY;
+                    Timer->Handle = ScheduleEvent(Scheduler, Delay, GameEvent_None, Event.Target, 0);
+                    Timer->ExpectedTick = Tick + Delay;
+                }
+            }
+        }
+        u64 BusyWheelNanoseconds = BenchGetWallClock() - BusyWheelStart;
+        for (u32 TimerIndex = 0;
+             TimerIndex < TimerCount;
+             ++TimerIndex)
+        {
+            if (Timers[TimerIndex].ExpectedTick)
+            {
+                ++Mismatches;
+            }
+        }
+
+        u64 ScanFired = 0;
+        RepeatSeed = 0x4E9E47;
+        u64 BusyScanStart = BenchGetWallClock();
+        for (u64 Tick = 1;
+             Tick <= BusyTicks;
+             ++Tick)
+        {
+            ScanFired += TickBenchFlatTimers(FlatTimers, &FlatCount, Tick, &RepeatSeed);
+        }
+        u64 BusyScanNanoseconds = BenchGetWallClock() - BusyScanStart;
+        if (ScanFired != Fired)
+        {
+            ++Mismatches;
+        }
+
+        f64 InsertNs = (f64)InsertNanoseconds / (f64)TimerCount;
+        f64 CancelNs = CancelCount ? (f64)CancelNanoseconds / (f64)CancelCount : 0.0;
+        f64 IdleWheelNs = (f64)IdleWheelNanoseconds / (f64)IdleTicks;
+        f64 IdleScanNs = (f64)IdleScanNanoseconds / (f64)IdleScanTicks;
+        f64 BusyWheelNs = (f64)BusyWheelNanoseconds / (f64)BusyTicks;
+        f64 BusyScanNs = (f64)BusyScanNanoseconds / (f64)BusyTicks;
+        if (Csv)
+        {
+            printf("%u,%.1f,%.1f,%.1f,%.1f,%llu,%llu,%.1f,%.1f,%llu\n",
+                   TimerCount, InsertNs, CancelNs, IdleWheelNs, IdleScanNs,
+                   (unsigned long long)BusyTicks, (unsigned long long)Fired, BusyWheelNs, BusyScanNs,
+                   (unsigned long long)Mismatches);
+        }
+        else
+        {
+            printf("%8u %9.1f %9.1f %12.1f %12.1f %8llu %8llu %12.1f %12.1f %8llu\n",
+                   TimerCount, InsertNs, CancelNs, IdleWheelNs, IdleScanNs,
+                   (unsigned long long)BusyTicks, (unsigned long long)Fired, BusyWheelNs, BusyScanNs,
+                   (unsigned long long)Mismatches);
+        }
+        if (Mismatches)
+        {
+            Result = 1;
+        }
+    }
+
+    munmap(Storage, StorageSize);
+    return Result;
+}
+
+#define BENCH_TEXTURE_COUNT 2048
+
+internal int
+RemoveBenchFile(const char *Path, const struct stat *Status, int Type, struct FTW *Walk)
+{
+    int Result = remove(Path);
+    return Result;
+}
+
+struct bench_texture_source
+{
+    char *Path;
+    char *Extension;
+    platform_read_file_result File;
+
+    // NOTE: What every copy has to decode to
+    i32 Width;
+    i32 Height;
+    u32 *Pixels;
+};
+
+internal bool32
+VerifyBenchTextures(texture_load *Loads, u32 Count, bench_texture_source *Sources, u32 SourceCount)
+{
+    bool32 Result = true;
+    for (u32 LoadIndex = 0;
+         LoadIndex < Count;
+         ++LoadIndex)
+    {
+        bench_texture_source *Source = &Sources[LoadIndex % SourceCount];
+        texture *Texture = Loads[LoadIndex].Texture;
+        bool32 Match = (Texture->Pixels && (Texture->Width == Source->Width) && (Texture->Height == Source->Height) &&
+                        (memcmp(Texture->Pixels, Source->Pixels, (memory_index)Source->Width*Source->Height*4) == 0));
+        if (!Match)
+        {
+            fprintf(stderr, "%s doesn't match its source\n", Loads[LoadIndex].Filename);
+            Result = false;
+        }
+    }
+    return Result;
+}
+
+internal int
+RunTextureBench(bool32 Csv)
+{
+    // NOTE: Run from data/, like the game. The sources are copied into a
+    // scratch directory BENCH_TEXTURE_COUNT times over, each copy with its
+    // own trailing bytes so it hashes to its own cache entry; both formats
+    // ignore anything after the image.
+    //
+    // The BMPs have to come out exactly as the raw pixels LoadBMP used to
+    // point straight into. The PNG has no such reference, so the first,
+    // serial decode is the reference for the rest: cached and parallel
+    // loads have to agree with it.
+    bench_texture_source Sources[] =
+    {
+        {"textures/brick.bmp", "bmp"},
+        {"textures/enemy.bmp", "bmp"},
+        {"textures/font.bmp", "bmp"},
+        {"textures/brick_400.bmp", "bmp"},
+        {"textures/enemy.png", "png"},
+    };
+    u32 SourceCount = ArrayCount(Sources);
+    for (u32 SourceIndex = 0;
+         SourceIndex < SourceCount;
+         ++SourceIndex)
+    {
+        bench_texture_source *Source = &Sources[SourceIndex];
+        Source->File = PLATFORMReadEntireFile(Source->Path);
+        if (!Source->File.ContentsSize)
+        {
+            fprintf(stderr, "Could not read %s; run the texture bench from data/\n", Source->Path);
+            return 1;
+        }
+        if (strcmp(Source->Extension, "bmp") == 0)
+        {
+            u8 *Header = (u8 *)Source->File.Contents;
+            Source->Width = (i32)ReadU32LE(Header + 18);
+            Source->Height = (i32)ReadU32LE(Header + 22);
+            Source->Pixels = (u32 *)(Header + ReadU32LE(Header + 10));
+        }
+    }
+
+    char DataDirectory[PATH_MAX];
+    char ScratchDirectory[] = "/tmp/rayc_textures_XXXXXX";
+    if (!getcwd(DataDirectory, sizeof(DataDirectory)) || !mkdtemp(ScratchDirectory) ||
+        (chdir(ScratchDirectory) != 0))
+    {
+        fprintf(stderr, "Could not set up a scratch directory\n");
+        return 1;
+    }
+
+    texture_load *Loads = (texture_load *)calloc(BENCH_TEXTURE_COUNT, sizeof(texture_load));
+    texture *Textures = (texture *)calloc(BENCH_TEXTURE_COUNT, sizeof(texture));
+    u64 SourceBytes = 0;
+    for (u32 LoadIndex = 0;
+         LoadIndex < BENCH_TEXTURE_COUNT;
+         ++LoadIndex)
+    {
+        bench_texture_source *Source = &Sources[LoadIndex % SourceCount];
+        char *Filename = (char *)malloc(64);
+        snprintf(Filename, 64, "sources/%05u.%s", LoadIndex, Source->Extension);
+
+        u32 FileSize = Source->File.ContentsSize + 4;
+        u8 *File = (u8 *)malloc(FileSize);
+        memcpy(File, Source->File.Contents, Source->File.ContentsSize);
+        memcpy(File + Source->File.ContentsSize, &LoadIndex, 4);
+        PLATFORMWriteEntireFile(Filename, FileSize, File);
+        free(File);
+        SourceBytes += FileSize;
+
+        Loads[LoadIndex].Filename = Filename;
+        Loads[LoadIndex].Texture = &Textures[LoadIndex];
+    }
+
+    memory_index StorageSize = Gigabytes(2);
+    char *RunNames[] = {"cold serial", "warm serial", "cold parallel", "warm parallel"};
+    if (Csv)
+    {
+        printf("run,textures,threads,ms,from_cache,decoded,failed,source_mb,verified\n");
+    }
+    else
+    {
+        printf("%u textures (%u BMPs and a PNG, round robin), %.1f MB of source\n",
+               BENCH_TEXTURE_COUNT, SourceCount - 1, (f64)SourceBytes / (1024.0*1024.0));
+        printf("%-16s %8s %10s %10s %10s %8s %9s\n",
+               "run", "threads", "ms", "cached", "decoded", "failed", "verified");
+    }
+
+    int Result = 0;
+    for (u32 Run = 0;
+         Run < ArrayCount(RunNames);
+         ++Run)
+    {
+        // NOTE: The serial runs go first, before the queue has any workers,
+        // so CompleteAllWork does everything on this thread
+        bool32 Cold = ((Run & 1) == 0);
+        if (Run == 2)
+        {
+            LinuxStartWorkQueue(&GlobalWorkQueue, LinuxGetSpareCoreCount());
+        }
+        if (Cold)
+        {
+            nftw(TEXTURE_CACHE_DIRECTORY, RemoveBenchFile, 16, FTW_DEPTH|FTW_PHYS);
+        }
+
+        void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                             MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+        if (Storage == MAP_FAILED)
+        {
+            fprintf(stderr, "Could not reserve bench memory\n");
+            Result = 1;
+            break;
+        }
+        memory_arena Arena;
+        InitializeArena(&Arena, StorageSize, Storage);
+
+        u64 Start = BenchGetWallClock();
+        texture_load_stats Stats = LoadTextures(Loads, BENCH_TEXTURE_COUNT, &Arena);
+        u64 Elapsed = BenchGetWallClock() - Start;
+
+        for (u32 SourceIndex = 0;
+             SourceIndex < SourceCount;
+             ++SourceIndex)
+        {
+            bench_texture_source *Source = &Sources[SourceIndex];
+            texture *First = &Textures[SourceIndex];
+            if (!Source->Pixels && First->Pixels)
+            {
+                memory_index Size = (memory_index)First->Width*First->Height*4;
+                Source->Width = First->Width;
+                Source->Height = First->Height;
+                Source->Pixels = (u32 *)malloc(Size);
+                memcpy(Source->Pixels, First->Pixels, Size);
+            }
+        }
+        bool32 Verified = VerifyBenchTextures(Loads, BENCH_TEXTURE_COUNT, Sources, SourceCount);
+        if (!Verified || Stats.Failed)
+        {
+            Result = 1;
+        }
+
+        f64 Milliseconds = (f64)Elapsed / 1.0e6;
+        if (Csv)
+        {
+            printf("%s,%u,%u,%.2f,%u,%u,%u,%.1f,%s\n",
+                   RunNames[Run], BENCH_TEXTURE_COUNT, GlobalWorkQueue.ThreadCount + 1, Milliseconds,
+                   Stats.FromCache, Stats.Decoded, Stats.Failed, (f64)SourceBytes / (1024.0*1024.0),
+                   Verified ? "yes" : "no");
+        }
+        else
+        {
+            printf("%-16s %8u %10.2f %10u %10u %8u %9s\n",
+                   RunNames[Run], GlobalWorkQueue.ThreadCount + 1, Milliseconds,
+                   Stats.FromCache, Stats.Decoded, Stats.Failed, Verified ? "yes" : "no");
+        }
+
+        // NOTE: Cached textures live in their cache file's memory
+        for (u32 LoadIndex = 0;
+             LoadIndex < BENCH_TEXTURE_COUNT;
+             ++LoadIndex)
+        {
+            if (Loads[LoadIndex].FromCache)
+            {
+                PLATFORMFreeFileMemory((texture_cache_header *)Textures[LoadIndex].Pixels - 1);
+            }
+        }
+        munmap(Storage, StorageSize);
+    }
+
+    for (u32 LoadIndex = 0;
+         LoadIndex < BENCH_TEXTURE_COUNT;
+         ++LoadIndex)
+    {
+        free(Loads[LoadIndex].Filename);
+    }
+    free(Loads);
+    free(Textures);
+    for (u32 SourceIndex = 0;
+         SourceIndex < SourceCount;
+         ++SourceIndex)
+    {
+        bench_texture_source *Source = &Sources[SourceIndex];
+        if (strcmp(Source->Extension, "png") == 0)
+        {
+            free(Source->Pixels);
+        }
+        PLATFORMFreeFileMemory(Source->File.Contents);
+    }
+
+    if (chdir(DataDirectory) == 0)
+    {
+        nftw(ScratchDirectory, RemoveBenchFile, 16, FTW_DEPTH|FTW_PHYS);
+    }
+    return Result;
+}
+
+internal u64
+HashBenchLevel(game_map *Map, generated_level *Level)
+{
+    // NOTE: FNV-1a over the tiles and the spawns
+    u64 Result = 0xCBF29CE484222325ULL;
+    memory_index CellCount = (memory_index)Map->Width*Map->Height;
+    for (memory_index CellIndex = 0;
+         CellIndex < CellCount;
+         ++CellIndex)
+    {
+        Result = (Result ^ Map->Tiles[CellIndex])*0x100000001B3ULL;
+    }
+
+    u8 *SpawnBytes = (u8 *)Level->Spawns;
+    memory_index SpawnSize = Level->SpawnCount*sizeof(level_spawn);
+    for (memory_index ByteIndex = 0;
+         ByteIndex < SpawnSize;
+         ++ByteIndex)
+    {
+        Result = (Result ^ SpawnBytes[ByteIndex])*0x100000001B3ULL;
+    }
+    return Result;
+}
+
+internal int
+RunLevelGenBench(bool32 Csv)
+{
+    // NOTE: Workers for the strip-a-job runs, unless the textures suite has
+    // already started them
+    if (GlobalWorkQueue.ThreadCount == 0)
+    {
+        LinuxStartWorkQueue(&GlobalWorkQueue, LinuxGetSpareCoreCount());
+    }
+
+    u32 RobotCount = 100000;
+    u32 TickCount = 20;
+    if (Csv)
+    {
+        printf("kind,size,open_pct,threads,one_job_ms,jobs,strip_jobs_ms,mcells_per_s,identical,"
+               "flow_ms,unreached,robots,robot_ns_per_tick\n");
+    }
+    else
+    {
+        printf("generated levels, seed %u, %u robots, %u ticks of chasing, %u threads\n",
+               GlobalBenchLevelSeed, RobotCount, TickCount, GlobalWorkQueue.ThreadCount + 1);
+        printf("%-6s %6s %6s %10s %6s %10s %9s %9s %10s %9s %9s\n",
+               "kind", "size", "open%", "1 job ms", "jobs", "jobs ms", "Mcells/s",
+               "same", "flow ms", "unreach", "robot ns");
+    }
+
+    int Result = 0;
+    i32 Sizes[] = {1024, 4096, 8192};
+    for (u32 Kind = 0;
+         Kind < LevelKind_Count;
+         ++Kind)
+    {
+        for (u32 SizeIndex = 0;
+             SizeIndex < ArrayCount(Sizes);
+             ++SizeIndex)
+        {
+            i32 Size = Sizes[SizeIndex];
+            memory_index CellCount = (memory_index)Size*Size;
+            memory_index StorageSize = CellCount*48 + Megabytes(256);
+            void *Storage = mmap(0, StorageSize, PROT_READ|PROT_WRITE,
+                                 MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+            if (Storage == MAP_FAILED)
+            {
+                fprintf(stderr, "Could not reserve bench memory\n");
+                return 1;
+            }
+
+            level_params Params = {};
+            Params.Kind = (level_kind)Kind;
+            Params.Width = Size;
+            Params.Height = Size;
+            Params.Seed = GlobalBenchLevelSeed;
+            Params.RobotCount = RobotCount;
+            Params.StripsPerJob = (u32)((Size + LEVEL_STRIP_ROWS - 1) / LEVEL_STRIP_ROWS);
+
+            memory_arena Arena;
+            InitializeArena(&Arena, StorageSize, Storage);
+            game_map Map;
+            u64 OneJobStart = BenchGetWallClock();
+            generated_level Level = GenerateLevel(&Map, &Params, &Arena);
+            u64 OneJobNanoseconds = BenchGetWallClock() - OneJobStart;
+            u64 OneJobHash = HashBenchLevel(&Map, &Level);
+
+            // NOTE: Again over the same memory, a strip a job
+            InitializeArena(&Arena, StorageSize, Storage);
+            Params.StripsPerJob = 0;
+            u64 StripJobsStart = BenchGetWallClock();
+            Level = GenerateLevel(&Map, &Params, &Arena);
+            u64 StripJobsNanoseconds = BenchGetWallClock() - StripJobsStart;
+            bool32 Identical = (HashBenchLevel(&Map, &Level) == OneJobHash);
+
+            flow_field FlowField;
+            InitializeFlowField(&FlowField, &Map, &Arena);
+            u64 FlowStart = BenchGetWallClock();
+            UpdateFlowField(&FlowField, &Map, TruncateF32ToI32(Level.PlayerX), TruncateF32ToI32(Level.PlayerY),
+                            0xFFFFFFFF);
+            u64 FlowNanoseconds = BenchGetWallClock() - FlowStart;
+
+            u64 Unreached = 0;
+            u32 *Distance = FlowField.Buffers[FlowField.ReadIndex].Distance;
+            for (memory_index CellIndex = 0;
+                 CellIndex < CellCount;
+                 ++CellIndex)
+            {
+                if ((Map.Tiles[CellIndex] == MapTile_Empty) && (Distance[CellIndex] == FLOW_FIELD_UNREACHED))
+                {
+                    ++Unreached;
+                }
+            }
+
+            entity_store Store;
+            InitializeEntityStore(&Store, Level.SpawnCount, &Arena);
+            for (u32 SpawnIndex = 0;
+                 SpawnIndex < Level.SpawnCount;
+                 ++SpawnIndex)
+            {
+                AddEntity(&Store, Level.Spawns[SpawnIndex].X, Level.Spawns[SpawnIndex].Y);
+                Store.AIState[Store.Count - 1] = EntityAI_Chasing;
+            }
+
+            u64 RobotStart = BenchGetWallClock();
+            for (u32 Tick = 0;
+                 Tick < TickCount;
+                 ++Tick)
+            {
+                SteerRobots(&Store, &FlowField, Level.PlayerX, Level.PlayerY, 1.5f, 0.6f);
+                MoveEntities(&Store, &Map, SIM_SECONDS_PER_TICK, 0.2f);
+            }
+            u64 RobotNanoseconds = BenchGetWallClock() - RobotStart;
+
+            f64 OpenPercent = 100.0*(f64)Level.OpenCellCount / (f64)CellCount;
+            f64 OneJobMs = (f64)OneJobNanoseconds / 1000000.0;
+            f64 StripJobsMs = (f64)StripJobsNanoseconds / 1000000.0;
+            f64 CellsPerSecond = (f64)CellCount / ((f64)StripJobsNanoseconds / 1000000000.0);
+            f64 FlowMs = (f64)FlowNanoseconds / 1000000.0;
+            f64 RobotNs = Store.Count ? (f64)RobotNanoseconds / ((f64)Store.Count*(f64)TickCount) : 0.0;
+            if (Csv)
+            {
+                printf("%s,%d,%.1f,%u,%.1f,%u,%.1f,%.1f,%u,%.1f,%llu,%u,%.2f\n",
+                       BenchLevelNames[Kind], Size, OpenPercent, GlobalWorkQueue.ThreadCount + 1,
+                       OneJobMs, Level.JobCount, StripJobsMs, CellsPerSecond / 1000000.0, Identical ? 1 : 0,
+                       FlowMs, (unsigned long long)Unreached, Store.Count, RobotNs);
+            }
+            else
+            {
+                printf("%-6s %6d %6.1f %10.1f %6u %10.1f %9.1f %9s %10.1f %9llu %9.2f\n",
+                       BenchLevelNames[Kind], Size, OpenPercent, OneJobMs, Level.JobCount, StripJobsMs,
+                       CellsPerSecond / 1000000.0, Identical ? "yes" : "NO", FlowMs,
+                       (unsigned long long)Unreached, RobotNs);
+            }
+            if (!Identical || Unreached || (Level.SpawnCount != RobotCount))
+            {
+                Result = 1;
+            }
+
+            munmap(Storage, StorageSize);
+        }
+    }
+    return Result;
+}
+
+int
+main(int ArgCount, char **Args)
+{
+    u32 TickCount = 200;
+    i32 MapSize = 1024;
+    char *Suite = "all";
+    bool32 Csv = false;
+    for (int ArgIndex = 1;
+         ArgIndex < ArgCount;
+         ++ArgIndex)
+    {
+        if ((strcmp(Args[ArgIndex], "-ticks") == 0) && (ArgIndex + 1 < ArgCount))
+        {
+            TickCount = (u32)atoi(Args[++ArgIndex]);
+        }
+        else if ((strcmp(Args[ArgIndex], "-map") == 0) && (ArgIndex + 1 < ArgCount))
+        {
+            MapSize = atoi(Args[++ArgIndex]);
+        }
+        else if ((strcmp(Args[ArgIndex], "-suite") == 0) && (ArgIndex + 1 < ArgCount))
+        {
+            Suite = Args[++ArgIndex];
+        }
+        else if ((strcmp(Args[ArgIndex], "-level") == 0) && (ArgIndex + 1 < ArgCount))
+        {
+            char *LevelName = Args[++ArgIndex];
+            for (u32 Kind = 0;
+                 Kind < LevelKind_Count;
+                 ++Kind)
+            {
+                if (strcmp(LevelName, BenchLevelNames[Kind]) == 0)
+                {
+                    GlobalBenchUseLevel = true;
+                    GlobalBenchLevelKind = (level_kind)Kind;
+                }
+            }
+            if (!GlobalBenchUseLevel)
+            {
+                fprintf(stderr, "Unknown level kind %s\n", LevelName);
+                return 1;
+            }
+        }
+        else if ((strcmp(Args[ArgIndex], "-seed") == 0) && (ArgIndex + 1 < ArgCount))
+        {
+            GlobalBenchLevelSeed = (u32)strtoul(Args[++ArgIndex], 0, 0);
+        }
+        else if (strcmp(Args[ArgIndex], "-csv") == 0)
+        {
+            Csv = true;
+        }
+    }
+
+    bool32 All = (strcmp(Suite, "all") == 0);
+    int Result = 0;
+    if (All || (strcmp(Suite, "entities") == 0))
+    {
+        Result |= RunEntityBench(TickCount, MapSize, Csv);
+    }
+    if (All || (strcmp(Suite, "primitives") == 0))
+    {
+        Result |= RunPrimitiveBench(Csv);
+    }
+    if (All || (strcmp(Suite, "restart") == 0))
+    {
+        Result |= RunRestartBench(MapSize, Csv);
+    }
+    if (All || (strcmp(Suite, "pvs") == 0))
+    {
+        Result |= RunPVSBench(Csv);
+    }
+    if (All || (strcmp(Suite, "render") == 0))
+    {
+        Result |= RunRenderBench(Csv);
+    }
+    if (All || (strcmp(Suite, "textures") == 0))
+    {
+        Result |= RunTextureBench(Csv);
+    }
+    if (All || (strcmp(Suite, "occupancy") == 0))
+    {
+        Result |= RunOccupancyBench(Csv);
+    }
+    if (All || (strcmp(Suite, "lighting") == 0))
+    {
+        Result |= RunLightingBench(Csv);
+    }
+    if (All || (strcmp(Suite, "scheduler") == 0))
+    {
+        Result |= RunSchedulerBench(Csv);
+    }
+    if (All || (strcmp(Suite, "levelgen") == 0))
+    {
+        Result |= RunLevelGenBench(Csv);
+    }
+    return Result;
+}
@@ -0,0 +1,94 @@
+// NOTE: Whole-file reads and writes for every Linux front end: the game, the
+// batch runner and the bench.
+
+internal void
+PLATFORMFreeFileMemory(void *Memory)
+{
+    if (Memory)
+    {
+        free(Memory);
+    }
+}
+
+internal platform_read_file_result
+PLATFORMReadEntireFile(char *Filename)
+{
+    platform_read_file_result Result = {0};
+
+    int FileHandle = open(Filename, O_RDONLY);
+    if (FileHandle >= 0)
+    {
+        struct stat FileStatus;
+        if (fstat(FileHandle, &FileStatus) == 0)
+        {
+            u32 FileSize32 = SafeTruncateU64((u64)FileStatus.st_size);
+            Result.Contents = malloc(FileSize32);
+            if (Result.Contents)
+            {
+                ssize_t BytesRead = read(FileHandle, Result.Contents, FileSize32);
+                if (BytesRead == (ssize_t)FileSize32)
+                {
+                    Result.ContentsSize = FileSize32;
+                }
+                else
+                {
+                    PLATFORMFreeFileMemory(Result.Contents);
+                    Result.Contents = 0;
+                }
+            }
+            else
+            {
+                // TODO: Logging
+            }
+        }
+
+        close(FileHandle);
+    }
+    else
+    {
+        // TODO: Logging
+    }
+
+    return Result;
+}
+
+internal bool32
+PLATFORMWriteEntireFile(char *Filename, u32 MemorySize, void *Memory)
+{
+    // NOTE: Written under a name of its own and renamed over the real one,
+    // so other threads and processes see the old file or the new one, never
+    // half of either. A missing directory is made on the way.
+    bool32 Result = false;
+
+    char TempFilename[PATH_MAX];
+    snprintf(TempFilename, sizeof(TempFilename), "%s.%d.%ld.tmp", Filename, (int)getpid(), (long)syscall(SYS_gettid));
+    int FileHandle = open(TempFilename, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if ((FileHandle < 0) && (errno == ENOENT))
+    {
+        char Directory[PATH_MAX];
+        snprintf(Directory, sizeof(Directory), "%s", Filename);
+        char *Slash = strrchr(Directory, '/');
+        if (Slash)
+        {
+            *Slash = 0;
+            mkdir(Directory, 0755);
+            FileHandle = open(TempFilename, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+        }
+    }
+
+    if (FileHandle >= 0)
+    {
+        ssize_t BytesWritten = write(FileHandle, Memory, MemorySize);
+        close(FileHandle);
+        if ((BytesWritten == (ssize_t)MemorySize) && (rename(TempFilename, Filename) == 0))
+        {
+            Result = true;
+        }
+        else
+        {
+            unlink(TempFilename);
+        }
+    }
+
+    return Result;
+}
@@ -0,0 +1,490 @@
+// NOTE: Output sinks. A sink owns the memory frames are rendered into, so the
+// renderer draws straight into whatever the consumer reads and nothing copies
+// the framebuffer on the hot thread. Every sink hands frames to its consumer
+// through a triple buffer: the renderer always has a slot of its own to draw
+// into, publishing swaps it with the "middle" slot, and the consumer swaps the
+// middle slot for its own when it sees a fresh one. Neither side ever waits; if
+// the consumer is slow it simply skips to the newest frame.
+
+#define OUTPUT_SLOT_COUNT 3
+#define OUTPUT_SLOT_MASK 0x3
+#define OUTPUT_SLOT_FRESH 0x4
+
+struct output_sink;
+
+#define OUTPUT_SINK_ACQUIRE_FRAME(name) game_offscreen_buffer name(output_sink *Sink)
+typedef OUTPUT_SINK_ACQUIRE_FRAME(output_sink_acquire_frame);
+
+#define OUTPUT_SINK_SUBMIT_FRAME(name) void name(output_sink *Sink)
+typedef OUTPUT_SINK_SUBMIT_FRAME(output_sink_submit_frame);
+
+// NOTE: What a sink did over its life, as of closing it
+struct output_sink_totals
+{
+    u64 FramesSubmitted;
+    u64 FramesConsumed;
+};
+
+// NOTE: Frees the sink, so the totals come back from here rather than being
+// read off it afterwards
+#define OUTPUT_SINK_CLOSE(name) output_sink_totals name(output_sink *Sink)
+typedef OUTPUT_SINK_CLOSE(output_sink_close);
+
+struct output_sink
+{
+    output_sink_acquire_frame *AcquireFrame;
+    output_sink_submit_frame *SubmitFrame;
+    output_sink_close *Close;
+
+    u64 FramesSubmitted;
+    u64 FramesConsumed;
+};
+
+//
+// NOTE: Triple buffer handoff
+//
+
+struct output_triple_buffer
+{
+    // NOTE: Index of the middle slot, plus OUTPUT_SLOT_FRESH if the producer
+    // published into it since the consumer last took it.
+    u32 volatile Middle;
+    // NOTE: Bumped on every publish so consumers can futex-wait on it.
+    u32 volatile PublishCount;
+};
+
+internal void
+TripleBufferInit(output_triple_buffer *Triple, u32 *ProducerSlot, u32 *ConsumerSlot)
+{
+    *ProducerSlot = 0;
+    Triple->Middle = 1;
+    *ConsumerSlot = 2;
+    Triple->PublishCount = 0;
+}
+
+internal u32
+TripleBufferPublish(output_triple_buffer *Triple, u32 ProducerSlot)
+{
+    // NOTE: Returns the producer's next slot.
+    u32 Previous = AtomicExchangeU32(&Triple->Middle, ProducerSlot | OUTPUT_SLOT_FRESH);
+    AtomicStoreU32(&Triple->PublishCount, Triple->PublishCount + 1);
+    u32 Result = Previous & OUTPUT_SLOT_MASK;
+    return Result;
+}
+
+internal bool32
+TripleBufferConsume(output_triple_buffer *Triple, u32 *ConsumerSlot)
+{
+    bool32 Result = false;
+    if (AtomicLoadU32(&Triple->Middle) & OUTPUT_SLOT_FRESH)
+    {
+        u32 Previous = AtomicExchangeU32(&Triple->Middle, *ConsumerSlot);
+        *ConsumerSlot = Previous & OUTPUT_SLOT_MASK;
+        Result = true;
+    }
+    return Result;
+}
+
+inline game_offscreen_buffer
+OutputSlotBuffer(u8 *Base, u64 SlotSize, u32 Slot, i32 Width, i32 Height)
+{
+    game_offscreen_buffer Result = {};
+    Result.Data = Base + Slot*SlotSize;
+    Result.Width = Width;
+    Result.Height = Height;
+    Result.BytesPerPixel = 4;
+    Result.Pitch = Width*4;
+    return Result;
+}
+
+//
+// NOTE: Shared-memory frame ring
+//
+// Layout of the shared object, for external viewers and encoders:
+//   shm_frame_ring_header, padded to SHM_FRAME_RING_HEADER_SIZE
+//   SlotCount slots of SlotSize bytes, each a Width x Height BGRA frame with
+//   Pitch bytes per row, top row first
+// To read, start owning slot 2, then whenever Triple.Middle has the fresh bit
+// set, atomically exchange your slot index into Triple.Middle and take the low
+// two bits of what comes back as your new slot. Triple.PublishCount can be
+// waited on with FUTEX_WAIT (shared, not private).
+
+#define SHM_FRAME_RING_MAGIC 0x52594152 // 'RAYR'
+#define SHM_FRAME_RING_VERSION 1
+#define SHM_FRAME_RING_HEADER_SIZE 4096
+
+struct shm_frame_ring_header
+{
+    u32 Magic;
+    u32 Version;
+    u32 HeaderSize;
+    u32 SlotCount;
+    u64 SlotSize;
+    i32 Width;
+    i32 Height;
+    i32 Pitch;
+    u32 Reserved;
+
+    output_triple_buffer Triple;
+    u64 SlotFrameIndex[OUTPUT_SLOT_COUNT];
+};
+
+struct shm_output_sink
+{
+    output_sink Sink;
+
+    int FileDescriptor;
+    char Name[64];
+    u64 MappingSize;
+    shm_frame_ring_header *Header;
+    u8 *Slots;
+
+    u32 ProducerSlot;
+};
+
+internal OUTPUT_SINK_ACQUIRE_FRAME(ShmAcquireFrame)
+{
+    shm_output_sink *Shm = (shm_output_sink *)Sink;
+    shm_frame_ring_header *Header = Shm->Header;
+    game_offscreen_buffer Result = OutputSlotBuffer(Shm->Slots, Header->SlotSize, Shm->ProducerSlot,
+                                                    Header->Width, Header->Height);
+    return Result;
+}
+
+internal OUTPUT_SINK_SUBMIT_FRAME(ShmSubmitFrame)
+{
+    shm_output_sink *Shm = (shm_output_sink *)Sink;
+    shm_frame_ring_header *Header = Shm->Header;
+
+    Header->SlotFrameIndex[Shm->ProducerSlot] = Sink->FramesSubmitted++;
+    Shm->ProducerSlot = TripleBufferPublish(&Header->Triple, Shm->ProducerSlot);
+    syscall(SYS_futex, (u32 *)&Header->Triple.PublishCount, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+}
+
+internal OUTPUT_SINK_CLOSE(ShmClose)
+{
+    shm_output_sink *Shm = (shm_output_sink *)Sink;
+    output_sink_totals Result = {Sink->FramesSubmitted, Sink->FramesConsumed};
+    munmap(Shm->Header, Shm->MappingSize);
+    close(Shm->FileDescriptor);
+    if (Shm->Name[0])
+    {
+        shm_unlink(Shm->Name);
+    }
+    free(Shm);
+    return Result;
+}
+
+internal output_sink *
+LinuxOpenShmOutputSink(char *Name, i32 Width, i32 Height)
+{
+    // NOTE: With a name this is a POSIX shared memory object other processes
+    // can shm_open. Without one it's an anonymous memfd, reachable from outside
+    // through /proc/<pid>/fd/<fd>.
+    shm_output_sink *Shm = (shm_output_sink *)calloc(1, sizeof(shm_output_sink));
+
+    u64 Pitch = (u64)Width*4;
+    u64 SlotSize = (Pitch*(u64)Height + 4095) & ~4095ull;
+    Shm->MappingSize = SHM_FRAME_RING_HEADER_SIZE + OUTPUT_SLOT_COUNT*SlotSize;
+
+    if (Name)
+    {
+        snprintf(Shm->Name, sizeof(Shm->Name), "/%s", Name);
+        Shm->FileDescriptor = shm_open(Shm->Name, O_RDWR|O_CREAT|O_TRUNC, 0600);
+    }
+    else
+    {
+        Shm->FileDescriptor = (int)syscall(SYS_memfd_create, "rayc-frames", 0);
+    }
+
+    if ((Shm->FileDescriptor < 0) ||
+        (ftruncate(Shm->FileDescriptor, (off_t)Shm->MappingSize) != 0))
+    {
+        fprintf(stderr, "Could not create frame ring shared memory\n");
+        if (Shm->FileDescriptor >= 0) close(Shm->FileDescriptor);
+        free(Shm);
+        return 0;
+    }
+
+    void *Mapping = mmap(0, Shm->MappingSize, PROT_READ|PROT_WRITE, MAP_SHARED, Shm->FileDescriptor, 0);
+    if (Mapping == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not map frame ring shared memory\n");
+        close(Shm->FileDescriptor);
+        free(Shm);
+        return 0;
+    }
+
+    Shm->Header = (shm_frame_ring_header *)Mapping;
+    Shm->Slots = (u8 *)Mapping + SHM_FRAME_RING_HEADER_SIZE;
+
+    shm_frame_ring_header *Header = Shm->Header;
+    Header->Version = SHM_FRAME_RING_VERSION;
+    Header->HeaderSize = SHM_FRAME_RING_HEADER_SIZE;
+    Header->SlotCount = OUTPUT_SLOT_COUNT;
+    Header->SlotSize = SlotSize;
+    Header->Width = Width;
+    Header->Height = Height;
+    Header->Pitch = (i32)Pitch;
+    u32 UnusedConsumerSlot;
+    TripleBufferInit(&Header->Triple, &Shm->ProducerSlot, &UnusedConsumerSlot);
+    // NOTE: Magic last, so a viewer polling for it sees a complete header
+    AtomicStoreU32(&Header->Magic, SHM_FRAME_RING_MAGIC);
+
+    if (Name)
+    {
+        fprintf(stderr, "Frame ring at /dev/shm%s\n", Shm->Name);
+    }
+    else
+    {
+        fprintf(stderr, "Frame ring at /proc/%d/fd/%d\n", (int)getpid(), Shm->FileDescriptor);
+    }
+
+    Shm->Sink.AcquireFrame = ShmAcquireFrame;
+    Shm->Sink.SubmitFrame = ShmSubmitFrame;
+    Shm->Sink.Close = ShmClose;
+
+    return &Shm->Sink;
+}
+
+//
+// NOTE: Raw video stream writer (Y4M or concatenated PPM)
+//
+
+enum stream_format
+{
+    StreamFormat_Y4M,
+    StreamFormat_PPM,
+};
+
+struct stream_output_sink
+{
+    output_sink Sink;
+
+    stream_format Format;
+    FILE *File;
+    bool32 IsPipe;
+
+    i32 Width;
+    i32 Height;
+    u64 SlotSize;
+    u8 *Slots;
+    output_triple_buffer Triple;
+    u32 ProducerSlot;
+    u32 ConsumerSlot;
+
+    u8 *ConvertBuffer;
+    u64 ConvertBufferSize;
+
+    pthread_t WriterThread;
+    u32 volatile Quit;
+};
+
+internal void
+StreamConvertFrame(stream_output_sink *Stream, u32 *Pixels, u8 *Dest)
+{
+    // NOTE: Source pixels are 0xAARRGGBB
+    i32 PixelCount = Stream->Width*Stream->Height;
+    if (Stream->Format == StreamFormat_PPM)
+    {
+        for (i32 PixelIndex = 0;
+             PixelIndex < PixelCount;
+             ++PixelIndex)
+        {
+            u32 Pixel = Pixels[PixelIndex];
+            *Dest++ = (u8)(Pixel >> 16);
+            *Dest++ = (u8)(Pixel >> 8);
+            *Dest++ = (u8)(Pixel >> 0);
+        }
+    }
+    else
+    {
+        // NOTE: Planar 4:4:4, BT.601 limited range
+        u8 *DestY = Dest;
+        u8 *DestU = DestY + PixelCount;
+        u8 *DestV = DestU + PixelCount;
+        for (i32 PixelIndex = 0;
+             PixelIndex < PixelCount;
+             ++PixelIndex)
+        {
+            u32 Pixel = Pixels[PixelIndex];
+            i32 R = (i32)((Pixel >> 16) & 0xFF);
+            i32 G = (i32)((Pixel >> 8) & 0xFF);
+            i32 B = (i32)((Pixel >> 0) & 0xFF);
+            DestY[PixelIndex] = (u8)(((66*R + 129*G + 25*B + 128) >> 8) + 16);
+            DestU[PixelIndex] = (u8)(((-38*R - 74*G + 112*B + 128) >> 8) + 128);
+            DestV[PixelIndex] = (u8)(((112*R - 94*G - 18*B + 128) >> 8) + 128);
+        }
+    }
+}
+
+internal void *
+StreamWriterThreadProc(void *Parameter)
+{
+    stream_output_sink *Stream = (stream_output_sink *)Parameter;
+    output_sink *Sink = &Stream->Sink;
+
+    u32 LastPublishCount = 0;
+    for (;;)
+    {
+        if (TripleBufferConsume(&Stream->Triple, &Stream->ConsumerSlot))
+        {
+            u32 *Pixels = (u32 *)(Stream->Slots + Stream->ConsumerSlot*Stream->SlotSize);
+            StreamConvertFrame(Stream, Pixels, Stream->ConvertBuffer);
+
+            if (Stream->Format == StreamFormat_PPM)
+            {
+                fprintf(Stream->File, "P6\n%d %d\n255\n", Stream->Width, Stream->Height);
+            }
+            else
+            {
+                fputs("FRAME\n", Stream->File);
+            }
+            fwrite(Stream->ConvertBuffer, 1, Stream->ConvertBufferSize, Stream->File);
+            ++Sink->FramesConsumed;
+        }
+        else if (AtomicLoadU32(&Stream->Quit))
+        {
+            break;
+        }
+        else
+        {
+            syscall(SYS_futex, (u32 *)&Stream->Triple.PublishCount, FUTEX_WAIT_PRIVATE,
+                    LastPublishCount, 0, 0, 0);
+        }
+
+        LastPublishCount = AtomicLoadU32(&Stream->Triple.PublishCount);
+    }
+
+    fflush(Stream->File);
+    return 0;
+}
+
+internal OUTPUT_SINK_ACQUIRE_FRAME(StreamAcquireFrame)
+{
+    stream_output_sink *Stream = (stream_output_sink *)Sink;
+    game_offscreen_buffer Result = OutputSlotBuffer(Stream->Slots, Stream->SlotSize, Stream->ProducerSlot,
+                                                    Stream->Width, Stream->Height);
+    return Result;
+}
+
+internal OUTPUT_SINK_SUBMIT_FRAME(StreamSubmitFrame)
+{
+    stream_output_sink *Stream = (stream_output_sink *)Sink;
+    ++Sink->FramesSubmitted;
+    Stream->ProducerSlot = TripleBufferPublish(&Stream->Triple, Stream->ProducerSlot);
+    syscall(SYS_futex, (u32 *)&Stream->Triple.PublishCount, FUTEX_WAKE_PRIVATE, INT_MAX, 0, 0, 0);
+}
+
+internal void
+CloseStreamFile(stream_output_sink *Stream)
+{
+    if (Stream->IsPipe)
+    {
+        pclose(Stream->File);
+    }
+    else if (Stream->File != stdout)
+    {
+        fclose(Stream->File);
+    }
+}
+
+internal OUTPUT_SINK_CLOSE(StreamClose)
+{
+    stream_output_sink *Stream = (stream_output_sink *)Sink;
+
+    AtomicStoreU32(&Stream->Quit, 1);
+    AtomicStoreU32(&Stream->Triple.PublishCount, Stream->Triple.PublishCount + 1);
+    syscall(SYS_futex, (u32 *)&Stream->Triple.PublishCount, FUTEX_WAKE_PRIVATE, INT_MAX, 0, 0, 0);
+    pthread_join(Stream->WriterThread, 0);
+    // NOTE: Only final once the writer has stopped
+    output_sink_totals Result = {Sink->FramesSubmitted, Sink->FramesConsumed};
+
+    CloseStreamFile(Stream);
+    munmap(Stream->Slots, OUTPUT_SLOT_COUNT*Stream->SlotSize);
+    free(Stream->ConvertBuffer);
+    free(Stream);
+    return Result;
+}
+
+internal output_sink *
+LinuxOpenStreamOutputSink(char *Path, i32 Width, i32 Height, f32 FramesPerSecond)
+{
+    // NOTE: Path is a file, "-" for stdout, or "|command" to pipe into a
+    // process (e.g. an encoder). A ".ppm" suffix selects concatenated PPM,
+    // anything else gets Y4M.
+    stream_output_sink *Stream = (stream_output_sink *)calloc(1, sizeof(stream_output_sink));
+
+    size_t PathLength = strlen(Path);
+    Stream->Format = ((PathLength >= 4) && (strcmp(Path + PathLength - 4, ".ppm") == 0)) ?
+        StreamFormat_PPM : StreamFormat_Y4M;
+
+    if (strcmp(Path, "-") == 0)
+    {
+        Stream->File = stdout;
+    }
+    else if (Path[0] == '|')
+    {
+        Stream->File = popen(Path + 1, "w");
+        Stream->IsPipe = true;
+    }
+    else
+    {
+        Stream->File = fopen(Path, "wb");
+    }
+
+    if (!Stream->File)
+    {
+        fprintf(stderr, "Could not open %s for writing\n", Path);
+        free(Stream);
+        return 0;
+    }
+
+    Stream->Width = Width;
+    Stream->Height = Height;
+    Stream->SlotSize = ((u64)Width*(u64)Height*4 + 4095) & ~4095ull;
+    void *Slots = mmap(0, OUTPUT_SLOT_COUNT*Stream->SlotSize, PROT_READ|PROT_WRITE,
+                       MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (Slots == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not map stream frame slots\n");
+        CloseStreamFile(Stream);
+        free(Stream);
+        return 0;
+    }
+    Stream->Slots = (u8 *)Slots;
+
+    Stream->ConvertBufferSize = (u64)Width*(u64)Height*3;
+    Stream->ConvertBuffer = (u8 *)malloc(Stream->ConvertBufferSize);
+    if (!Stream->ConvertBuffer)
+    {
+        fprintf(stderr, "Could not allocate the stream convert buffer\n");
+        munmap(Stream->Slots, OUTPUT_SLOT_COUNT*Stream->SlotSize);
+        CloseStreamFile(Stream);
+        free(Stream);
+        return 0;
+    }
+    TripleBufferInit(&Stream->Triple, &Stream->ProducerSlot, &Stream->ConsumerSlot);
+
+    if (Stream->Format == StreamFormat_Y4M)
+    {
+        fprintf(Stream->File, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n",
+                Width, Height, RoundF32ToI32(FramesPerSecond));
+    }
+
+    Stream->Sink.AcquireFrame = StreamAcquireFrame;
+    Stream->Sink.SubmitFrame = StreamSubmitFrame;
+    Stream->Sink.Close = StreamClose;
+
+    if (pthread_create(&Stream->WriterThread, 0, StreamWriterThreadProc, Stream) != 0)
+    {
+        fprintf(stderr, "Could not start the stream writer thread\n");
+        munmap(Stream->Slots, OUTPUT_SLOT_COUNT*Stream->SlotSize);
+        free(Stream->ConvertBuffer);
+        CloseStreamFile(Stream);
+        free(Stream);
+        return 0;
+    }
+
+    return &Stream->Sink;
+}
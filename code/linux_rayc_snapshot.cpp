@@ -0,0 +1,172 @@
+// NOTE: Game state snapshots for restart. The simulation's memory is one
+// contiguous run (GameStateSnapshotSize), so a snapshot is a copy of that run
+// in a memfd. Restoring maps the memfd copy-on-write straight back over the
+// live run, so the map and anything else read-only after init stays shared
+// with the snapshot for good and is never copied.
+//
+// The pages the sim writes every tick do get copied, though, and left alone
+// that copy would land on the first tick after the restart as a fault per
+// page. So before remapping, restore asks /proc/self/pagemap which pages
+// the last run had copied (private, not the snapshot's), and after it
+// populates those again up front. It's the same copy, paid inside the
+// restart instead of the next tick, and scales with how much the sim
+// writes, not with the whole state.
+//
+// Capture maps the live run over the snapshot too, so from then on the
+// read-only part of the state is held once, not twice.
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+// NOTE: /proc/self/pagemap bits
+#define PAGEMAP_PRESENT (1ull << 63)
+#define PAGEMAP_FILE_OR_SHARED (1ull << 61)
+
+struct linux_state_snapshot
+{
+    int FileDescriptor;
+    void *Base;
+    memory_index Size;
+    memory_index PageSize;
+
+    // NOTE: -1 if pagemap isn't readable, in which case restores don't pre-fault
+    int PagemapFileDescriptor;
+    u64 *PageFlags;
+};
+
+internal void
+LinuxPopulatePages(u8 *Base, memory_index Size, memory_index PageSize)
+{
+    if (madvise(Base, Size, MADV_POPULATE_WRITE) != 0)
+    {
+        // NOTE: Kernels before 5.14; a write to each page does the same
+        for (memory_index Offset = 0;
+             Offset < Size;
+             Offset += PageSize)
+        {
+            u8 volatile *Byte = Base + Offset;
+            *Byte = *Byte;
+        }
+    }
+}
+
+internal bool32
+LinuxRestoreStateSnapshot(linux_state_snapshot *Snapshot)
+{
+    // NOTE: Nothing may be running on the state while this happens
+    memory_index PageCount = Snapshot->Size / Snapshot->PageSize;
+    bool32 PagesKnown = false;
+    if (Snapshot->PagemapFileDescriptor >= 0)
+    {
+        off_t Offset = (off_t)(((memory_index)Snapshot->Base / Snapshot->PageSize)*sizeof(u64));
+        memory_index Bytes = PageCount*sizeof(u64);
+        PagesKnown = (pread(Snapshot->PagemapFileDescriptor, Snapshot->PageFlags,
+                            Bytes, Offset) == (ssize_t)Bytes);
+    }
+
+    void *Mapped = mmap(Snapshot->Base, Snapshot->Size, PROT_READ|PROT_WRITE,
+                        MAP_PRIVATE|MAP_FIXED, Snapshot->FileDescriptor, 0);
+    bool32 Result = (Mapped == Snapshot->Base);
+
+    if (Result && PagesKnown)
+    {
+        // NOTE: Runs of pages the last run had written, one call per run
+        memory_index PageIndex = 0;
+        while (PageIndex < PageCount)
+        {
+            u64 Flags = Snapshot->PageFlags[PageIndex];
+            if ((Flags & PAGEMAP_PRESENT) && !(Flags & PAGEMAP_FILE_OR_SHARED))
+            {
+                memory_index FirstPage = PageIndex;
+                while ((PageIndex < PageCount) &&
+                       (Snapshot->PageFlags[PageIndex] & PAGEMAP_PRESENT) &&
+                       !(Snapshot->PageFlags[PageIndex] & PAGEMAP_FILE_OR_SHARED))
+                {
+                    ++PageIndex;
+                }
+                LinuxPopulatePages((u8 *)Snapshot->Base + FirstPage*Snapshot->PageSize,
+                                   (PageIndex - FirstPage)*Snapshot->PageSize,
+                                   Snapshot->PageSize);
+            }
+            else
+            {
+                ++PageIndex;
+            }
+        }
+    }
+
+    return Result;
+}
+
+internal bool32
+LinuxCaptureStateSnapshot(linux_state_snapshot *Snapshot, void *Base, memory_index Size)
+{
+    // NOTE: Base has to be page aligned; the run is rounded up to whole pages
+    bool32 Result = false;
+
+    memory_index PageSize = (memory_index)sysconf(_SC_PAGESIZE);
+    Assert(((memory_index)Base & (PageSize - 1)) == 0);
+    Snapshot->Base = Base;
+    Snapshot->Size = (Size + PageSize - 1) & ~(PageSize - 1);
+    Snapshot->PageSize = PageSize;
+    Snapshot->PagemapFileDescriptor = -1;
+    Snapshot->PageFlags = 0;
+
+    Snapshot->FileDescriptor = (int)syscall(SYS_memfd_create, "rayc-state", 0);
+    if ((Snapshot->FileDescriptor >= 0) &&
+        (ftruncate(Snapshot->FileDescriptor, (off_t)Snapshot->Size) == 0))
+    {
+        memory_index Written = 0;
+        while (Written < Snapshot->Size)
+        {
+            ssize_t BytesWritten = pwrite(Snapshot->FileDescriptor, (u8 *)Base + Written,
+                                          Snapshot->Size - Written, (off_t)Written);
+            if (BytesWritten <= 0)
+            {
+                break;
+            }
+            Written += (memory_index)BytesWritten;
+        }
+
+        if (Written == Snapshot->Size)
+        {
+            // NOTE: Everything is private right now, so this first restore
+            // would populate the whole run; the pagemap is only opened after
+            Result = LinuxRestoreStateSnapshot(Snapshot);
+
+            if (Result)
+            {
+                Snapshot->PageFlags = (u64 *)malloc((Snapshot->Size / PageSize)*sizeof(u64));
+                if (Snapshot->PageFlags)
+                {
+                    Snapshot->PagemapFileDescriptor = open("/proc/self/pagemap", O_RDONLY);
+                }
+            }
+        }
+    }
+
+    if (!Result && (Snapshot->FileDescriptor >= 0))
+    {
+        close(Snapshot->FileDescriptor);
+        Snapshot->FileDescriptor = -1;
+    }
+
+    return Result;
+}
+
+internal void
+LinuxReleaseStateSnapshot(linux_state_snapshot *Snapshot)
+{
+    // NOTE: The live run stays mapped from the memfd; closing it only drops
+    // the snapshot once nothing maps it any more
+    close(Snapshot->FileDescriptor);
+    Snapshot->FileDescriptor = -1;
+    if (Snapshot->PagemapFileDescriptor >= 0)
+    {
+        close(Snapshot->PagemapFileDescriptor);
+        Snapshot->PagemapFileDescriptor = -1;
+    }
+    free(Snapshot->PageFlags);
+    Snapshot->PageFlags = 0;
+}
@@ -0,0 +1,153 @@
+// NOTE: The platform work queue. A ring of entries filled by the main thread
+// and drained by one worker per spare core. Workers claim an entry with a
+// compare-exchange on the read index and park on a futex when the ring is
+// empty; CompleteAllWork has the main thread drain entries alongside them and
+// then park on the completion count. Counters are free-running.
+
+#define LINUX_WORK_QUEUE_SIZE 256
+#define LINUX_WORK_QUEUE_MAX_THREADS 32
+
+struct linux_work_queue_entry
+{
+    platform_work_callback *Callback;
+    void *Data;
+};
+
+struct linux_work_queue
+{
+    u32 volatile NextEntryToWrite;
+    u32 volatile NextEntryToRead;
+    u32 volatile CompletionGoal;
+    u32 volatile CompletionCount;
+
+    u32 ThreadCount;
+    linux_work_queue_entry Entries[LINUX_WORK_QUEUE_SIZE];
+};
+
+global_variable linux_work_queue GlobalWorkQueue;
+
+inline void
+LinuxFutexWait(u32 volatile *Address, u32 Value)
+{
+    syscall(SYS_futex, (u32 *)Address, FUTEX_WAIT_PRIVATE, Value, 0, 0, 0);
+}
+
+inline void
+LinuxFutexWake(u32 volatile *Address, i32 Count)
+{
+    syscall(SYS_futex, (u32 *)Address, FUTEX_WAKE_PRIVATE, Count, 0, 0, 0);
+}
+
+internal bool32
+LinuxDoNextWorkQueueEntry(linux_work_queue *Queue)
+{
+    // NOTE: Returns false if the ring was empty. Losing the race for an
+    // entry still counts as work found, so the caller looks again.
+    bool32 Result = false;
+    u32 OriginalNextEntryToRead = AtomicLoadU32(&Queue->NextEntryToRead);
+    if (OriginalNextEntryToRead != AtomicLoadU32(&Queue->NextEntryToWrite))
+    {
+        // NOTE: Copied before the claim: once the read index moves on, the
+        // main thread is free to reuse the slot
+        Result = true;
+        linux_work_queue_entry Entry = Queue->Entries[OriginalNextEntryToRead & (LINUX_WORK_QUEUE_SIZE - 1)];
+        if (AtomicCompareExchangeU32(&Queue->NextEntryToRead, OriginalNextEntryToRead + 1,
+                                     OriginalNextEntryToRead) == OriginalNextEntryToRead)
+        {
+            Entry.Callback(Entry.Data);
+
+            u32 Completed = AtomicAddU32(&Queue->CompletionCount, 1) + 1;
+            if (Completed == AtomicLoadU32(&Queue->CompletionGoal))
+            {
+                LinuxFutexWake(&Queue->CompletionCount, 1);
+            }
+        }
+    }
+    return Result;
+}
+
+internal void *
+LinuxWorkQueueThreadProc(void *Parameter)
+{
+    linux_work_queue *Queue = (linux_work_queue *)Parameter;
+    for (;;)
+    {
+        u32 NextEntryToWrite = AtomicLoadU32(&Queue->NextEntryToWrite);
+        if (!LinuxDoNextWorkQueueEntry(Queue))
+        {
+            LinuxFutexWait(&Queue->NextEntryToWrite, NextEntryToWrite);
+        }
+    }
+    return 0;
+}
+
+internal void
+LinuxStartWorkQueue(linux_work_queue *Queue, u32 ThreadCount)
+{
+    // NOTE: The workers live as long as the process. With none, the main
+    // thread runs everything itself in CompleteAllWork.
+    if (ThreadCount > LINUX_WORK_QUEUE_MAX_THREADS)
+    {
+        ThreadCount = LINUX_WORK_QUEUE_MAX_THREADS;
+    }
+    Queue->ThreadCount = 0;
+    for (u32 ThreadIndex = 0;
+         ThreadIndex < ThreadCount;
+         ++ThreadIndex)
+    {
+        pthread_t Thread;
+        if (pthread_create(&Thread, 0, LinuxWorkQueueThreadProc, Queue) == 0)
+        {
+            pthread_detach(Thread);
+            ++Queue->ThreadCount;
+        }
+    }
+}
+
+inline u32
+LinuxGetSpareCoreCount(void)
+{
+    long CoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 Result = (CoreCount > 1) ? (u32)(CoreCount - 1) : 0;
+    return Result;
+}
+
+internal void
+PLATFORMAddWork(platform_work_callback *Callback, void *Data)
+{
+    linux_work_queue *Queue = &GlobalWorkQueue;
+    u32 NextEntryToWrite = Queue->NextEntryToWrite;
+    if (NextEntryToWrite - AtomicLoadU32(&Queue->NextEntryToRead) >= LINUX_WORK_QUEUE_SIZE)
+    {
+        // NOTE: Ring full; the main thread may as well do this one itself
+        Callback(Data);
+        return;
+    }
+
+    linux_work_queue_entry *Entry = &Queue->Entries[NextEntryToWrite & (LINUX_WORK_QUEUE_SIZE - 1)];
+    Entry->Callback = Callback;
+    Entry->Data = Data;
+    AtomicStoreU32(&Queue->CompletionGoal, Queue->CompletionGoal + 1);
+    AtomicStoreU32(&Queue->NextEntryToWrite, NextEntryToWrite + 1);
+    LinuxFutexWake(&Queue->NextEntryToWrite, 1);
+}
+
+internal void
+PLATFORMCompleteAllWork(void)
+{
+    linux_work_queue *Queue = &GlobalWorkQueue;
+    u32 CompletionGoal = Queue->CompletionGoal;
+    for (;;)
+    {
+        u32 CompletionCount = AtomicLoadU32(&Queue->CompletionCount);
+        if (CompletionCount == CompletionGoal)
+        {
+            break;
+        }
+        if (!LinuxDoNextWorkQueueEntry(Queue))
+        {
+            // NOTE: Everything's claimed; wait for the stragglers
+            LinuxFutexWait(&Queue->CompletionCount, CompletionCount);
+        }
+    }
+}
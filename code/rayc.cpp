@@ -1,11 +1,13 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <math.h>
+#include <string.h>
+#include <stdarg.h>
 
 typedef int8_t i8;
 typedef int16_t i16;
 typedef int32_t i32;
-typedef int32_t i64;
+typedef int64_t i64;
 
 typedef uint8_t u8;
 typedef uint16_t u16;
@@ -13,7 +15,7 @@ typedef uint32_t u32;
 typedef uint64_t u64;
 
 typedef float f32;
-typedef float f64;
+typedef double f64;
 
 typedef i32 bool32;
 
@@ -24,7 +26,59 @@ typedef i32 bool32;
 #define global_variable static
 
 #define Assert(Expression) if (!(Expression)) {*(int *)0 = 0;}
-#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0])
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+#include "rayc_intrinsics.h"
+
+#define Kilobytes(Value) ((Value)*1024LL)
+#define Megabytes(Value) (Kilobytes(Value)*1024LL)
+#define Gigabytes(Value) (Megabytes(Value)*1024LL)
+
+typedef size_t memory_index;
+
+struct memory_arena
+{
+    u8 *Base;
+    memory_index Size;
+    memory_index Used;
+};
+
+internal void
+InitializeArena(memory_arena *Arena, memory_index Size, void *Base)
+{
+    Arena->Base = (u8 *)Base;
+    Arena->Size = Size;
+    Arena->Used = 0;
+}
+
+#define PushStruct(Arena, type) (type *)PushSize_(Arena, sizeof(type))
+#define PushArray(Arena, Count, type) (type *)PushSize_(Arena, (Count)*sizeof(type))
+internal void *
+PushSize_(memory_arena *Arena, memory_index Size)
+{
+    // NOTE: Everything comes out 64-byte aligned so arrays start on a cache line
+    // (and SIMD kernels can use aligned loads). Aligns the address, not the
+    // offset, since the arena base itself sits right after a struct.
+    memory_index AlignmentOffset = (64 - ((memory_index)(Arena->Base + Arena->Used) & 63)) & 63;
+    memory_index AlignedUsed = Arena->Used + AlignmentOffset;
+    Assert(AlignedUsed + Size <= Arena->Size);
+    void *Result = Arena->Base + AlignedUsed;
+    Arena->Used = AlignedUsed + Size;
+
+    return Result;
+}
+
+struct game_memory
+{
+    // NOTE: Simulation state. game_state sits at the start, followed by the
+    // arena everything it points to is allocated from.
+    u64 PermanentStorageSize;
+    void *PermanentStorage;
+
+    // NOTE: Render state and assets, laid out the same way
+    u64 TransientStorageSize;
+    void *TransientStorage;
+};
 
 struct game_offscreen_buffer
 {
@@ -33,11 +87,20 @@ struct game_offscreen_buffer
     int Height;
     int Pitch;
     int BytesPerPixel;
+
+    // NOTE: Optional, Width x Height; see rayc_heatmap.h
+    u8 *WriteCounts;
 };
 
+#include "rayc_column_buffer.h"
+#include "rayc_lighting.h"
+#include "rayc_heatmap.h"
+#include "rayc_entity.h"
+
 struct game_input
 {
-    f32 SecondsPerFrame;
+    // NOTE: Measured wall-clock duration of the previous frame, not the target
+    f32 SecondsElapsed;
 
     bool32 MouseLeft;
     bool32 MouseRight;
@@ -49,6 +112,7 @@ struct game_input
     bool32 StrafeLeft;
     bool32 StrafeRight;
     bool32 Back;
+    bool32 Jump;
     
     bool32 Up;
     bool32 Down;
@@ -68,6 +132,32 @@ struct ray_to_point
     f32 Angle;
 };
 
+struct render_view
+{
+    f32 PlayerX;
+    f32 PlayerY;
+    f32 PlayerAngle;
+    f32 PlayerEyeZ;
+    f32 PlayerPitch;
+
+    // NOTE: For the stats overlay
+    f32 FrameSeconds;
+    u64 SimTickCount;
+
+    // NOTE: Interpolated robot positions, EntityCount long, in entity store
+    // order, and each robot's handle, for anything that keeps state for a
+    // robot from one frame to the next; the order changes when one is removed
+    u32 EntityCount;
+    f32 *EntityX;
+    f32 *EntityY;
+    entity_handle *EntityHandles;
+
+    // NOTE: The level's lights as of the latest tick
+    f32 AmbientLight;
+    u32 LightCount;
+    point_light Lights[GAME_MAX_LIGHTS];
+};
+
 struct ray_data
 {
     f32 RayAngle;
@@ -80,6 +170,40 @@ struct ray_data
 
     f32 HitWallTexturePosition;
     f32 Distance;
+    // NOTE: map_face of the hit tile the ray came in through
+    u32 Face;
+
+    // NOTE: Grate faces the ray passed on the way, nearest first
+    u32 TransparentHitCount;
+    // NOTE: Map cells the ray walked through, the one it started in included
+    u32 CellSteps;
+};
+
+struct transparent_hit
+{
+    u32 TextureId;
+    f32 TextureU;
+    u32 Light;
+    f32 Depth;
+
+    // NOTE: Everything needed to draw the face again, clipped the same way
+    f32 RealMinY;
+    f32 RealMaxY;
+    f32 TextureMinV;
+    f32 TextureMaxV;
+    i32 ClipMinY;
+    i32 ClipMaxY;
+};
+
+// NOTE: Where a column's drawing has got to. Rows ClipTop..ClipBottom are
+// still open; Coverage stays null until the column's first grate.
+struct column_clip
+{
+    i32 ClipTop;
+    i32 ClipBottom;
+    u8 *Coverage;
+    i32 UncoveredRows;
+    u32 HitCount;
 };
 
 struct texture
@@ -91,28 +215,213 @@ struct texture
     i32 Pitch;
 };
 
+#include "rayc_sprite.h"
+#include "rayc_atlas.h"
+#include "rayc_hud.h"
+#include "rayc_audio.h"
+#include "rayc_faces.h"
+#include "rayc_image.h"
+#include "rayc_occupancy.h"
+
 #define TEXTURE_NUM 16
 struct render_data
 {
     texture Textures[TEXTURE_NUM];
+    sprite RobotSprite;
+};
+
+enum map_face
+{
+    MapFace_East,
+    MapFace_North,
+    MapFace_West,
+    MapFace_South,
+
+    MapFace_Count,
+};
+
+// NOTE: Values in game_map.Tiles. Anything but empty blocks movement and
+// line of sight; grates only let the renderer see through.
+enum map_tile
+{
+    MapTile_Empty,
+    MapTile_Wall,
+    MapTile_Grate,
+};
+
+// NOTE: Wall texture IDs index the render side's wall_atlas; the atlas is
+// built in this order
+enum wall_texture_id
+{
+    WallTexture_Brick,
+    WallTexture_Pumpkin,
+    WallTexture_Grate,
+
+    WallTexture_Count,
+};
+
+struct game_map
+{
+    i32 Width;
+    i32 Height;
+
+    // NOTE: Row-major, Width*Height
+    u8 *Tiles;
+    u32 *Colors;
+
+    // NOTE: Texture ID per face of each cell, FaceTextures[CellIndex*MapFace_Count + Face]
+    u16 *FaceTextures;
+
+    // NOTE: Per open cell, in tiles. A standard room is floor 0, ceiling 1.
+    f32 *FloorHeights;
+    f32 *CeilingHeights;
+
+    // NOTE: Packed copies of Tiles for the ray and collision loops: Solid is
+    // anything but empty, Opaque is solid and not a grate. Rebuilt with
+    // UpdateMapOccupancy whenever Tiles changes.
+    occupancy_grid Solid;
+    occupancy_grid Opaque;
 };
 
+#include "rayc_flowfield.h"
+#include "rayc_pvs.h"
+#include "rayc_scheduler.h"
+#include "rayc_levelgen.h"
+
+// NOTE: The simulation always advances in fixed ticks. Rendering interpolates
+// between the last two ticks using whatever is left in the accumulator.
+#define SIM_TICKS_PER_SECOND 120
+#define SIM_SECONDS_PER_TICK (1.0f / (f32)SIM_TICKS_PER_SECOND)
+// NOTE: Cap on catch-up after a long stall (debugger break, window drag) so the
+// simulation doesn't spiral trying to replay seconds of ticks in one frame.
+#define SIM_MAX_TICKS_PER_FRAME 12
+
+// NOTE: Player heights in tiles, measured from the feet
+#define PLAYER_EYE_HEIGHT 0.5f
+#define PLAYER_HEIGHT 0.6f
+#define PLAYER_STEP_HEIGHT 0.26f
+// NOTE: A robot this close (in the plane) has caught the player
+#define PLAYER_CATCH_DISTANCE 0.75f
+
 #define RAYCAST_NUM 1600
+#define RAYCAST_MAX_TRANSPARENT_HITS 8
+#define GAME_MAX_ENTITIES 4096
+// NOTE: Timed events pending at once, a few per robot
+#define GAME_MAX_SCHEDULED_EVENTS 16384
 struct game_state
 {
     f32 PlayerX;
     f32 PlayerY;
     f32 PlayerAngle;
+    // NOTE: Height of the player's feet, and vertical speed (up is positive)
+    f32 PlayerZ;
+    f32 PlayerVelocityZ;
+    bool32 PlayerOnGround;
+    // NOTE: Vertical look as a y-shear: the horizon moves by this many
+    // column heights. Roughly tan of the look angle.
+    f32 PlayerPitch;
+
+    // NOTE: Player position as of the previous tick, for render interpolation
+    f32 PrevPlayerX;
+    f32 PrevPlayerY;
+    f32 PrevPlayerAngle;
+    f32 PrevPlayerZ;
+
+    // NOTE: Set by the tick a robot catches the player; the platform layer
+    // restarts from a snapshot
+    bool32 PlayerCaught;
+
+    f32 SimAccumulator;
+    u64 SimTickCount;
+    f32 LastFrameSeconds;
+
+    game_map Map;
+    flow_field FlowField;
+    // NOTE: Read-only once built, so the render stage reads it too
+    potentially_visible_sets PVS;
+    entity_store Entities;
+    event_scheduler Events;
+
+    f32 AmbientLight;
+    u32 LightCount;
+    point_light Lights[GAME_MAX_LIGHTS];
+
+    // NOTE: View for the serial (unpipelined) path
+    render_view View;
+
+    memory_arena Arena;
+};
 
-    f32 EnemyX;
-    f32 EnemyY;
+// NOTE: The minimap shows at most this many tiles across, centered on the player
+#define MINIMAP_MAX_TILES 16
+
+// NOTE: Owned by the render stage. The render stage only reads game_state
+// fields that the simulation never writes after init (map, colors); anything
+// that moves reaches it through a render_snapshot.
+struct render_state
+{
+    render_data RenderData;
 
-    u8 Map[8][8];
-    u8 RaycastHitMap[8][8];
-    u32 MapColors[8][8];
     ray_data RaycastData[RAYCAST_NUM];
 
-    render_data RenderData;
+    // NOTE: Per-frame scratch. Ray N's grate hits start at
+    // TransparentHits[N*RAYCAST_MAX_TRANSPARENT_HITS]; the coverage mask is
+    // reused for every column.
+    transparent_hit *TransparentHits;
+    u8 ColumnCoverage[RENDER_MAX_BUFFER_HEIGHT];
+    // NOTE: Depth of the nearest robot drawn in each column so far this
+    // frame, 0 for none
+    f32 SpriteNearDepth[RAYCAST_NUM];
+
+    wall_atlas WallAtlas;
+    // NOTE: Baked from the view's lights; pushed the first time there are any
+    face_lighting Lighting;
+
+    // NOTE: The 3D view is drawn here, then presented into the platform's buffer
+    column_buffer Columns;
+
+    // NOTE: Which engine draws the walls. The platform layer can switch it
+    // between frames.
+    render_engine Engine;
+    face_sweep Faces;
+
+    // NOTE: Debug overlay, also switched by the platform layer
+    render_heatmap Heatmap;
+
+    // NOTE: Scratch for sorting visible robots, GAME_MAX_ENTITIES long
+    sprite_draw *SpriteDraws;
+
+    glyph_atlas Glyphs;
+    hud_batch Hud;
+
+    // NOTE: Audio is mixed on the render thread too, from the same view
+    audio_mixer Audio;
+
+    memory_arena Arena;
+};
+
+struct render_snapshot
+{
+    u32 FrameIndex;
+    render_view View;
+};
+
+// NOTE: Two-stage frame pipeline. The sim stage produces snapshot N+1 while the
+// render stage draws snapshot N, so a frame costs max(sim, render) rather than
+// their sum. Handoff is two counters, each written by exactly one stage:
+//   render stage: copies input into slot N+1, then bumps SimFramesRequested
+//   sim stage:    writes snapshot slot N+1, then bumps SimFramesCompleted
+// The render stage never submits a frame until the previous one completed, so
+// the slot it is drawing from is never the one being written.
+struct frame_pipeline
+{
+    game_input Inputs[2];
+    render_snapshot Snapshots[2];
+
+    u32 volatile SimFramesRequested;
+    u32 volatile SimFramesCompleted;
+    // NOTE: Set once, by the render stage, when the sim stage should exit
+    u32 volatile Quit;
 };
 
 struct platform_read_file_result
@@ -130,6 +439,25 @@ PLATFORMFreeFileMemory(void *Memory);
 internal platform_read_file_result
 PLATFORMReadEntireFile(char *Filename);
 
+// NOTE: Writes the whole file or nothing: readers never see it half written
+internal bool32
+PLATFORMWriteEntireFile(char *Filename, u32 MemorySize, void *Memory);
+
+// NOTE: Work queue for spreading startup jobs over every core. Only the main
+// thread adds work. CompleteAllWork returns once everything added so far has
+// run, and the caller works through the queue too while it waits.
+typedef void platform_work_callback(void *Data);
+
+internal void
+PLATFORMAddWork(platform_work_callback *Callback, void *Data);
+
+internal void
+PLATFORMCompleteAllWork(void);
+
+#include "rayc_log.h"
+#include "rayc_log.cpp"
+#include "rayc_assets.h"
+
 inline u32
 SafeTruncateU64(u64 Value)
 {
@@ -153,6 +481,13 @@ TruncateF32ToI32(f32 Real)
     return Result;
 }
 
+inline f32
+Minimum(f32 A, f32 B)
+{
+    f32 Result = (A < B) ? A : B;
+    return Result;
+}
+
 inline f32
 AbsoluteF32(f32 Value)
 {
@@ -160,40 +495,77 @@ AbsoluteF32(f32 Value)
     return Result;
 }
 
-#pragma pack(push, 1)
-struct bitmap_header
+inline i32
+AbsoluteI32(i32 Value)
+{
+    i32 Result = ((Value > 0) ? Value : -Value);
+    return Result;
+}
+
+#include "rayc_occupancy.cpp"
+
+inline bool32
+IsTileInMap(game_map *Map, i32 TileX, i32 TileY)
 {
-    u16 FileType;
-    u32 FileSize;
-    u16 Reserved1;
-    u16 Reserved2;
-    u32 BitmapOffset;
-    u32 Size;
-    i32 Width;
-    i32 Height;
-    u16 Planes;
-    u16 BitsPerPixel;
-};
-#pragma pack(pop)
+    // NOTE: One unsigned compare per axis catches negatives as well
+    bool32 Result = (((u32)TileX < (u32)Map->Width) &&
+                     ((u32)TileY < (u32)Map->Height));
+    return Result;
+}
+
+inline bool32
+IsTileSolid(game_map *Map, i32 TileX, i32 TileY)
+{
+    // NOTE: Everything outside the map counts as wall
+    bool32 Result = true;
+    if (IsTileInMap(Map, TileX, TileY))
+    {
+        Result = IsCellOccupied(&Map->Solid, TileX, TileY);
+    }
+    return Result;
+}
 
-internal texture
-LoadBMP(char *Filename)
+inline bool32
+IsTileOpaque(game_map *Map, i32 TileX, i32 TileY)
 {
-    texture Result = {0};
-    platform_read_file_result ReadResult = PLATFORMReadEntireFile(Filename);
-    if (ReadResult.ContentsSize != 0)
+    // NOTE: Solid and not see-through; outside the map counts as wall
+    bool32 Result = true;
+    if (IsTileInMap(Map, TileX, TileY))
     {
-        bitmap_header *Header = (bitmap_header *)ReadResult.Contents;
-        Result.Pixels = (u8 *)ReadResult.Contents + Header->BitmapOffset;
-        Result.Width = Header->Width;
-        Result.Height = Header->Height;
-        Result.BytesPerPixel = 4;
-        Result.Pitch = Result.Width * Result.BytesPerPixel;
+        Result = IsCellOccupied(&Map->Opaque, TileX, TileY);
     }
+    return Result;
+}
 
+inline bool32
+IsTileSeeThrough(game_map *Map, i32 TileX, i32 TileY)
+{
+    bool32 Result = false;
+    if (IsTileInMap(Map, TileX, TileY))
+    {
+        Result = (IsCellOccupied(&Map->Solid, TileX, TileY) &&
+                  !IsCellOccupied(&Map->Opaque, TileX, TileY));
+    }
     return Result;
 }
 
+#include "rayc_flowfield.cpp"
+#include "rayc_visibility.cpp"
+#include "rayc_pvs.cpp"
+#include "rayc_entity.cpp"
+#include "rayc_scheduler.cpp"
+#include "rayc_levelgen.cpp"
+#include "rayc_lighting.cpp"
+
+#include "rayc_image.cpp"
+#include "rayc_assets.cpp"
+
+#include "rayc_heatmap.cpp"
+#include "rayc_column_buffer.cpp"
+#include "rayc_sprite.cpp"
+#include "rayc_atlas.cpp"
+#include "rayc_hud.cpp"
+
 internal void
 DrawBitmap(game_offscreen_buffer *DestBuffer, texture *SourceBitmap,
            f32 RealDestMinX, f32 RealDestMinY,
@@ -246,6 +618,9 @@ DrawBitmap(game_offscreen_buffer *DestBuffer, texture *SourceBitmap,
     
     i32 ScaledColumnsToDraw = RoundedScaleX-RoundF32ToI32(RealScaledOffsetX);
     i32 ScaledRowsToDraw = RoundedScaleY-RoundF32ToI32(RealScaledOffsetY);
+    i32 CountedMaxX = (DestMaxX < DestMinX + ScaledColumnsToDraw) ? DestMaxX : (DestMinX + ScaledColumnsToDraw);
+    i32 CountedMaxY = (DestMaxY < DestMinY + ScaledRowsToDraw) ? DestMaxY : (DestMinY + ScaledRowsToDraw);
+    CountBufferWrites(DestBuffer, DestMinX, CountedMaxX, DestMinY, CountedMaxY);
 
     f32 RealSourceCursorY = RealSourceOffsetY;
     for (int DestY = DestMinY;
@@ -307,6 +682,7 @@ DrawRectangle(game_offscreen_buffer *Buffer,
     if (MinY < 0) MinY = 0;
     if (MaxX > Buffer->Width) MaxX = Buffer->Width;
     if (MaxY > Buffer->Height) MaxY = Buffer->Height;
+    CountBufferWrites(Buffer, MinX, MaxX, MinY, MaxY);
 
     u8 *Row = ((u8 *)Buffer->Data +
                MinX * Buffer->BytesPerPixel +
@@ -335,26 +711,6 @@ DrawRectangle(game_offscreen_buffer *Buffer,
     }
 }
 
-internal void
-DrawWallVerticalSection(game_offscreen_buffer *Buffer,
-                        f32 RealMinX, f32 RealMinY,
-                        f32 RealMaxX, f32 RealMaxY,
-                        texture *Texture,
-                        f32 TextureHorizontalPosition)
-{
-    f32 TextureOffsetY = 0.0f;
-    if (RealMinY < 0.0f)
-    {
-        TextureOffsetY = (-RealMinY);
-    }
-    DrawBitmap(Buffer, Texture,
-               RealMinX, RealMinY,
-               RealMaxX, RealMaxY,
-               900.0f, RealMaxY-RealMinY,
-               900.0f*TextureHorizontalPosition, TextureOffsetY);
-    // DrawRectangle(Buffer, RealMinX, RealMinY, RealMaxX, RealMaxY, 0xFF0000FF, 0xFF0000FF);
-}
-
 internal void
 DrawLine(game_offscreen_buffer *Buffer,
          f32 RealStartX, f32 RealStartY,
@@ -373,6 +729,7 @@ DrawLine(game_offscreen_buffer *Buffer,
     f32 X = RealStartX;
     f32 Y = RealStartY;
     u32 *Pixels = (u32 *)Buffer->Data;
+    bool32 CountingWrites = (Buffer->WriteCounts != 0);
     for (i32 SteppingIndex = 0;
          SteppingIndex < (i32)SteppingDistance;
          ++SteppingIndex)
@@ -383,6 +740,10 @@ DrawLine(game_offscreen_buffer *Buffer,
             RoundedY >= 0 && RoundedY < Buffer->Height)
         {
             Pixels[RoundedY * Buffer->Width + RoundedX] = Color;
+            if (CountingWrites)
+            {
+                CountBufferWrites(Buffer, RoundedX, RoundedX + 1, RoundedY, RoundedY + 1);
+            }
         }
 
         X += dX;
@@ -392,66 +753,67 @@ DrawLine(game_offscreen_buffer *Buffer,
 
 internal void
 DEBUGDrawMinimap(game_offscreen_buffer *Buffer,
-                 game_state *State,
+                 game_state *State, render_state *Render, render_view *View,
                  f32 RealMinX, f32 RealMinY,
                  f32 RealMaxX, f32 RealMaxY)
 {
     DrawRectangle(Buffer, RealMinX, RealMinY, RealMaxX, RealMaxY, 0xFFAAAAAA, 0xFFAAAAAA);
 
-    int MapWidth = 8;
-    int MapHeight = 8;
+    game_map *Map = &State->Map;
+
+    // NOTE: Large maps only show a window of tiles around the player
+    i32 WindowTilesX = (Map->Width < MINIMAP_MAX_TILES) ? Map->Width : MINIMAP_MAX_TILES;
+    i32 WindowTilesY = (Map->Height < MINIMAP_MAX_TILES) ? Map->Height : MINIMAP_MAX_TILES;
+    i32 WindowOriginX = TruncateF32ToI32(View->PlayerX) - WindowTilesX/2;
+    i32 WindowOriginY = TruncateF32ToI32(View->PlayerY) - WindowTilesY/2;
+    if (WindowOriginX > Map->Width - WindowTilesX) WindowOriginX = Map->Width - WindowTilesX;
+    if (WindowOriginY > Map->Height - WindowTilesY) WindowOriginY = Map->Height - WindowTilesY;
+    if (WindowOriginX < 0) WindowOriginX = 0;
+    if (WindowOriginY < 0) WindowOriginY = 0;
+
     f32 Padding = 4.0f;
     f32 PaddedMinX = RealMinX + Padding;
     f32 PaddedMinY = RealMinY + Padding;
     f32 PaddedMaxX = RealMaxX - Padding;
     f32 PaddedMaxY = RealMaxY - Padding;
-    f32 TileWidth = (PaddedMaxX - PaddedMinX) / (f32)MapWidth;
-    f32 TileHeight = (PaddedMaxY - PaddedMinY) / (f32)MapHeight;
+    f32 TileWidth = (PaddedMaxX - PaddedMinX) / (f32)WindowTilesX;
+    f32 TileHeight = (PaddedMaxY - PaddedMinY) / (f32)WindowTilesY;
+    // NOTE: Map coordinates to minimap coordinates
+    f32 OriginX = PaddedMinX - (f32)WindowOriginX*TileWidth;
+    f32 OriginY = PaddedMinY - (f32)WindowOriginY*TileHeight;
     u32 BorderColor = 0xFFAAAAAA;
     u32 EmptyTileColor = 0xFFFFFFFF;
     u32 SolidTileColor = 0xFF000000;
     u32 RaycastHitColor = 0xFFFF00FF;
     
-    for (int MapY = 0;
-         MapY < MapHeight;
-         ++MapY)
+    for (int WindowY = 0;
+         WindowY < WindowTilesY;
+         ++WindowY)
     {
-        f32 TileMinY = PaddedMinY + (f32)MapY*TileHeight;
+        i32 MapY = WindowOriginY + WindowY;
+        f32 TileMinY = PaddedMinY + (f32)WindowY*TileHeight;
         f32 TileMaxY = TileMinY + TileHeight;
-        for (int MapX = 0;
-             MapX < MapWidth;
-             ++MapX)
+        for (int WindowX = 0;
+             WindowX < WindowTilesX;
+             ++WindowX)
         {
-            f32 TileMinX = PaddedMinX + (f32)MapX*TileWidth;
+            i32 MapX = WindowOriginX + WindowX;
+            f32 TileMinX = PaddedMinX + (f32)WindowX*TileWidth;
             f32 TileMaxX = TileMinX + TileWidth;
             u32 FillColor = EmptyTileColor;
-            if (State->Map[MapY][MapX])
+            if (Map->Tiles[MapY*Map->Width + MapX])
             {
-                FillColor = State->MapColors[MapY][MapX];
+                FillColor = Map->Colors[MapY*Map->Width + MapX];
             }
         
             DrawRectangle(Buffer, TileMinX, TileMinY, TileMaxX, TileMaxY, FillColor, BorderColor);
-
-            if (State->RaycastHitMap[MapY][MapX])
-            {
-                f32 RaycastHighlightTilePortion = 0.5f;
-                f32 RaycastHighlightWidth = TileWidth*RaycastHighlightTilePortion;
-                f32 RaycastHighlightHeight = TileHeight*RaycastHighlightTilePortion;
-                f32 TileCenterX = TileMinX + TileWidth/2.0f;
-                f32 TileCenterY = TileMinY + TileHeight/2.0f;
-                f32 RaycastMinX = TileCenterX - RaycastHighlightWidth/2.0f;
-                f32 RaycastMinY = TileCenterY - RaycastHighlightHeight/2.0f;
-                f32 RaycastMaxX = RaycastMinX + RaycastHighlightWidth;
-                f32 RaycastMaxY = RaycastMinY + RaycastHighlightHeight;
-                DrawRectangle(Buffer, RaycastMinX, RaycastMinY, RaycastMaxX, RaycastMaxY, RaycastHitColor, BorderColor);
-            }
         }
     }
 
     f32 EntityDotHalfSize = 5.0f;
     
-    f32 PlayerMinimapX = PaddedMinX + State->PlayerX*TileWidth;
-    f32 PlayerMinimapY = PaddedMinY + State->PlayerY*TileHeight;
+    f32 PlayerMinimapX = OriginX + View->PlayerX*TileWidth;
+    f32 PlayerMinimapY = OriginY + View->PlayerY*TileHeight;
     f32 PlayerMinX = PlayerMinimapX - EntityDotHalfSize;
     f32 PlayerMinY = PlayerMinimapY - EntityDotHalfSize;
     f32 PlayerMaxX = PlayerMinimapX + EntityDotHalfSize;
@@ -463,25 +825,46 @@ DEBUGDrawMinimap(game_offscreen_buffer *Buffer,
          RayIndex < RAYCAST_NUM;
          ++RayIndex)
     {
-        f32 LineStartX = PaddedMinX + State->PlayerX * TileWidth;
-        f32 LineStartY = PaddedMinY + State->PlayerY * TileHeight;
-        f32 LineEndX = PaddedMinX + State->RaycastData[RayIndex].InterceptX * TileWidth;
-        f32 LineEndY = PaddedMinY + State->RaycastData[RayIndex].InterceptY * TileHeight;
+        f32 LineStartX = OriginX + View->PlayerX * TileWidth;
+        f32 LineStartY = OriginY + View->PlayerY * TileHeight;
+        f32 LineEndX = OriginX + Render->RaycastData[RayIndex].InterceptX * TileWidth;
+        f32 LineEndY = OriginY + Render->RaycastData[RayIndex].InterceptY * TileHeight;
+
+        // NOTE: Pull the end of the line back inside the minimap
+        f32 LineT = 1.0f;
+        f32 LineDX = LineEndX - LineStartX;
+        f32 LineDY = LineEndY - LineStartY;
+        if (LineEndX < PaddedMinX) LineT = Minimum(LineT, (PaddedMinX - LineStartX) / LineDX);
+        if (LineEndX > PaddedMaxX) LineT = Minimum(LineT, (PaddedMaxX - LineStartX) / LineDX);
+        if (LineEndY < PaddedMinY) LineT = Minimum(LineT, (PaddedMinY - LineStartY) / LineDY);
+        if (LineEndY > PaddedMaxY) LineT = Minimum(LineT, (PaddedMaxY - LineStartY) / LineDY);
+        LineEndX = LineStartX + LineT*LineDX;
+        LineEndY = LineStartY + LineT*LineDY;
+
         DrawLine(Buffer, LineStartX, LineStartY, LineEndX, LineEndY, RaycastHitColor);
     }
 
-    f32 EnemyMinimapX = PaddedMinX + State->EnemyX*TileWidth;
-    f32 EnemyMinimapY = PaddedMinY + State->EnemyY*TileHeight;
-    f32 EnemyMinX = EnemyMinimapX - EntityDotHalfSize;
-    f32 EnemyMinY = EnemyMinimapY - EntityDotHalfSize;
-    f32 EnemyMaxX = EnemyMinimapX + EntityDotHalfSize;
-    f32 EnemyMaxY = EnemyMinimapY + EntityDotHalfSize;
     u32 EnemyColor = 0xFFFF0000;
-    DrawRectangle(Buffer, EnemyMinX, EnemyMinY, EnemyMaxX, EnemyMaxY, EnemyColor, EnemyColor);
+    for (u32 EntityIndex = 0;
+         EntityIndex < View->EntityCount;
+         ++EntityIndex)
+    {
+        f32 EnemyMinimapX = OriginX + View->EntityX[EntityIndex]*TileWidth;
+        f32 EnemyMinimapY = OriginY + View->EntityY[EntityIndex]*TileHeight;
+        if ((EnemyMinimapX >= PaddedMinX) && (EnemyMinimapX < PaddedMaxX) &&
+            (EnemyMinimapY >= PaddedMinY) && (EnemyMinimapY < PaddedMaxY))
+        {
+            f32 EnemyMinX = EnemyMinimapX - EntityDotHalfSize;
+            f32 EnemyMinY = EnemyMinimapY - EntityDotHalfSize;
+            f32 EnemyMaxX = EnemyMinimapX + EntityDotHalfSize;
+            f32 EnemyMaxY = EnemyMinimapY + EntityDotHalfSize;
+            DrawRectangle(Buffer, EnemyMinX, EnemyMinY, EnemyMaxX, EnemyMaxY, EnemyColor, EnemyColor);
+        }
+    }
 }
 
 internal ray_data
-CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
+CastARay(game_state *State, f32 PlayerX, f32 PlayerY, f32 PlayerAngle, f32 RayAngle)
 {
     Assert(RayAngle > -2*Pi32 && RayAngle < 4*Pi32);
 
@@ -498,8 +881,8 @@ CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
 
     Result.RayAngle = RayAngle;
 
-    f32 X_DecimalPart = State->PlayerX - (f32)TruncateF32ToI32(State->PlayerX);
-    f32 Y_DecimalPart = State->PlayerY - (f32)TruncateF32ToI32(State->PlayerY);
+    f32 X_DecimalPart = PlayerX - (f32)TruncateF32ToI32(PlayerX);
+    f32 Y_DecimalPart = PlayerY - (f32)TruncateF32ToI32(PlayerY);
     f32 OffsetX, OffsetY;
     f32 X_StepDirection, Y_StepDirection;
     if (RayAngle > 0.0f && RayAngle <= Pi32/2.0f)
@@ -540,8 +923,8 @@ CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
     bool32 IsInterceptHorizontal = false;
 
     // Vertical Intercepts (traversing horizontally)
-    f32 VerticalInterceptX = State->PlayerX + X_StepDirection*OffsetX;
-    f32 VerticalInterceptY = State->PlayerY + Y_StepDirection*OffsetX*RayAngleTan;
+    f32 VerticalInterceptX = PlayerX + X_StepDirection*OffsetX;
+    f32 VerticalInterceptY = PlayerY + Y_StepDirection*OffsetX*RayAngleTan;
     for (;;)
     {
         i32 HitTileX = RoundF32ToI32(VerticalInterceptX);
@@ -551,15 +934,14 @@ CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
         }
         i32 HitTileY = TruncateF32ToI32(VerticalInterceptY);
         
-        if (HitTileX < 0 || HitTileX >= 8 ||
-            HitTileY < 0 || HitTileY >= 8 ||
-            State->Map[HitTileY][HitTileX])
+        if (IsTileSolid(&State->Map, HitTileX, HitTileY))
         {
             // NOTE: Hit a wall or end of map
             Result.InterceptX = VerticalInterceptX;
             Result.InterceptY = VerticalInterceptY;
             Result.TileX = HitTileX;
             Result.TileY = HitTileY;
+            Result.Face = (X_StepDirection > 0) ? MapFace_West : MapFace_East;
             break;
         }
         
@@ -568,8 +950,8 @@ CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
     }
 
     // Horizontal Intercepts (traversing vertically)
-    f32 HorizontalInterceptX = State->PlayerX + X_StepDirection*OffsetY/RayAngleTan;
-    f32 HorizontalInterceptY = State->PlayerY + Y_StepDirection*OffsetY;
+    f32 HorizontalInterceptX = PlayerX + X_StepDirection*OffsetY/RayAngleTan;
+    f32 HorizontalInterceptY = PlayerY + Y_StepDirection*OffsetY;
     for (;;)
     {
         i32 HitTileX = TruncateF32ToI32(HorizontalInterceptX);
@@ -579,9 +961,7 @@ CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
             --HitTileY;
         }
         
-        if (HitTileX < 0 || HitTileX >= 8 ||
-            HitTileY < 0 || HitTileY >= 8 ||
-            State->Map[HitTileY][HitTileX])
+        if (IsTileSolid(&State->Map, HitTileX, HitTileY))
         {
             // NOTE: Hit a wall or end of map
 
@@ -591,8 +971,8 @@ CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
                 // NOTE:
                 // Absolute value of tangent of theta is greater than 1 => Slope (y1-y0)/(x1-x0) is greater than 1
                 // Determine the closer to player point using Y axis
-                f32 HorizontalInterceptDistanceToPlayerY = AbsoluteF32(State->PlayerY - HorizontalInterceptY);
-                f32 VerticalInterceptDistanceToPlayerY = AbsoluteF32(State->PlayerY - VerticalInterceptY);
+                f32 HorizontalInterceptDistanceToPlayerY = AbsoluteF32(PlayerY - HorizontalInterceptY);
+                f32 VerticalInterceptDistanceToPlayerY = AbsoluteF32(PlayerY - VerticalInterceptY);
                 ShouldReplaceVerticalIntercept = HorizontalInterceptDistanceToPlayerY < VerticalInterceptDistanceToPlayerY;
             }
             else
@@ -600,8 +980,8 @@ CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
                 // NOTE:
                 // Absolute value of tangent of theta is less than 1 => Slope (y1-y0)/(x1-x0) is less than 1
                 // Determine the closer to player point using X axis
-                f32 HorizontalInterceptDistanceToPlayerX = AbsoluteF32(State->PlayerX - HorizontalInterceptX);
-                f32 VerticalInterceptDistanceToPlayerX = AbsoluteF32(State->PlayerX - VerticalInterceptX);
+                f32 HorizontalInterceptDistanceToPlayerX = AbsoluteF32(PlayerX - HorizontalInterceptX);
+                f32 VerticalInterceptDistanceToPlayerX = AbsoluteF32(PlayerX - VerticalInterceptX);
                 ShouldReplaceVerticalIntercept = HorizontalInterceptDistanceToPlayerX < VerticalInterceptDistanceToPlayerX;
             }
 
@@ -611,6 +991,7 @@ CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
                 Result.InterceptY = HorizontalInterceptY;
                 Result.TileX = HitTileX;
                 Result.TileY = HitTileY;
+                Result.Face = (Y_StepDirection > 0) ? MapFace_North : MapFace_South;
 
                 IsInterceptHorizontal = true;
             }
@@ -622,8 +1003,8 @@ CastARay(game_state *State, f32 PlayerAngle, f32 RayAngle)
         HorizontalInterceptY += Y_StepDirection;
     }
 
-    f32 PlayerInterceptDistanceX = Result.InterceptX - State->PlayerX;
-    f32 PlayerInterceptDistanceY = State->PlayerY - Result.InterceptY; // ???????????????????????????????????????????????????
+    f32 PlayerInterceptDistanceX = Result.InterceptX - PlayerX;
+    f32 PlayerInterceptDistanceY = PlayerY - Result.InterceptY; // ???????????????????????????????????????????????????
                                                                  // IMPORTANT: Review this. Only 70% understand why Y should be inverted
     // f32 OldDistance = sqrtf(PlayerInterceptDistanceX*PlayerInterceptDistanceX +
     //                      PlayerInterceptDistanceY*PlayerInterceptDistanceY);
@@ -676,22 +1057,43 @@ CastARayToPoint(game_state *State, f32 X1, f32 Y1, f32 X2, f32 Y2)
     return Result;
 }
 
+#include "rayc_audio.cpp"
+
 internal void
-GameStateInit(game_state *State)
+InitializeRenderView(render_view *View, u32 EntityCapacity, memory_arena *Arena)
+{
+    // NOTE: Views hold enough room for every entity the store can ever have
+    View->EntityCount = 0;
+    View->EntityX = PushArray(Arena, EntityCapacity, f32);
+    View->EntityY = PushArray(Arena, EntityCapacity, f32);
+    View->EntityHandles = PushArray(Arena, EntityCapacity, entity_handle);
+}
+
+inline u64
+GetBlinkTicks(point_light *Light)
+{
+    u64 Result = (u64)(Light->BlinkSeconds*(f32)SIM_TICKS_PER_SECOND);
+    return Result;
+}
+
+internal game_state *
+GameStateInit(game_memory *Memory)
 {
+    Assert(sizeof(game_state) <= Memory->PermanentStorageSize);
+    game_state *State = (game_state *)Memory->PermanentStorage;
+    InitializeArena(&State->Arena, Memory->PermanentStorageSize - sizeof(game_state),
+                    (u8 *)Memory->PermanentStorage + sizeof(game_state));
+
     State->PlayerX = 1.5f;
     State->PlayerY = 2.5f;
     // State->PlayerAngle = -Pi32/12.0f;
     State->PlayerAngle = 2*Pi32-Pi32/8;
 
-    State->EnemyX = 6.5f;
-    State->EnemyY = 3.5f;
-
     u8 Map[8][8] = {
         { 1, 1, 1, 1,  1, 1, 1, 1 },
         { 1, 0, 0, 0,  0, 0, 0, 1 },
         { 1, 0, 0, 0,  0, 0, 0, 1 },
-        { 1, 0, 0, 1,  1, 0, 0, 1 },
+        { 1, 0, 0, 2,  2, 0, 0, 1 },
 
         { 1, 0, 0, 1,  1, 0, 0, 1 },
         { 1, 0, 0, 0,  0, 0, 0, 1 },
@@ -699,45 +1101,260 @@ GameStateInit(game_state *State)
         { 1, 1, 1, 1,  1, 1, 1, 1 },
     };
 
+    State->Map.Width = 8;
+    State->Map.Height = 8;
+    State->Map.Tiles = PushArray(&State->Arena, 8*8, u8);
+    State->Map.Colors = PushArray(&State->Arena, 8*8, u32);
+    State->Map.FaceTextures = PushArray(&State->Arena, 8*8*MapFace_Count, u16);
+    State->Map.FloorHeights = PushArray(&State->Arena, 8*8, f32);
+    State->Map.CeilingHeights = PushArray(&State->Arena, 8*8, f32);
+
     u8 *Source = (u8 *)Map;
-    u8 *Dest = (u8 *)State->Map;
+    u8 *Dest = State->Map.Tiles;
 
     u32 MapTileColor = 0xFF111111;
-    u32 *MapColors = (u32 *)State->MapColors;
+    u32 *MapColors = State->Map.Colors;
+    u16 *FaceTextures = State->Map.FaceTextures;
     
     for (int MapIndex = 0;
          MapIndex < 8*8;
          ++MapIndex)
     {
-        *Dest++ = *Source++;
+        u8 Tile = *Source++;
+        *Dest++ = Tile;
+
+        // NOTE: Same brick/pumpkin pattern the walls have always had
+        u16 TextureId = (MapTileColor % 2 == 0) ? WallTexture_Pumpkin : WallTexture_Brick;
+        if (Tile == MapTile_Grate)
+        {
+            TextureId = WallTexture_Grate;
+        }
+        for (u32 Face = 0;
+             Face < MapFace_Count;
+             ++Face)
+        {
+            *FaceTextures++ = TextureId;
+        }
 
         *MapColors++ = MapTileColor;
         MapTileColor = (MapTileColor + 0xFFABCDEF) % 0xFFFFFFFF;
+
+        State->Map.FloorHeights[MapIndex] = 0.0f;
+        State->Map.CeilingHeights[MapIndex] = 1.0f;
+    }
+
+    // NOTE: A stepped platform in the north-east corner (the top step needs a
+    // jump), a low lintel over the north corridor, and a tall room to the south
+    State->Map.FloorHeights[1*8 + 5] = 0.25f;
+    State->Map.FloorHeights[2*8 + 5] = 0.25f;
+    State->Map.FloorHeights[2*8 + 6] = 0.25f;
+    State->Map.FloorHeights[1*8 + 6] = 0.5f;
+    State->Map.CeilingHeights[1*8 + 6] = 1.25f;
+    State->Map.CeilingHeights[1*8 + 3] = 0.75f;
+    State->Map.CeilingHeights[1*8 + 4] = 0.75f;
+    for (i32 TileY = 5;
+         TileY <= 6;
+         ++TileY)
+    {
+        for (i32 TileX = 1;
+             TileX <= 6;
+             ++TileX)
+        {
+            State->Map.CeilingHeights[TileY*8 + TileX] = 1.75f;
+        }
+    }
+
+    InitializeMapOccupancy(&State->Map, &State->Arena);
+    UpdateMapOccupancy(&State->Map);
+
+    // NOTE: A warm lamp in the north corridor, a cold one high in the tall
+    // room, and a red alarm by the grates that blinks
+    point_light Lights[] =
+    {
+        {1.5f, 1.5f, 0.8f, 4.5f, 1.1f, 0.85f, 0.55f, true, 0.0f},
+        {4.0f, 5.8f, 1.5f, 5.0f, 0.45f, 0.6f, 1.0f, true, 0.0f},
+        {3.9f, 2.4f, 0.6f, 3.0f, 1.4f, 0.15f, 0.1f, true, 0.75f},
+    };
+    State->AmbientLight = 0.4f;
+    State->LightCount = ArrayCount(Lights);
+    for (u32 LightIndex = 0;
+         LightIndex < State->LightCount;
+         ++LightIndex)
+    {
+        State->Lights[LightIndex] = Lights[LightIndex];
+    }
+
+    State->PlayerZ = State->Map.FloorHeights[TruncateF32ToI32(State->PlayerY)*8 + TruncateF32ToI32(State->PlayerX)];
+    State->PlayerOnGround = true;
+
+    State->PrevPlayerX = State->PlayerX;
+    State->PrevPlayerY = State->PlayerY;
+    State->PrevPlayerAngle = State->PlayerAngle;
+    State->PrevPlayerZ = State->PlayerZ;
+
+    InitializeEntityStore(&State->Entities, GAME_MAX_ENTITIES, &State->Arena);
+    AddEntity(&State->Entities, 6.5f, 3.5f);
+
+    InitializeEventScheduler(&State->Events, GAME_MAX_SCHEDULED_EVENTS, State->SimTickCount, &State->Arena);
+    for (u32 LightIndex = 0;
+         LightIndex < State->LightCount;
+         ++LightIndex)
+    {
+        point_light *Light = &State->Lights[LightIndex];
+        if (Light->BlinkSeconds > 0.0f)
+        {
+            ScheduleEvent(&State->Events, GetBlinkTicks(Light), GameEvent_ToggleLight, LightIndex, 0);
+        }
+    }
+    InitializeRenderView(&State->View, State->Entities.Capacity, &State->Arena);
+
+    InitializeFlowField(&State->FlowField, &State->Map, &State->Arena);
+    UpdateFlowField(&State->FlowField, &State->Map,
+                    TruncateF32ToI32(State->PlayerX), TruncateF32ToI32(State->PlayerY),
+                    0xFFFFFFFF);
+
+    BuildPotentiallyVisibleSets(&State->PVS, &State->Map, &State->Arena);
+
+    return State;
+}
+
+inline f32
+NormalizeAngle(f32 Angle)
+{
+    f32 Result = Angle;
+    if (Result >= 2*Pi32)
+    {
+        Result -= 2*Pi32;
+    }
+    else if (Result < 0.0f)
+    {
+        Result += 2*Pi32;
+    }
+    return Result;
+}
+
+inline f32
+LerpF32(f32 A, f32 B, f32 T)
+{
+    f32 Result = A + (B - A)*T;
+    return Result;
+}
+
+inline f32
+LerpAngle(f32 A, f32 B, f32 T)
+{
+    // NOTE: Interpolate along the short way around so 359deg->1deg doesn't spin
+    f32 Delta = B - A;
+    if (Delta > Pi32)
+    {
+        Delta -= 2*Pi32;
+    }
+    else if (Delta < -Pi32)
+    {
+        Delta += 2*Pi32;
     }
+    f32 Result = NormalizeAngle(A + Delta*T);
+    return Result;
+}
+
+inline memory_index
+GameStateSnapshotSize(game_state *State)
+{
+    // NOTE: game_state and everything it points to sit in one run at the start
+    // of permanent storage, and nothing in that run points outside it (render
+    // state and assets are all in transient storage). Copying the run out and
+    // back to the same address is a complete save and restore of the
+    // simulation.
+    memory_index Result = (memory_index)((State->Arena.Base + State->Arena.Used) - (u8 *)State);
+    return Result;
+}
+
+internal render_state *
+RenderStateInit(game_memory *Memory)
+{
+    Assert(sizeof(render_state) <= Memory->TransientStorageSize);
+    render_state *Render = (render_state *)Memory->TransientStorage;
+    InitializeArena(&Render->Arena, Memory->TransientStorageSize - sizeof(render_state),
+                    (u8 *)Memory->TransientStorage + sizeof(render_state));
 
     render_data RenderData = {0};
 
-    RenderData.Textures[0] = LoadBMP("textures/brick.bmp");
-    RenderData.Textures[1] = LoadBMP("textures/pumpkin.bmp");
-    RenderData.Textures[2] = LoadBMP("textures/enemy.bmp");
+    texture_load TextureLoads[] =
+    {
+        {"textures/brick.bmp", &RenderData.Textures[0]},
+        {"textures/pumpkin.bmp", &RenderData.Textures[1]},
+        {"textures/enemy.bmp", &RenderData.Textures[2]},
+        {"textures/grate.bmp", &RenderData.Textures[3]},
+        {"textures/font.bmp", &RenderData.Textures[4]},
+    };
+    texture_load_stats TextureStats = LoadTextures(TextureLoads, ArrayCount(TextureLoads), &Render->Arena);
+    LogPrint("Textures: %u requested, %u from cache, %u decoded, %u failed\n",
+             TextureStats.Requested, TextureStats.FromCache, TextureStats.Decoded, TextureStats.Failed);
+    RenderData.RobotSprite = LoadSprite(&RenderData.Textures[2], &Render->Arena);
     
-    State->RenderData = RenderData;
+    Render->RenderData = RenderData;
+
+    InitializeWallAtlas(&Render->WallAtlas, WALL_ATLAS_TILE_SIZE_LOG2, WALL_ATLAS_MAX_TILES, &Render->Arena);
+    u32 BrickId = AddWallTexture(&Render->WallAtlas, &RenderData.Textures[0]);
+    u32 PumpkinId = AddWallTexture(&Render->WallAtlas, &RenderData.Textures[1]);
+    u32 GrateId = AddWallTexture(&Render->WallAtlas, &RenderData.Textures[3]);
+    Assert((BrickId == WallTexture_Brick) && (PumpkinId == WallTexture_Pumpkin) &&
+           (GrateId == WallTexture_Grate));
+
+    InitializeColumnBuffer(&Render->Columns, RENDER_MAX_BUFFER_WIDTH, RENDER_MAX_BUFFER_HEIGHT, &Render->Arena);
+    Render->TransparentHits = PushArray(&Render->Arena, RAYCAST_NUM*RAYCAST_MAX_TRANSPARENT_HITS,
+                                        transparent_hit);
+
+    // NOTE: The face sweep's scratch is pushed the first time it draws
+    Render->Engine = RenderEngine_Raycast;
+
+    Render->SpriteDraws = PushArray(&Render->Arena, GAME_MAX_ENTITIES, sprite_draw);
+
+    LoadGlyphAtlas(&Render->Glyphs, &RenderData.Textures[4]);
+    InitializeAudioMixer(&Render->Audio, LoadWAV("sounds/robot.wav"));
+
+    return Render;
 }
 
 internal void
-ProcessInput(game_state *State, game_input *Input)
+ProcessMouseLook(game_state *State, game_input *Input)
 {
+    // NOTE: Mouse deltas are per frame, not per tick, so look is applied once
+    // per frame outside of the fixed step. The previous angle is rotated along
+    // with the current one so interpolation never smears the turn.
+    // (Sensitivity is what it was when this scaled by the 1/60 frame target.)
     i32 MouseXDeltaRange = 700;
-    State->PlayerAngle += -((f32)Input->MouseDX/(f32)MouseXDeltaRange) * Input->SecondsPerFrame * 20.0f;
-    if (State->PlayerAngle >= 2*Pi32)
-    {
-        State->PlayerAngle -= 2*Pi32;
-    }
-    else if (State->PlayerAngle < 0.0f)
+    f32 MouseRadiansPerCount = 20.0f / (60.0f*(f32)MouseXDeltaRange);
+    f32 DeltaAngle = -(f32)Input->MouseDX * MouseRadiansPerCount;
+
+    State->PlayerAngle = NormalizeAngle(State->PlayerAngle + DeltaAngle);
+    State->PrevPlayerAngle = NormalizeAngle(State->PrevPlayerAngle + DeltaAngle);
+
+    // NOTE: Past about half a column height the y-shear distorts too much
+    f32 MaxPitch = 0.5f;
+    State->PlayerPitch -= (f32)Input->MouseDY * MouseRadiansPerCount;
+    if (State->PlayerPitch > MaxPitch) State->PlayerPitch = MaxPitch;
+    if (State->PlayerPitch < -MaxPitch) State->PlayerPitch = -MaxPitch;
+}
+
+inline bool32
+IsTileBlockedForPlayer(game_state *State, i32 TileX, i32 TileY)
+{
+    // NOTE: Walls, ledges too high to step onto, and ceilings too low to fit under
+    game_map *Map = &State->Map;
+    bool32 Result = IsTileSolid(Map, TileX, TileY);
+    if (!Result)
     {
-        State->PlayerAngle += 2*Pi32;
+        u32 CellIndex = (u32)(TileY*Map->Width + TileX);
+        Result = ((Map->FloorHeights[CellIndex] > State->PlayerZ + PLAYER_STEP_HEIGHT) ||
+                  (Map->CeilingHeights[CellIndex] < State->PlayerZ + PLAYER_HEIGHT));
     }
+    return Result;
+}
 
+internal void
+ProcessInput(game_state *State, game_input *Input, f32 dt)
+{
     f32 PlayerVelocity = 2.0f; // tiles/sec
 
     f32 DiagonalMovementCoefficient = 0.707107f; // 1/sqrt(2)
@@ -746,20 +1363,20 @@ ProcessInput(game_state *State, game_input *Input)
     f32 PlayerDStrafe = 0.0f;
     if (Input->Forward)
     {
-        PlayerDForward = PlayerVelocity * Input->SecondsPerFrame;
+        PlayerDForward = PlayerVelocity * dt;
     }
     else if (Input->Back)
     {
-        PlayerDForward = -PlayerVelocity * Input->SecondsPerFrame;
+        PlayerDForward = -PlayerVelocity * dt;
     }
     
     if (Input->StrafeLeft)
     {
-        PlayerDStrafe = -PlayerVelocity * Input->SecondsPerFrame;
+        PlayerDStrafe = -PlayerVelocity * dt;
     }
     else if (Input->StrafeRight)
     {
-        PlayerDStrafe = PlayerVelocity * Input->SecondsPerFrame;
+        PlayerDStrafe = PlayerVelocity * dt;
     }
 
     if (AbsoluteF32(PlayerDForward) > 0.0f && AbsoluteF32(PlayerDStrafe) > 0.0f)
@@ -784,19 +1401,19 @@ ProcessInput(game_state *State, game_input *Input)
 
     f32 WallSlideDeadzone = 0.015f;
 
-    if (!State->Map[TruncateF32ToI32(PlayerCollisionTestPositionY)][TruncateF32ToI32(PlayerCollisionTestPositionX)])
+    if (!IsTileBlockedForPlayer(State, TruncateF32ToI32(PlayerCollisionTestPositionX), TruncateF32ToI32(PlayerCollisionTestPositionY)))
     {
         State->PlayerX = NewPlayerX;
         State->PlayerY = NewPlayerY;
     }
-    else if (!State->Map[TruncateF32ToI32(PlayerCollisionTestPositionY)][TruncateF32ToI32(State->PlayerX)])
+    else if (!IsTileBlockedForPlayer(State, TruncateF32ToI32(State->PlayerX), TruncateF32ToI32(PlayerCollisionTestPositionY)))
     {
         if (AbsoluteF32(PlayerDY) > WallSlideDeadzone)
         {
             State->PlayerY = NewPlayerY;
         }
     }
-    else if (!State->Map[TruncateF32ToI32(State->PlayerY)][TruncateF32ToI32(PlayerCollisionTestPositionX)])
+    else if (!IsTileBlockedForPlayer(State, TruncateF32ToI32(PlayerCollisionTestPositionX), TruncateF32ToI32(State->PlayerY)))
     {
         if (AbsoluteF32(PlayerDX) > WallSlideDeadzone)
         {
@@ -804,114 +1421,817 @@ ProcessInput(game_state *State, game_input *Input)
         }
     }
 
-}
+    // NOTE: Vertical movement. Stepping onto a ledge snaps up to it; walking
+    // off one falls.
+    f32 JumpVelocity = 3.2f; // tiles/sec
+    f32 Gravity = 10.0f; // tiles/sec^2
+    u32 PlayerCellIndex = (u32)(TruncateF32ToI32(State->PlayerY)*State->Map.Width + TruncateF32ToI32(State->PlayerX));
+    f32 FloorHeight = State->Map.FloorHeights[PlayerCellIndex];
+    f32 CeilingHeight = State->Map.CeilingHeights[PlayerCellIndex];
 
-internal void
-GameUpdateAndRender(game_state *State, game_input *Input, game_offscreen_buffer *Buffer)
-{
-    DrawRectangle(Buffer, 0.0f, 0.0f, (f32)Buffer->Width, (f32)Buffer->Height, 0xFF000000, 0xFF000000);
+    if (Input->Jump && State->PlayerOnGround)
+    {
+        State->PlayerVelocityZ = JumpVelocity;
+    }
+    State->PlayerVelocityZ -= Gravity*dt;
+    State->PlayerZ += State->PlayerVelocityZ*dt;
+    State->PlayerOnGround = false;
+    if (State->PlayerZ <= FloorHeight)
     {
-        u8 *RaycastHitMap = (u8 *)State->RaycastHitMap;
-        for (int RaycastHitMapIndex = 0;
-             RaycastHitMapIndex < 8*8;
-             ++RaycastHitMapIndex)
+        State->PlayerZ = FloorHeight;
+        State->PlayerVelocityZ = 0.0f;
+        State->PlayerOnGround = true;
+    }
+    if (State->PlayerZ + PLAYER_HEIGHT > CeilingHeight)
+    {
+        State->PlayerZ = CeilingHeight - PLAYER_HEIGHT;
+        if (State->PlayerVelocityZ > 0.0f)
         {
-            *RaycastHitMap++ = 0;
+            State->PlayerVelocityZ = 0.0f;
         }
     }
+}
 
-    ProcessInput(State, Input);
-
-    i32 RayNumber = RAYCAST_NUM;
-    f32 ColumnWidth = (f32)Buffer->Width / (f32)RayNumber;
-    f32 CurrentColumn = 0.0f;
-    f32 ScreenCenter = (f32)Buffer->Height / 2.0f;
-
-    // NOTE: Start is the smaller angle. Going counterclockwise to the end - the greater angle.
-    // But drawing from left to right, so going clockwise.
-    f32 PlayerFovStart = State->PlayerAngle - Pi32 / 6.0f;
-    f32 PlayerFovEnd = State->PlayerAngle + Pi32 / 6.0f;
-    
-    f32 dAngle = (PlayerFovStart - PlayerFovEnd) / (f32)RayNumber;
-    
-    // TODO: Is this right? What's the reasonable max distance?
-    f32 ColumnHeightConstant = 900.0f;
+internal void
+UpdateRobots(game_state *State, f32 dt)
+{
+    f32 RobotVelocity = 1.5f; // tiles/sec
+    f32 RobotStopDistance = 0.6f;
+    f32 RobotCollisionOffset = 0.2f;
+
+    entity_store *Entities = &State->Entities;
+    UpdateRobotPerception(Entities, &State->Map, &State->PVS, State->PlayerX, State->PlayerY);
+    SteerRobots(Entities, &State->FlowField, State->PlayerX, State->PlayerY,
+                RobotVelocity, RobotStopDistance);
+    MoveEntities(Entities, &State->Map, dt, RobotCollisionOffset);
+}
 
-    f32 RayAngle = PlayerFovEnd;
-    for (int RayIndex = 0;
-         RayIndex < RayNumber;
-         ++RayIndex)
+internal bool32
+IsPlayerCaught(game_state *State)
+{
+    bool32 Result = false;
+    entity_store *Entities = &State->Entities;
+    for (u32 Index = 0;
+         Index < Entities->Count;
+         ++Index)
     {
-        ray_data RayData = CastARay(State, State->PlayerAngle, RayAngle);
-
-        f32 ColumnHeight = ColumnHeightConstant / RayData.Distance;
-        f32 ColumnMinY = ScreenCenter - ColumnHeight / 2.0f;
-        f32 ColumnMaxY = ScreenCenter + ColumnHeight / 2.0f;
-        f32 ColumnMinX = CurrentColumn;
-        f32 ColumnMaxX = CurrentColumn + ColumnWidth;
-        u32 ColumnColor = 0;
-        if (RayData.TileX >= 0 && RayData.TileX < 8 &&
-            RayData.TileY >= 0 && RayData.TileY < 8)
+        f32 DX = Entities->X[Index] - State->PlayerX;
+        f32 DY = Entities->Y[Index] - State->PlayerY;
+        if (DX*DX + DY*DY < PLAYER_CATCH_DISTANCE*PLAYER_CATCH_DISTANCE)
         {
-            ColumnColor = State->MapColors[RayData.TileY][RayData.TileX];
-            texture *Texture = (ColumnColor % 2 == 0) ? &State->RenderData.Textures[1] : &State->RenderData.Textures[0]; 
-            DrawWallVerticalSection(Buffer, ColumnMinX, ColumnMinY, ColumnMaxX, ColumnMaxY,
-                                    Texture, RayData.HitWallTexturePosition);
+            Result = true;
+            break;
         }
-
-        // if (State->Map[RayData.TileY][RayData.TileX] == 2)
-        // {
-        //     DrawWallVerticalSection(Buffer, ColumnMinX, ColumnMinY, ColumnMaxX, ColumnMaxY,
-        //                             Texture, RayData.HitWallTexturePosition);
-        // }
-        // else
-        // {
-        //     DrawRectangle(Buffer, ColumnMinX, ColumnMinY, ColumnMaxX, ColumnMaxY, ColumnColor, ColumnColor);
-        // }
-
-        State->RaycastData[RayIndex] = RayData;
-
-        RayAngle += dAngle;
-        CurrentColumn += ColumnWidth;
     }
+    return Result;
+}
 
-    ray_to_point RayToEnemy = CastARayToPoint(State, State->PlayerX, State->PlayerY, State->EnemyX, State->EnemyY);
-    f32 AngleToEnemy = RayToEnemy.Angle;
+// NOTE: Runs every event due this tick. Handlers may schedule or cancel
+// other events, including ones due this same tick.
+internal void
+FireScheduledEvents(game_state *State)
+{
+    event_scheduler *Events = &State->Events;
+    AdvanceEventScheduler(Events, State->SimTickCount);
 
-    f32 NormalizedPlayerFovStart = PlayerFovStart;
-    if (NormalizedPlayerFovStart < -Pi32)
+    scheduled_event Event;
+    while (PopDueEvent(Events, &Event))
     {
-        NormalizedPlayerFovStart += 2.0f*Pi32;
-    }
-    if (NormalizedPlayerFovStart > Pi32)
+        switch (Event.Type)
+        {
+            case GameEvent_ToggleLight:
+            {
+                if (Event.Target < State->LightCount)
+                {
+                    point_light *Light = &State->Lights[Event.Target];
+                    Light->On = !Light->On;
+                    ScheduleEvent(Events, GetBlinkTicks(Light), GameEvent_ToggleLight, Event.Target, 0);
+                }
+            } break;
+
+            default:
+            {
+                Assert(!"Unknown game event type");
+            } break;
+        }
+    }
+}
+
+internal void
+SimulateTick(game_state *State, game_input *Input, f32 dt)
+{
+    State->PrevPlayerX = State->PlayerX;
+    State->PrevPlayerY = State->PlayerY;
+    State->PrevPlayerAngle = State->PlayerAngle;
+    State->PrevPlayerZ = State->PlayerZ;
+
+    ProcessInput(State, Input, dt);
+
+    UpdateFlowField(&State->FlowField, &State->Map,
+                    TruncateF32ToI32(State->PlayerX), TruncateF32ToI32(State->PlayerY),
+                    FLOW_FIELD_CELLS_PER_TICK);
+    UpdateRobots(State, dt);
+    if (IsPlayerCaught(State))
+    {
+        State->PlayerCaught = true;
+    }
+    FireScheduledEvents(State);
+
+    ++State->SimTickCount;
+}
+
+internal void
+FillRenderView(game_state *State, render_view *View, f32 Alpha)
+{
+    // NOTE: Alpha is how far between the previous tick and the current one
+    View->PlayerX = LerpF32(State->PrevPlayerX, State->PlayerX, Alpha);
+    View->PlayerY = LerpF32(State->PrevPlayerY, State->PlayerY, Alpha);
+    View->PlayerAngle = LerpAngle(State->PrevPlayerAngle, State->PlayerAngle, Alpha);
+    View->PlayerEyeZ = LerpF32(State->PrevPlayerZ, State->PlayerZ, Alpha) + PLAYER_EYE_HEIGHT;
+    View->PlayerPitch = State->PlayerPitch;
+    View->FrameSeconds = State->LastFrameSeconds;
+    View->SimTickCount = State->SimTickCount;
+    View->EntityCount = State->Entities.Count;
+    InterpolateEntities(&State->Entities, Alpha, View->EntityX, View->EntityY);
+    GetEntityHandles(&State->Entities, View->EntityHandles);
+    View->AmbientLight = State->AmbientLight;
+    View->LightCount = State->LightCount;
+    for (u32 LightIndex = 0;
+         LightIndex < State->LightCount;
+         ++LightIndex)
+    {
+        View->Lights[LightIndex] = State->Lights[LightIndex];
+    }
+}
+
+internal void
+GameUpdate(game_state *State, game_input *Input, render_view *View)
+{
+    ProcessMouseLook(State, Input);
+    State->LastFrameSeconds = Input->SecondsElapsed;
+
+    f32 dt = SIM_SECONDS_PER_TICK;
+    State->SimAccumulator += Input->SecondsElapsed;
+    if (State->SimAccumulator > SIM_MAX_TICKS_PER_FRAME*dt)
+    {
+        State->SimAccumulator = SIM_MAX_TICKS_PER_FRAME*dt;
+    }
+
+    while (State->SimAccumulator >= dt)
+    {
+        SimulateTick(State, Input, dt);
+        State->SimAccumulator -= dt;
+    }
+
+    f32 Alpha = State->SimAccumulator / dt;
+    FillRenderView(State, View, Alpha);
+}
+
+struct wall_camera
+{
+    f32 X;
+    f32 Y;
+    f32 EyeZ;
+    f32 Angle;
+
+    // NOTE: Screen row of the horizon (moves with pitch), and pixels per tile
+    // of height at distance 1
+    f32 Horizon;
+    f32 Scale;
+};
+
+inline f32
+ProjectHeight(wall_camera *Camera, f32 Height, f32 Depth)
+{
+    f32 Result = Camera->Horizon + (Camera->EyeZ - Height)*Camera->Scale / Depth;
+    return Result;
+}
+
+inline i32
+ScreenRowForY(f32 RealY)
+{
+    // NOTE: Clamped well inside i32 for walls right up against the camera
+    if (RealY < -1.0e6f) RealY = -1.0e6f;
+    if (RealY > 1.0e6f) RealY = 1.0e6f;
+    i32 Result = (i32)floorf(RealY + 0.5f);
+    return Result;
+}
+
+internal i32
+FillColumnSpan(column_buffer *Buffer, f32 RealMinX, f32 RealMaxX,
+               i32 MinY, i32 MaxY, u32 Color, u8 *Coverage)
+{
+    // NOTE: Coverage is optional, same as for DrawWallColumn. Returns the
+    // number of rows written.
+    i32 Result = 0;
+    i32 MinX = RoundF32ToI32(RealMinX);
+    i32 MaxX = RoundF32ToI32(RealMaxX);
+    if (MaxX > Buffer->Width) MaxX = Buffer->Width;
+
+    u32 *Pixels = GetColumn(Buffer, MinX) + MinY;
+    u32 PixelsPerColumn = (u32)Buffer->ColumnPitch / sizeof(u32);
+    for (i32 Y = MinY;
+         Y < MaxY;
+         ++Y)
+    {
+        u32 *Pixel = Pixels++;
+        if (!Coverage || !Coverage[Y])
+        {
+            for (i32 X = MinX;
+                 X < MaxX;
+                 ++X)
+            {
+                *Pixel = Color;
+                Pixel += PixelsPerColumn;
+            }
+            if (Coverage)
+            {
+                Coverage[Y] = 1;
+                CountColumnWrites(Buffer, MinX, MaxX, Y, Y + 1);
+            }
+            ++Result;
+        }
+    }
+    if (!Coverage)
+    {
+        CountColumnWrites(Buffer, MinX, MaxX, MinY, MaxY);
+    }
+
+    return Result;
+}
+
+inline u32
+FloorColorForHeight(f32 Height)
+{
+    // NOTE: Flat shade, lighter the higher the floor, so steps read at a glance
+    i32 Level = 0x20 + TruncateF32ToI32(Height*96.0f);
+    if (Level < 0) Level = 0;
+    if (Level > 0xA0) Level = 0xA0;
+    u32 Result = 0xFF000000 | (Level << 16) | (Level << 8) | Level;
+    return Result;
+}
+
+// NOTE: One cell and the face a column leaves it through: everything about
+// the map that drawing the column across that face needs. The ray caster
+// looks this up at every step; the face sweep once per face.
+struct cell_boundary
+{
+    u32 CellIndex;
+    bool32 InGrate;
+    f32 Floor;
+    f32 Ceiling;
+
+    i32 NextX;
+    i32 NextY;
+    u32 Face;
+    u32 TextureId;
+    // NOTE: Solid and not see-through, so the column ends here. The next
+    // cell's heights are only read when it isn't.
+    bool32 NextSolid;
+    bool32 NextInGrate;
+    f32 NextFloor;
+    f32 NextCeiling;
+};
+
+internal void
+LoadCellBoundary(game_map *Map, cell_boundary *Boundary, i32 CellX, i32 CellY,
+                 i32 NextX, i32 NextY, u32 Face)
+{
+    Boundary->CellIndex = (u32)(CellY*Map->Width + CellX);
+    Boundary->InGrate = IsTileSeeThrough(Map, CellX, CellY);
+    Boundary->Floor = Map->FloorHeights[Boundary->CellIndex];
+    Boundary->Ceiling = Map->CeilingHeights[Boundary->CellIndex];
+
+    Boundary->NextX = NextX;
+    Boundary->NextY = NextY;
+    Boundary->Face = Face;
+    Boundary->TextureId = 0;
+    if (IsTileInMap(Map, NextX, NextY))
+    {
+        Boundary->TextureId = Map->FaceTextures[(NextY*Map->Width + NextX)*MapFace_Count + Face];
+    }
+
+    Boundary->NextInGrate = IsTileSeeThrough(Map, NextX, NextY);
+    Boundary->NextSolid = IsTileOpaque(Map, NextX, NextY);
+    Boundary->NextFloor = 0.0f;
+    Boundary->NextCeiling = 0.0f;
+    if (!Boundary->NextSolid)
+    {
+        u32 NextCellIndex = (u32)(NextY*Map->Width + NextX);
+        Boundary->NextFloor = Map->FloorHeights[NextCellIndex];
+        Boundary->NextCeiling = Map->CeilingHeights[NextCellIndex];
+    }
+}
+
+internal bool32
+DrawCellBoundary(game_map *Map, render_state *Render, column_buffer *Buffer, wall_camera *Camera,
+                 cell_boundary *Boundary, column_clip *Clip, u8 *CoverageStorage, transparent_hit *Hits,
+                 f32 ColumnMinX, f32 ColumnMaxX, f32 TextureU, f32 Depth)
+{
+    // NOTE: Draws one column's share of a cell: its floor and ceiling out to
+    // the far boundary at Depth, then whatever is on that boundary. Returns
+    // true once the column is done.
+    wall_atlas *Atlas = &Render->WallAtlas;
+    u32 CeilingColor = 0xFF000000;
+    f32 Floor = Boundary->Floor;
+    f32 Ceiling = Boundary->Ceiling;
+    u32 TextureId = Boundary->TextureId;
+
+    f32 RealFloorY = ProjectHeight(Camera, Floor, Depth);
+    f32 RealCeilingY = ProjectHeight(Camera, Ceiling, Depth);
+
+    // NOTE: This cell's floor and ceiling, out to its far boundary
+    i32 FloorY = ScreenRowForY(RealFloorY);
+    if (FloorY < Clip->ClipTop) FloorY = Clip->ClipTop;
+    if (FloorY < Clip->ClipBottom)
+    {
+        Clip->UncoveredRows -= FillColumnSpan(Buffer, ColumnMinX, ColumnMaxX, FloorY, Clip->ClipBottom,
+                                              FloorColorForHeight(Floor), Clip->Coverage);
+        Clip->ClipBottom = FloorY;
+    }
+    i32 CeilingY = ScreenRowForY(RealCeilingY);
+    if (CeilingY > Clip->ClipBottom) CeilingY = Clip->ClipBottom;
+    if (CeilingY > Clip->ClipTop)
+    {
+        Clip->UncoveredRows -= FillColumnSpan(Buffer, ColumnMinX, ColumnMaxX, Clip->ClipTop, CeilingY,
+                                              CeilingColor, Clip->Coverage);
+        Clip->ClipTop = CeilingY;
+    }
+
+    // NOTE: One light value for everything drawn on the boundary, looked up
+    // only if something is
+    f32 NextFloor = Boundary->NextFloor;
+    f32 NextCeiling = Boundary->NextCeiling;
+    u32 Light = LIGHTMAP_UNLIT;
+    if (Boundary->NextSolid || (NextFloor > Floor) || (NextCeiling < Ceiling) ||
+        (Boundary->InGrate != Boundary->NextInGrate))
+    {
+        Light = SampleFaceLight(&Render->Lighting, Boundary->NextX, Boundary->NextY, Boundary->Face, TextureU);
+    }
+
+    if (Boundary->NextSolid)
+    {
+        Clip->UncoveredRows -= DrawWallColumn(Buffer, Atlas, TextureId, TextureU, Light,
+                                              ColumnMinX, ColumnMaxX, RealCeilingY, RealFloorY,
+                                              -Ceiling, -Floor, Clip->ClipTop, Clip->ClipBottom,
+                                              Clip->Coverage, false);
+        Clip->ClipTop = Clip->ClipBottom;
+    }
+    else
+    {
+        if (NextFloor > Floor)
+        {
+            // NOTE: Step up into the next cell
+            f32 RealStepY = ProjectHeight(Camera, NextFloor, Depth);
+            Clip->UncoveredRows -= DrawWallColumn(Buffer, Atlas, TextureId, TextureU, Light,
+                                                  ColumnMinX, ColumnMaxX, RealStepY, RealFloorY,
+                                                  -NextFloor, -Floor, Clip->ClipTop, Clip->ClipBottom,
+                                                  Clip->Coverage, false);
+            i32 StepRowY = ScreenRowForY(RealStepY);
+            if (StepRowY < Clip->ClipBottom)
+            {
+                Clip->ClipBottom = (StepRowY > Clip->ClipTop) ? StepRowY : Clip->ClipTop;
+            }
+        }
+        if (NextCeiling < Ceiling)
+        {
+            // NOTE: Lintel down to the next cell's ceiling
+            f32 RealLintelY = ProjectHeight(Camera, NextCeiling, Depth);
+            Clip->UncoveredRows -= DrawWallColumn(Buffer, Atlas, TextureId, TextureU, Light,
+                                                  ColumnMinX, ColumnMaxX, RealCeilingY, RealLintelY,
+                                                  -Ceiling, -NextCeiling, Clip->ClipTop, Clip->ClipBottom,
+                                                  Clip->Coverage, false);
+            i32 LintelY = ScreenRowForY(RealLintelY);
+            if (LintelY > Clip->ClipTop)
+            {
+                Clip->ClipTop = (LintelY < Clip->ClipBottom) ? LintelY : Clip->ClipBottom;
+            }
+        }
+
+        // NOTE: A grate face is where the ray goes into or comes out of
+        // grate cells. Faces between two grate cells aren't drawn.
+        if ((Boundary->InGrate != Boundary->NextInGrate) && (Clip->ClipTop < Clip->ClipBottom))
+        {
+            u32 GrateTextureId = TextureId;
+            if (Boundary->InGrate)
+            {
+                u32 ExitFace = (Boundary->Face + 2) % MapFace_Count;
+                GrateTextureId = Map->FaceTextures[Boundary->CellIndex*MapFace_Count + ExitFace];
+            }
+            f32 GrateFloor = (NextFloor > Floor) ? NextFloor : Floor;
+            f32 GrateCeiling = (NextCeiling < Ceiling) ? NextCeiling : Ceiling;
+            f32 RealGrateMinY = ProjectHeight(Camera, GrateCeiling, Depth);
+            f32 RealGrateMaxY = ProjectHeight(Camera, GrateFloor, Depth);
+
+            if (Clip->HitCount < RAYCAST_MAX_TRANSPARENT_HITS)
+            {
+                if (!Clip->Coverage)
+                {
+                    Clip->Coverage = CoverageStorage;
+                    for (i32 Y = Clip->ClipTop;
+                         Y < Clip->ClipBottom;
+                         ++Y)
+                    {
+                        Clip->Coverage[Y] = 0;
+                    }
+                    Clip->UncoveredRows = Clip->ClipBottom - Clip->ClipTop;
+                }
+
+                transparent_hit *Hit = &Hits[Clip->HitCount++];
+                Hit->TextureId = GrateTextureId;
+                Hit->TextureU = TextureU;
+                Hit->Light = Light;
+                Hit->Depth = Depth;
+                Hit->RealMinY = RealGrateMinY;
+                Hit->RealMaxY = RealGrateMaxY;
+                Hit->TextureMinV = -GrateCeiling;
+                Hit->TextureMaxV = -GrateFloor;
+                Hit->ClipMinY = Clip->ClipTop;
+                Hit->ClipMaxY = Clip->ClipBottom;
+
+                Clip->UncoveredRows -= DrawWallColumn(Buffer, Atlas, GrateTextureId, TextureU, Light,
+                                                      ColumnMinX, ColumnMaxX, RealGrateMinY, RealGrateMaxY,
+                                                      -GrateCeiling, -GrateFloor, Clip->ClipTop, Clip->ClipBottom,
+                                                      Clip->Coverage, true);
+            }
+            else
+            {
+                // NOTE: Out of hits, so this grate is drawn solid and ends
+                // the column. Keeps rooms full of grates bounded.
+                Clip->UncoveredRows -= DrawWallColumn(Buffer, Atlas, GrateTextureId, TextureU, Light,
+                                                      ColumnMinX, ColumnMaxX, RealGrateMinY, RealGrateMaxY,
+                                                      -GrateCeiling, -GrateFloor, Clip->ClipTop, Clip->ClipBottom,
+                                                      Clip->Coverage, false);
+                Clip->ClipTop = Clip->ClipBottom;
+            }
+        }
+    }
+
+    bool32 Result = ((Clip->ClipTop >= Clip->ClipBottom) ||
+                     (Clip->Coverage && (Clip->UncoveredRows <= 0)));
+    return Result;
+}
+
+inline f32
+GridLineCrossingT(f32 CameraP, i32 Line, f32 Dir, f32 TDelta)
+{
+    // NOTE: How far along the ray it crosses grid line Line, worked out from
+    // scratch rather than summed a cell at a time, so both engines get the
+    // same value for a face whatever order they reach it in
+    f32 Result = 1.0e30f;
+    if (Dir > 0.0f)
+    {
+        Result = ((f32)Line - CameraP)*TDelta;
+    }
+    else if (Dir < 0.0f)
+    {
+        Result = (CameraP - (f32)Line)*TDelta;
+    }
+    return Result;
+}
+
+internal ray_data
+RenderWallColumn(game_state *State, render_state *Render, column_buffer *Buffer,
+                 wall_camera *Camera, f32 RayAngle, f32 ColumnMinX, f32 ColumnMaxX,
+                 transparent_hit *Hits)
+{
+    // NOTE: Walks the cells along the ray front to back, Build style. The
+    // column keeps a clip span of rows not yet drawn; each cell's floor and
+    // ceiling, and any step or lintel where heights change, draw into that
+    // span and shrink it. The walk stops the moment the span closes, so
+    // every pixel is written exactly once.
+    //
+    // Grate faces don't end the walk. They draw only their opaque texels, under
+    // a per-row coverage mask so nothing behind them draws over those rows,
+    // and are recorded in Hits (at most RAYCAST_MAX_TRANSPARENT_HITS) for the
+    // sprite pass. The column is done when the span closes or every row is
+    // covered. Until the first grate the mask isn't touched at all.
+    //
+    // Returns the last boundary reached, which is what the minimap and sprite
+    // occlusion use.
+    game_map *Map = &State->Map;
+    ray_data Result = {0};
+    Result.RayAngle = NormalizeAngle(RayAngle);
+
+    f32 DirX = cosf(RayAngle);
+    f32 DirY = -sinf(RayAngle);
+    f32 CosOffView = cosf(RayAngle - Camera->Angle);
+
+    i32 CellX = TruncateF32ToI32(Camera->X);
+    i32 CellY = TruncateF32ToI32(Camera->Y);
+    i32 StepX = (DirX > 0.0f) ? 1 : -1;
+    i32 StepY = (DirY > 0.0f) ? 1 : -1;
+    f32 NoCrossing = 1.0e30f;
+    f32 TDeltaX = (DirX != 0.0f) ? AbsoluteF32(1.0f / DirX) : NoCrossing;
+    f32 TDeltaY = (DirY != 0.0f) ? AbsoluteF32(1.0f / DirY) : NoCrossing;
+    i32 FarSideX = (StepX > 0) ? 1 : 0;
+    i32 FarSideY = (StepY > 0) ? 1 : 0;
+    f32 TMaxX = GridLineCrossingT(Camera->X, CellX + FarSideX, DirX, TDeltaX);
+    f32 TMaxY = GridLineCrossingT(Camera->Y, CellY + FarSideY, DirY, TDeltaY);
+
+    column_clip Clip = {};
+    Clip.ClipBottom = Buffer->Height;
+    u32 CellSteps = 0;
+
+    for (;;)
+    {
+        ++CellSteps;
+
+        f32 T;
+        i32 NextX = CellX;
+        i32 NextY = CellY;
+        u32 Face;
+        f32 TextureU;
+        if (TMaxX < TMaxY)
+        {
+            T = TMaxX;
+            NextX += StepX;
+            TMaxX = GridLineCrossingT(Camera->X, NextX + FarSideX, DirX, TDeltaX);
+            Face = (StepX > 0) ? MapFace_West : MapFace_East;
+            f32 HitY = Camera->Y + T*DirY;
+            TextureU = HitY - floorf(HitY);
+        }
+        else
+        {
+            T = TMaxY;
+            NextY += StepY;
+            TMaxY = GridLineCrossingT(Camera->Y, NextY + FarSideY, DirY, TDeltaY);
+            Face = (StepY > 0) ? MapFace_North : MapFace_South;
+            f32 HitX = Camera->X + T*DirX;
+            TextureU = HitX - floorf(HitX);
+        }
+
+        f32 Depth = T*CosOffView;
+        if (Depth < 1.0e-4f)
+        {
+            Depth = 1.0e-4f;
+        }
+
+        cell_boundary Boundary;
+        LoadCellBoundary(Map, &Boundary, CellX, CellY, NextX, NextY, Face);
+        if (DrawCellBoundary(Map, Render, Buffer, Camera, &Boundary, &Clip, Render->ColumnCoverage, Hits,
+                             ColumnMinX, ColumnMaxX, TextureU, Depth))
+        {
+            Result.InterceptX = Camera->X + T*DirX;
+            Result.InterceptY = Camera->Y + T*DirY;
+            Result.TileX = NextX;
+            Result.TileY = NextY;
+            Result.Face = Face;
+            Result.HitWallTexturePosition = TextureU;
+            Result.Distance = Depth;
+            Result.TransparentHitCount = Clip.HitCount;
+            Result.CellSteps = CellSteps;
+            break;
+        }
+
+        CellX = NextX;
+        CellY = NextY;
+    }
+
+    return Result;
+}
+
+#include "rayc_faces.cpp"
+
+internal void
+RenderWalls(game_state *State, render_state *Render, column_buffer *Buffer, wall_camera *Camera,
+            f32 FirstRayAngle, f32 dAngle, f32 ColumnWidth, i32 ColumnCount)
+{
+    // NOTE: Fills in every column of the view, and RaycastData and
+    // TransparentHits for them, with whichever engine is selected. The game
+    // always asks for RAYCAST_NUM columns; the bench asks for fewer to see
+    // how each engine's cost grows with them.
+    Assert(ColumnCount <= RAYCAST_NUM);
+    if (Render->Engine == RenderEngine_Faces)
+    {
+        RenderFaceSweep(State, Render, Buffer, Camera, FirstRayAngle, dAngle, ColumnWidth, ColumnCount);
+    }
+    else
+    {
+        f32 RayAngle = FirstRayAngle;
+        f32 CurrentColumn = 0.0f;
+        for (int RayIndex = 0;
+             RayIndex < ColumnCount;
+             ++RayIndex)
+        {
+            f32 ColumnMinX = CurrentColumn;
+            f32 ColumnMaxX = CurrentColumn + ColumnWidth;
+            transparent_hit *Hits = Render->TransparentHits + RayIndex*RAYCAST_MAX_TRANSPARENT_HITS;
+            Render->RaycastData[RayIndex] = RenderWallColumn(State, Render, Buffer, Camera, RayAngle,
+                                                             ColumnMinX, ColumnMaxX, Hits);
+
+            RayAngle += dAngle;
+            CurrentColumn += ColumnWidth;
+        }
+    }
+}
+
+internal void
+RedrawGrates(render_state *Render, column_buffer *Columns, i32 RayIndex, f32 ColumnWidth,
+             f32 MinDepth, f32 MaxDepth)
+{
+    // NOTE: Draws the column's grate faces from MinDepth up to (not
+    // including) MaxDepth again, far to near
+    ray_data *RayData = &Render->RaycastData[RayIndex];
+    transparent_hit *Hits = Render->TransparentHits + RayIndex*RAYCAST_MAX_TRANSPARENT_HITS;
+    for (i32 HitIndex = (i32)RayData->TransparentHitCount - 1;
+         HitIndex >= 0;
+         --HitIndex)
+    {
+        transparent_hit *Hit = &Hits[HitIndex];
+        if (Hit->Depth < MinDepth)
+        {
+            break;
+        }
+
+        if (Hit->Depth < MaxDepth)
+        {
+            DrawWallColumn(Columns, &Render->WallAtlas, Hit->TextureId, Hit->TextureU, Hit->Light,
+                           (f32)RayIndex*ColumnWidth, (f32)(RayIndex + 1)*ColumnWidth,
+                           Hit->RealMinY, Hit->RealMaxY, Hit->TextureMinV, Hit->TextureMaxV,
+                           Hit->ClipMinY, Hit->ClipMaxY, 0, true);
+        }
+    }
+}
+
+internal void
+GameRender(game_state *State, render_state *Render, render_view *View, game_offscreen_buffer *PlatformBuffer)
+{
+    // NOTE: Drawn through a copy, so write counting never touches the
+    // platform's buffer
+    game_offscreen_buffer Target = *PlatformBuffer;
+    Target.WriteCounts = 0;
+    game_offscreen_buffer *Buffer = &Target;
+
+    Assert((Buffer->Width <= RENDER_MAX_BUFFER_WIDTH) && (Buffer->Height <= RENDER_MAX_BUFFER_HEIGHT));
+    column_buffer *Columns = &Render->Columns;
+    ResizeColumnBuffer(Columns, Buffer->Width, Buffer->Height);
+
+    render_heatmap *Heatmap = &Render->Heatmap;
+    bool32 CountingWrites = BeginHeatmapFrame(Heatmap, Buffer->Width, Buffer->Height, &Render->Arena);
+    Columns->WriteCounts = CountingWrites ? Heatmap->ColumnWrites : 0;
+
+    i32 RayNumber = RAYCAST_NUM;
+    f32 ColumnWidth = (f32)Buffer->Width / (f32)RayNumber;
+    f32 ScreenCenter = (f32)Buffer->Height / 2.0f;
+
+    // NOTE: Start is the smaller angle. Going counterclockwise to the end - the greater angle.
+    // But drawing from left to right, so going clockwise.
+    f32 PlayerFovStart = View->PlayerAngle - Pi32 / 6.0f;
+    f32 PlayerFovEnd = View->PlayerAngle + Pi32 / 6.0f;
+    
+    f32 dAngle = (PlayerFovStart - PlayerFovEnd) / (f32)RayNumber;
+    
+    // TODO: Is this right? What's the reasonable max distance?
+    f32 ColumnHeightConstant = 900.0f;
+
+    // NOTE: Jumping raises the eye; looking up and down shears the horizon
+    wall_camera Camera = {};
+    Camera.X = View->PlayerX;
+    Camera.Y = View->PlayerY;
+    Camera.EyeZ = View->PlayerEyeZ;
+    Camera.Angle = View->PlayerAngle;
+    Camera.Horizon = ScreenCenter + View->PlayerPitch*ColumnHeightConstant;
+    Camera.Scale = ColumnHeightConstant;
+
+    UpdateFaceLighting(&Render->Lighting, &State->Map, View->AmbientLight,
+                       View->Lights, View->LightCount, &Render->Arena);
+
+    // NOTE: Every column fills every row, so there's no clear
+    RenderWalls(State, Render, Columns, &Camera, PlayerFovEnd, dAngle, ColumnWidth, RayNumber);
+
+    u32 TotalCellSteps = 0;
+    u32 MaxCellSteps = 0;
+    for (int RayIndex = 0;
+         RayIndex < RayNumber;
+         ++RayIndex)
+    {
+        u32 CellSteps = Render->RaycastData[RayIndex].CellSteps;
+        TotalCellSteps += CellSteps;
+        if (CellSteps > MaxCellSteps)
+        {
+            MaxCellSteps = CellSteps;
+        }
+    }
+
+    // NOTE: Robots, far to near so nearer ones overdraw. Rays are evenly spaced
+    // in angle, so a sprite's screen X is linear in its angle off the view.
+    f32 FovAngle = PlayerFovEnd - PlayerFovStart;
+    f32 PixelsPerRadian = (f32)Buffer->Width / FovAngle;
+    sprite *RobotSprite = &Render->RenderData.RobotSprite;
+    f32 RobotAspect = (RobotSprite->Height > 0) ? ((f32)RobotSprite->Width / (f32)RobotSprite->Height) : 1.0f;
+    f32 RobotMinDepth = 0.05f;
+
+    // NOTE: SpriteNearDepth is left zeroed from last frame. Robots outside
+    // the camera cell's potentially visible set can't show, whatever the walls
+    // in between look like this frame.
+    pvs_set *ViewSet = GetPotentiallyVisibleSet(&State->PVS, View->PlayerX, View->PlayerY);
+    u32 SpriteDrawCount = 0;
+    for (u32 EntityIndex = 0;
+         EntityIndex < View->EntityCount;
+         ++EntityIndex)
+    {
+        if (!IsInPotentiallyVisibleSet(&State->PVS, ViewSet, View->EntityX[EntityIndex], View->EntityY[EntityIndex]))
+        {
+            continue;
+        }
+
+        ray_to_point RayToEnemy = CastARayToPoint(State, View->PlayerX, View->PlayerY,
+                                                  View->EntityX[EntityIndex], View->EntityY[EntityIndex]);
+        f32 AngleOffView = RayToEnemy.Angle - View->PlayerAngle;
+        while (AngleOffView > Pi32) AngleOffView -= 2.0f*Pi32;
+        while (AngleOffView < -Pi32) AngleOffView += 2.0f*Pi32;
+
+        // NOTE: Same perpendicular distance the walls use
+        f32 Depth = RayToEnemy.Distance*cosf(AngleOffView);
+        if (Depth > RobotMinDepth)
+        {
+            // NOTE: Let sprites straddling the edge of the view through
+            f32 HalfAngularWidth = 0.5f*RobotAspect / Depth;
+            if (AbsoluteF32(AngleOffView) <= FovAngle/2.0f + HalfAngularWidth)
+            {
+                sprite_draw *Draw = &Render->SpriteDraws[SpriteDrawCount++];
+                Draw->EntityIndex = EntityIndex;
+                Draw->Depth = Depth;
+                Draw->ScreenX = (FovAngle/2.0f - AngleOffView)*PixelsPerRadian;
+            }
+        }
+    }
+
+    // TODO: Insertion sort is fine for a handful of robots in view; radix sort
+    // on depth if crowds get big
+    for (u32 DrawIndex = 1;
+         DrawIndex < SpriteDrawCount;
+         ++DrawIndex)
     {
-        NormalizedPlayerFovStart -= 2.0f*Pi32;
+        sprite_draw Draw = Render->SpriteDraws[DrawIndex];
+        u32 InsertIndex = DrawIndex;
+        while ((InsertIndex > 0) && (Render->SpriteDraws[InsertIndex - 1].Depth < Draw.Depth))
+        {
+            Render->SpriteDraws[InsertIndex] = Render->SpriteDraws[InsertIndex - 1];
+            --InsertIndex;
+        }
+        Render->SpriteDraws[InsertIndex] = Draw;
     }
-    f32 NormalizedPlayerFovEnd = PlayerFovEnd;
-    if (NormalizedPlayerFovEnd < -Pi32)
+
+    // NOTE: Robots are drawn after the walls, over any grates already in the
+    // columns. So each column's grates get drawn again, clipped as they first
+    // were, in among the robots: before a robot goes on, the grates between
+    // it and the robot last drawn in that column, and once they're all on,
+    // the grates in front of the nearest. Far to near throughout, so
+    // whatever is nearer ends up on top.
+    for (u32 DrawIndex = 0;
+         DrawIndex < SpriteDrawCount;
+         ++DrawIndex)
     {
-        NormalizedPlayerFovEnd += 2.0f*Pi32;
+        sprite_draw *Draw = &Render->SpriteDraws[DrawIndex];
+        // NOTE: Robots are one tile tall, standing on their cell's floor
+        game_map *Map = &State->Map;
+        u32 CellIndex = (u32)(TruncateF32ToI32(View->EntityY[Draw->EntityIndex])*Map->Width +
+                              TruncateF32ToI32(View->EntityX[Draw->EntityIndex]));
+        f32 SpriteMinY = ProjectHeight(&Camera, Map->FloorHeights[CellIndex] + 1.0f, Draw->Depth);
+        f32 SpriteHeight = ColumnHeightConstant / Draw->Depth;
+        f32 SpriteWidth = RobotAspect*PixelsPerRadian / Draw->Depth;
+
+        i32 MinRay = (i32)floorf(Draw->ScreenX - SpriteWidth/2.0f)*RAYCAST_NUM / Buffer->Width;
+        i32 MaxRay = (i32)ceilf(Draw->ScreenX + SpriteWidth/2.0f)*RAYCAST_NUM / Buffer->Width;
+        if (MinRay < 0) MinRay = 0;
+        if (MaxRay > RAYCAST_NUM - 1) MaxRay = RAYCAST_NUM - 1;
+        for (i32 RayIndex = MinRay;
+             RayIndex <= MaxRay;
+             ++RayIndex)
+        {
+            f32 NearDepth = Render->SpriteNearDepth[RayIndex];
+            if (NearDepth > 0.0f)
+            {
+                RedrawGrates(Render, Columns, RayIndex, ColumnWidth, Draw->Depth, NearDepth);
+            }
+            Render->SpriteNearDepth[RayIndex] = Draw->Depth;
+        }
+
+        DrawSprite(Columns, RobotSprite,
+                   Draw->ScreenX, SpriteMinY,
+                   SpriteWidth, SpriteHeight,
+                   Draw->Depth, Render->RaycastData, RAYCAST_NUM);
     }
-    if (NormalizedPlayerFovEnd > Pi32)
+
+    for (i32 RayIndex = 0;
+         RayIndex < RAYCAST_NUM;
+         ++RayIndex)
     {
-        NormalizedPlayerFovEnd -= 2.0f*Pi32;
+        f32 NearDepth = Render->SpriteNearDepth[RayIndex];
+        if (NearDepth > 0.0f)
+        {
+            RedrawGrates(Render, Columns, RayIndex, ColumnWidth, 0.0f, NearDepth);
+            Render->SpriteNearDepth[RayIndex] = 0.0f;
+        }
     }
-    DEBUGPrintString("PlayerFovStart: %.02f; NormalizedPlayerFovStart: %.02f; PlayerFovEnd: %.02f; NormalizedPlayerFovEnd: %.02f; AngleToEnemy: %.02f\n",
-                     PlayerFovStart, NormalizedPlayerFovStart, PlayerFovEnd, NormalizedPlayerFovEnd, AngleToEnemy);
 
-sddd    if ((AngleToEnemy >= NormalizedPlayerFovStart) && (AngleToEnemy <= NormalizedPlayerFovEnd))
+    PresentColumnBuffer(Columns, Buffer);
+    if (CountingWrites)
     {
-        f32 DistanceToEnemy = RayToEnemy.Distance;
-        f32 SpriteHeight = ColumnHeightConstant / DistanceToEnemy;
-        f32 SpriteMinY = ScreenCenter - SpriteHeight / 2.0f;
-        f32 SpriteMaxY = ScreenCenter + SpriteHeight / 2.0f;
-        f32 SpriteMinX = (f32)Buffer->Width/2.0f - (f32)State->RenderData.Textures[2].Width/2.0f;
-        f32 SpriteMaxX = (f32)Buffer->Width/2.0f + (f32)State->RenderData.Textures[2].Width/2.0f;
-        DrawBitmap(Buffer, &State->RenderData.Textures[2],
-                   SpriteMinX, SpriteMinY,
-                   SpriteMaxX, SpriteMaxY,
-                   SpriteMaxX-SpriteMinX, SpriteMaxY-SpriteMinY,
-                   -1.0f, -1.0f);
+        PresentHeatmapColumns(Heatmap, Render->RaycastData, RAYCAST_NUM);
+        Buffer->WriteCounts = Heatmap->PixelWrites;
     }
 
     f32 MinimapWidth = 450;
@@ -920,40 +2240,193 @@ sddd    if ((AngleToEnemy >= NormalizedPlayerFovStart) && (AngleToEnemy <= Norma
     f32 MinimapMaxX = (f32)Buffer->Width;
     f32 MinimapMinY = (f32)Buffer->Height - MinimapHeight;
     f32 MinimapMaxY = (f32)Buffer->Height;
-    DEBUGDrawMinimap(Buffer, State, MinimapMinX, MinimapMinY, MinimapMaxX, MinimapMaxY);
+    DEBUGDrawMinimap(Buffer, State, Render, View, MinimapMinX, MinimapMinY, MinimapMaxX, MinimapMaxY);
+
+    hud_batch *Hud = &Render->Hud;
+    BeginHud(Hud);
+    i32 HudX = 8;
+    i32 HudY = 8;
+    u32 HudColor = 0xFFFFFFFF;
+    f32 FramesPerSecond = (View->FrameSeconds > 0.0f) ? (1.0f / View->FrameSeconds) : 0.0f;
+    HudPrint(Hud, HudX, HudY, HudColor, "frame  %6.2f ms  %5.1f fps", View->FrameSeconds*1000.0f, FramesPerSecond);
+    HudY += HUD_GLYPH_HEIGHT;
+    HudPrint(Hud, HudX, HudY, HudColor, "rays   %u  steps %u  avg %.1f  max %u",
+             RAYCAST_NUM, TotalCellSteps, (f32)TotalCellSteps / (f32)RAYCAST_NUM, MaxCellSteps);
+    HudY += HUD_GLYPH_HEIGHT;
+    if (Render->Engine == RenderEngine_Faces)
+    {
+        HudPrint(Hud, HudX, HudY, HudColor, "faces  %u drawn of %u  cells %u", Render->Faces.FacesDrawn,
+                 Render->Faces.FacesSwept, Render->Faces.CellsSwept);
+        HudY += HUD_GLYPH_HEIGHT;
+    }
+    HudPrint(Hud, HudX, HudY, HudColor, "robots %u  drawn %u", View->EntityCount, SpriteDrawCount);
+    HudY += HUD_GLYPH_HEIGHT;
+    if (Render->Lighting.Luxels)
+    {
+        HudPrint(Hud, HudX, HudY, HudColor, "lights %u  relit %u  total %llu", View->LightCount,
+                 Render->Lighting.FacesRelit, (unsigned long long)Render->Lighting.TotalFacesRelit);
+        HudY += HUD_GLYPH_HEIGHT;
+    }
+    HudPrint(Hud, HudX, HudY, HudColor, "tick   %llu", (unsigned long long)View->SimTickCount);
+    DrawHud(Hud, &Render->Glyphs, Buffer);
 
-    // for (int TextureXOffset = 0;
-    //      TextureXOffset < 1600;
-    //      ++TextureXOffset)
-    // {
-    //     f32 ColumnHeight = 450.0f + (f32)TextureXOffset/1600.0f * 450.0f;
-    //     f32 ColumnMinY = ScreenCenter - ColumnHeight/2.0f;
-    //     f32 ColumnMaxY = ScreenCenter + ColumnHeight/2.0f;
-    //     DrawBitmap(Buffer, State->RenderData.Textures[1],
-    //                0.0f+(f32)TextureXOffset, 0.0f,
-    //                1.0f+(f32)TextureXOffset, ColumnHeight,
-    //                1600.0f, ColumnHeight,
-    //                0.0f+(f32)TextureXOffset, 0.0f);
-                   
-    // }
-    // DrawBitmap(Buffer, State->RenderData.Textures[1],
-    //            0.0f, 0.0f,
-    //            1000.0f, 1000.0f,
-    //            800.0f, 800.0f,
-    //            0.0f, 0.0f);
-               
-    
-    // for (int TextureXOffset = 0;
-    //      TextureXOffset < 400;
-    //      ++TextureXOffset)
-    // {
-    //     f32 ColumnHeight = 200.0f + ((f32)TextureXOffset/400.0f)*200.0f;
-    //     f32 ColumnMinY = ScreenCenter - ColumnHeight / 2.0f;
-    //     f32 ColumnMaxY = ScreenCenter + ColumnHeight / 2.0f;
-    //     DrawBitmap(Buffer, State->RenderData.Textures[0],
-    //                0.0f+(f32)TextureXOffset, ColumnMinY,
-    //                1.0f+(f32)TextureXOffset, ColumnMaxY,
-    //                TextureXOffset, 0,
-    //                false, true);
-    // }
+    if (CountingWrites)
+    {
+        Buffer->WriteCounts = 0;
+        EndHeatmapFrame(Heatmap);
+        if (Heatmap->Mode != HeatmapMode_Off)
+        {
+            DrawHeatmapOverlay(Heatmap, Buffer);
+
+            // NOTE: The legend goes on after the counts are taken, so it
+            // isn't in them
+            BeginHud(Hud);
+            i32 LegendY = Buffer->Height - HUD_GLYPH_HEIGHT - HUD_BACKDROP_MARGIN - 4;
+            if (Heatmap->Mode == HeatmapMode_Overdraw)
+            {
+                HudPrint(Hud, HudX, LegendY, HudColor, "overdraw  avg %.2f  max %u  (blue 1, red 8+)",
+                         (f64)Heatmap->TotalWrites / (f64)(Heatmap->Width*Heatmap->Height), Heatmap->MaxWrites);
+            }
+            else
+            {
+                HudPrint(Hud, HudX, LegendY, HudColor, "ray steps  avg %.1f  max %u  (blue 1, red 256)",
+                         (f64)Heatmap->TotalSteps / (f64)Heatmap->Width, Heatmap->MaxSteps);
+            }
+            DrawHud(Hud, &Render->Glyphs, Buffer);
+        }
+    }
+}
+
+internal void
+GameMixAudio(game_state *State, render_state *Render, render_view *View, audio_ring *Ring)
+{
+    // NOTE: Tops the ring up to AUDIO_TARGET_LATENCY_FRAMES ahead of playback.
+    // Called once a frame after GameRender.
+    u32 Queued = AudioRingQueuedFrames(Ring);
+    if (Queued < AUDIO_TARGET_LATENCY_FRAMES)
+    {
+        audio_mixer *Mixer = &Render->Audio;
+        UpdateAudioVoices(Mixer, State, View);
+
+        u32 FramesToMix = AUDIO_TARGET_LATENCY_FRAMES - Queued;
+        while (FramesToMix)
+        {
+            u32 FrameCount = (FramesToMix < AUDIO_MIX_CHUNK) ? FramesToMix : AUDIO_MIX_CHUNK;
+            MixVoices(Mixer, Mixer->Output, FrameCount);
+            AudioRingWrite(Ring, Mixer->Output, FrameCount);
+            FramesToMix -= FrameCount;
+        }
+    }
+}
+
+internal void
+GameUpdateAndRender(game_state *State, render_state *Render, game_input *Input, game_offscreen_buffer *Buffer)
+{
+    GameUpdate(State, Input, &State->View);
+    GameRender(State, Render, &State->View, Buffer);
+}
+
+//
+// NOTE: Frame pipeline stages
+//
+
+internal void
+InitializeFramePipeline(frame_pipeline *Pipeline, game_state *State, render_state *Render)
+{
+    // NOTE: Snapshot entity arrays come out of the render state's arena, not
+    // the sim's: the pipeline lives outside the game state snapshot, so its
+    // count and its arrays have to stay together when a restart puts the
+    // sim back. It also keeps the sim's writes to them off the snapshot's
+    // copy-on-write pages.
+    for (u32 SnapshotIndex = 0;
+         SnapshotIndex < 2;
+         ++SnapshotIndex)
+    {
+        InitializeRenderView(&Pipeline->Snapshots[SnapshotIndex].View, State->Entities.Capacity, &Render->Arena);
+    }
+}
+
+internal void
+PipelineSubmitSimFrame(frame_pipeline *Pipeline, game_input *Input)
+{
+    // NOTE: Render stage. Must not be called while a sim frame is in flight.
+    u32 Requested = Pipeline->SimFramesRequested;
+    Assert(AtomicLoadU32(&Pipeline->SimFramesCompleted) == Requested);
+
+    Pipeline->Inputs[(Requested + 1) & 1] = *Input;
+    AtomicStoreU32(&Pipeline->SimFramesRequested, Requested + 1);
+}
+
+internal void
+PipelineRequestQuit(frame_pipeline *Pipeline)
+{
+    // NOTE: Render stage. Sets Quit, then bumps SimFramesRequested, which is
+    // the word the sim stage parks on: a sim stage that saw no quit and is
+    // just about to park finds the word changed and doesn't sleep through
+    // the wake. PipelineRunSimStage never runs the bumped frame.
+    AtomicStoreU32(&Pipeline->Quit, 1);
+    AtomicStoreU32(&Pipeline->SimFramesRequested, Pipeline->SimFramesRequested + 1);
+}
+
+inline bool32
+PipelineQuitRequested(frame_pipeline *Pipeline)
+{
+    bool32 Result = (AtomicLoadU32(&Pipeline->Quit) != 0);
+    return Result;
+}
+
+internal bool32
+PipelineRunSimStage(frame_pipeline *Pipeline, game_state *State)
+{
+    // NOTE: Sim stage. Returns false if there was no frame waiting, or the
+    // pipeline is quitting.
+    bool32 Result = false;
+
+    u32 Completed = Pipeline->SimFramesCompleted;
+    if (!PipelineQuitRequested(Pipeline) &&
+        (AtomicLoadU32(&Pipeline->SimFramesRequested) != Completed))
+    {
+        u32 FrameIndex = Completed + 1;
+        render_snapshot *Snapshot = &Pipeline->Snapshots[FrameIndex & 1];
+        GameUpdate(State, &Pipeline->Inputs[FrameIndex & 1], &Snapshot->View);
+        Snapshot->FrameIndex = FrameIndex;
+
+        AtomicStoreU32(&Pipeline->SimFramesCompleted, FrameIndex);
+        Result = true;
+    }
+
+    return Result;
+}
+
+inline bool32
+PipelineIsSimFrameComplete(frame_pipeline *Pipeline)
+{
+    bool32 Result = (AtomicLoadU32(&Pipeline->SimFramesCompleted) ==
+                     Pipeline->SimFramesRequested);
+    return Result;
+}
+
+internal void
+PipelineRefreshRenderSnapshot(frame_pipeline *Pipeline, game_state *State)
+{
+    // NOTE: Render stage, with no sim frame in flight. The completed snapshot
+    // is the one the next frame draws; after the state has been put back
+    // underneath it (a restart), it still holds the old state, so redo it
+    // from the new one rather than drawing a frame from before the restart.
+    u32 FrameIndex = Pipeline->SimFramesRequested;
+    Assert(AtomicLoadU32(&Pipeline->SimFramesCompleted) == FrameIndex);
+
+    render_snapshot *Snapshot = &Pipeline->Snapshots[FrameIndex & 1];
+    FillRenderView(State, &Snapshot->View, State->SimAccumulator / SIM_SECONDS_PER_TICK);
+}
+
+inline render_snapshot *
+PipelineGetRenderSnapshot(frame_pipeline *Pipeline)
+{
+    // NOTE: Render stage. Called right after submitting frame N+1, this is the
+    // snapshot for frame N, which the sim stage is done with.
+    u32 FrameIndex = Pipeline->SimFramesRequested - 1;
+    render_snapshot *Result = &Pipeline->Snapshots[FrameIndex & 1];
+    Assert(Result->FrameIndex == FrameIndex);
+    return Result;
 }
@@ -0,0 +1,236 @@
+#define TEXTURE_HASH_PRIME1 0x9E3779B185EBCA87ull
+#define TEXTURE_HASH_PRIME2 0xC2B2AE3D27D4EB4Full
+
+inline u64
+RotateLeftU64(u64 Value, u32 Shift)
+{
+    u64 Result = (Value << Shift) | (Value >> (64 - Shift));
+    return Result;
+}
+
+internal u64
+HashTextureSource(u8 *Data, memory_index Size)
+{
+    // NOTE: Four independent multiply-rotate lanes over 32-byte blocks, so
+    // hashing runs at about memory speed. Not cryptographic; it only has to
+    // tell one version of a file from the next. The cache version is mixed
+    // in so a format change can't match an old entry.
+    u64 Lanes[4] =
+    {
+        TEXTURE_HASH_PRIME1 + TEXTURE_HASH_PRIME2 + TEXTURE_CACHE_VERSION,
+        TEXTURE_HASH_PRIME2,
+        TEXTURE_CACHE_VERSION,
+        TEXTURE_CACHE_VERSION - TEXTURE_HASH_PRIME1,
+    };
+
+    u8 *At = Data;
+    memory_index BlockCount = Size / 32;
+    for (memory_index BlockIndex = 0;
+         BlockIndex < BlockCount;
+         ++BlockIndex)
+    {
+        for (u32 Lane = 0;
+             Lane < 4;
+             ++Lane)
+        {
+            u64 Value;
+            memcpy(&Value, At + Lane*8, 8);
+            Lanes[Lane] = RotateLeftU64(Lanes[Lane] + Value*TEXTURE_HASH_PRIME2, 31)*TEXTURE_HASH_PRIME1;
+        }
+        At += 32;
+    }
+
+    u64 Result = (RotateLeftU64(Lanes[0], 1) + RotateLeftU64(Lanes[1], 7) +
+                  RotateLeftU64(Lanes[2], 12) + RotateLeftU64(Lanes[3], 18) + (u64)Size);
+    for (u8 *End = Data + Size;
+         At < End;
+         ++At)
+    {
+        Result = RotateLeftU64(Result ^ ((u64)*At*TEXTURE_HASH_PRIME1), 11)*TEXTURE_HASH_PRIME2;
+    }
+
+    Result ^= Result >> 33;
+    Result *= 0xFF51AFD7ED558CCDull;
+    Result ^= Result >> 33;
+    Result *= 0xC4CEB9FE1A85EC53ull;
+    Result ^= Result >> 33;
+    return Result;
+}
+
+inline void
+SetTexturePixels(texture *Texture, void *Pixels, i32 Width, i32 Height)
+{
+    Texture->Pixels = Pixels;
+    Texture->Width = Width;
+    Texture->Height = Height;
+    Texture->BytesPerPixel = 4;
+    Texture->Pitch = Width*4;
+}
+
+internal void
+ReadTextureWork(void *Data)
+{
+    // NOTE: Read the source, hash it, and either take the texture straight
+    // from the cache or find out what decoding it will need
+    texture_load *Load = (texture_load *)Data;
+    Load->Source = PLATFORMReadEntireFile(Load->Filename);
+    if (Load->Source.ContentsSize == 0)
+    {
+        return;
+    }
+
+    Load->SourceHash = HashTextureSource((u8 *)Load->Source.Contents, Load->Source.ContentsSize);
+    snprintf(Load->CachePath, sizeof(Load->CachePath), TEXTURE_CACHE_DIRECTORY "/%016llx.tex",
+             (unsigned long long)Load->SourceHash);
+
+    platform_read_file_result Cached = PLATFORMReadEntireFile(Load->CachePath);
+    if (Cached.ContentsSize >= sizeof(texture_cache_header))
+    {
+        texture_cache_header *Header = (texture_cache_header *)Cached.Contents;
+        if ((Header->Magic == TEXTURE_CACHE_MAGIC) &&
+            (Header->Version == TEXTURE_CACHE_VERSION) &&
+            (Header->SourceHash == Load->SourceHash) &&
+            (Header->SourceSize == Load->Source.ContentsSize) &&
+            (Header->Width > 0) && (Header->Width <= IMAGE_MAX_DIMENSION) &&
+            (Header->Height > 0) && (Header->Height <= IMAGE_MAX_DIMENSION) &&
+            (Cached.ContentsSize == sizeof(texture_cache_header) + (memory_index)Header->Width*Header->Height*4))
+        {
+            // NOTE: The texture lives in the cache file's memory from here on
+            SetTexturePixels(Load->Texture, Header + 1, Header->Width, Header->Height);
+            Load->FromCache = true;
+            PLATFORMFreeFileMemory(Load->Source.Contents);
+            Load->Source.Contents = 0;
+            return;
+        }
+    }
+    PLATFORMFreeFileMemory(Cached.Contents);
+
+    Load->Info = InspectImage((u8 *)Load->Source.Contents, Load->Source.ContentsSize);
+    if (Load->Info.Format == ImageFormat_Unknown)
+    {
+        PLATFORMFreeFileMemory(Load->Source.Contents);
+        Load->Source.Contents = 0;
+    }
+}
+
+internal void
+DecodeTextureWork(void *Data)
+{
+    texture_load *Load = (texture_load *)Data;
+    texture_cache_header *Output = Load->Output;
+    u32 *Pixels = (u32 *)(Output + 1);
+    if (DecodeImage(&Load->Info, (u8 *)Load->Source.Contents, Load->Source.ContentsSize, Pixels, Load->Scratch))
+    {
+        Output->Magic = TEXTURE_CACHE_MAGIC;
+        Output->Version = TEXTURE_CACHE_VERSION;
+        Output->SourceHash = Load->SourceHash;
+        Output->SourceSize = Load->Source.ContentsSize;
+        Output->Width = Load->Info.Width;
+        Output->Height = Load->Info.Height;
+        Output->Reserved = 0;
+
+        // NOTE: A failed write only costs the next start a decode
+        memory_index OutputSize = sizeof(texture_cache_header) + (memory_index)Output->Width*Output->Height*4;
+        PLATFORMWriteEntireFile(Load->CachePath, SafeTruncateU64(OutputSize), Output);
+
+        SetTexturePixels(Load->Texture, Pixels, Output->Width, Output->Height);
+        Load->Decoded = true;
+    }
+    PLATFORMFreeFileMemory(Load->Source.Contents);
+    Load->Source.Contents = 0;
+}
+
+internal texture_load_stats
+LoadTextures(texture_load *Loads, u32 Count, memory_arena *Arena)
+{
+    // NOTE: Textures that don't load are left empty, the same as a missing
+    // file always was. Decoded pixels are pushed on Arena; decode scratch is
+    // borrowed from the arena's free space and never pushed, with as many
+    // decodes in flight at once as fit in it.
+    texture_load_stats Result = {};
+    Result.Requested = Count;
+
+    for (u32 LoadIndex = 0;
+         LoadIndex < Count;
+         ++LoadIndex)
+    {
+        texture_load *Load = &Loads[LoadIndex];
+        texture EmptyTexture = {};
+        *Load->Texture = EmptyTexture;
+        Load->Source.Contents = 0;
+        Load->Source.ContentsSize = 0;
+        Load->FromCache = false;
+        Load->Decoded = false;
+        Load->Output = 0;
+        PLATFORMAddWork(ReadTextureWork, Load);
+    }
+    PLATFORMCompleteAllWork();
+
+    for (u32 LoadIndex = 0;
+         LoadIndex < Count;
+         ++LoadIndex)
+    {
+        texture_load *Load = &Loads[LoadIndex];
+        if (Load->Source.Contents)
+        {
+            memory_index OutputSize = sizeof(texture_cache_header) + (memory_index)Load->Info.Width*Load->Info.Height*4;
+            Load->Output = (texture_cache_header *)PushSize_(Arena, OutputSize);
+        }
+    }
+
+    u8 *ScratchBase = Arena->Base + Arena->Used;
+    memory_index ScratchSize = Arena->Size - Arena->Used;
+    u32 NextLoad = 0;
+    while (NextLoad < Count)
+    {
+        memory_index ScratchUsed = 0;
+        for (;
+             NextLoad < Count;
+             ++NextLoad)
+        {
+            texture_load *Load = &Loads[NextLoad];
+            if (!Load->Source.Contents)
+            {
+                continue;
+            }
+
+            memory_index LoadScratchSize = (Load->Info.ScratchSize + 63) & ~(memory_index)63;
+            if (LoadScratchSize > ScratchSize)
+            {
+                PLATFORMFreeFileMemory(Load->Source.Contents);
+                Load->Source.Contents = 0;
+                continue;
+            }
+            if (ScratchUsed + LoadScratchSize > ScratchSize)
+            {
+                break;
+            }
+
+            Load->Scratch = ScratchBase + ScratchUsed;
+            ScratchUsed += LoadScratchSize;
+            PLATFORMAddWork(DecodeTextureWork, Load);
+        }
+        PLATFORMCompleteAllWork();
+    }
+
+    for (u32 LoadIndex = 0;
+         LoadIndex < Count;
+         ++LoadIndex)
+    {
+        texture_load *Load = &Loads[LoadIndex];
+        if (Load->FromCache)
+        {
+            ++Result.FromCache;
+        }
+        else if (Load->Decoded)
+        {
+            ++Result.Decoded;
+        }
+        else
+        {
+            ++Result.Failed;
+        }
+    }
+
+    return Result;
+}
@@ -0,0 +1,50 @@
+// NOTE: Texture loading. LoadTextures takes a whole list of image files at
+// once and spreads the work over the platform's work queue: read, hash, look
+// in the decoded-texture cache, and only decode what the cache doesn't have.
+//
+// The cache is one file per source image under TEXTURE_CACHE_DIRECTORY,
+// named by a hash of the source file's bytes, holding the texture already in
+// engine layout behind a small header. A warm start is a file read per
+// texture and nothing else. Editing an image changes its hash, so the stale
+// entry is simply never looked at again; bumping TEXTURE_CACHE_VERSION
+// orphans the lot.
+
+#define TEXTURE_CACHE_DIRECTORY "texture_cache"
+#define TEXTURE_CACHE_MAGIC 0x58455452 // NOTE: "RTEX"
+#define TEXTURE_CACHE_VERSION 1
+
+// NOTE: Cache file header, followed by Width*Height 0xAARRGGBB pixels
+struct texture_cache_header
+{
+    u32 Magic;
+    u32 Version;
+    u64 SourceHash;
+    u32 SourceSize;
+    i32 Width;
+    i32 Height;
+    u32 Reserved;
+};
+
+struct texture_load
+{
+    char *Filename;
+    texture *Texture;
+
+    // NOTE: Everything below is LoadTextures' working state
+    platform_read_file_result Source;
+    u64 SourceHash;
+    char CachePath[64];
+    image_info Info;
+    texture_cache_header *Output;
+    u8 *Scratch;
+    bool32 FromCache;
+    bool32 Decoded;
+};
+
+struct texture_load_stats
+{
+    u32 Requested;
+    u32 FromCache;
+    u32 Decoded;
+    u32 Failed;
+};
@@ -0,0 +1,185 @@
+internal void
+InitializeWallAtlas(wall_atlas *Atlas, u32 TileSizeLog2, u32 MaxTiles, memory_arena *Arena)
+{
+    Atlas->TileSizeLog2 = TileSizeLog2;
+    Atlas->TileCount = 0;
+    Atlas->MaxTiles = MaxTiles;
+    Atlas->Texels = PushArray(Arena, (memory_index)MaxTiles << (2*TileSizeLog2), u32);
+}
+
+internal u32
+AddWallTexture(wall_atlas *Atlas, texture *Texture)
+{
+    // NOTE: Returns the new tile's texture ID. Nearest-neighbour resample, so
+    // textures that already divide the tile size come through unchanged. A
+    // texture that failed to load becomes a magenta tile rather than a hole.
+    Assert(Atlas->TileCount < Atlas->MaxTiles);
+    u32 TextureId = Atlas->TileCount++;
+
+    u32 TileSize = 1 << Atlas->TileSizeLog2;
+    u32 *Tile = Atlas->Texels + (TextureId << (2*Atlas->TileSizeLog2));
+    for (u32 U = 0;
+         U < TileSize;
+         ++U)
+    {
+        for (u32 V = 0;
+             V < TileSize;
+             ++V)
+        {
+            u32 Texel = 0xFFFF00FF;
+            if (Texture->Pixels)
+            {
+                i32 SourceX = (i32)((U*(u32)Texture->Width) >> Atlas->TileSizeLog2);
+                i32 SourceY = (i32)((V*(u32)Texture->Height) >> Atlas->TileSizeLog2);
+                // NOTE: BMP rows are stored bottom-up
+                Texel = *(u32 *)((u8 *)Texture->Pixels +
+                                 (Texture->Height - 1 - SourceY)*Texture->Pitch +
+                                 SourceX*sizeof(u32));
+            }
+            Tile[(U << Atlas->TileSizeLog2) | V] = Texel;
+        }
+    }
+
+    return TextureId;
+}
+
+inline u32
+ModulateTexel(u32 Texel, __m128i Light)
+{
+    // NOTE: Light is a lightmap value already widened to 16 bits a channel;
+    // 0x80 is 1.0, and the result saturates
+    __m128i Zero = _mm_setzero_si128();
+    __m128i Wide = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)Texel), Zero);
+    __m128i Lit = _mm_srli_epi16(_mm_mullo_epi16(Wide, Light), 7);
+    u32 Result = (u32)_mm_cvtsi128_si32(_mm_packus_epi16(Lit, Lit));
+    return Result;
+}
+
+internal i32
+DrawWallColumn(column_buffer *Buffer, wall_atlas *Atlas,
+               u32 TextureId, f32 TextureU, u32 Light,
+               f32 RealMinX, f32 RealMaxX,
+               f32 RealMinY, f32 RealMaxY,
+               f32 TextureMinV, f32 TextureMaxV,
+               i32 ClipMinY, i32 ClipMaxY,
+               u8 *Coverage, bool32 SeeThrough)
+{
+    // NOTE: Draws the wall slice spanning RealMinY..RealMaxY on screen, only
+    // where it falls inside ClipMinY..ClipMaxY. TextureMinV/MaxV are in tiles
+    // and may be any value; the texture wraps.
+    //
+    // Light scales every texel (see rayc_lighting.h); LIGHTMAP_UNLIT draws the
+    // texture as it is. Coverage is optional, one byte per screen row of this
+    // column. Rows already covered are skipped and rows written get marked.
+    // SeeThrough alpha-tests texels the way sprites do. Returns the number of
+    // rows written.
+    i32 Result = 0;
+
+    i32 MinX = RoundF32ToI32(RealMinX);
+    i32 MaxX = RoundF32ToI32(RealMaxX);
+    i32 MinY = (i32)floorf(RealMinY + 0.5f);
+    i32 MaxY = (i32)floorf(RealMaxY + 0.5f);
+    if (MinX < 0) MinX = 0;
+    if (MaxX > Buffer->Width) MaxX = Buffer->Width;
+    if (MinY < ClipMinY) MinY = ClipMinY;
+    if (MaxY > ClipMaxY) MaxY = ClipMaxY;
+
+    if ((MinX < MaxX) && (MinY < MaxY) && (RealMaxY > RealMinY))
+    {
+        u32 Log2 = Atlas->TileSizeLog2;
+        u32 TexelMask = (1 << Log2) - 1;
+        f32 TileSize = (f32)(1 << Log2);
+        u32 U = (u32)TruncateF32ToI32(TextureU*TileSize) & TexelMask;
+        u32 *Column = Atlas->Texels + ((TextureId << (2*Log2)) | (U << Log2));
+
+        // NOTE: 16.16 V, sampled at pixel centers. Wraps through the mask.
+        f32 TexelsPerPixel = (TextureMaxV - TextureMinV)*TileSize / (RealMaxY - RealMinY);
+        u32 StepV = (u32)(i32)(TexelsPerPixel*65536.0f);
+        u32 V = (u32)(i32)((TextureMinV*TileSize + ((f32)MinY + 0.5f - RealMinY)*TexelsPerPixel)*65536.0f);
+
+        // NOTE: A ray's column is usually one pixel wide, so the inner loop
+        // runs once and stores go straight down the column buffer
+        u32 *Pixels = GetColumn(Buffer, MinX) + MinY;
+        u32 PixelsPerColumn = (u32)Buffer->ColumnPitch / sizeof(u32);
+        bool32 Lit = (Light != LIGHTMAP_UNLIT);
+        __m128i WideLight = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)Light), _mm_setzero_si128());
+        if (!Coverage && !SeeThrough && !Lit)
+        {
+            for (i32 Y = MinY;
+                 Y < MaxY;
+                 ++Y)
+            {
+                u32 Texel = Column[(V >> 16) & TexelMask];
+                u32 *Pixel = Pixels++;
+                for (i32 X = MinX;
+                     X < MaxX;
+                     ++X)
+                {
+                    *Pixel = Texel;
+                    Pixel += PixelsPerColumn;
+                }
+
+                V += StepV;
+            }
+            Result = MaxY - MinY;
+            CountColumnWrites(Buffer, MinX, MaxX, MinY, MaxY);
+        }
+        else if (!Coverage && !SeeThrough)
+        {
+            for (i32 Y = MinY;
+                 Y < MaxY;
+                 ++Y)
+            {
+                u32 Texel = ModulateTexel(Column[(V >> 16) & TexelMask], WideLight);
+                u32 *Pixel = Pixels++;
+                for (i32 X = MinX;
+                     X < MaxX;
+                     ++X)
+                {
+                    *Pixel = Texel;
+                    Pixel += PixelsPerColumn;
+                }
+
+                V += StepV;
+            }
+            Result = MaxY - MinY;
+            CountColumnWrites(Buffer, MinX, MaxX, MinY, MaxY);
+        }
+        else
+        {
+            for (i32 Y = MinY;
+                 Y < MaxY;
+                 ++Y)
+            {
+                u32 Texel = Column[(V >> 16) & TexelMask];
+                bool32 Covered = Coverage && Coverage[Y];
+                bool32 Opaque = !SeeThrough || ((Texel >> 24) >= 0x80);
+                u32 *Pixel = Pixels++;
+                if (!Covered && Opaque)
+                {
+                    if (Lit)
+                    {
+                        Texel = ModulateTexel(Texel, WideLight);
+                    }
+                    for (i32 X = MinX;
+                         X < MaxX;
+                         ++X)
+                    {
+                        *Pixel = Texel;
+                        Pixel += PixelsPerColumn;
+                    }
+                    if (Coverage)
+                    {
+                        Coverage[Y] = 1;
+                    }
+                    CountColumnWrites(Buffer, MinX, MaxX, Y, Y + 1);
+                    ++Result;
+                }
+
+                V += StepV;
+            }
+        }
+    }
+
+    return Result;
+}
@@ -0,0 +1,20 @@
+// NOTE: Wall texture atlas. Every wall texture is resampled into a square tile
+// of the same power-of-two size, and tiles sit back to back in one block, so
+// a texel is
+//
+//   Texels[(TextureId << 2*TileSizeLog2) | (U << TileSizeLog2) | V]
+//
+// with U and V masked to the tile. Tiles are column-major (V is the fast
+// axis) because walls are drawn a screen column at a time.
+
+#define WALL_ATLAS_TILE_SIZE_LOG2 6
+#define WALL_ATLAS_MAX_TILES 256
+
+struct wall_atlas
+{
+    u32 TileSizeLog2;
+    u32 TileCount;
+    u32 MaxTiles;
+
+    u32 *Texels;
+};
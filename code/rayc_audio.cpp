@@ -0,0 +1,526 @@
+internal sound
+LoadWAV(char *Filename)
+{
+    // NOTE: Only mono 16-bit PCM at the mix rate is taken; anything else
+    // comes back as an empty sound, which mixes as silence
+    sound Result = {0};
+    platform_read_file_result ReadResult = PLATFORMReadEntireFile(Filename);
+    if (ReadResult.ContentsSize >= 12)
+    {
+        u8 *At = (u8 *)ReadResult.Contents;
+        u8 *End = At + ReadResult.ContentsSize;
+        u32 *Riff = (u32 *)At;
+        if ((Riff[0] == RIFF_CODE('R', 'I', 'F', 'F')) && (Riff[2] == RIFF_CODE('W', 'A', 'V', 'E')))
+        {
+            At += 12;
+            wav_format *Format = 0;
+            while (At + sizeof(wav_chunk_header) <= End)
+            {
+                wav_chunk_header *Chunk = (wav_chunk_header *)At;
+                u8 *Data = At + sizeof(wav_chunk_header);
+                if (Chunk->Size > (memory_index)(End - Data))
+                {
+                    break;
+                }
+
+                if ((Chunk->Id == RIFF_CODE('f', 'm', 't', ' ')) && (Chunk->Size >= sizeof(wav_format)))
+                {
+                    Format = (wav_format *)Data;
+                }
+                else if ((Chunk->Id == RIFF_CODE('d', 'a', 't', 'a')) && Format &&
+                         (Format->FormatTag == 1) && (Format->ChannelCount == 1) &&
+                         (Format->BitsPerSample == 16) &&
+                         (Format->SamplesPerSecond == AUDIO_SAMPLES_PER_SECOND))
+                {
+                    Result.Samples = (i16 *)Data;
+                    Result.SampleCount = Chunk->Size / sizeof(i16);
+                }
+
+                // NOTE: Chunks are padded to an even size
+                At = Data + ((Chunk->Size + 1) & ~1u);
+            }
+        }
+    }
+
+    if (!Result.Samples)
+    {
+        PLATFORMFreeFileMemory(ReadResult.Contents);
+        Result.SampleCount = 0;
+    }
+
+    return Result;
+}
+
+internal void
+InitializeAudioMixer(audio_mixer *Mixer, sound RobotSound)
+{
+    Mixer->MasterGain = 0.5f;
+    Mixer->RobotSound = RobotSound;
+    Mixer->VoiceCount = 0;
+    Mixer->CandidateCount = 0;
+}
+
+internal void
+OfferAudioCandidate(audio_mixer *Mixer, u32 EntityIndex, f32 Gain)
+{
+    // NOTE: Keeps the AUDIO_MAX_VOICES loudest robots offered. Once full, a
+    // robot only gets in by being louder than the quietest, which it
+    // replaces at the root.
+    audio_candidate *Heap = Mixer->Candidates;
+    u32 Index = 0;
+    if (Mixer->CandidateCount < AUDIO_MAX_VOICES)
+    {
+        Index = Mixer->CandidateCount++;
+        while (Index > 0)
+        {
+            u32 Parent = (Index - 1) / 2;
+            if (Heap[Parent].Gain <= Gain)
+            {
+                break;
+            }
+            Heap[Index] = Heap[Parent];
+            Index = Parent;
+        }
+    }
+    else if (Gain > Heap[0].Gain)
+    {
+        for (;;)
+        {
+            u32 Child = 2*Index + 1;
+            if (Child >= AUDIO_MAX_VOICES)
+            {
+                break;
+            }
+            if ((Child + 1 < AUDIO_MAX_VOICES) && (Heap[Child + 1].Gain < Heap[Child].Gain))
+            {
+                ++Child;
+            }
+            if (Heap[Child].Gain >= Gain)
+            {
+                break;
+            }
+            Heap[Index] = Heap[Child];
+            Index = Child;
+        }
+    }
+    else
+    {
+        return;
+    }
+
+    Heap[Index].Gain = Gain;
+    Heap[Index].EntityIndex = EntityIndex;
+}
+
+inline f32
+GetAudioCandidateFloor(audio_mixer *Mixer)
+{
+    // NOTE: How loud a robot has to be to get in
+    f32 Result = (Mixer->CandidateCount < AUDIO_MAX_VOICES) ? 0.0f : Mixer->Candidates[0].Gain;
+    return Result;
+}
+
+internal void
+FlushAudioQueries(audio_mixer *Mixer, game_state *State, u32 QueryCount)
+{
+    visibility_query_batch Batch = {QueryCount, Mixer->ListenerX, Mixer->ListenerY,
+                                    Mixer->SourceX, Mixer->SourceY,
+                                    Mixer->Occluded, Mixer->HitDistance};
+    QueryLineOfSight(&State->Map, &Batch);
+    for (u32 QueryIndex = 0;
+         QueryIndex < QueryCount;
+         ++QueryIndex)
+    {
+        f32 Gain = Mixer->QueryGain[QueryIndex];
+        if (Mixer->Occluded[QueryIndex])
+        {
+            Gain *= AUDIO_OCCLUDED_GAIN;
+        }
+        OfferAudioCandidate(Mixer, Mixer->QueryEntities[QueryIndex], Gain);
+    }
+}
+
+inline u32
+HashAudioSlot(u32 Slot)
+{
+    u32 Result = (Slot*2654435761u) >> 22;
+    return Result;
+}
+
+internal u32
+FindAudioCandidate(audio_mixer *Mixer, render_view *View, entity_handle Source)
+{
+    // NOTE: AUDIO_NO_CANDIDATE if the robot isn't among this mix's loudest,
+    // or its slot has since gone to another robot
+    u32 Result = AUDIO_NO_CANDIDATE;
+    u32 HashIndex = HashAudioSlot(Source.Slot);
+    for (;;)
+    {
+        u32 CandidateIndex = Mixer->CandidateHash[HashIndex];
+        if (CandidateIndex == AUDIO_NO_CANDIDATE)
+        {
+            break;
+        }
+
+        entity_handle Handle = View->EntityHandles[Mixer->Candidates[CandidateIndex].EntityIndex];
+        if (Handle.Slot == Source.Slot)
+        {
+            if (Handle.Generation == Source.Generation)
+            {
+                Result = CandidateIndex;
+            }
+            break;
+        }
+        HashIndex = (HashIndex + 1) & (AUDIO_CANDIDATE_HASH_SIZE - 1);
+    }
+    return Result;
+}
+
+internal void
+SetVoiceTargets(audio_voice *Voice, game_state *State, render_view *View, audio_candidate *Candidate)
+{
+    // NOTE: Same bearing math the sprite pass uses. Positive angles off view
+    // are to the left.
+    ray_to_point RayToSource = CastARayToPoint(State, View->PlayerX, View->PlayerY,
+                                               View->EntityX[Candidate->EntityIndex],
+                                               View->EntityY[Candidate->EntityIndex]);
+    f32 AngleOffView = RayToSource.Angle - View->PlayerAngle;
+    while (AngleOffView > Pi32) AngleOffView -= 2.0f*Pi32;
+    while (AngleOffView < -Pi32) AngleOffView += 2.0f*Pi32;
+
+    // NOTE: Equal-power pan, -1 hard left to 1 hard right
+    f32 Pan = -sinf(AngleOffView);
+    f32 PanAngle = (Pan + 1.0f)*(Pi32/4.0f);
+    Voice->TargetLeft = Candidate->Gain*cosf(PanAngle);
+    Voice->TargetRight = Candidate->Gain*sinf(PanAngle);
+}
+
+internal void
+UpdateAudioVoices(audio_mixer *Mixer, game_state *State, render_view *View)
+{
+    // NOTE: Find the loudest robots in earshot. Sources outside the
+    // listener's potentially visible set are occluded without asking; the
+    // rest are asked in batches, and only if they could get in even with
+    // nothing in the way.
+    Mixer->CandidateCount = 0;
+    pvs_set *ListenerSet = GetPotentiallyVisibleSet(&State->PVS, View->PlayerX, View->PlayerY);
+    f32 MaxDistanceSq = AUDIO_MAX_DISTANCE*AUDIO_MAX_DISTANCE;
+    u32 QueryCount = 0;
+    for (u32 EntityIndex = 0;
+         EntityIndex < View->EntityCount;
+         ++EntityIndex)
+    {
+        f32 SourceX = View->EntityX[EntityIndex];
+        f32 SourceY = View->EntityY[EntityIndex];
+        f32 dX = SourceX - View->PlayerX;
+        f32 dY = SourceY - View->PlayerY;
+        f32 DistanceSq = dX*dX + dY*dY;
+        if (DistanceSq >= MaxDistanceSq)
+        {
+            continue;
+        }
+
+        f32 Distance = sqrtf(DistanceSq);
+        f32 Gain = AUDIO_REFERENCE_DISTANCE / ((Distance > AUDIO_REFERENCE_DISTANCE) ?
+                                               Distance : AUDIO_REFERENCE_DISTANCE);
+        if (!IsInPotentiallyVisibleSet(&State->PVS, ListenerSet, SourceX, SourceY))
+        {
+            OfferAudioCandidate(Mixer, EntityIndex, Gain*AUDIO_OCCLUDED_GAIN);
+        }
+        else if (Gain > GetAudioCandidateFloor(Mixer))
+        {
+            Mixer->ListenerX[QueryCount] = View->PlayerX;
+            Mixer->ListenerY[QueryCount] = View->PlayerY;
+            Mixer->SourceX[QueryCount] = SourceX;
+            Mixer->SourceY[QueryCount] = SourceY;
+            Mixer->QueryEntities[QueryCount] = EntityIndex;
+            Mixer->QueryGain[QueryCount] = Gain;
+            if (++QueryCount == AUDIO_MAX_VOICES)
+            {
+                FlushAudioQueries(Mixer, State, QueryCount);
+                QueryCount = 0;
+            }
+        }
+    }
+    FlushAudioQueries(Mixer, State, QueryCount);
+
+    for (u32 HashIndex = 0;
+         HashIndex < AUDIO_CANDIDATE_HASH_SIZE;
+         ++HashIndex)
+    {
+        Mixer->CandidateHash[HashIndex] = AUDIO_NO_CANDIDATE;
+    }
+    for (u32 CandidateIndex = 0;
+         CandidateIndex < Mixer->CandidateCount;
+         ++CandidateIndex)
+    {
+        entity_handle Handle = View->EntityHandles[Mixer->Candidates[CandidateIndex].EntityIndex];
+        u32 HashIndex = HashAudioSlot(Handle.Slot);
+        while (Mixer->CandidateHash[HashIndex] != AUDIO_NO_CANDIDATE)
+        {
+            HashIndex = (HashIndex + 1) & (AUDIO_CANDIDATE_HASH_SIZE - 1);
+        }
+        Mixer->CandidateHash[HashIndex] = (u16)CandidateIndex;
+        Mixer->CandidateVoiced[CandidateIndex] = false;
+    }
+
+    // NOTE: Voices whose robot is still among the loudest keep playing it.
+    // The rest fade out over the next mix, and are free once they have.
+    for (u32 VoiceIndex = 0;
+         VoiceIndex < Mixer->VoiceCount;
+         ++VoiceIndex)
+    {
+        audio_voice *Voice = &Mixer->Voices[VoiceIndex];
+        if (Voice->Source.Slot != ENTITY_INVALID_INDEX)
+        {
+            u32 CandidateIndex = FindAudioCandidate(Mixer, View, Voice->Source);
+            if (CandidateIndex != AUDIO_NO_CANDIDATE)
+            {
+                Mixer->CandidateVoiced[CandidateIndex] = true;
+                SetVoiceTargets(Voice, State, View, &Mixer->Candidates[CandidateIndex]);
+            }
+            else if ((Voice->GainLeft == 0.0f) && (Voice->GainRight == 0.0f))
+            {
+                Voice->Source.Slot = ENTITY_INVALID_INDEX;
+            }
+            else
+            {
+                Voice->TargetLeft = 0.0f;
+                Voice->TargetRight = 0.0f;
+            }
+        }
+    }
+
+    // NOTE: Robots new to the loudest take free voices. With every voice
+    // busy, some still fading, the rest wait a mix.
+    sound *RobotSound = Mixer->RobotSound.SampleCount ? &Mixer->RobotSound : 0;
+    u32 FreeVoiceIndex = 0;
+    for (u32 CandidateIndex = 0;
+         CandidateIndex < Mixer->CandidateCount;
+         ++CandidateIndex)
+    {
+        if (Mixer->CandidateVoiced[CandidateIndex])
+        {
+            continue;
+        }
+
+        while ((FreeVoiceIndex < Mixer->VoiceCount) &&
+               (Mixer->Voices[FreeVoiceIndex].Source.Slot != ENTITY_INVALID_INDEX))
+        {
+            ++FreeVoiceIndex;
+        }
+        if (FreeVoiceIndex == AUDIO_MAX_VOICES)
+        {
+            break;
+        }
+        if (FreeVoiceIndex == Mixer->VoiceCount)
+        {
+            ++Mixer->VoiceCount;
+        }
+
+        // NOTE: Voices start spread through the loop so a crowd doesn't play
+        // in lockstep
+        audio_candidate *Candidate = &Mixer->Candidates[CandidateIndex];
+        entity_handle Source = View->EntityHandles[Candidate->EntityIndex];
+        audio_voice *Voice = &Mixer->Voices[FreeVoiceIndex];
+        Voice->Sound = RobotSound;
+        Voice->Position = RobotSound ? ((Source.Slot*7919) % RobotSound->SampleCount) : 0;
+        Voice->Looping = true;
+        Voice->Source = Source;
+        Voice->GainLeft = 0.0f;
+        Voice->GainRight = 0.0f;
+        SetVoiceTargets(Voice, State, View, Candidate);
+    }
+}
+
+internal void
+MixVoice(audio_voice *Voice, f32 *MixLeft, f32 *MixRight, u32 FrameCount,
+         f32 StepLeft, f32 StepRight)
+{
+    // NOTE: Adds FrameCount frames of the voice into the accumulators, gains
+    // moving by Step per frame. Stops a one-shot at its end.
+    sound *Sound = Voice->Sound;
+    f32 GainLeft = Voice->GainLeft;
+    f32 GainRight = Voice->GainRight;
+    u32 Frame = 0;
+    while (Voice->Sound && (Frame < FrameCount))
+    {
+        u32 Run = Sound->SampleCount - Voice->Position;
+        if (Run > FrameCount - Frame)
+        {
+            Run = FrameCount - Frame;
+        }
+
+        i16 *Source = Sound->Samples + Voice->Position;
+        f32 *Left = MixLeft + Frame;
+        f32 *Right = MixRight + Frame;
+
+        __m128 Ramp = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        __m128 GainLeft4 = _mm_add_ps(_mm_set1_ps(GainLeft), _mm_mul_ps(Ramp, _mm_set1_ps(StepLeft)));
+        __m128 GainRight4 = _mm_add_ps(_mm_set1_ps(GainRight), _mm_mul_ps(Ramp, _mm_set1_ps(StepRight)));
+        __m128 StepLeft4 = _mm_set1_ps(4.0f*StepLeft);
+        __m128 StepRight4 = _mm_set1_ps(4.0f*StepRight);
+        u32 Index = 0;
+        for (;
+             Index + 4 <= Run;
+             Index += 4)
+        {
+            // NOTE: Sign-extend four samples to 32 bits by unpacking each
+            // into the high half and shifting back down
+            __m128i Samples16 = _mm_loadl_epi64((__m128i *)(Source + Index));
+            __m128i Samples32 = _mm_srai_epi32(_mm_unpacklo_epi16(Samples16, Samples16), 16);
+            __m128 Samples = _mm_cvtepi32_ps(Samples32);
+
+            _mm_storeu_ps(Left + Index, _mm_add_ps(_mm_loadu_ps(Left + Index), _mm_mul_ps(Samples, GainLeft4)));
+            _mm_storeu_ps(Right + Index, _mm_add_ps(_mm_loadu_ps(Right + Index), _mm_mul_ps(Samples, GainRight4)));
+
+            GainLeft4 = _mm_add_ps(GainLeft4, StepLeft4);
+            GainRight4 = _mm_add_ps(GainRight4, StepRight4);
+        }
+        for (;
+             Index < Run;
+             ++Index)
+        {
+            f32 Sample = (f32)Source[Index];
+            Left[Index] += Sample*(GainLeft + StepLeft*(f32)Index);
+            Right[Index] += Sample*(GainRight + StepRight*(f32)Index);
+        }
+
+        GainLeft += StepLeft*(f32)Run;
+        GainRight += StepRight*(f32)Run;
+        Frame += Run;
+        Voice->Position += Run;
+        if (Voice->Position >= Sound->SampleCount)
+        {
+            Voice->Position = 0;
+            if (!Voice->Looping)
+            {
+                Voice->Sound = 0;
+            }
+        }
+    }
+}
+
+internal void
+MixVoices(audio_mixer *Mixer, i16 *Dest, u32 FrameCount)
+{
+    // NOTE: Mixes FrameCount (at most AUDIO_MIX_CHUNK) interleaved stereo
+    // frames into Dest. Each voice ramps from the gains it was left on to its
+    // targets across the call; voices silent at both ends only advance.
+    Assert(FrameCount <= AUDIO_MIX_CHUNK);
+    __m128 Zero = _mm_setzero_ps();
+    for (u32 Frame = 0;
+         Frame < FrameCount;
+         Frame += 4)
+    {
+        _mm_storeu_ps(Mixer->MixLeft + Frame, Zero);
+        _mm_storeu_ps(Mixer->MixRight + Frame, Zero);
+    }
+
+    f32 FrameCountInverse = 1.0f / (f32)FrameCount;
+    for (u32 VoiceIndex = 0;
+         VoiceIndex < Mixer->VoiceCount;
+         ++VoiceIndex)
+    {
+        audio_voice *Voice = &Mixer->Voices[VoiceIndex];
+        if (Voice->Sound)
+        {
+            bool32 Audible = ((Voice->GainLeft != 0.0f) || (Voice->GainRight != 0.0f) ||
+                              (Voice->TargetLeft != 0.0f) || (Voice->TargetRight != 0.0f));
+            if (Audible)
+            {
+                MixVoice(Voice, Mixer->MixLeft, Mixer->MixRight, FrameCount,
+                         (Voice->TargetLeft - Voice->GainLeft)*FrameCountInverse,
+                         (Voice->TargetRight - Voice->GainRight)*FrameCountInverse);
+            }
+            else
+            {
+                Voice->Position += FrameCount;
+                if (Voice->Position >= Voice->Sound->SampleCount)
+                {
+                    if (Voice->Looping)
+                    {
+                        Voice->Position %= Voice->Sound->SampleCount;
+                    }
+                    else
+                    {
+                        Voice->Sound = 0;
+                    }
+                }
+            }
+        }
+        Voice->GainLeft = Voice->TargetLeft;
+        Voice->GainRight = Voice->TargetRight;
+    }
+
+    // NOTE: Interleave and saturate to 16 bits, four frames at a time
+    __m128 MasterGain = _mm_set1_ps(Mixer->MasterGain);
+    u32 Frame = 0;
+    for (;
+         Frame + 4 <= FrameCount;
+         Frame += 4)
+    {
+        __m128i Left = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(Mixer->MixLeft + Frame), MasterGain));
+        __m128i Right = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(Mixer->MixRight + Frame), MasterGain));
+        __m128i Frames01 = _mm_unpacklo_epi32(Left, Right);
+        __m128i Frames23 = _mm_unpackhi_epi32(Left, Right);
+        _mm_storeu_si128((__m128i *)(Dest + 2*Frame), _mm_packs_epi32(Frames01, Frames23));
+    }
+    for (;
+         Frame < FrameCount;
+         ++Frame)
+    {
+        for (u32 Channel = 0;
+             Channel < 2;
+             ++Channel)
+        {
+            f32 Value = (Channel ? Mixer->MixRight[Frame] : Mixer->MixLeft[Frame])*Mixer->MasterGain;
+            if (Value > 32767.0f) Value = 32767.0f;
+            if (Value < -32768.0f) Value = -32768.0f;
+            Dest[2*Frame + Channel] = (i16)RoundF32ToI32(Value);
+        }
+    }
+}
+
+inline u32
+AudioRingQueuedFrames(audio_ring *Ring)
+{
+    u32 Result = AtomicLoadU32(&Ring->WriteFrame) - AtomicLoadU32(&Ring->ReadFrame);
+    return Result;
+}
+
+internal void
+AudioRingWrite(audio_ring *Ring, i16 *Samples, u32 FrameCount)
+{
+    // NOTE: Producer side. The caller keeps the queue under AUDIO_RING_FRAMES.
+    u32 WriteFrame = Ring->WriteFrame;
+    Assert((WriteFrame - AtomicLoadU32(&Ring->ReadFrame)) + FrameCount <= AUDIO_RING_FRAMES);
+    for (u32 Frame = 0;
+         Frame < FrameCount;
+         ++Frame)
+    {
+        u32 RingFrame = (WriteFrame + Frame) & (AUDIO_RING_FRAMES - 1);
+        Ring->Samples[2*RingFrame] = Samples[2*Frame];
+        Ring->Samples[2*RingFrame + 1] = Samples[2*Frame + 1];
+    }
+    AtomicStoreU32(&Ring->WriteFrame, WriteFrame + FrameCount);
+}
+
+internal u32
+AudioRingRead(audio_ring *Ring, i16 *Dest, u32 FrameCount)
+{
+    // NOTE: Consumer side. Returns how many frames there were, up to FrameCount.
+    u32 ReadFrame = Ring->ReadFrame;
+    u32 Available = AtomicLoadU32(&Ring->WriteFrame) - ReadFrame;
+    u32 Result = (Available < FrameCount) ? Available : FrameCount;
+    for (u32 Frame = 0;
+         Frame < Result;
+         ++Frame)
+    {
+        u32 RingFrame = (ReadFrame + Frame) & (AUDIO_RING_FRAMES - 1);
+        Dest[2*Frame] = Ring->Samples[2*RingFrame];
+        Dest[2*Frame + 1] = Ring->Samples[2*RingFrame + 1];
+    }
+    AtomicStoreU32(&Ring->ReadFrame, ReadFrame + Result);
+    return Result;
+}
@@ -0,0 +1,127 @@
+// NOTE: Software mixer. Sounds are mono 16-bit at AUDIO_SAMPLES_PER_SECOND;
+// every voice plays one with a left and a right gain, and the mix is summed
+// in float four samples at a time, then packed to interleaved 16-bit stereo
+// with saturation. Gains are ramped across each mix call so moving sources
+// don't click.
+//
+// The render stage mixes a little ahead of playback into an audio_ring, a
+// single-producer single-consumer ring of stereo frames that the platform's
+// audio thread drains at the device (or file) rate.
+//
+// There are more robots than voices, so each mix gives voices to the
+// loudest robots in earshot, attenuated and occluded. A voice follows its
+// robot by handle for as long as it stays among them, and once it drops out
+// fades to silence over a mix before it's given to another.
+
+#define AUDIO_SAMPLES_PER_SECOND 48000
+#define AUDIO_MAX_VOICES 512
+// NOTE: Slot lookup for this mix's loudest robots; a power of two, at least
+// twice AUDIO_MAX_VOICES
+#define AUDIO_CANDIDATE_HASH_SIZE 1024
+#define AUDIO_NO_CANDIDATE 0xFFFF
+// NOTE: Frames mixed per pass; the float accumulators for a pass stay in L1
+#define AUDIO_MIX_CHUNK 256
+#define AUDIO_RING_FRAMES 16384
+#define AUDIO_TARGET_LATENCY_FRAMES 2400
+
+// NOTE: Distance attenuation is Reference/Distance, flat inside Reference and
+// silent past Max. A wall between player and source scales the gain by
+// AUDIO_OCCLUDED_GAIN.
+#define AUDIO_REFERENCE_DISTANCE 1.0f
+#define AUDIO_MAX_DISTANCE 24.0f
+#define AUDIO_OCCLUDED_GAIN 0.35f
+
+struct sound
+{
+    u32 SampleCount;
+    i16 *Samples;
+};
+
+struct audio_voice
+{
+    sound *Sound;
+    u32 Position;
+    bool32 Looping;
+
+    // NOTE: The robot it plays for, wherever the entity store moves it. The
+    // voice is free when Source.Slot is ENTITY_INVALID_INDEX.
+    entity_handle Source;
+
+    // NOTE: Gains the last mix ended on, and the ones the next mix ramps to
+    f32 GainLeft;
+    f32 GainRight;
+    f32 TargetLeft;
+    f32 TargetRight;
+};
+
+// NOTE: A robot in the running for a voice, as loud as it is this mix
+struct audio_candidate
+{
+    f32 Gain;
+    u32 EntityIndex;
+};
+
+struct audio_mixer
+{
+    f32 MasterGain;
+    sound RobotSound;
+
+    // NOTE: Voices in use or fading out are all below VoiceCount
+    u32 VoiceCount;
+    audio_voice Voices[AUDIO_MAX_VOICES];
+
+    // NOTE: The loudest robots this mix, a min-heap on Gain so the quietest
+    // is the one pushed out, and their slots hashed to their place in it
+    u32 CandidateCount;
+    audio_candidate Candidates[AUDIO_MAX_VOICES];
+    u8 CandidateVoiced[AUDIO_MAX_VOICES];
+    u16 CandidateHash[AUDIO_CANDIDATE_HASH_SIZE];
+
+    // NOTE: Occlusion query scratch, packed; QueryEntities[N] is the robot
+    // query N is for and QueryGain[N] its gain if nothing's in the way
+    f32 ListenerX[AUDIO_MAX_VOICES];
+    f32 ListenerY[AUDIO_MAX_VOICES];
+    f32 SourceX[AUDIO_MAX_VOICES];
+    f32 SourceY[AUDIO_MAX_VOICES];
+    u8 Occluded[AUDIO_MAX_VOICES];
+    f32 HitDistance[AUDIO_MAX_VOICES];
+    u32 QueryEntities[AUDIO_MAX_VOICES];
+    f32 QueryGain[AUDIO_MAX_VOICES];
+
+    f32 MixLeft[AUDIO_MIX_CHUNK];
+    f32 MixRight[AUDIO_MIX_CHUNK];
+    i16 Output[2*AUDIO_MIX_CHUNK];
+};
+
+struct audio_ring
+{
+    // NOTE: Free-running frame counts, producer's and consumer's on their own
+    // cache lines
+    u32 volatile WriteFrame;
+    u8 ProducerPad[60];
+    u32 volatile ReadFrame;
+    u8 ConsumerPad[60];
+
+    // NOTE: Interleaved left, right
+    i16 Samples[2*AUDIO_RING_FRAMES];
+};
+
+#pragma pack(push, 1)
+struct wav_chunk_header
+{
+    u32 Id;
+    u32 Size;
+};
+
+struct wav_format
+{
+    u16 FormatTag;
+    u16 ChannelCount;
+    u32 SamplesPerSecond;
+    u32 BytesPerSecond;
+    u16 BlockAlign;
+    u16 BitsPerSample;
+};
+#pragma pack(pop)
+
+#define RIFF_CODE(a, b, c, d) (((u32)(a) << 0) | ((u32)(b) << 8) | ((u32)(c) << 16) | ((u32)(d) << 24))
@@ -0,0 +1,116 @@
+inline i32
+ColumnPitchForHeight(i32 Height)
+{
+    // NOTE: Cache-line aligned, but never a whole number of pages; a pitch
+    // like that puts every column's row Y in the same cache set
+    i32 Result = (Height*(i32)sizeof(u32) + 63) & ~63;
+    if ((Result & 4095) == 0)
+    {
+        Result += 64;
+    }
+    return Result;
+}
+
+internal void
+InitializeColumnBuffer(column_buffer *Buffer, i32 MaxWidth, i32 MaxHeight, memory_arena *Arena)
+{
+    Buffer->Capacity = (memory_index)MaxWidth*ColumnPitchForHeight(MaxHeight);
+    Buffer->Data = PushSize_(Arena, Buffer->Capacity);
+    Buffer->Width = 0;
+    Buffer->Height = 0;
+    Buffer->ColumnPitch = 0;
+    Buffer->WriteCounts = 0;
+}
+
+internal void
+ResizeColumnBuffer(column_buffer *Buffer, i32 Width, i32 Height)
+{
+    // NOTE: The pitch follows the frame's height rather than the maximum; a
+    // padded pitch spreads the present's reads over twice the pages
+    Buffer->Width = Width;
+    Buffer->Height = Height;
+    Buffer->ColumnPitch = ColumnPitchForHeight(Height);
+    Assert((memory_index)Width*Buffer->ColumnPitch <= Buffer->Capacity);
+}
+
+inline u32 *
+GetColumn(column_buffer *Buffer, i32 X)
+{
+    u32 *Result = (u32 *)((u8 *)Buffer->Data + (memory_index)X*Buffer->ColumnPitch);
+    return Result;
+}
+
+internal void
+PresentColumnBuffer(column_buffer *Source, game_offscreen_buffer *Dest)
+{
+    // NOTE: Tile by tile; inside a tile, 4x4 blocks are transposed in
+    // registers. Four columns' worth of four pixels come in, four rows' worth
+    // go out.
+    i32 Width = (Source->Width < Dest->Width) ? Source->Width : Dest->Width;
+    i32 Height = (Source->Height < Dest->Height) ? Source->Height : Dest->Height;
+    i32 BlockWidth = Width & ~3;
+    i32 BlockHeight = Height & ~3;
+
+    for (i32 TileX = 0;
+         TileX < BlockWidth;
+         TileX += COLUMN_BUFFER_PRESENT_TILE)
+    {
+        i32 TileMaxX = TileX + COLUMN_BUFFER_PRESENT_TILE;
+        if (TileMaxX > BlockWidth) TileMaxX = BlockWidth;
+        for (i32 TileY = 0;
+             TileY < BlockHeight;
+             TileY += COLUMN_BUFFER_PRESENT_TILE)
+        {
+            i32 TileMaxY = TileY + COLUMN_BUFFER_PRESENT_TILE;
+            if (TileMaxY > BlockHeight) TileMaxY = BlockHeight;
+            // NOTE: Down the tile a block row at a time, so each destination
+            // row gets its tile-width written in one go
+            for (i32 Y = TileY;
+                 Y < TileMaxY;
+                 Y += 4)
+            {
+                u8 *DestRow = (u8 *)Dest->Data + Y*Dest->Pitch + TileX*sizeof(u32);
+                for (i32 X = TileX;
+                     X < TileMaxX;
+                     X += 4)
+                {
+                    __m128i A = _mm_load_si128((__m128i *)(GetColumn(Source, X) + Y));
+                    __m128i B = _mm_load_si128((__m128i *)(GetColumn(Source, X + 1) + Y));
+                    __m128i C = _mm_load_si128((__m128i *)(GetColumn(Source, X + 2) + Y));
+                    __m128i D = _mm_load_si128((__m128i *)(GetColumn(Source, X + 3) + Y));
+
+                    __m128i AB01 = _mm_unpacklo_epi32(A, B);
+                    __m128i AB23 = _mm_unpackhi_epi32(A, B);
+                    __m128i CD01 = _mm_unpacklo_epi32(C, D);
+                    __m128i CD23 = _mm_unpackhi_epi32(C, D);
+
+                    u8 *Dest4 = DestRow;
+                    _mm_storeu_si128((__m128i *)Dest4, _mm_unpacklo_epi64(AB01, CD01));
+                    Dest4 += Dest->Pitch;
+                    _mm_storeu_si128((__m128i *)Dest4, _mm_unpackhi_epi64(AB01, CD01));
+                    Dest4 += Dest->Pitch;
+                    _mm_storeu_si128((__m128i *)Dest4, _mm_unpacklo_epi64(AB23, CD23));
+                    Dest4 += Dest->Pitch;
+                    _mm_storeu_si128((__m128i *)Dest4, _mm_unpackhi_epi64(AB23, CD23));
+
+                    DestRow += 4*sizeof(u32);
+                }
+            }
+        }
+    }
+
+    // NOTE: Ragged right and bottom edges, when the size isn't a multiple of 4
+    for (i32 Y = 0;
+         Y < Height;
+         ++Y)
+    {
+        i32 MinX = (Y < BlockHeight) ? BlockWidth : 0;
+        u32 *DestPixel = (u32 *)((u8 *)Dest->Data + Y*Dest->Pitch) + MinX;
+        for (i32 X = MinX;
+             X < Width;
+             ++X)
+        {
+            *DestPixel++ = GetColumn(Source, X)[Y];
+        }
+    }
+}
@@ -0,0 +1,30 @@
+// NOTE: Column-major render target. The 3D view is drawn a screen column at a
+// time, so walls, floors and sprites go here, where walking down a column is
+// walking forward through memory. Pixel (X, Y) is
+//
+//   *(u32 *)((u8 *)Data + X*ColumnPitch + Y*sizeof(u32))
+//
+// PresentColumnBuffer transposes it into the row-major game_offscreen_buffer
+// the platform shows; anything drawn after that (the minimap) goes straight
+// to the offscreen buffer.
+
+#define RENDER_MAX_BUFFER_WIDTH 3840
+#define RENDER_MAX_BUFFER_HEIGHT 2160
+
+// NOTE: Square tiles the present transposes one at a time, so a tile's source
+// columns and destination rows both stay in L1
+#define COLUMN_BUFFER_PRESENT_TILE 32
+
+struct column_buffer
+{
+    i32 Width;
+    i32 Height;
+
+    // NOTE: Bytes between columns, a multiple of 64, set from Height
+    i32 ColumnPitch;
+    void *Data;
+    memory_index Capacity;
+
+    // NOTE: Optional, Height bytes a column; see rayc_heatmap.h
+    u8 *WriteCounts;
+};
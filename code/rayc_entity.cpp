@@ -0,0 +1,386 @@
+internal void
+InitializeEntityStore(entity_store *Store, u32 Capacity, memory_arena *Arena)
+{
+    Capacity = (Capacity + 3) & ~3u;
+    Store->Capacity = Capacity;
+    Store->Count = 0;
+
+    Store->X = PushArray(Arena, Capacity, f32);
+    Store->Y = PushArray(Arena, Capacity, f32);
+    Store->PrevX = PushArray(Arena, Capacity, f32);
+    Store->PrevY = PushArray(Arena, Capacity, f32);
+    Store->VelocityX = PushArray(Arena, Capacity, f32);
+    Store->VelocityY = PushArray(Arena, Capacity, f32);
+    Store->Heading = PushArray(Arena, Capacity, f32);
+
+    Store->AIState = PushArray(Arena, Capacity, u8);
+    Store->Gear = PushArray(Arena, Capacity, u8);
+    Store->Health = PushArray(Arena, Capacity, f32);
+    Store->DenseToSlot = PushArray(Arena, Capacity, u32);
+
+    Store->SlotGeneration = PushArray(Arena, Capacity, u32);
+    Store->SlotToDense = PushArray(Arena, Capacity, u32);
+    Store->FreeSlots = PushArray(Arena, Capacity, u32);
+
+    // NOTE: Hand out low slots first
+    Store->FreeSlotCount = Capacity;
+    for (u32 SlotIndex = 0;
+         SlotIndex < Capacity;
+         ++SlotIndex)
+    {
+        Store->FreeSlots[SlotIndex] = Capacity - 1 - SlotIndex;
+        Store->SlotGeneration[SlotIndex] = 0;
+        Store->SlotToDense[SlotIndex] = ENTITY_INVALID_INDEX;
+    }
+
+    Store->PerceptionCursor = 0;
+}
+
+internal entity_handle
+AddEntity(entity_store *Store, f32 X, f32 Y)
+{
+    entity_handle Result = {};
+    Assert(Store->FreeSlotCount > 0);
+
+    u32 Slot = Store->FreeSlots[--Store->FreeSlotCount];
+    u32 Index = Store->Count++;
+
+    Store->X[Index] = X;
+    Store->Y[Index] = Y;
+    Store->PrevX[Index] = X;
+    Store->PrevY[Index] = Y;
+    Store->VelocityX[Index] = 0.0f;
+    Store->VelocityY[Index] = 0.0f;
+    Store->Heading[Index] = 0.0f;
+
+    Store->AIState[Index] = EntityAI_Idle;
+    Store->Gear[Index] = 0;
+    Store->Health[Index] = 100.0f;
+    Store->DenseToSlot[Index] = Slot;
+
+    Store->SlotToDense[Slot] = Index;
+
+    Result.Slot = Slot;
+    Result.Generation = Store->SlotGeneration[Slot];
+    return Result;
+}
+
+internal u32
+GetEntityIndex(entity_store *Store, entity_handle Handle)
+{
+    u32 Result = ENTITY_INVALID_INDEX;
+    if ((Handle.Slot < Store->Capacity) &&
+        (Store->SlotGeneration[Handle.Slot] == Handle.Generation))
+    {
+        Result = Store->SlotToDense[Handle.Slot];
+    }
+    return Result;
+}
+
+internal void
+GetEntityHandles(entity_store *Store, entity_handle *Handles)
+{
+    // NOTE: Handles for [0, Count), in dense order
+    for (u32 Index = 0;
+         Index < Store->Count;
+         ++Index)
+    {
+        u32 Slot = Store->DenseToSlot[Index];
+        Handles[Index].Slot = Slot;
+        Handles[Index].Generation = Store->SlotGeneration[Slot];
+    }
+}
+
+internal void
+RemoveEntity(entity_store *Store, entity_handle Handle)
+{
+    u32 Index = GetEntityIndex(Store, Handle);
+    if (Index != ENTITY_INVALID_INDEX)
+    {
+        u32 Last = --Store->Count;
+        if (Index != Last)
+        {
+            Store->X[Index] = Store->X[Last];
+            Store->Y[Index] = Store->Y[Last];
+            Store->PrevX[Index] = Store->PrevX[Last];
+            Store->PrevY[Index] = Store->PrevY[Last];
+            Store->VelocityX[Index] = Store->VelocityX[Last];
+            Store->VelocityY[Index] = Store->VelocityY[Last];
+            Store->Heading[Index] = Store->Heading[Last];
+
+            Store->AIState[Index] = Store->AIState[Last];
+            Store->Gear[Index] = Store->Gear[Last];
+            Store->Health[Index] = Store->Health[Last];
+
+            u32 MovedSlot = Store->DenseToSlot[Last];
+            Store->DenseToSlot[Index] = MovedSlot;
+            Store->SlotToDense[MovedSlot] = Index;
+        }
+
+        Store->SlotToDense[Handle.Slot] = ENTITY_INVALID_INDEX;
+        ++Store->SlotGeneration[Handle.Slot];
+        Store->FreeSlots[Store->FreeSlotCount++] = Handle.Slot;
+    }
+}
+
+//
+// NOTE: Update kernels. Each runs over whole groups of four; lanes past Count
+// are scratch and never read back.
+//
+
+inline __m128
+Atan2Approx4(__m128 Y, __m128 X)
+{
+    // NOTE: Polynomial atan on [0, 1] folded out to all octants, ~0.005 rad max error
+    __m128 AbsMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 AbsX = _mm_and_ps(X, AbsMask);
+    __m128 AbsY = _mm_and_ps(Y, AbsMask);
+    __m128 Max = _mm_max_ps(AbsX, AbsY);
+    __m128 Min = _mm_min_ps(AbsX, AbsY);
+    __m128 A = _mm_div_ps(Min, _mm_max_ps(Max, _mm_set1_ps(1.0e-20f)));
+    __m128 S = _mm_mul_ps(A, A);
+    __m128 R = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.0464964749f), S), _mm_set1_ps(0.15931422f));
+    R = _mm_sub_ps(_mm_mul_ps(R, S), _mm_set1_ps(0.327622764f));
+    R = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(R, S), A), A);
+
+    __m128 SteepMask = _mm_cmpgt_ps(AbsY, AbsX);
+    R = _mm_or_ps(_mm_and_ps(SteepMask, _mm_sub_ps(_mm_set1_ps(Pi32/2.0f), R)), _mm_andnot_ps(SteepMask, R));
+    __m128 NegativeXMask = _mm_cmplt_ps(X, _mm_setzero_ps());
+    R = _mm_or_ps(_mm_and_ps(NegativeXMask, _mm_sub_ps(_mm_set1_ps(Pi32), R)), _mm_andnot_ps(NegativeXMask, R));
+    __m128 SignY = _mm_and_ps(Y, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+    R = _mm_xor_ps(R, SignY);
+
+    return R;
+}
+
+inline __m128
+Select4(__m128 Mask, __m128 A, __m128 B)
+{
+    // NOTE: A where Mask is set, B elsewhere
+    __m128 Result = _mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B));
+    return Result;
+}
+
+inline __m128i
+GatherTileSolid4(game_map *Map, __m128i TileX, __m128i TileY)
+{
+    alignas(16) i32 LaneX[4];
+    alignas(16) i32 LaneY[4];
+    alignas(16) i32 LaneSolid[4];
+    _mm_store_si128((__m128i *)LaneX, TileX);
+    _mm_store_si128((__m128i *)LaneY, TileY);
+    for (u32 Lane = 0;
+         Lane < 4;
+         ++Lane)
+    {
+        LaneSolid[Lane] = IsTileSolid(Map, LaneX[Lane], LaneY[Lane]) ? -1 : 0;
+    }
+    __m128i Result = _mm_load_si128((__m128i *)LaneSolid);
+    return Result;
+}
+
+internal void
+SteerRobots(entity_store *Store, flow_field *Field,
+            f32 PlayerX, f32 PlayerY, f32 Speed, f32 StopDistance)
+{
+    // NOTE: Chasing robots head for the center of the next cell down the flow
+    // field, or straight at the player once they share a cell.
+    __m128 PlayerX4 = _mm_set1_ps(PlayerX);
+    __m128 PlayerY4 = _mm_set1_ps(PlayerY);
+    __m128i PlayerTileX4 = _mm_set1_epi32(TruncateF32ToI32(PlayerX));
+    __m128i PlayerTileY4 = _mm_set1_epi32(TruncateF32ToI32(PlayerY));
+    __m128 Speed4 = _mm_set1_ps(Speed);
+    __m128 StopDistanceSq4 = _mm_set1_ps(StopDistance*StopDistance);
+    __m128 Half = _mm_set1_ps(0.5f);
+    __m128 Epsilon = _mm_set1_ps(1.0e-8f);
+    __m128i Chasing4 = _mm_set1_epi32(EntityAI_Chasing);
+
+    alignas(16) i32 LaneTileX[4];
+    alignas(16) i32 LaneTileY[4];
+    alignas(16) i32 LaneStepX[4];
+    alignas(16) i32 LaneStepY[4];
+    alignas(16) i32 LaneHasStep[4];
+
+    for (u32 Index = 0;
+         Index < Store->Count;
+         Index += 4)
+    {
+        __m128 X = _mm_load_ps(Store->X + Index);
+        __m128 Y = _mm_load_ps(Store->Y + Index);
+        __m128i TileX = _mm_cvttps_epi32(X);
+        __m128i TileY = _mm_cvttps_epi32(Y);
+
+        _mm_store_si128((__m128i *)LaneTileX, TileX);
+        _mm_store_si128((__m128i *)LaneTileY, TileY);
+        for (u32 Lane = 0;
+             Lane < 4;
+             ++Lane)
+        {
+            u32 Direction = GetFlowDirection(Field, LaneTileX[Lane], LaneTileY[Lane]);
+            bool32 HasStep = (Direction != FLOW_FIELD_NO_DIRECTION);
+            LaneStepX[Lane] = HasStep ? FlowDirectionDX[Direction] : 0;
+            LaneStepY[Lane] = HasStep ? FlowDirectionDY[Direction] : 0;
+            LaneHasStep[Lane] = HasStep ? -1 : 0;
+        }
+
+        u32 PackedAIState;
+        memcpy(&PackedAIState, Store->AIState + Index, sizeof(PackedAIState));
+        __m128i AIState = _mm_cvtsi32_si128((i32)PackedAIState);
+        AIState = _mm_unpacklo_epi8(AIState, _mm_setzero_si128());
+        AIState = _mm_unpacklo_epi16(AIState, _mm_setzero_si128());
+        __m128 IsChasing = _mm_castsi128_ps(_mm_cmpeq_epi32(AIState, Chasing4));
+
+        __m128 SameTile = _mm_castsi128_ps(_mm_and_si128(_mm_cmpeq_epi32(TileX, PlayerTileX4),
+                                                         _mm_cmpeq_epi32(TileY, PlayerTileY4)));
+        __m128 StepTargetX = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(TileX, _mm_load_si128((__m128i *)LaneStepX))), Half);
+        __m128 StepTargetY = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(TileY, _mm_load_si128((__m128i *)LaneStepY))), Half);
+        __m128 TargetX = Select4(SameTile, PlayerX4, StepTargetX);
+        __m128 TargetY = Select4(SameTile, PlayerY4, StepTargetY);
+        __m128 HasTarget = _mm_or_ps(SameTile, _mm_castsi128_ps(_mm_load_si128((__m128i *)LaneHasStep)));
+
+        __m128 ToPlayerX = _mm_sub_ps(PlayerX4, X);
+        __m128 ToPlayerY = _mm_sub_ps(PlayerY4, Y);
+        __m128 PlayerDistanceSq = _mm_add_ps(_mm_mul_ps(ToPlayerX, ToPlayerX), _mm_mul_ps(ToPlayerY, ToPlayerY));
+        __m128 FarEnough = _mm_cmpge_ps(PlayerDistanceSq, StopDistanceSq4);
+
+        __m128 DX = _mm_sub_ps(TargetX, X);
+        __m128 DY = _mm_sub_ps(TargetY, Y);
+        __m128 LengthSq = _mm_add_ps(_mm_mul_ps(DX, DX), _mm_mul_ps(DY, DY));
+        __m128 Moves = _mm_and_ps(_mm_and_ps(IsChasing, HasTarget),
+                                  _mm_and_ps(FarEnough, _mm_cmpgt_ps(LengthSq, Epsilon)));
+
+        __m128 Scale = _mm_div_ps(Speed4, _mm_sqrt_ps(_mm_max_ps(LengthSq, Epsilon)));
+        __m128 VelocityX = _mm_and_ps(Moves, _mm_mul_ps(DX, Scale));
+        __m128 VelocityY = _mm_and_ps(Moves, _mm_mul_ps(DY, Scale));
+        _mm_store_ps(Store->VelocityX + Index, VelocityX);
+        _mm_store_ps(Store->VelocityY + Index, VelocityY);
+
+        // NOTE: Same convention as PlayerAngle: counterclockwise, map Y flipped
+        __m128 Heading = Atan2Approx4(_mm_sub_ps(_mm_setzero_ps(), DY), DX);
+        _mm_store_ps(Store->Heading + Index, Select4(Moves, Heading, _mm_load_ps(Store->Heading + Index)));
+    }
+}
+
+internal void
+MoveEntities(entity_store *Store, game_map *Map, f32 dt, f32 CollisionRadius)
+{
+    // NOTE: Integrate velocity and slide along walls, one axis at a time,
+    // testing a point CollisionRadius ahead in the direction of travel.
+    __m128 dt4 = _mm_set1_ps(dt);
+    __m128 Radius = _mm_set1_ps(CollisionRadius);
+    __m128 NegativeRadius = _mm_set1_ps(-CollisionRadius);
+    __m128 Zero = _mm_setzero_ps();
+
+    for (u32 Index = 0;
+         Index < Store->Count;
+         Index += 4)
+    {
+        __m128 X = _mm_load_ps(Store->X + Index);
+        __m128 Y = _mm_load_ps(Store->Y + Index);
+        __m128 VelocityX = _mm_load_ps(Store->VelocityX + Index);
+        __m128 VelocityY = _mm_load_ps(Store->VelocityY + Index);
+        _mm_store_ps(Store->PrevX + Index, X);
+        _mm_store_ps(Store->PrevY + Index, Y);
+
+        __m128 NewX = _mm_add_ps(X, _mm_mul_ps(VelocityX, dt4));
+        __m128 TestX = _mm_add_ps(NewX, Select4(_mm_cmpgt_ps(VelocityX, Zero), Radius, NegativeRadius));
+        __m128i BlockedX = GatherTileSolid4(Map, _mm_cvttps_epi32(TestX), _mm_cvttps_epi32(Y));
+        NewX = Select4(_mm_castsi128_ps(BlockedX), X, NewX);
+
+        __m128 NewY = _mm_add_ps(Y, _mm_mul_ps(VelocityY, dt4));
+        __m128 TestY = _mm_add_ps(NewY, Select4(_mm_cmpgt_ps(VelocityY, Zero), Radius, NegativeRadius));
+        __m128i BlockedY = GatherTileSolid4(Map, _mm_cvttps_epi32(NewX), _mm_cvttps_epi32(TestY));
+        NewY = Select4(_mm_castsi128_ps(BlockedY), Y, NewY);
+
+        _mm_store_ps(Store->X + Index, NewX);
+        _mm_store_ps(Store->Y + Index, NewY);
+    }
+}
+
+internal void
+InterpolateEntities(entity_store *Store, f32 Alpha, f32 *OutX, f32 *OutY)
+{
+    __m128 Alpha4 = _mm_set1_ps(Alpha);
+    for (u32 Index = 0;
+         Index < Store->Count;
+         Index += 4)
+    {
+        __m128 PrevX = _mm_load_ps(Store->PrevX + Index);
+        __m128 PrevY = _mm_load_ps(Store->PrevY + Index);
+        __m128 X = _mm_load_ps(Store->X + Index);
+        __m128 Y = _mm_load_ps(Store->Y + Index);
+        _mm_store_ps(OutX + Index, _mm_add_ps(PrevX, _mm_mul_ps(_mm_sub_ps(X, PrevX), Alpha4)));
+        _mm_store_ps(OutY + Index, _mm_add_ps(PrevY, _mm_mul_ps(_mm_sub_ps(Y, PrevY), Alpha4)));
+    }
+}
+
+#define PERCEPTION_QUERIES_PER_TICK 1024
+// NOTE: Robots looked at per tick. Only those in the player's potentially
+// visible set cost a line-of-sight query; the rest are a set lookup.
+#define PERCEPTION_SCANS_PER_TICK 4096
+
+internal void
+UpdateRobotPerception(entity_store *Store, game_map *Map, potentially_visible_sets *PVS,
+                      f32 PlayerX, f32 PlayerY)
+{
+    // NOTE: Idle robots start chasing once they see the player. Robots are
+    // checked a window at a time, so a large crowd costs the same per tick.
+    if (Store->PerceptionCursor >= Store->Count)
+    {
+        Store->PerceptionCursor = 0;
+    }
+
+    pvs_set *PlayerSet = GetPotentiallyVisibleSet(PVS, PlayerX, PlayerY);
+    u32 QueryIndices[PERCEPTION_QUERIES_PER_TICK];
+    f32 SourceX[PERCEPTION_QUERIES_PER_TICK];
+    f32 SourceY[PERCEPTION_QUERIES_PER_TICK];
+    u32 QueryCount = 0;
+    u32 Cursor = Store->PerceptionCursor;
+    u32 ScanEnd = Cursor + PERCEPTION_SCANS_PER_TICK;
+    if (ScanEnd > Store->Count)
+    {
+        ScanEnd = Store->Count;
+    }
+    for (;
+         (Cursor < ScanEnd) && (QueryCount < PERCEPTION_QUERIES_PER_TICK);
+         ++Cursor)
+    {
+        f32 X = Store->X[Cursor];
+        f32 Y = Store->Y[Cursor];
+        if (IsInPotentiallyVisibleSet(PVS, PlayerSet, X, Y))
+        {
+            QueryIndices[QueryCount] = Cursor;
+            SourceX[QueryCount] = X;
+            SourceY[QueryCount] = Y;
+            ++QueryCount;
+        }
+    }
+
+    f32 TargetX[PERCEPTION_QUERIES_PER_TICK];
+    f32 TargetY[PERCEPTION_QUERIES_PER_TICK];
+    u8 Occluded[PERCEPTION_QUERIES_PER_TICK];
+    f32 HitDistance[PERCEPTION_QUERIES_PER_TICK];
+    for (u32 QueryIndex = 0;
+         QueryIndex < QueryCount;
+         ++QueryIndex)
+    {
+        TargetX[QueryIndex] = PlayerX;
+        TargetY[QueryIndex] = PlayerY;
+    }
+
+    visibility_query_batch Batch = {QueryCount, SourceX, SourceY,
+                                    TargetX, TargetY, Occluded, HitDistance};
+    QueryLineOfSight(Map, &Batch);
+
+    for (u32 QueryIndex = 0;
+         QueryIndex < QueryCount;
+         ++QueryIndex)
+    {
+        if (!Occluded[QueryIndex])
+        {
+            Store->AIState[QueryIndices[QueryIndex]] = EntityAI_Chasing;
+        }
+    }
+
+    Store->PerceptionCursor = Cursor;
+}
@@ -0,0 +1,55 @@
+// NOTE: Entity store, laid out as structure-of-arrays. Live entities are
+// packed densely in [0, Count) so update kernels stream straight through the
+// arrays four at a time; removal swaps the last entity into the hole. Outside
+// code refers to entities through handles, which go through a slot table and
+// are checked against a per-slot generation so a stale handle can never reach
+// whatever entity reused its slot.
+//
+// Hot fields (read and written every tick) and cold fields (gameplay state
+// touched occasionally) live in separate arrays so the kernels never pull cold
+// data into cache.
+
+#define ENTITY_INVALID_INDEX 0xFFFFFFFF
+
+struct entity_handle
+{
+    u32 Slot;
+    u32 Generation;
+};
+
+enum entity_ai_state
+{
+    EntityAI_Idle,
+    EntityAI_Chasing,
+};
+
+struct entity_store
+{
+    // NOTE: Always a multiple of 4, so kernels can run whole SIMD groups past Count
+    u32 Capacity;
+    u32 Count;
+
+    // NOTE: Hot
+    f32 *X;
+    f32 *Y;
+    f32 *PrevX;
+    f32 *PrevY;
+    f32 *VelocityX;
+    f32 *VelocityY;
+    f32 *Heading;
+
+    // NOTE: Cold
+    u8 *AIState;
+    u8 *Gear;
+    f32 *Health;
+    u32 *DenseToSlot;
+
+    // NOTE: Slot table
+    u32 *SlotGeneration;
+    u32 *SlotToDense;
+    u32 *FreeSlots;
+    u32 FreeSlotCount;
+
+    // NOTE: Perception is spread across ticks, this many robots at a time
+    u32 PerceptionCursor;
+};
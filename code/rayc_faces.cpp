@@ -0,0 +1,525 @@
+internal void
+InitializeFaceSweep(face_sweep *Sweep, memory_arena *Arena)
+{
+    Assert(RAYCAST_NUM <= FACE_SPAN_LEAVES);
+    Sweep->RayAngle = PushArray(Arena, RAYCAST_NUM, f32);
+    // NOTE: One more than there are columns: column N spans
+    // ColumnMinX[N]..ColumnMinX[N + 1]
+    Sweep->ColumnMinX = PushArray(Arena, RAYCAST_NUM + 1, f32);
+    Sweep->DirX = PushArray(Arena, RAYCAST_NUM, f32);
+    Sweep->DirY = PushArray(Arena, RAYCAST_NUM, f32);
+    Sweep->TDeltaX = PushArray(Arena, RAYCAST_NUM, f32);
+    Sweep->TDeltaY = PushArray(Arena, RAYCAST_NUM, f32);
+    Sweep->CosOffView = PushArray(Arena, RAYCAST_NUM, f32);
+
+    Sweep->Clips = PushArray(Arena, RAYCAST_NUM, column_clip);
+    Sweep->Coverage = PushArray(Arena, RAYCAST_NUM*RENDER_MAX_BUFFER_HEIGHT, u8);
+    Sweep->CloseDepth = PushArray(Arena, 2*FACE_SPAN_LEAVES, f32);
+
+    Sweep->Cells[0] = PushArray(Arena, RAYCAST_NUM, face_cell);
+    Sweep->Cells[1] = PushArray(Arena, RAYCAST_NUM, face_cell);
+
+    Sweep->HashCellIndex = PushArray(Arena, FACE_CELL_HASH_SIZE, u32);
+    Sweep->HashSlot = PushArray(Arena, FACE_CELL_HASH_SIZE, u32);
+    Sweep->HashStamp = PushArray(Arena, FACE_CELL_HASH_SIZE, u32);
+    for (u32 HashIndex = 0;
+         HashIndex < FACE_CELL_HASH_SIZE;
+         ++HashIndex)
+    {
+        Sweep->HashStamp[HashIndex] = 0;
+    }
+    Sweep->Stamp = 0;
+}
+
+internal void
+BeginFaceRing(face_sweep *Sweep)
+{
+    // NOTE: Moves the next ring up and starts a new, empty next ring
+    face_cell *Cells = Sweep->Cells[0];
+    Sweep->Cells[0] = Sweep->Cells[1];
+    Sweep->Cells[1] = Cells;
+    Sweep->CellCount[0] = Sweep->CellCount[1];
+    Sweep->CellCount[1] = 0;
+
+    if (++Sweep->Stamp == 0)
+    {
+        for (u32 HashIndex = 0;
+             HashIndex < FACE_CELL_HASH_SIZE;
+             ++HashIndex)
+        {
+            Sweep->HashStamp[HashIndex] = 0;
+        }
+        Sweep->Stamp = 1;
+    }
+}
+
+internal void
+AddFaceCell(face_sweep *Sweep, i32 X, i32 Y, u32 CellIndex, i32 MinColumn, i32 MaxColumn)
+{
+    // NOTE: Queues the cell for the next ring, or widens its run of columns if
+    // the face on its other near side already queued it. The two runs always
+    // meet, since they're split at the corner the faces share.
+    u32 Mask = FACE_CELL_HASH_SIZE - 1;
+    u32 HashIndex = (CellIndex*2654435761u) >> 20;
+    for (;;)
+    {
+        HashIndex &= Mask;
+        if (Sweep->HashStamp[HashIndex] != Sweep->Stamp)
+        {
+            Assert(Sweep->CellCount[1] < RAYCAST_NUM);
+            u32 Slot = Sweep->CellCount[1]++;
+            face_cell *Cell = &Sweep->Cells[1][Slot];
+            Cell->X = X;
+            Cell->Y = Y;
+            Cell->MinColumn = MinColumn;
+            Cell->MaxColumn = MaxColumn;
+
+            Sweep->HashStamp[HashIndex] = Sweep->Stamp;
+            Sweep->HashCellIndex[HashIndex] = CellIndex;
+            Sweep->HashSlot[HashIndex] = Slot;
+            break;
+        }
+
+        if (Sweep->HashCellIndex[HashIndex] == CellIndex)
+        {
+            face_cell *Cell = &Sweep->Cells[1][Sweep->HashSlot[HashIndex]];
+            if (MinColumn < Cell->MinColumn) Cell->MinColumn = MinColumn;
+            if (MaxColumn > Cell->MaxColumn) Cell->MaxColumn = MaxColumn;
+            break;
+        }
+
+        ++HashIndex;
+    }
+}
+
+internal void
+UpdateFaceSpans(face_sweep *Sweep, i32 MinColumn, i32 MaxColumn)
+{
+    // NOTE: Fixes up the minimums above leaves MinColumn..MaxColumn, a level
+    // at a time, after a face has set them
+    u32 MinNode = (FACE_SPAN_LEAVES + (u32)MinColumn) >> 1;
+    u32 MaxNode = (FACE_SPAN_LEAVES + (u32)MaxColumn) >> 1;
+    while (MinNode)
+    {
+        for (u32 Node = MinNode;
+             Node <= MaxNode;
+             ++Node)
+        {
+            f32 Left = Sweep->CloseDepth[2*Node];
+            f32 Right = Sweep->CloseDepth[2*Node + 1];
+            Sweep->CloseDepth[Node] = (Left < Right) ? Left : Right;
+        }
+        MinNode >>= 1;
+        MaxNode >>= 1;
+    }
+}
+
+internal i32
+NextFaceColumn(face_sweep *Sweep, i32 MinColumn, i32 MaxColumn, f32 MaxDepth)
+{
+    // NOTE: The first column in MinColumn..MaxColumn whose close depth is at
+    // most MaxDepth, or -1. Climbs until a subtree to the right has one,
+    // then goes down into it, so a covered run costs one look however long
+    // it is. Leaves a face has set are right even before UpdateFaceSpans;
+    // the nodes above them are only ever too low, which costs a wasted
+    // look, never a missed column.
+    i32 Result = -1;
+    if (MinColumn <= MaxColumn)
+    {
+        f32 *CloseDepth = Sweep->CloseDepth;
+        u32 Node = FACE_SPAN_LEAVES + (u32)MinColumn;
+        for (;;)
+        {
+            if (CloseDepth[Node] <= MaxDepth)
+            {
+                while (Node < FACE_SPAN_LEAVES)
+                {
+                    Node = 2*Node;
+                    if (CloseDepth[Node] > MaxDepth)
+                    {
+                        ++Node;
+                    }
+                }
+                if (CloseDepth[Node] <= MaxDepth)
+                {
+                    Result = (i32)(Node - FACE_SPAN_LEAVES);
+                    break;
+                }
+            }
+
+            while (Node & 1)
+            {
+                Node >>= 1;
+            }
+            if (Node == 0)
+            {
+                break;
+            }
+            ++Node;
+        }
+
+        if (Result > MaxColumn)
+        {
+            Result = -1;
+        }
+    }
+    return Result;
+}
+
+// NOTE: How far a projected row may be off the exact value, in rows, before
+// the close depths below stop being safe
+#define FACE_ROW_SLACK 0.01f
+
+internal f32
+FaceRowCloseDepth(wall_camera *Camera, f32 Floor, f32 Ceiling, i32 Row)
+{
+    // NOTE: The nearest depth at which crossing a face between cells of these
+    // heights could fill Row: the floor coming up to it or the ceiling coming
+    // down past it. Floors at or over the eye, and ceilings at or under it,
+    // don't move the right way for this, so they just say 0 and get looked
+    // at every face.
+    f32 Below = (f32)Row + 0.5f - Camera->Horizon;
+
+    f32 FromFloor = 0.0f;
+    f32 FloorRise = (Camera->EyeZ - Floor)*Camera->Scale;
+    if (FloorRise > 0.0f)
+    {
+        FromFloor = ((Below + FACE_ROW_SLACK) > 0.0f) ? (FloorRise / (Below + FACE_ROW_SLACK)) : FACE_NEVER_CLOSES;
+    }
+
+    f32 FromCeiling = 0.0f;
+    f32 CeilingDrop = (Camera->EyeZ - Ceiling)*Camera->Scale;
+    if (CeilingDrop < 0.0f)
+    {
+        FromCeiling = ((Below - FACE_ROW_SLACK) < 0.0f) ? (CeilingDrop / (Below - FACE_ROW_SLACK)) : FACE_NEVER_CLOSES;
+    }
+
+    f32 Result = (FromFloor < FromCeiling) ? FromFloor : FromCeiling;
+    return Result;
+}
+
+internal f32
+FaceColumnCloseDepth(wall_camera *Camera, column_clip *Clip, f32 Floor, f32 Ceiling)
+{
+    // NOTE: How deep a face between cells of these heights has to be before
+    // crossing it could close the column. Every row still open has to get
+    // filled for that, so any one of them gives a bound; the open rows
+    // nearest the horizon, either side of it, give the furthest.
+    f32 Result = 0.0f;
+    i32 HorizonRow = (i32)ceilf(Camera->Horizon - 0.5f);
+
+    i32 Row = (HorizonRow > Clip->ClipTop) ? HorizonRow : Clip->ClipTop;
+    while ((Row < Clip->ClipBottom) && Clip->Coverage && Clip->Coverage[Row])
+    {
+        ++Row;
+    }
+    if (Row < Clip->ClipBottom)
+    {
+        f32 RowDepth = FaceRowCloseDepth(Camera, Floor, Ceiling, Row);
+        if (RowDepth > Result) Result = RowDepth;
+    }
+
+    Row = ((HorizonRow < Clip->ClipBottom) ? HorizonRow : Clip->ClipBottom) - 1;
+    while ((Row >= Clip->ClipTop) && Clip->Coverage && Clip->Coverage[Row])
+    {
+        --Row;
+    }
+    if (Row >= Clip->ClipTop)
+    {
+        f32 RowDepth = FaceRowCloseDepth(Camera, Floor, Ceiling, Row);
+        if (RowDepth > Result) Result = RowDepth;
+    }
+
+    if (Result < FACE_NEVER_CLOSES)
+    {
+        Result *= 0.999f;
+    }
+    return Result;
+}
+
+inline bool32
+FaceColumnLeavesByX(face_sweep *Sweep, wall_camera *Camera, i32 Column, i32 LineX, i32 LineY)
+{
+    // NOTE: The ray caster's own test for which way to step
+    f32 TX = GridLineCrossingT(Camera->X, LineX, Sweep->DirX[Column], Sweep->TDeltaX[Column]);
+    f32 TY = GridLineCrossingT(Camera->Y, LineY, Sweep->DirY[Column], Sweep->TDeltaY[Column]);
+    bool32 Result = (TX < TY);
+    return Result;
+}
+
+internal void
+SweepFace(game_state *State, render_state *Render, column_buffer *Buffer, wall_camera *Camera,
+          face_cell *Cell, bool32 AlongX, i32 StepX, i32 StepY, u32 CellSteps, i32 MinColumn, i32 MaxColumn)
+{
+    // NOTE: One of the cell's far faces, seen by columns MinColumn..MaxColumn
+    face_sweep *Sweep = &Render->Faces;
+    game_map *Map = &State->Map;
+
+    i32 NextX = Cell->X;
+    i32 NextY = Cell->Y;
+    i32 Line;
+    u32 Face;
+    f32 EndAX;
+    f32 EndAY;
+    f32 EndBX;
+    f32 EndBY;
+    if (AlongX)
+    {
+        Line = Cell->X + ((StepX > 0) ? 1 : 0);
+        NextX += StepX;
+        Face = (StepX > 0) ? MapFace_West : MapFace_East;
+        EndAX = EndBX = (f32)Line;
+        EndAY = (f32)Cell->Y;
+        EndBY = (f32)(Cell->Y + 1);
+    }
+    else
+    {
+        Line = Cell->Y + ((StepY > 0) ? 1 : 0);
+        NextY += StepY;
+        Face = (StepY > 0) ? MapFace_North : MapFace_South;
+        EndAY = EndBY = (f32)Line;
+        EndAX = (f32)Cell->X;
+        EndBX = (f32)(Cell->X + 1);
+    }
+
+    cell_boundary Boundary;
+    LoadCellBoundary(Map, &Boundary, Cell->X, Cell->Y, NextX, NextY, Face);
+    ++Sweep->FacesSwept;
+
+    // NOTE: A plain face, with the same heights and no grate on either side
+    // or grates on both, draws nothing, and the floor and ceiling just carry
+    // on behind it. Filling them out to the next face that isn't plain
+    // covers the same rows as filling them cell by cell, so the columns skip
+    // it, apart from any that could close on it: those whose floor and
+    // ceiling meet short of its far end.
+    bool32 Plain = (!Boundary.NextSolid && (Boundary.InGrate == Boundary.NextInGrate) &&
+                    (Boundary.NextFloor == Boundary.Floor) && (Boundary.NextCeiling == Boundary.Ceiling));
+    f32 MaxDepth = FACE_NEVER_CLOSES;
+    if (Plain)
+    {
+        f32 DepthA = (EndAX - Camera->X)*Sweep->ViewX + (EndAY - Camera->Y)*Sweep->ViewY;
+        f32 DepthB = (EndBX - Camera->X)*Sweep->ViewX + (EndBY - Camera->Y)*Sweep->ViewY;
+        MaxDepth = ((DepthA > DepthB) ? DepthA : DepthB)*1.01f + 0.01f;
+    }
+
+    bool32 Drew = false;
+    for (i32 ColumnIndex = NextFaceColumn(Sweep, MinColumn, MaxColumn, MaxDepth);
+         ColumnIndex >= 0;
+         ColumnIndex = NextFaceColumn(Sweep, ColumnIndex + 1, MaxColumn, MaxDepth))
+    {
+        f32 DirX = Sweep->DirX[ColumnIndex];
+        f32 DirY = Sweep->DirY[ColumnIndex];
+        f32 T;
+        f32 TextureU;
+        if (AlongX)
+        {
+            T = GridLineCrossingT(Camera->X, Line, DirX, Sweep->TDeltaX[ColumnIndex]);
+            f32 HitY = Camera->Y + T*DirY;
+            TextureU = HitY - floorf(HitY);
+        }
+        else
+        {
+            T = GridLineCrossingT(Camera->Y, Line, DirY, Sweep->TDeltaY[ColumnIndex]);
+            f32 HitX = Camera->X + T*DirX;
+            TextureU = HitX - floorf(HitX);
+        }
+
+        f32 Depth = T*Sweep->CosOffView[ColumnIndex];
+        if (Depth < 1.0e-4f)
+        {
+            Depth = 1.0e-4f;
+        }
+
+        column_clip *Clip = &Sweep->Clips[ColumnIndex];
+        transparent_hit *Hits = Render->TransparentHits + ColumnIndex*RAYCAST_MAX_TRANSPARENT_HITS;
+        u8 *CoverageStorage = Sweep->Coverage + ColumnIndex*RENDER_MAX_BUFFER_HEIGHT;
+        Drew = true;
+        ++Sweep->ColumnsDrawn;
+        if (DrawCellBoundary(Map, Render, Buffer, Camera, &Boundary, Clip, CoverageStorage, Hits,
+                             Sweep->ColumnMinX[ColumnIndex], Sweep->ColumnMinX[ColumnIndex + 1],
+                             TextureU, Depth))
+        {
+            ray_data *Result = &Render->RaycastData[ColumnIndex];
+            Result->RayAngle = NormalizeAngle(Sweep->RayAngle[ColumnIndex]);
+            Result->InterceptX = Camera->X + T*DirX;
+            Result->InterceptY = Camera->Y + T*DirY;
+            Result->TileX = NextX;
+            Result->TileY = NextY;
+            Result->Face = Face;
+            Result->HitWallTexturePosition = TextureU;
+            Result->Distance = Depth;
+            Result->TransparentHitCount = Clip->HitCount;
+            Result->CellSteps = CellSteps;
+            Sweep->CloseDepth[FACE_SPAN_LEAVES + ColumnIndex] = FACE_COLUMN_COVERED;
+        }
+        else
+        {
+            Sweep->CloseDepth[FACE_SPAN_LEAVES + ColumnIndex] =
+                FaceColumnCloseDepth(Camera, Clip, Boundary.NextFloor, Boundary.NextCeiling);
+        }
+    }
+    if (Drew)
+    {
+        UpdateFaceSpans(Sweep, MinColumn, MaxColumn);
+        ++Sweep->FacesDrawn;
+    }
+
+    // NOTE: The cell behind gets the face's columns from the first still open
+    i32 FirstOpen = NextFaceColumn(Sweep, MinColumn, MaxColumn, FACE_NEVER_CLOSES);
+    if (!Boundary.NextSolid && (FirstOpen >= 0))
+    {
+        AddFaceCell(Sweep, NextX, NextY, (u32)(NextY*Map->Width + NextX), FirstOpen, MaxColumn);
+    }
+}
+
+internal void
+RenderFaceSweep(game_state *State, render_state *Render, column_buffer *Buffer, wall_camera *Camera,
+                f32 FirstRayAngle, f32 dAngle, f32 ColumnWidth, i32 ColumnCount)
+{
+    // NOTE: Every step away from the camera cell takes a column one cell
+    // further out in |dx| + |dy|, never back, so the rings of cells at equal
+    // |dx| + |dy| are front to back for every column at once.
+    //
+    // Within one quadrant of directions, which far face of a cell a column
+    // leaves by flips once across the cell's run of columns, at the corner
+    // the two faces share, so a binary search on the ray caster's own step
+    // test splits the run. Columns are swept a quadrant at a time; a view
+    // straddles at most two. Where a ray crosses a face comes from
+    // GridLineCrossingT in both engines, so every column meets the same
+    // faces at the same T as it would walking on its own, and RaycastData
+    // and TransparentHits come out the same too.
+    face_sweep *Sweep = &Render->Faces;
+    if (!Sweep->Clips)
+    {
+        InitializeFaceSweep(Sweep, &Render->Arena);
+    }
+    game_map *Map = &State->Map;
+
+    i32 CameraCellX = TruncateF32ToI32(Camera->X);
+    i32 CameraCellY = TruncateF32ToI32(Camera->Y);
+    u32 CameraCellIndex = (u32)(CameraCellY*Map->Width + CameraCellX);
+    f32 CameraFloor = Map->FloorHeights[CameraCellIndex];
+    f32 CameraCeiling = Map->CeilingHeights[CameraCellIndex];
+    f32 NoCrossing = 1.0e30f;
+    Sweep->ViewX = cosf(Camera->Angle);
+    Sweep->ViewY = -sinf(Camera->Angle);
+
+    f32 RayAngle = FirstRayAngle;
+    f32 CurrentColumn = 0.0f;
+    for (i32 ColumnIndex = 0;
+         ColumnIndex < ColumnCount;
+         ++ColumnIndex)
+    {
+        f32 DirX = cosf(RayAngle);
+        f32 DirY = -sinf(RayAngle);
+        Sweep->RayAngle[ColumnIndex] = RayAngle;
+        Sweep->ColumnMinX[ColumnIndex] = CurrentColumn;
+        Sweep->DirX[ColumnIndex] = DirX;
+        Sweep->DirY[ColumnIndex] = DirY;
+        Sweep->TDeltaX[ColumnIndex] = (DirX != 0.0f) ? AbsoluteF32(1.0f / DirX) : NoCrossing;
+        Sweep->TDeltaY[ColumnIndex] = (DirY != 0.0f) ? AbsoluteF32(1.0f / DirY) : NoCrossing;
+        Sweep->CosOffView[ColumnIndex] = cosf(RayAngle - Camera->Angle);
+
+        column_clip *Clip = &Sweep->Clips[ColumnIndex];
+        column_clip ZeroClip = {};
+        *Clip = ZeroClip;
+        Clip->ClipBottom = Buffer->Height;
+        Sweep->CloseDepth[FACE_SPAN_LEAVES + ColumnIndex] =
+            FaceColumnCloseDepth(Camera, Clip, CameraFloor, CameraCeiling);
+
+        RayAngle += dAngle;
+        CurrentColumn += ColumnWidth;
+    }
+    Sweep->ColumnMinX[ColumnCount] = CurrentColumn;
+
+    for (i32 ColumnIndex = ColumnCount;
+         ColumnIndex < FACE_SPAN_LEAVES;
+         ++ColumnIndex)
+    {
+        Sweep->CloseDepth[FACE_SPAN_LEAVES + ColumnIndex] = FACE_COLUMN_COVERED;
+    }
+    for (u32 Node = FACE_SPAN_LEAVES - 1;
+         Node > 0;
+         --Node)
+    {
+        f32 Left = Sweep->CloseDepth[2*Node];
+        f32 Right = Sweep->CloseDepth[2*Node + 1];
+        Sweep->CloseDepth[Node] = (Left < Right) ? Left : Right;
+    }
+
+    Sweep->CellsSwept = 0;
+    Sweep->FacesSwept = 0;
+    Sweep->FacesDrawn = 0;
+    Sweep->ColumnsDrawn = 0;
+    i32 QuadrantMinColumn = 0;
+    while (QuadrantMinColumn < ColumnCount)
+    {
+        i32 StepX = (Sweep->DirX[QuadrantMinColumn] > 0.0f) ? 1 : -1;
+        i32 StepY = (Sweep->DirY[QuadrantMinColumn] > 0.0f) ? 1 : -1;
+        i32 QuadrantMaxColumn = QuadrantMinColumn;
+        while ((QuadrantMaxColumn + 1 < ColumnCount) &&
+               (((Sweep->DirX[QuadrantMaxColumn + 1] > 0.0f) ? 1 : -1) == StepX) &&
+               (((Sweep->DirY[QuadrantMaxColumn + 1] > 0.0f) ? 1 : -1) == StepY))
+        {
+            ++QuadrantMaxColumn;
+        }
+
+        Sweep->CellCount[1] = 0;
+        BeginFaceRing(Sweep);
+        AddFaceCell(Sweep, CameraCellX, CameraCellY, CameraCellIndex, QuadrantMinColumn, QuadrantMaxColumn);
+
+        u32 CellSteps = 0;
+        for (;;)
+        {
+            BeginFaceRing(Sweep);
+            if (Sweep->CellCount[0] == 0)
+            {
+                break;
+            }
+            ++CellSteps;
+
+            for (u32 CellSlot = 0;
+                 CellSlot < Sweep->CellCount[0];
+                 ++CellSlot)
+            {
+                face_cell *Cell = &Sweep->Cells[0][CellSlot];
+                ++Sweep->CellsSwept;
+
+                i32 LineX = Cell->X + ((StepX > 0) ? 1 : 0);
+                i32 LineY = Cell->Y + ((StepY > 0) ? 1 : 0);
+                bool32 FirstAlongX = FaceColumnLeavesByX(Sweep, Camera, Cell->MinColumn, LineX, LineY);
+                i32 Split = Cell->MaxColumn + 1;
+                if (FaceColumnLeavesByX(Sweep, Camera, Cell->MaxColumn, LineX, LineY) != FirstAlongX)
+                {
+                    // NOTE: Low always leaves the way the first column does
+                    // and High never does
+                    i32 Low = Cell->MinColumn;
+                    i32 High = Cell->MaxColumn;
+                    while (High - Low > 1)
+                    {
+                        i32 Middle = (Low + High) / 2;
+                        if (FaceColumnLeavesByX(Sweep, Camera, Middle, LineX, LineY) == FirstAlongX)
+                        {
+                            Low = Middle;
+                        }
+                        else
+                        {
+                            High = Middle;
+                        }
+                    }
+                    Split = High;
+                }
+
+                SweepFace(State, Render, Buffer, Camera, Cell, FirstAlongX, StepX, StepY, CellSteps,
+                          Cell->MinColumn, Split - 1);
+                if (Split <= Cell->MaxColumn)
+                {
+                    SweepFace(State, Render, Buffer, Camera, Cell, !FirstAlongX, StepX, StepY, CellSteps,
+                              Split, Cell->MaxColumn);
+                }
+            }
+        }
+
+        QuadrantMinColumn = QuadrantMaxColumn + 1;
+    }
+}
@@ -0,0 +1,96 @@
+// NOTE: The face sweep, a second way to draw the 3D view next to the ray
+// caster. Instead of walking each column through the map on its own, it
+// walks the map once, front to back in rings of cells around the camera,
+// and hands each face it reaches to the columns that see it.
+//
+// A cell knows the run of columns looking through it. Splitting that run at
+// the cell's far corner gives each of its two far faces its own run, the
+// face's endpoints projected to columns, and the cell behind each face
+// inherits that run. Only faces where something changes (a wall, a step, a
+// lintel, a grate, a new floor or ceiling height) are drawn, and only into
+// the columns in their run that are still open. A face between two cells of
+// the same heights is crossed without touching a single column, except for
+// the odd column far enough out for its floor and ceiling to meet.
+//
+// Open and covered columns are kept in a span buffer over the columns: a
+// min tree of the depth at which each column could next close on its own,
+// with covered columns holding FACE_COLUMN_COVERED. A face asks it for the
+// columns in its run below a depth, and covered runs drop out a whole
+// subtree at a time.
+//
+// Both engines draw a column's share of a face with the same code and work
+// out where a ray crosses a grid line the same way, so the pictures match to
+// the pixel.
+
+enum render_engine
+{
+    RenderEngine_Raycast,
+    RenderEngine_Faces,
+
+    RenderEngine_Count,
+};
+
+// NOTE: Leaves in the span buffer, a power of two at least RAYCAST_NUM
+#define FACE_SPAN_LEAVES 2048
+// NOTE: Span buffer keys for a column that's done, and for one that no run of
+// plain faces can close
+#define FACE_COLUMN_COVERED 3.0e38f
+#define FACE_NEVER_CLOSES 1.0e30f
+// NOTE: A ring never has more live cells than there are columns, since each
+// open column looks through one cell at a time. Power of two, at least twice
+// that.
+#define FACE_CELL_HASH_SIZE 4096
+
+// NOTE: A cell waiting its turn in the sweep, with the run of columns that
+// look through it
+struct face_cell
+{
+    i32 X;
+    i32 Y;
+    i32 MinColumn;
+    i32 MaxColumn;
+};
+
+struct face_sweep
+{
+    // NOTE: The view direction, for how deep a face's ends are
+    f32 ViewX;
+    f32 ViewY;
+
+    // NOTE: Per-column constants, RAYCAST_NUM long. Rebuilt every frame.
+    f32 *RayAngle;
+    f32 *ColumnMinX;
+    f32 *DirX;
+    f32 *DirY;
+    f32 *TDeltaX;
+    f32 *TDeltaY;
+    f32 *CosOffView;
+
+    column_clip *Clips;
+    // NOTE: RAYCAST_NUM coverage masks of RENDER_MAX_BUFFER_HEIGHT rows, since
+    // the columns are all in flight at once
+    u8 *Coverage;
+
+    // NOTE: The span buffer. Node 1 is the root, column N is leaf
+    // FACE_SPAN_LEAVES + N, and every node holds the smaller of its children.
+    f32 *CloseDepth;
+
+    // NOTE: This ring's cells and the next one's, swapped every ring
+    face_cell *Cells[2];
+    u32 CellCount[2];
+
+    // NOTE: Cell index to slot in the next ring's list. Entries are only
+    // valid when their stamp is the current ring's.
+    u32 *HashCellIndex;
+    u32 *HashSlot;
+    u32 *HashStamp;
+    u32 Stamp;
+
+    // NOTE: Last frame's, for the HUD and the bench. FacesSwept counts every
+    // face crossed, FacesDrawn only those that drew, and ColumnsDrawn each
+    // column's share of a face.
+    u32 CellsSwept;
+    u32 FacesSwept;
+    u32 FacesDrawn;
+    u32 ColumnsDrawn;
+};
@@ -0,0 +1,199 @@
+// NOTE: Directions are numbered counterclockwise from east. Map Y grows south.
+global_variable const i32 FlowDirectionDX[8] = { 1,  1,  0, -1, -1, -1,  0,  1 };
+global_variable const i32 FlowDirectionDY[8] = { 0, -1, -1, -1,  0,  1,  1,  1 };
+
+internal void
+InitializeFlowField(flow_field *Field, game_map *Map, memory_arena *Arena)
+{
+    Field->Width = Map->Width;
+    Field->Height = Map->Height;
+    u32 CellCount = (u32)(Map->Width*Map->Height);
+
+    for (u32 BufferIndex = 0;
+         BufferIndex < 2;
+         ++BufferIndex)
+    {
+        flow_field_buffer *Buffer = &Field->Buffers[BufferIndex];
+        Buffer->Distance = PushArray(Arena, CellCount, u32);
+        Buffer->Direction = PushArray(Arena, CellCount, u8);
+        Buffer->TargetX = -1;
+        Buffer->TargetY = -1;
+    }
+    Field->Frontier = PushArray(Arena, CellCount, u32);
+
+    Field->ReadIndex = 0;
+    Field->HasField = false;
+    Field->Phase = FlowFieldPhase_Idle;
+    Field->PendingTargetX = -1;
+    Field->PendingTargetY = -1;
+}
+
+internal void
+BeginFlowFieldSweep(flow_field *Field, i32 TargetX, i32 TargetY)
+{
+    flow_field_buffer *Build = &Field->Buffers[Field->ReadIndex ^ 1];
+    Build->TargetX = TargetX;
+    Build->TargetY = TargetY;
+    Field->ClearCursor = 0;
+    Field->Phase = FlowFieldPhase_Clearing;
+}
+
+inline void
+FlowFieldVisit(flow_field *Field, flow_field_buffer *Build,
+               u32 CellIndex, u32 Distance, u32 DirectionFromParent)
+{
+    if (Build->Distance[CellIndex] == FLOW_FIELD_UNREACHED)
+    {
+        Build->Distance[CellIndex] = Distance;
+        // NOTE: A robot here steps back toward the cell that discovered it
+        Build->Direction[CellIndex] = (u8)((DirectionFromParent + 4) & 7);
+        Field->Frontier[Field->FrontierTail++] = CellIndex;
+    }
+}
+
+internal u32
+SweepFlowField(flow_field *Field, game_map *Map, flow_field_buffer *Build, u32 CellBudget)
+{
+    // NOTE: Returns how many cells were expanded
+    i32 Width = Field->Width;
+    i32 Height = Field->Height;
+    u8 *Tiles = Map->Tiles;
+
+    u32 Expanded = 0;
+    while ((Expanded < CellBudget) && (Field->FrontierHead < Field->FrontierTail))
+    {
+        u32 CellIndex = Field->Frontier[Field->FrontierHead++];
+        i32 Y = (i32)CellIndex / Width;
+        i32 X = (i32)CellIndex - Y*Width;
+        u32 NextDistance = Build->Distance[CellIndex] + 1;
+
+        bool32 OpenE = ((X + 1 < Width) && !Tiles[CellIndex + 1]);
+        bool32 OpenN = ((Y > 0) && !Tiles[CellIndex - Width]);
+        bool32 OpenW = ((X > 0) && !Tiles[CellIndex - 1]);
+        bool32 OpenS = ((Y + 1 < Height) && !Tiles[CellIndex + Width]);
+
+        // NOTE: Orthogonal neighbours first so ties prefer straight steps.
+        // Diagonals only when both sides are open, so robots never clip corners.
+        if (OpenE) FlowFieldVisit(Field, Build, CellIndex + 1, NextDistance, 0);
+        if (OpenN) FlowFieldVisit(Field, Build, CellIndex - Width, NextDistance, 2);
+        if (OpenW) FlowFieldVisit(Field, Build, CellIndex - 1, NextDistance, 4);
+        if (OpenS) FlowFieldVisit(Field, Build, CellIndex + Width, NextDistance, 6);
+        if (OpenE && OpenN && !Tiles[CellIndex - Width + 1])
+        {
+            FlowFieldVisit(Field, Build, CellIndex - Width + 1, NextDistance, 1);
+        }
+        if (OpenW && OpenN && !Tiles[CellIndex - Width - 1])
+        {
+            FlowFieldVisit(Field, Build, CellIndex - Width - 1, NextDistance, 3);
+        }
+        if (OpenW && OpenS && !Tiles[CellIndex + Width - 1])
+        {
+            FlowFieldVisit(Field, Build, CellIndex + Width - 1, NextDistance, 5);
+        }
+        if (OpenE && OpenS && !Tiles[CellIndex + Width + 1])
+        {
+            FlowFieldVisit(Field, Build, CellIndex + Width + 1, NextDistance, 7);
+        }
+
+        ++Expanded;
+    }
+
+    return Expanded;
+}
+
+internal void
+UpdateFlowField(flow_field *Field, game_map *Map, i32 TargetX, i32 TargetY, u32 CellBudget)
+{
+    Field->PendingTargetX = TargetX;
+    Field->PendingTargetY = TargetY;
+
+    if (Field->Phase == FlowFieldPhase_Idle)
+    {
+        flow_field_buffer *Read = &Field->Buffers[Field->ReadIndex];
+        if (!Field->HasField || (Read->TargetX != TargetX) || (Read->TargetY != TargetY))
+        {
+            BeginFlowFieldSweep(Field, TargetX, TargetY);
+        }
+    }
+
+    u32 CellCount = (u32)(Field->Width*Field->Height);
+    u32 BudgetLeft = CellBudget;
+    while ((BudgetLeft > 0) && (Field->Phase != FlowFieldPhase_Idle))
+    {
+        flow_field_buffer *Build = &Field->Buffers[Field->ReadIndex ^ 1];
+        if (Field->Phase == FlowFieldPhase_Clearing)
+        {
+            // NOTE: Clearing is a plain fill, so it gets 16 cells per unit of budget
+            u32 ClearCount = CellCount - Field->ClearCursor;
+            if (ClearCount > BudgetLeft*16)
+            {
+                ClearCount = BudgetLeft*16;
+            }
+            memset(Build->Distance + Field->ClearCursor, 0xFF, ClearCount*sizeof(u32));
+            memset(Build->Direction + Field->ClearCursor, FLOW_FIELD_NO_DIRECTION, ClearCount);
+            Field->ClearCursor += ClearCount;
+            BudgetLeft -= (ClearCount + 15) / 16;
+
+            if (Field->ClearCursor == CellCount)
+            {
+                Field->FrontierHead = 0;
+                Field->FrontierTail = 0;
+                if ((Build->TargetX >= 0) && (Build->TargetX < Field->Width) &&
+                    (Build->TargetY >= 0) && (Build->TargetY < Field->Height))
+                {
+                    u32 TargetIndex = (u32)(Build->TargetY*Field->Width + Build->TargetX);
+                    if (!Map->Tiles[TargetIndex])
+                    {
+                        Build->Distance[TargetIndex] = 0;
+                        Field->Frontier[Field->FrontierTail++] = TargetIndex;
+                    }
+                }
+                Field->Phase = FlowFieldPhase_Sweeping;
+            }
+        }
+        else
+        {
+            BudgetLeft -= SweepFlowField(Field, Map, Build, BudgetLeft);
+            if (Field->FrontierHead == Field->FrontierTail)
+            {
+                Field->ReadIndex ^= 1;
+                Field->HasField = true;
+                Field->Phase = FlowFieldPhase_Idle;
+
+                // NOTE: If the player moved on while this sweep ran, chase the
+                // newest cell straight away rather than waiting a tick.
+                if ((Field->PendingTargetX != Build->TargetX) ||
+                    (Field->PendingTargetY != Build->TargetY))
+                {
+                    BeginFlowFieldSweep(Field, Field->PendingTargetX, Field->PendingTargetY);
+                }
+            }
+        }
+    }
+}
+
+inline u32
+GetFlowDirection(flow_field *Field, i32 TileX, i32 TileY)
+{
+    u32 Result = FLOW_FIELD_NO_DIRECTION;
+    if (Field->HasField &&
+        (TileX >= 0) && (TileX < Field->Width) &&
+        (TileY >= 0) && (TileY < Field->Height))
+    {
+        Result = Field->Buffers[Field->ReadIndex].Direction[TileY*Field->Width + TileX];
+    }
+    return Result;
+}
+
+inline u32
+GetFlowDistance(flow_field *Field, i32 TileX, i32 TileY)
+{
+    u32 Result = FLOW_FIELD_UNREACHED;
+    if (Field->HasField &&
+        (TileX >= 0) && (TileX < Field->Width) &&
+        (TileY >= 0) && (TileY < Field->Height))
+    {
+        Result = Field->Buffers[Field->ReadIndex].Distance[TileY*Field->Width + TileX];
+    }
+    return Result;
+}
@@ -0,0 +1,50 @@
+// NOTE: Flow field navigation. One breadth-first sweep outward from the player's
+// cell gives every reachable open cell its step count to the player and the
+// direction of its next step, so any number of robots steer with one lookup
+// each. The sweep only reruns when the player changes cells.
+//
+// There are two buffers: robots read the finished one while the other is
+// rebuilt a bounded number of cells per tick, so even very large maps never
+// stall a tick on a full sweep.
+
+#define FLOW_FIELD_UNREACHED 0xFFFFFFFF
+#define FLOW_FIELD_NO_DIRECTION 0xFF
+#define FLOW_FIELD_CELLS_PER_TICK (1 << 15)
+
+enum flow_field_phase
+{
+    FlowFieldPhase_Idle,
+    FlowFieldPhase_Clearing,
+    FlowFieldPhase_Sweeping,
+};
+
+struct flow_field_buffer
+{
+    // NOTE: Row-major, same layout as game_map::Tiles
+    u32 *Distance;
+    u8 *Direction;
+
+    i32 TargetX;
+    i32 TargetY;
+};
+
+struct flow_field
+{
+    i32 Width;
+    i32 Height;
+
+    flow_field_buffer Buffers[2];
+    u32 ReadIndex;
+    bool32 HasField;
+
+    flow_field_phase Phase;
+    i32 PendingTargetX;
+    i32 PendingTargetY;
+    u32 ClearCursor;
+
+    // NOTE: Every cell enters the frontier at most once per sweep, so it is a
+    // flat array of cell indices consumed front to back, never a ring.
+    u32 *Frontier;
+    u32 FrontierHead;
+    u32 FrontierTail;
+};
@@ -0,0 +1,211 @@
+internal void
+CountWrites(u8 *Counts, i32 Pitch, i32 MinOuter, i32 MaxOuter, i32 MinInner, i32 MaxInner)
+{
+    // NOTE: Bumps every count in the span, saturating. Outer steps by Pitch,
+    // inner by one, whichever way round the shadowed buffer is laid out.
+    for (i32 Outer = MinOuter;
+         Outer < MaxOuter;
+         ++Outer)
+    {
+        u8 *Count = Counts + (memory_index)Outer*Pitch + MinInner;
+        for (i32 Inner = MinInner;
+             Inner < MaxInner;
+             ++Inner)
+        {
+            if (*Count < 0xFF)
+            {
+                ++*Count;
+            }
+            ++Count;
+        }
+    }
+}
+
+inline void
+CountColumnWrites(column_buffer *Buffer, i32 MinX, i32 MaxX, i32 MinY, i32 MaxY)
+{
+    if (Buffer->WriteCounts)
+    {
+        CountWrites(Buffer->WriteCounts, Buffer->Height, MinX, MaxX, MinY, MaxY);
+    }
+}
+
+inline void
+CountBufferWrites(game_offscreen_buffer *Buffer, i32 MinX, i32 MaxX, i32 MinY, i32 MaxY)
+{
+    if (Buffer->WriteCounts)
+    {
+        CountWrites(Buffer->WriteCounts, Buffer->Width, MinY, MaxY, MinX, MaxX);
+    }
+}
+
+// NOTE: Returns whether this frame is counted. The counts are pushed the
+// first time one is, at the largest buffer size.
+internal bool32
+BeginHeatmapFrame(render_heatmap *Heatmap, i32 Width, i32 Height, memory_arena *Arena)
+{
+    bool32 Result = ((Heatmap->Mode != HeatmapMode_Off) || Heatmap->Record);
+    if (Result)
+    {
+        memory_index MaxPixels = (memory_index)RENDER_MAX_BUFFER_WIDTH*RENDER_MAX_BUFFER_HEIGHT;
+        if (!Heatmap->PixelWrites)
+        {
+            Heatmap->ColumnSteps = PushArray(Arena, RENDER_MAX_BUFFER_WIDTH, u16);
+            Heatmap->PixelWrites = PushArray(Arena, MaxPixels, u8);
+            Heatmap->ColumnWrites = PushArray(Arena, MaxPixels, u8);
+        }
+
+        Heatmap->Width = Width;
+        Heatmap->Height = Height;
+        memset(Heatmap->ColumnWrites, 0, (memory_index)Width*Height);
+    }
+    return Result;
+}
+
+// NOTE: After the column buffer is presented: the 3D view's counts become the
+// frame's, row-major, and the ray steps are spread across the screen columns
+// each ray drew
+internal void
+PresentHeatmapColumns(render_heatmap *Heatmap, ray_data *Rays, u32 RayCount)
+{
+    i32 Width = Heatmap->Width;
+    i32 Height = Heatmap->Height;
+    for (i32 Y = 0;
+         Y < Height;
+         ++Y)
+    {
+        u8 *Row = Heatmap->PixelWrites + (memory_index)Y*Width;
+        for (i32 X = 0;
+             X < Width;
+             ++X)
+        {
+            Row[X] = Heatmap->ColumnWrites[(memory_index)X*Height + Y];
+        }
+    }
+
+    for (i32 X = 0;
+         X < Width;
+         ++X)
+    {
+        u32 Steps = Rays[(u32)X*RayCount / (u32)Width].CellSteps;
+        Heatmap->ColumnSteps[X] = (u16)((Steps < 0xFFFF) ? Steps : 0xFFFF);
+    }
+}
+
+// NOTE: Once everything is drawn
+internal void
+EndHeatmapFrame(render_heatmap *Heatmap)
+{
+    Heatmap->MaxSteps = 0;
+    Heatmap->TotalSteps = 0;
+    for (i32 X = 0;
+         X < Heatmap->Width;
+         ++X)
+    {
+        u32 Steps = Heatmap->ColumnSteps[X];
+        Heatmap->TotalSteps += Steps;
+        if (Steps > Heatmap->MaxSteps)
+        {
+            Heatmap->MaxSteps = Steps;
+        }
+    }
+
+    Heatmap->MaxWrites = 0;
+    Heatmap->TotalWrites = 0;
+    memory_index PixelCount = (memory_index)Heatmap->Width*Heatmap->Height;
+    for (memory_index PixelIndex = 0;
+         PixelIndex < PixelCount;
+         ++PixelIndex)
+    {
+        u32 Writes = Heatmap->PixelWrites[PixelIndex];
+        Heatmap->TotalWrites += Writes;
+        if (Writes > Heatmap->MaxWrites)
+        {
+            Heatmap->MaxWrites = Writes;
+        }
+    }
+}
+
+inline u32
+HeatColor(f32 T)
+{
+    // NOTE: Blue, cyan, green, yellow, red as T goes 0 to 1
+    u8 Stops[][3] =
+    {
+        {0x00, 0x00, 0xFF},
+        {0x00, 0xFF, 0xFF},
+        {0x00, 0xFF, 0x00},
+        {0xFF, 0xFF, 0x00},
+        {0xFF, 0x00, 0x00},
+    };
+    u32 StopCount = ArrayCount(Stops);
+
+    if (T < 0.0f) T = 0.0f;
+    if (T > 1.0f) T = 1.0f;
+    f32 Position = T*(f32)(StopCount - 1);
+    u32 Stop = (u32)TruncateF32ToI32(Position);
+    if (Stop > StopCount - 2) Stop = StopCount - 2;
+    f32 Fraction = Position - (f32)Stop;
+
+    u32 Result = 0xFF000000;
+    for (u32 Channel = 0;
+         Channel < 3;
+         ++Channel)
+    {
+        f32 From = (f32)Stops[Stop][Channel];
+        f32 Value = From + ((f32)Stops[Stop + 1][Channel] - From)*Fraction;
+        Result |= (u32)RoundF32ToI32(Value) << (16 - 8*Channel);
+    }
+    return Result;
+}
+
+inline u32
+BlendHalf(u32 A, u32 B)
+{
+    u32 Result = 0xFF000000 | (((A >> 1) & 0x007F7F7F) + ((B >> 1) & 0x007F7F7F));
+    return Result;
+}
+
+// NOTE: Half and half over the frame, so the scene still shows through.
+// Overdraw: one write is blue, eight or more red, none black. Column cost is
+// on a log scale: one step blue, 256 red.
+internal void
+DrawHeatmapOverlay(render_heatmap *Heatmap, game_offscreen_buffer *Buffer)
+{
+    u32 Palette[256];
+    Palette[0] = 0xFF000000;
+    for (u32 Value = 1;
+         Value < ArrayCount(Palette);
+         ++Value)
+    {
+        f32 T = (Heatmap->Mode == HeatmapMode_Overdraw) ? ((f32)(Value - 1) / 7.0f) : (log2f((f32)Value) / 8.0f);
+        Palette[Value] = HeatColor(T);
+    }
+
+    i32 Width = (Heatmap->Width < Buffer->Width) ? Heatmap->Width : Buffer->Width;
+    i32 Height = (Heatmap->Height < Buffer->Height) ? Heatmap->Height : Buffer->Height;
+    for (i32 Y = 0;
+         Y < Height;
+         ++Y)
+    {
+        u32 *Pixel = (u32 *)((u8 *)Buffer->Data + Y*Buffer->Pitch);
+        u8 *Writes = Heatmap->PixelWrites + (memory_index)Y*Heatmap->Width;
+        for (i32 X = 0;
+             X < Width;
+             ++X)
+        {
+            u32 Value;
+            if (Heatmap->Mode == HeatmapMode_Overdraw)
+            {
+                Value = Writes[X];
+            }
+            else
+            {
+                u32 Steps = Heatmap->ColumnSteps[X];
+                Value = (Steps < 0xFF) ? Steps : 0xFF;
+            }
+            *Pixel = BlendHalf(*Pixel, Palette[Value]);
+            ++Pixel;
+        }
+    }
+}
@@ -0,0 +1,44 @@
+// NOTE: Debug heatmaps of what a frame cost, laid over the frame in false
+// colour. Column cost is how many cells the ray behind each screen column
+// stepped through before its column closed; overdraw is how many times each
+// pixel was written, by the walls, floors, sprites and grates in the 3D view
+// and then by the minimap and the HUD over the top.
+//
+// Counting is off unless a heatmap is showing or being recorded. When it's
+// on, each drawing primitive bumps one byte per pixel it writes in a count
+// buffer shadowing its target: column-major for the column buffer, row-major
+// for the offscreen buffer. With it off the only cost is one null test per
+// span drawn.
+
+enum heatmap_mode
+{
+    HeatmapMode_Off,
+    HeatmapMode_ColumnCost,
+    HeatmapMode_Overdraw,
+
+    HeatmapMode_Count,
+};
+
+struct render_heatmap
+{
+    // NOTE: Which overlay to draw. Record keeps the counts up to date with
+    // the overlay off, for the platform layer to dump.
+    heatmap_mode Mode;
+    bool32 Record;
+
+    // NOTE: The last frame counted, Width x Height. ColumnSteps has one entry
+    // per screen column; PixelWrites is row-major and saturates at 255.
+    i32 Width;
+    i32 Height;
+    u16 *ColumnSteps;
+    u8 *PixelWrites;
+
+    // NOTE: What the 3D view counts into, column-major like the column buffer
+    // but Height bytes a column. Merged into PixelWrites at present.
+    u8 *ColumnWrites;
+
+    u32 MaxSteps;
+    u64 TotalSteps;
+    u32 MaxWrites;
+    u64 TotalWrites;
+};
@@ -0,0 +1,229 @@
+internal void
+LoadGlyphAtlas(glyph_atlas *Atlas, texture *Texture)
+{
+    // NOTE: A texel counts as ink at alpha >= 0x80, same as sprites. A font
+    // that failed to load leaves every glyph blank.
+    for (u32 Glyph = 0;
+         Glyph < HUD_GLYPH_COUNT;
+         ++Glyph)
+    {
+        i32 CellX = (i32)(Glyph % HUD_ATLAS_COLUMNS)*HUD_GLYPH_WIDTH;
+        i32 CellY = (i32)(Glyph / HUD_ATLAS_COLUMNS)*HUD_GLYPH_HEIGHT;
+        for (i32 Row = 0;
+             Row < HUD_GLYPH_HEIGHT;
+             ++Row)
+        {
+            u8 Bits = 0;
+            i32 Y = CellY + Row;
+            if (Texture->Pixels && (CellX + HUD_GLYPH_WIDTH <= Texture->Width) && (Y < Texture->Height))
+            {
+                // NOTE: BMP rows are stored bottom-up
+                u32 *Texels = (u32 *)((u8 *)Texture->Pixels + (Texture->Height - 1 - Y)*Texture->Pitch) + CellX;
+                for (i32 Column = 0;
+                     Column < HUD_GLYPH_WIDTH;
+                     ++Column)
+                {
+                    if ((Texels[Column] >> 24) >= 0x80)
+                    {
+                        Bits |= (u8)(1 << Column);
+                    }
+                }
+            }
+            Atlas->Rows[Glyph][Row] = Bits;
+        }
+    }
+
+    for (u32 Bits = 0;
+         Bits < 256;
+         ++Bits)
+    {
+        for (u32 Column = 0;
+             Column < HUD_GLYPH_WIDTH;
+             ++Column)
+        {
+            Atlas->LaneMasks[Bits][Column] = (Bits & (1 << Column)) ? 0xFFFFFFFF : 0;
+        }
+    }
+}
+
+internal void
+BeginHud(hud_batch *Batch)
+{
+    Batch->GlyphCount = 0;
+    Batch->MinX = INT32_MAX;
+    Batch->MinY = INT32_MAX;
+    Batch->MaxX = INT32_MIN;
+    Batch->MaxY = INT32_MIN;
+}
+
+internal void
+HudPrint(hud_batch *Batch, i32 X, i32 Y, u32 Color, const char *Format, ...)
+{
+    // NOTE: Queues the text with its top-left at X, Y. '\n' starts a new line
+    // under X; anything outside the atlas draws as '?'. Glyphs past
+    // HUD_MAX_GLYPHS for the frame are dropped.
+    char Text[256];
+    va_list Args;
+    va_start(Args, Format);
+    vsnprintf(Text, sizeof(Text), Format, Args);
+    va_end(Args);
+
+    i32 PenX = X;
+    i32 PenY = Y;
+    for (char *At = Text;
+         *At;
+         ++At)
+    {
+        if (*At == '\n')
+        {
+            PenX = X;
+            PenY += HUD_GLYPH_HEIGHT;
+            continue;
+        }
+
+        u32 Glyph = (u32)(u8)*At - HUD_FIRST_GLYPH;
+        if (Glyph >= HUD_GLYPH_COUNT)
+        {
+            Glyph = '?' - HUD_FIRST_GLYPH;
+        }
+
+        if ((Glyph != 0) && (Batch->GlyphCount < HUD_MAX_GLYPHS))
+        {
+            hud_glyph *Queued = &Batch->Glyphs[Batch->GlyphCount++];
+            Queued->X = PenX;
+            Queued->Y = PenY;
+            Queued->Color = Color;
+            Queued->Glyph = Glyph;
+        }
+
+        if (PenX < Batch->MinX) Batch->MinX = PenX;
+        if (PenY < Batch->MinY) Batch->MinY = PenY;
+        if (PenX + HUD_GLYPH_WIDTH > Batch->MaxX) Batch->MaxX = PenX + HUD_GLYPH_WIDTH;
+        if (PenY + HUD_GLYPH_HEIGHT > Batch->MaxY) Batch->MaxY = PenY + HUD_GLYPH_HEIGHT;
+
+        PenX += HUD_GLYPH_WIDTH;
+    }
+}
+
+internal void
+DimRectangle(game_offscreen_buffer *Buffer, i32 MinX, i32 MinY, i32 MaxX, i32 MaxY)
+{
+    // NOTE: Halves the color channels, four pixels at a time
+    if (MinX < 0) MinX = 0;
+    if (MinY < 0) MinY = 0;
+    if (MaxX > Buffer->Width) MaxX = Buffer->Width;
+    if (MaxY > Buffer->Height) MaxY = Buffer->Height;
+    CountBufferWrites(Buffer, MinX, MaxX, MinY, MaxY);
+
+    __m128i ColorMask = _mm_set1_epi32(0x007F7F7F);
+    __m128i AlphaMask = _mm_set1_epi32((i32)0xFF000000);
+    for (i32 Y = MinY;
+         Y < MaxY;
+         ++Y)
+    {
+        u32 *Pixel = (u32 *)((u8 *)Buffer->Data + Y*Buffer->Pitch) + MinX;
+        i32 X = MinX;
+        for (;
+             X + 4 <= MaxX;
+             X += 4)
+        {
+            __m128i Color = _mm_loadu_si128((__m128i *)Pixel);
+            Color = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(Color, 1), ColorMask),
+                                 _mm_and_si128(Color, AlphaMask));
+            _mm_storeu_si128((__m128i *)Pixel, Color);
+            Pixel += 4;
+        }
+        for (;
+             X < MaxX;
+             ++X)
+        {
+            *Pixel = ((*Pixel >> 1) & 0x007F7F7F) | (*Pixel & 0xFF000000);
+            ++Pixel;
+        }
+    }
+}
+
+internal void
+DrawHud(hud_batch *Batch, glyph_atlas *Atlas, game_offscreen_buffer *Buffer)
+{
+    if (Batch->GlyphCount)
+    {
+        DimRectangle(Buffer,
+                     Batch->MinX - HUD_BACKDROP_MARGIN, Batch->MinY - HUD_BACKDROP_MARGIN,
+                     Batch->MaxX + HUD_BACKDROP_MARGIN, Batch->MaxY + HUD_BACKDROP_MARGIN);
+    }
+
+    for (u32 GlyphIndex = 0;
+         GlyphIndex < Batch->GlyphCount;
+         ++GlyphIndex)
+    {
+        hud_glyph *Glyph = &Batch->Glyphs[GlyphIndex];
+        u8 *Rows = Atlas->Rows[Glyph->Glyph];
+        i32 X = Glyph->X;
+        i32 Y = Glyph->Y;
+
+        if ((X >= 0) && (Y >= 0) &&
+            (X + HUD_GLYPH_WIDTH <= Buffer->Width) && (Y + HUD_GLYPH_HEIGHT <= Buffer->Height))
+        {
+            // NOTE: Whole glyph on screen: each row is a select between the
+            // glyph color and what's there, eight pixels in two halves
+            __m128i Color = _mm_set1_epi32((i32)Glyph->Color);
+            u32 *Pixel = (u32 *)((u8 *)Buffer->Data + Y*Buffer->Pitch) + X;
+            for (i32 Row = 0;
+                 Row < HUD_GLYPH_HEIGHT;
+                 ++Row)
+            {
+                u8 Bits = Rows[Row];
+                if (Bits)
+                {
+                    __m128i MaskLow = _mm_loadu_si128((__m128i *)&Atlas->LaneMasks[Bits][0]);
+                    __m128i MaskHigh = _mm_loadu_si128((__m128i *)&Atlas->LaneMasks[Bits][4]);
+                    __m128i DestLow = _mm_loadu_si128((__m128i *)Pixel);
+                    __m128i DestHigh = _mm_loadu_si128((__m128i *)(Pixel + 4));
+                    DestLow = _mm_or_si128(_mm_and_si128(MaskLow, Color), _mm_andnot_si128(MaskLow, DestLow));
+                    DestHigh = _mm_or_si128(_mm_and_si128(MaskHigh, Color), _mm_andnot_si128(MaskHigh, DestHigh));
+                    _mm_storeu_si128((__m128i *)Pixel, DestLow);
+                    _mm_storeu_si128((__m128i *)(Pixel + 4), DestHigh);
+                    if (Buffer->WriteCounts)
+                    {
+                        for (i32 Column = 0;
+                             Column < HUD_GLYPH_WIDTH;
+                             ++Column)
+                        {
+                            if (Bits & (1 << Column))
+                            {
+                                CountBufferWrites(Buffer, X + Column, X + Column + 1, Y + Row, Y + Row + 1);
+                            }
+                        }
+                    }
+                }
+                Pixel = (u32 *)((u8 *)Pixel + Buffer->Pitch);
+            }
+        }
+        else
+        {
+            // NOTE: Straddles an edge; per pixel
+            for (i32 Row = 0;
+                 Row < HUD_GLYPH_HEIGHT;
+                 ++Row)
+            {
+                i32 PixelY = Y + Row;
+                if ((PixelY >= 0) && (PixelY < Buffer->Height))
+                {
+                    u32 *Pixels = (u32 *)((u8 *)Buffer->Data + PixelY*Buffer->Pitch);
+                    for (i32 Column = 0;
+                         Column < HUD_GLYPH_WIDTH;
+                         ++Column)
+                    {
+                        i32 PixelX = X + Column;
+                        if ((PixelX >= 0) && (PixelX < Buffer->Width) && (Rows[Row] & (1 << Column)))
+                        {
+                            Pixels[PixelX] = Glyph->Color;
+                            CountBufferWrites(Buffer, PixelX, PixelX + 1, PixelY, PixelY + 1);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
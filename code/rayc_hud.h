@@ -0,0 +1,44 @@
+// NOTE: Text overlay. Glyphs come from a prebaked atlas (textures/font.bmp, a
+// 16x6 grid of 8x12 cells covering ASCII 32..127) and are kept as one byte of
+// coverage bits per glyph row, bit N being pixel N from the left. A row blit
+// is then one table lookup for the lane masks and a masked select over eight
+// pixels.
+//
+// Text is queued into a hud_batch while the frame is built and drawn in one
+// pass at the end, behind a dimmed backdrop covering everything queued.
+
+#define HUD_GLYPH_WIDTH 8
+#define HUD_GLYPH_HEIGHT 12
+#define HUD_ATLAS_COLUMNS 16
+#define HUD_FIRST_GLYPH 32
+#define HUD_GLYPH_COUNT 96
+#define HUD_MAX_GLYPHS 1024
+#define HUD_BACKDROP_MARGIN 4
+
+struct glyph_atlas
+{
+    u8 Rows[HUD_GLYPH_COUNT][HUD_GLYPH_HEIGHT];
+
+    // NOTE: Coverage byte to eight u32 lane masks
+    u32 LaneMasks[256][HUD_GLYPH_WIDTH];
+};
+
+struct hud_glyph
+{
+    i32 X;
+    i32 Y;
+    u32 Color;
+    u32 Glyph;
+};
+
+struct hud_batch
+{
+    u32 GlyphCount;
+    hud_glyph Glyphs[HUD_MAX_GLYPHS];
+
+    // NOTE: Bounds of everything queued, for the backdrop
+    i32 MinX;
+    i32 MinY;
+    i32 MaxX;
+    i32 MaxY;
+};
@@ -0,0 +1,1276 @@
+inline u16
+ReadU16LE(u8 *At)
+{
+    u16 Result = (u16)(At[0] | (At[1] << 8));
+    return Result;
+}
+
+inline u32
+ReadU32LE(u8 *At)
+{
+    u32 Result = (u32)At[0] | ((u32)At[1] << 8) | ((u32)At[2] << 16) | ((u32)At[3] << 24);
+    return Result;
+}
+
+inline u32
+ReadU32BE(u8 *At)
+{
+    u32 Result = ((u32)At[0] << 24) | ((u32)At[1] << 16) | ((u32)At[2] << 8) | (u32)At[3];
+    return Result;
+}
+
+//
+// NOTE: BMP
+//
+
+#define BMP_COMPRESSION_RGB 0
+#define BMP_COMPRESSION_RLE8 1
+#define BMP_COMPRESSION_RLE4 2
+#define BMP_COMPRESSION_BITFIELDS 3
+#define BMP_COMPRESSION_ALPHABITFIELDS 6
+
+struct bmp_channel
+{
+    u32 Mask;
+    u32 Shift;
+    u32 Bits;
+};
+
+struct bmp_layout
+{
+    i32 Width;
+    i32 Height;
+    bool32 TopDown;
+    u32 BitCount;
+    u32 Compression;
+
+    // NOTE: Red, green, blue, alpha. No alpha mask means opaque.
+    bmp_channel Channels[4];
+
+    u8 *Palette;
+    u32 PaletteCount;
+    u32 PaletteEntrySize;
+
+    u8 *Pixels;
+    memory_index PixelBytes;
+};
+
+internal bmp_channel
+MakeBMPChannel(u32 Mask)
+{
+    bmp_channel Result = {};
+    Result.Mask = Mask;
+    if (Mask)
+    {
+        while (!(Mask & 1))
+        {
+            Mask >>= 1;
+            ++Result.Shift;
+        }
+        while (Mask & 1)
+        {
+            Mask >>= 1;
+            ++Result.Bits;
+        }
+    }
+    return Result;
+}
+
+inline u32
+ExtractBMPChannel(u32 Value, bmp_channel *Channel)
+{
+    // NOTE: Scaled to 0..255 whatever the mask width
+    u32 Result = (Value & Channel->Mask) >> Channel->Shift;
+    if (Channel->Bits >= 8)
+    {
+        Result >>= (Channel->Bits - 8);
+    }
+    else
+    {
+        u32 Max = (1u << Channel->Bits) - 1;
+        Result = (Result*255 + Max/2) / Max;
+    }
+    return Result;
+}
+
+internal bool32
+ParseBMP(u8 *Data, u32 Size, bmp_layout *Layout)
+{
+    bool32 Result = false;
+    *Layout = {};
+    if ((Size >= 26) && (Data[0] == 'B') && (Data[1] == 'M'))
+    {
+        u32 BitmapOffset = ReadU32LE(Data + 10);
+        u32 HeaderSize = ReadU32LE(Data + 14);
+        u32 MaskBytes = 0;
+        if (HeaderSize == 12)
+        {
+            // NOTE: OS/2 core header: 16-bit dimensions, 3-byte palette entries
+            Layout->Width = ReadU16LE(Data + 18);
+            Layout->Height = (i16)ReadU16LE(Data + 20);
+            Layout->BitCount = ReadU16LE(Data + 24);
+            Layout->Compression = BMP_COMPRESSION_RGB;
+            Layout->PaletteEntrySize = 3;
+        }
+        else if ((HeaderSize >= 40) && (14 + HeaderSize <= Size))
+        {
+            Layout->Width = (i32)ReadU32LE(Data + 18);
+            Layout->Height = (i32)ReadU32LE(Data + 22);
+            Layout->BitCount = ReadU16LE(Data + 28);
+            Layout->Compression = ReadU32LE(Data + 30);
+            Layout->PaletteCount = ReadU32LE(Data + 46);
+            Layout->PaletteEntrySize = 4;
+
+            if ((Layout->Compression == BMP_COMPRESSION_BITFIELDS) ||
+                (Layout->Compression == BMP_COMPRESSION_ALPHABITFIELDS))
+            {
+                // NOTE: A plain info header has the masks straight after it;
+                // later versions have them inside
+                u32 MaskCount = (Layout->Compression == BMP_COMPRESSION_ALPHABITFIELDS) ? 4 : 3;
+                u8 *Masks = Data + 54;
+                if (HeaderSize == 40)
+                {
+                    MaskBytes = MaskCount*4;
+                }
+                else if (HeaderSize >= 56)
+                {
+                    MaskCount = 4;
+                }
+                if (54 + MaskCount*4 <= Size)
+                {
+                    for (u32 MaskIndex = 0;
+                         MaskIndex < MaskCount;
+                         ++MaskIndex)
+                    {
+                        Layout->Channels[MaskIndex] = MakeBMPChannel(ReadU32LE(Masks + MaskIndex*4));
+                    }
+                }
+            }
+        }
+
+        if (Layout->Height < 0)
+        {
+            Layout->TopDown = true;
+            Layout->Height = -Layout->Height;
+        }
+
+        if (Layout->Compression == BMP_COMPRESSION_RGB)
+        {
+            if (Layout->BitCount == 16)
+            {
+                Layout->Channels[0] = MakeBMPChannel(0x7C00);
+                Layout->Channels[1] = MakeBMPChannel(0x03E0);
+                Layout->Channels[2] = MakeBMPChannel(0x001F);
+            }
+            else if ((Layout->BitCount == 24) || (Layout->BitCount == 32))
+            {
+                Layout->Channels[0] = MakeBMPChannel(0x00FF0000);
+                Layout->Channels[1] = MakeBMPChannel(0x0000FF00);
+                Layout->Channels[2] = MakeBMPChannel(0x000000FF);
+            }
+        }
+
+        if (Layout->BitCount <= 8)
+        {
+            u32 MaxPaletteCount = 1u << Layout->BitCount;
+            if ((Layout->PaletteCount == 0) || (Layout->PaletteCount > MaxPaletteCount))
+            {
+                Layout->PaletteCount = MaxPaletteCount;
+            }
+            u32 PaletteOffset = 14 + HeaderSize + MaskBytes;
+            Layout->Palette = Data + PaletteOffset;
+            if (PaletteOffset + Layout->PaletteCount*Layout->PaletteEntrySize > Size)
+            {
+                Layout->PaletteCount = (PaletteOffset < Size) ? (Size - PaletteOffset) / Layout->PaletteEntrySize : 0;
+            }
+        }
+        else
+        {
+            Layout->PaletteCount = 0;
+        }
+
+        bool32 BitCountOk = false;
+        switch (Layout->Compression)
+        {
+            case BMP_COMPRESSION_RGB:
+            {
+                BitCountOk = ((Layout->BitCount == 1) || (Layout->BitCount == 2) || (Layout->BitCount == 4) ||
+                              (Layout->BitCount == 8) || (Layout->BitCount == 16) || (Layout->BitCount == 24) ||
+                              (Layout->BitCount == 32));
+            } break;
+
+            case BMP_COMPRESSION_RLE8:
+            {
+                BitCountOk = ((Layout->BitCount == 8) && !Layout->TopDown);
+            } break;
+
+            case BMP_COMPRESSION_RLE4:
+            {
+                BitCountOk = ((Layout->BitCount == 4) && !Layout->TopDown);
+            } break;
+
+            case BMP_COMPRESSION_BITFIELDS:
+            case BMP_COMPRESSION_ALPHABITFIELDS:
+            {
+                BitCountOk = ((Layout->BitCount == 16) || (Layout->BitCount == 32));
+            } break;
+        }
+
+        if (BitCountOk &&
+            (Layout->Width > 0) && (Layout->Width <= IMAGE_MAX_DIMENSION) &&
+            (Layout->Height > 0) && (Layout->Height <= IMAGE_MAX_DIMENSION) &&
+            (BitmapOffset < Size))
+        {
+            Layout->Pixels = Data + BitmapOffset;
+            Layout->PixelBytes = Size - BitmapOffset;
+
+            memory_index Stride = (((memory_index)Layout->Width*Layout->BitCount + 31) / 32)*4;
+            bool32 Compressed = ((Layout->Compression == BMP_COMPRESSION_RLE8) ||
+                                 (Layout->Compression == BMP_COMPRESSION_RLE4));
+            Result = (Compressed || (Stride*Layout->Height <= Layout->PixelBytes));
+        }
+    }
+
+    return Result;
+}
+
+inline u32
+GetBMPPaletteColor(bmp_layout *Layout, u32 Index)
+{
+    // NOTE: Out-of-range indices come out opaque black
+    u32 Result = 0xFF000000;
+    if (Index < Layout->PaletteCount)
+    {
+        u8 *Entry = Layout->Palette + Index*Layout->PaletteEntrySize;
+        Result = 0xFF000000 | ((u32)Entry[2] << 16) | ((u32)Entry[1] << 8) | (u32)Entry[0];
+    }
+    return Result;
+}
+
+internal void
+DecodeBMPRunLengths(bmp_layout *Layout, u32 *Pixels)
+{
+    // NOTE: RLE bitmaps are always bottom-up, same as the output. Pixels a
+    // delta or end-of-line skips over are left transparent.
+    i32 Width = Layout->Width;
+    i32 Height = Layout->Height;
+    for (i32 Index = 0;
+         Index < Width*Height;
+         ++Index)
+    {
+        Pixels[Index] = 0;
+    }
+
+    bool32 FourBit = (Layout->Compression == BMP_COMPRESSION_RLE4);
+    u8 *At = Layout->Pixels;
+    u8 *End = Layout->Pixels + Layout->PixelBytes;
+    i32 X = 0;
+    i32 Y = 0;
+    while ((At + 2 <= End) && (Y < Height))
+    {
+        u32 Count = *At++;
+        u32 Value = *At++;
+        if (Count)
+        {
+            // NOTE: Encoded run; RLE4 alternates the two nibbles
+            for (u32 RunIndex = 0;
+                 RunIndex < Count;
+                 ++RunIndex)
+            {
+                u32 Index = FourBit ? ((RunIndex & 1) ? (Value & 0xF) : (Value >> 4)) : Value;
+                if (X < Width)
+                {
+                    Pixels[Y*Width + X] = GetBMPPaletteColor(Layout, Index);
+                }
+                ++X;
+            }
+        }
+        else if (Value == 0)
+        {
+            X = 0;
+            ++Y;
+        }
+        else if (Value == 1)
+        {
+            break;
+        }
+        else if (Value == 2)
+        {
+            if (At + 2 > End)
+            {
+                break;
+            }
+            X += *At++;
+            Y += *At++;
+        }
+        else
+        {
+            // NOTE: Absolute run of Value indices, padded to a 16-bit boundary
+            u32 Bytes = FourBit ? (Value + 1)/2 : Value;
+            if (At + Bytes > End)
+            {
+                break;
+            }
+            for (u32 RunIndex = 0;
+                 RunIndex < Value;
+                 ++RunIndex)
+            {
+                u32 Index = FourBit ? ((RunIndex & 1) ? (At[RunIndex/2] & 0xF) : (At[RunIndex/2] >> 4)) : At[RunIndex];
+                if (X < Width)
+                {
+                    Pixels[Y*Width + X] = GetBMPPaletteColor(Layout, Index);
+                }
+                ++X;
+            }
+            At += (Bytes + 1) & ~1u;
+        }
+    }
+}
+
+internal void
+DecodeBMP(bmp_layout *Layout, u32 *Pixels)
+{
+    i32 Width = Layout->Width;
+    i32 Height = Layout->Height;
+    if ((Layout->Compression == BMP_COMPRESSION_RLE8) || (Layout->Compression == BMP_COMPRESSION_RLE4))
+    {
+        DecodeBMPRunLengths(Layout, Pixels);
+        return;
+    }
+
+    memory_index Stride = (((memory_index)Width*Layout->BitCount + 31) / 32)*4;
+    bool32 HasAlpha = (Layout->Channels[3].Mask != 0);
+    for (i32 Row = 0;
+         Row < Height;
+         ++Row)
+    {
+        u8 *Source = Layout->Pixels + Row*Stride;
+        i32 DestRow = Layout->TopDown ? (Height - 1 - Row) : Row;
+        u32 *Dest = Pixels + DestRow*Width;
+        for (i32 X = 0;
+             X < Width;
+             ++X)
+        {
+            u32 Color;
+            if (Layout->BitCount <= 8)
+            {
+                u32 Bits = Layout->BitCount;
+                u32 BitOffset = (u32)X*Bits;
+                u32 Index = (Source[BitOffset >> 3] >> (8 - Bits - (BitOffset & 7))) & ((1u << Bits) - 1);
+                Color = GetBMPPaletteColor(Layout, Index);
+            }
+            else
+            {
+                u32 Value;
+                if (Layout->BitCount == 16)
+                {
+                    Value = ReadU16LE(Source + X*2);
+                }
+                else if (Layout->BitCount == 24)
+                {
+                    Value = (u32)Source[X*3] | ((u32)Source[X*3 + 1] << 8) | ((u32)Source[X*3 + 2] << 16);
+                }
+                else
+                {
+                    Value = ReadU32LE(Source + X*4);
+                }
+                u32 Alpha = HasAlpha ? ExtractBMPChannel(Value, &Layout->Channels[3]) : 0xFF;
+                Color = ((Alpha << 24) |
+                         (ExtractBMPChannel(Value, &Layout->Channels[0]) << 16) |
+                         (ExtractBMPChannel(Value, &Layout->Channels[1]) << 8) |
+                         ExtractBMPChannel(Value, &Layout->Channels[2]));
+            }
+            Dest[X] = Color;
+        }
+    }
+}
+
+//
+// NOTE: Inflate (RFC 1951), for PNG's zlib stream
+//
+
+#define INFLATE_FAST_BITS 10
+// NOTE: Zero bytes fed in past the end of the input before it counts as truncated
+#define INFLATE_MAX_OVERRUN 8
+
+struct inflate_huffman
+{
+    // NOTE: (Length << 9) | Symbol for codes of up to INFLATE_FAST_BITS,
+    // indexed by the next bits of input; zero means the code is longer
+    u16 Fast[1 << INFLATE_FAST_BITS];
+    u16 Count[16];
+    u16 Symbol[288];
+};
+
+struct inflate_stream
+{
+    u8 *In;
+    u8 *InEnd;
+    u32 Overrun;
+    u64 BitBuffer;
+    u32 BitCount;
+
+    u8 *OutStart;
+    u8 *Out;
+    u8 *OutEnd;
+};
+
+global_variable u16 InflateLengthBase[29] =
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+global_variable u8 InflateLengthExtra[29] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+global_variable u16 InflateDistanceBase[30] =
+{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+global_variable u8 InflateDistanceExtra[30] =
+{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+inline void
+InflateRefill(inflate_stream *Stream)
+{
+    while (Stream->BitCount <= 56)
+    {
+        u64 Byte = 0;
+        if (Stream->In < Stream->InEnd)
+        {
+            Byte = *Stream->In++;
+        }
+        else
+        {
+            ++Stream->Overrun;
+        }
+        Stream->BitBuffer |= Byte << Stream->BitCount;
+        Stream->BitCount += 8;
+    }
+}
+
+inline u32
+InflateBits(inflate_stream *Stream, u32 Count)
+{
+    if (Stream->BitCount < Count)
+    {
+        InflateRefill(Stream);
+    }
+    u32 Result = (u32)(Stream->BitBuffer & ((1ull << Count) - 1));
+    Stream->BitBuffer >>= Count;
+    Stream->BitCount -= Count;
+    return Result;
+}
+
+internal bool32
+BuildInflateHuffman(inflate_huffman *Huffman, u8 *Lengths, u32 SymbolCount)
+{
+    // NOTE: Canonical codes from code lengths. Incomplete codes are allowed
+    // (a distance code with one symbol is legal); over-subscribed ones aren't.
+    for (u32 Length = 0;
+         Length < 16;
+         ++Length)
+    {
+        Huffman->Count[Length] = 0;
+    }
+    for (u32 SymbolIndex = 0;
+         SymbolIndex < SymbolCount;
+         ++SymbolIndex)
+    {
+        ++Huffman->Count[Lengths[SymbolIndex]];
+    }
+    Huffman->Count[0] = 0;
+
+    i32 Left = 1;
+    for (u32 Length = 1;
+         Length < 16;
+         ++Length)
+    {
+        Left <<= 1;
+        Left -= Huffman->Count[Length];
+        if (Left < 0)
+        {
+            return false;
+        }
+    }
+
+    u16 Offsets[16];
+    Offsets[1] = 0;
+    for (u32 Length = 1;
+         Length < 15;
+         ++Length)
+    {
+        Offsets[Length + 1] = Offsets[Length] + Huffman->Count[Length];
+    }
+    for (u32 SymbolIndex = 0;
+         SymbolIndex < SymbolCount;
+         ++SymbolIndex)
+    {
+        if (Lengths[SymbolIndex])
+        {
+            Huffman->Symbol[Offsets[Lengths[SymbolIndex]]++] = (u16)SymbolIndex;
+        }
+    }
+
+    for (u32 FastIndex = 0;
+         FastIndex < (1 << INFLATE_FAST_BITS);
+         ++FastIndex)
+    {
+        Huffman->Fast[FastIndex] = 0;
+    }
+
+    // NOTE: Codes are packed most significant bit first, so the table is
+    // indexed by the code bit-reversed
+    u32 Code = 0;
+    u32 SymbolIndex = 0;
+    for (u32 Length = 1;
+         Length <= INFLATE_FAST_BITS;
+         ++Length)
+    {
+        for (u32 CountIndex = 0;
+             CountIndex < Huffman->Count[Length];
+             ++CountIndex)
+        {
+            u32 Reversed = 0;
+            for (u32 Bit = 0;
+                 Bit < Length;
+                 ++Bit)
+            {
+                Reversed |= ((Code >> Bit) & 1) << (Length - 1 - Bit);
+            }
+            for (u32 FastIndex = Reversed;
+                 FastIndex < (1 << INFLATE_FAST_BITS);
+                 FastIndex += (1 << Length))
+            {
+                Huffman->Fast[FastIndex] = (u16)((Length << 9) | Huffman->Symbol[SymbolIndex]);
+            }
+            ++Code;
+            ++SymbolIndex;
+        }
+        Code <<= 1;
+    }
+
+    return true;
+}
+
+inline i32
+InflateDecode(inflate_stream *Stream, inflate_huffman *Huffman)
+{
+    // NOTE: Returns -1 for a code that isn't in the table
+    if (Stream->BitCount < 16)
+    {
+        InflateRefill(Stream);
+    }
+    u32 Entry = Huffman->Fast[Stream->BitBuffer & ((1 << INFLATE_FAST_BITS) - 1)];
+    if (Entry)
+    {
+        u32 Length = Entry >> 9;
+        Stream->BitBuffer >>= Length;
+        Stream->BitCount -= Length;
+        return (i32)(Entry & 0x1FF);
+    }
+
+    i32 Code = 0;
+    i32 First = 0;
+    i32 Index = 0;
+    for (u32 Length = 1;
+         Length < 16;
+         ++Length)
+    {
+        Code |= (i32)InflateBits(Stream, 1);
+        i32 Count = Huffman->Count[Length];
+        if (Code - First < Count)
+        {
+            return Huffman->Symbol[Index + (Code - First)];
+        }
+        Index += Count;
+        First += Count;
+        First <<= 1;
+        Code <<= 1;
+    }
+    return -1;
+}
+
+internal bool32
+InflateCodes(inflate_stream *Stream, inflate_huffman *Literals, inflate_huffman *Distances)
+{
+    for (;;)
+    {
+        i32 Symbol = InflateDecode(Stream, Literals);
+        if ((Symbol < 0) || (Stream->Overrun > INFLATE_MAX_OVERRUN))
+        {
+            return false;
+        }
+
+        if (Symbol < 256)
+        {
+            if (Stream->Out >= Stream->OutEnd)
+            {
+                return false;
+            }
+            *Stream->Out++ = (u8)Symbol;
+        }
+        else if (Symbol == 256)
+        {
+            return true;
+        }
+        else
+        {
+            Symbol -= 257;
+            if (Symbol >= 29)
+            {
+                return false;
+            }
+            u32 Length = InflateLengthBase[Symbol] + InflateBits(Stream, InflateLengthExtra[Symbol]);
+
+            i32 DistanceSymbol = InflateDecode(Stream, Distances);
+            if ((DistanceSymbol < 0) || (DistanceSymbol >= 30))
+            {
+                return false;
+            }
+            u32 Distance = InflateDistanceBase[DistanceSymbol] + InflateBits(Stream, InflateDistanceExtra[DistanceSymbol]);
+            if ((Distance > (u32)(Stream->Out - Stream->OutStart)) ||
+                (Length > (u32)(Stream->OutEnd - Stream->Out)))
+            {
+                return false;
+            }
+
+            // NOTE: Byte at a time, since the copy may overlap itself
+            u8 *Source = Stream->Out - Distance;
+            for (u32 Index = 0;
+                 Index < Length;
+                 ++Index)
+            {
+                Stream->Out[Index] = Source[Index];
+            }
+            Stream->Out += Length;
+        }
+    }
+}
+
+internal bool32
+Inflate(u8 *In, memory_index InSize, u8 *Out, memory_index OutSize)
+{
+    // NOTE: Raw deflate data in, exactly OutSize bytes out
+    inflate_stream Stream = {};
+    Stream.In = In;
+    Stream.InEnd = In + InSize;
+    Stream.OutStart = Out;
+    Stream.Out = Out;
+    Stream.OutEnd = Out + OutSize;
+
+    inflate_huffman Literals;
+    inflate_huffman Distances;
+    bool32 Final = false;
+    while (!Final)
+    {
+        Final = InflateBits(&Stream, 1);
+        u32 Type = InflateBits(&Stream, 2);
+        if (Type == 0)
+        {
+            // NOTE: Stored block, from the next byte boundary
+            InflateBits(&Stream, Stream.BitCount & 7);
+            u32 Length = InflateBits(&Stream, 16);
+            u32 NotLength = InflateBits(&Stream, 16);
+            if (((Length ^ 0xFFFF) != NotLength) || (Length > (u32)(Stream.OutEnd - Stream.Out)))
+            {
+                return false;
+            }
+            for (u32 Index = 0;
+                 Index < Length;
+                 ++Index)
+            {
+                *Stream.Out++ = (u8)InflateBits(&Stream, 8);
+            }
+        }
+        else if (Type == 1)
+        {
+            u8 Lengths[288 + 30];
+            for (u32 Index = 0; Index < 144; ++Index) Lengths[Index] = 8;
+            for (u32 Index = 144; Index < 256; ++Index) Lengths[Index] = 9;
+            for (u32 Index = 256; Index < 280; ++Index) Lengths[Index] = 7;
+            for (u32 Index = 280; Index < 288; ++Index) Lengths[Index] = 8;
+            for (u32 Index = 288; Index < 288 + 30; ++Index) Lengths[Index] = 5;
+            BuildInflateHuffman(&Literals, Lengths, 288);
+            BuildInflateHuffman(&Distances, Lengths + 288, 30);
+            if (!InflateCodes(&Stream, &Literals, &Distances))
+            {
+                return false;
+            }
+        }
+        else if (Type == 2)
+        {
+            u32 LiteralCount = InflateBits(&Stream, 5) + 257;
+            u32 DistanceCount = InflateBits(&Stream, 5) + 1;
+            u32 CodeLengthCount = InflateBits(&Stream, 4) + 4;
+            if ((LiteralCount > 286) || (DistanceCount > 30))
+            {
+                return false;
+            }
+
+            local_persist u8 CodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+            u8 CodeLengthLengths[19] = {};
+            for (u32 Index = 0;
+                 Index < CodeLengthCount;
+                 ++Index)
+            {
+                CodeLengthLengths[CodeLengthOrder[Index]] = (u8)InflateBits(&Stream, 3);
+            }
+            inflate_huffman CodeLengths;
+            if (!BuildInflateHuffman(&CodeLengths, CodeLengthLengths, 19))
+            {
+                return false;
+            }
+
+            u8 Lengths[286 + 30];
+            u32 LengthCount = 0;
+            while (LengthCount < LiteralCount + DistanceCount)
+            {
+                i32 Symbol = InflateDecode(&Stream, &CodeLengths);
+                if ((Symbol < 0) || (Stream.Overrun > INFLATE_MAX_OVERRUN))
+                {
+                    return false;
+                }
+
+                if (Symbol < 16)
+                {
+                    Lengths[LengthCount++] = (u8)Symbol;
+                }
+                else
+                {
+                    u8 Repeated = 0;
+                    u32 RepeatCount;
+                    if (Symbol == 16)
+                    {
+                        if (LengthCount == 0)
+                        {
+                            return false;
+                        }
+                        Repeated = Lengths[LengthCount - 1];
+                        RepeatCount = 3 + InflateBits(&Stream, 2);
+                    }
+                    else if (Symbol == 17)
+                    {
+                        RepeatCount = 3 + InflateBits(&Stream, 3);
+                    }
+                    else
+                    {
+                        RepeatCount = 11 + InflateBits(&Stream, 7);
+                    }
+                    if (LengthCount + RepeatCount > LiteralCount + DistanceCount)
+                    {
+                        return false;
+                    }
+                    while (RepeatCount--)
+                    {
+                        Lengths[LengthCount++] = Repeated;
+                    }
+                }
+            }
+
+            // NOTE: A block with no end-of-block code could never finish
+            if ((Lengths[256] == 0) ||
+                !BuildInflateHuffman(&Literals, Lengths, LiteralCount) ||
+                !BuildInflateHuffman(&Distances, Lengths + LiteralCount, DistanceCount) ||
+                !InflateCodes(&Stream, &Literals, &Distances))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+
+        if (Stream.Overrun > INFLATE_MAX_OVERRUN)
+        {
+            return false;
+        }
+    }
+
+    bool32 Result = (Stream.Out == Stream.OutEnd);
+    return Result;
+}
+
+//
+// NOTE: PNG
+//
+
+#define PNG_COLOR_GRAY 0
+#define PNG_COLOR_RGB 2
+#define PNG_COLOR_PALETTE 3
+#define PNG_COLOR_GRAY_ALPHA 4
+#define PNG_COLOR_RGBA 6
+
+struct png_layout
+{
+    i32 Width;
+    i32 Height;
+    u32 BitDepth;
+    u32 ColorType;
+    u32 Channels;
+    bool32 Interlaced;
+
+    memory_index CompressedSize;
+    memory_index RawSize;
+
+    // NOTE: Filled in by DecodePNG from PLTE and tRNS
+    u32 Palette[256];
+    u32 PaletteCount;
+    bool32 HasTransparentColor;
+    u32 TransparentColor[3];
+};
+
+global_variable u8 PNGSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+global_variable i32 Adam7StartX[7] = {0, 4, 0, 2, 0, 1, 0};
+global_variable i32 Adam7StartY[7] = {0, 0, 4, 0, 2, 0, 1};
+global_variable i32 Adam7StepX[7] = {8, 8, 4, 4, 2, 2, 1};
+global_variable i32 Adam7StepY[7] = {8, 8, 8, 4, 4, 2, 2};
+
+inline memory_index
+GetPNGRowBytes(png_layout *Layout, i32 Width)
+{
+    memory_index Result = ((memory_index)Width*Layout->Channels*Layout->BitDepth + 7) / 8;
+    return Result;
+}
+
+inline bool32
+GetPNGPass(png_layout *Layout, u32 Pass, i32 *StartX, i32 *StartY, i32 *StepX, i32 *StepY,
+           i32 *PassWidth, i32 *PassHeight)
+{
+    // NOTE: A non-interlaced image is one pass covering everything. Returns
+    // false for an Adam7 pass that has no pixels in an image this small.
+    if (Layout->Interlaced)
+    {
+        *StartX = Adam7StartX[Pass];
+        *StartY = Adam7StartY[Pass];
+        *StepX = Adam7StepX[Pass];
+        *StepY = Adam7StepY[Pass];
+    }
+    else
+    {
+        *StartX = 0;
+        *StartY = 0;
+        *StepX = 1;
+        *StepY = 1;
+    }
+    *PassWidth = (Layout->Width > *StartX) ? (Layout->Width - *StartX + *StepX - 1) / *StepX : 0;
+    *PassHeight = (Layout->Height > *StartY) ? (Layout->Height - *StartY + *StepY - 1) / *StepY : 0;
+    bool32 Result = ((*PassWidth > 0) && (*PassHeight > 0));
+    return Result;
+}
+
+internal bool32
+ParsePNG(u8 *Data, u32 Size, png_layout *Layout)
+{
+    // NOTE: Header and chunk sizes only. Chunk CRCs and the zlib checksum
+    // aren't checked; a corrupt stream still fails to inflate to the size the
+    // header promises.
+    bool32 Result = false;
+    *Layout = {};
+    if ((Size >= 8 + 25) && (memcmp(Data, PNGSignature, 8) == 0) &&
+        (ReadU32BE(Data + 8) == 13) && (memcmp(Data + 12, "IHDR", 4) == 0))
+    {
+        u8 *Header = Data + 16;
+        Layout->Width = (i32)ReadU32BE(Header);
+        Layout->Height = (i32)ReadU32BE(Header + 4);
+        Layout->BitDepth = Header[8];
+        Layout->ColorType = Header[9];
+        Layout->Interlaced = (Header[12] == 1);
+
+        bool32 DepthOk = false;
+        switch (Layout->ColorType)
+        {
+            case PNG_COLOR_GRAY:
+            {
+                Layout->Channels = 1;
+                DepthOk = ((Layout->BitDepth == 1) || (Layout->BitDepth == 2) || (Layout->BitDepth == 4) ||
+                           (Layout->BitDepth == 8) || (Layout->BitDepth == 16));
+            } break;
+
+            case PNG_COLOR_PALETTE:
+            {
+                Layout->Channels = 1;
+                DepthOk = ((Layout->BitDepth == 1) || (Layout->BitDepth == 2) || (Layout->BitDepth == 4) ||
+                           (Layout->BitDepth == 8));
+            } break;
+
+            case PNG_COLOR_RGB:
+            case PNG_COLOR_GRAY_ALPHA:
+            case PNG_COLOR_RGBA:
+            {
+                Layout->Channels = ((Layout->ColorType == PNG_COLOR_RGB) ? 3 :
+                                    (Layout->ColorType == PNG_COLOR_GRAY_ALPHA) ? 2 : 4);
+                DepthOk = ((Layout->BitDepth == 8) || (Layout->BitDepth == 16));
+            } break;
+        }
+
+        if (DepthOk && (Header[10] == 0) && (Header[11] == 0) && (Header[12] <= 1) &&
+            (Layout->Width > 0) && (Layout->Width <= IMAGE_MAX_DIMENSION) &&
+            (Layout->Height > 0) && (Layout->Height <= IMAGE_MAX_DIMENSION))
+        {
+            u32 At = 8;
+            while (At + 12 <= Size)
+            {
+                u32 Length = ReadU32BE(Data + At);
+                u8 *Type = Data + At + 4;
+                if (Length > Size - At - 12)
+                {
+                    break;
+                }
+                if (memcmp(Type, "IDAT", 4) == 0)
+                {
+                    Layout->CompressedSize += Length;
+                }
+                else if (memcmp(Type, "IEND", 4) == 0)
+                {
+                    break;
+                }
+                At += 12 + Length;
+            }
+
+            for (u32 Pass = 0;
+                 Pass < (Layout->Interlaced ? 7u : 1u);
+                 ++Pass)
+            {
+                i32 StartX, StartY, StepX, StepY, PassWidth, PassHeight;
+                if (GetPNGPass(Layout, Pass, &StartX, &StartY, &StepX, &StepY, &PassWidth, &PassHeight))
+                {
+                    Layout->RawSize += (memory_index)PassHeight*(1 + GetPNGRowBytes(Layout, PassWidth));
+                }
+            }
+
+            Result = (Layout->CompressedSize > 2);
+        }
+    }
+
+    return Result;
+}
+
+inline u32
+GetPNGSample(u8 *Row, u32 Index, u32 BitDepth)
+{
+    // NOTE: The whole sample, 16 bits included
+    u32 Result;
+    if (BitDepth == 16)
+    {
+        Result = ((u32)Row[Index*2] << 8) | Row[Index*2 + 1];
+    }
+    else if (BitDepth == 8)
+    {
+        Result = Row[Index];
+    }
+    else
+    {
+        u32 BitOffset = Index*BitDepth;
+        Result = (Row[BitOffset >> 3] >> (8 - BitDepth - (BitOffset & 7))) & ((1u << BitDepth) - 1);
+    }
+    return Result;
+}
+
+inline u32
+ScalePNGSample(u32 Sample, u32 BitDepth)
+{
+    // NOTE: To 0..255
+    u32 Result;
+    switch (BitDepth)
+    {
+        case 1: Result = Sample*255; break;
+        case 2: Result = Sample*85; break;
+        case 4: Result = Sample*17; break;
+        case 16: Result = Sample >> 8; break;
+        default: Result = Sample; break;
+    }
+    return Result;
+}
+
+internal u32
+GetPNGPixel(png_layout *Layout, u8 *Row, u32 X)
+{
+    u32 Depth = Layout->BitDepth;
+    u32 Result = 0;
+    switch (Layout->ColorType)
+    {
+        case PNG_COLOR_GRAY:
+        {
+            u32 Sample = GetPNGSample(Row, X, Depth);
+            u32 Gray = ScalePNGSample(Sample, Depth);
+            u32 Alpha = (Layout->HasTransparentColor && (Sample == Layout->TransparentColor[0])) ? 0 : 0xFF;
+            Result = (Alpha << 24) | (Gray << 16) | (Gray << 8) | Gray;
+        } break;
+
+        case PNG_COLOR_RGB:
+        {
+            u32 Red = GetPNGSample(Row, X*3, Depth);
+            u32 Green = GetPNGSample(Row, X*3 + 1, Depth);
+            u32 Blue = GetPNGSample(Row, X*3 + 2, Depth);
+            u32 Alpha = (Layout->HasTransparentColor &&
+                         (Red == Layout->TransparentColor[0]) &&
+                         (Green == Layout->TransparentColor[1]) &&
+                         (Blue == Layout->TransparentColor[2])) ? 0 : 0xFF;
+            Result = ((Alpha << 24) | (ScalePNGSample(Red, Depth) << 16) |
+                      (ScalePNGSample(Green, Depth) << 8) | ScalePNGSample(Blue, Depth));
+        } break;
+
+        case PNG_COLOR_PALETTE:
+        {
+            // NOTE: Out-of-range indices come out opaque black
+            u32 Index = GetPNGSample(Row, X, Depth);
+            Result = (Index < Layout->PaletteCount) ? Layout->Palette[Index] : 0xFF000000;
+        } break;
+
+        case PNG_COLOR_GRAY_ALPHA:
+        {
+            u32 Gray = ScalePNGSample(GetPNGSample(Row, X*2, Depth), Depth);
+            u32 Alpha = ScalePNGSample(GetPNGSample(Row, X*2 + 1, Depth), Depth);
+            Result = (Alpha << 24) | (Gray << 16) | (Gray << 8) | Gray;
+        } break;
+
+        case PNG_COLOR_RGBA:
+        {
+            Result = ((ScalePNGSample(GetPNGSample(Row, X*4 + 3, Depth), Depth) << 24) |
+                      (ScalePNGSample(GetPNGSample(Row, X*4, Depth), Depth) << 16) |
+                      (ScalePNGSample(GetPNGSample(Row, X*4 + 1, Depth), Depth) << 8) |
+                      ScalePNGSample(GetPNGSample(Row, X*4 + 2, Depth), Depth));
+        } break;
+    }
+    return Result;
+}
+
+inline u8
+PaethPredictor(u8 Left, u8 Up, u8 UpLeft)
+{
+    i32 Estimate = (i32)Left + (i32)Up - (i32)UpLeft;
+    i32 DistanceLeft = AbsoluteI32(Estimate - (i32)Left);
+    i32 DistanceUp = AbsoluteI32(Estimate - (i32)Up);
+    i32 DistanceUpLeft = AbsoluteI32(Estimate - (i32)UpLeft);
+    u8 Result = UpLeft;
+    if ((DistanceLeft <= DistanceUp) && (DistanceLeft <= DistanceUpLeft))
+    {
+        Result = Left;
+    }
+    else if (DistanceUp <= DistanceUpLeft)
+    {
+        Result = Up;
+    }
+    return Result;
+}
+
+internal bool32
+UnfilterPNGRow(u8 *Row, u8 *PriorRow, memory_index RowBytes, u32 FilterBytes)
+{
+    // NOTE: Row starts with its filter type byte; PriorRow is null for the
+    // first row of a pass. Unfilters in place.
+    u32 Filter = Row[0];
+    u8 *Bytes = Row + 1;
+    u8 *Prior = PriorRow ? PriorRow + 1 : 0;
+    for (memory_index Index = 0;
+         Index < RowBytes;
+         ++Index)
+    {
+        u8 Left = (Index >= FilterBytes) ? Bytes[Index - FilterBytes] : 0;
+        u8 Up = Prior ? Prior[Index] : 0;
+        u8 UpLeft = (Prior && (Index >= FilterBytes)) ? Prior[Index - FilterBytes] : 0;
+        switch (Filter)
+        {
+            case 0: break;
+            case 1: Bytes[Index] += Left; break;
+            case 2: Bytes[Index] += Up; break;
+            case 3: Bytes[Index] += (u8)(((u32)Left + (u32)Up) >> 1); break;
+            case 4: Bytes[Index] += PaethPredictor(Left, Up, UpLeft); break;
+            default: return false;
+        }
+    }
+    return true;
+}
+
+internal bool32
+DecodePNG(png_layout *Layout, u8 *Data, u32 Size, u32 *Pixels, u8 *Scratch)
+{
+    // NOTE: Scratch is CompressedSize bytes for the joined IDAT chunks,
+    // then RawSize for the inflated, filtered scanlines
+    u8 *Compressed = Scratch;
+    u8 *Raw = Scratch + Layout->CompressedSize;
+    memory_index CompressedUsed = 0;
+    u8 PaletteAlpha[256];
+    u32 PaletteAlphaCount = 0;
+
+    u32 At = 8;
+    while (At + 12 <= Size)
+    {
+        u32 Length = ReadU32BE(Data + At);
+        u8 *Type = Data + At + 4;
+        u8 *Chunk = Data + At + 8;
+        if (Length > Size - At - 12)
+        {
+            break;
+        }
+
+        if (memcmp(Type, "IDAT", 4) == 0)
+        {
+            memcpy(Compressed + CompressedUsed, Chunk, Length);
+            CompressedUsed += Length;
+        }
+        else if (memcmp(Type, "PLTE", 4) == 0)
+        {
+            Layout->PaletteCount = Length / 3;
+            if (Layout->PaletteCount > 256)
+            {
+                Layout->PaletteCount = 256;
+            }
+            for (u32 Index = 0;
+                 Index < Layout->PaletteCount;
+                 ++Index)
+            {
+                Layout->Palette[Index] = (0xFF000000 | ((u32)Chunk[Index*3] << 16) |
+                                          ((u32)Chunk[Index*3 + 1] << 8) | (u32)Chunk[Index*3 + 2]);
+            }
+        }
+        else if (memcmp(Type, "tRNS", 4) == 0)
+        {
+            if (Layout->ColorType == PNG_COLOR_PALETTE)
+            {
+                PaletteAlphaCount = (Length < 256) ? Length : 256;
+                memcpy(PaletteAlpha, Chunk, PaletteAlphaCount);
+            }
+            else if ((Layout->ColorType == PNG_COLOR_GRAY) && (Length >= 2))
+            {
+                Layout->HasTransparentColor = true;
+                Layout->TransparentColor[0] = ((u32)Chunk[0] << 8) | Chunk[1];
+            }
+            else if ((Layout->ColorType == PNG_COLOR_RGB) && (Length >= 6))
+            {
+                Layout->HasTransparentColor = true;
+                for (u32 Index = 0;
+                     Index < 3;
+                     ++Index)
+                {
+                    Layout->TransparentColor[Index] = ((u32)Chunk[Index*2] << 8) | Chunk[Index*2 + 1];
+                }
+            }
+        }
+        else if (memcmp(Type, "IEND", 4) == 0)
+        {
+            break;
+        }
+        At += 12 + Length;
+    }
+
+    for (u32 Index = 0;
+         Index < PaletteAlphaCount;
+         ++Index)
+    {
+        Layout->Palette[Index] = (Layout->Palette[Index] & 0x00FFFFFF) | ((u32)PaletteAlpha[Index] << 24);
+    }
+    if ((Layout->ColorType == PNG_COLOR_PALETTE) && (Layout->PaletteCount == 0))
+    {
+        return false;
+    }
+
+    // NOTE: Two bytes of zlib header: deflate, no preset dictionary
+    u32 Method = Compressed[0];
+    u32 Flags = Compressed[1];
+    if (((Method & 0xF) != 8) || (((Method << 8) | Flags) % 31) || (Flags & 0x20) ||
+        !Inflate(Compressed + 2, CompressedUsed - 2, Raw, Layout->RawSize))
+    {
+        return false;
+    }
+
+    u32 FilterBytes = (Layout->Channels*Layout->BitDepth + 7) / 8;
+    u8 *PassRaw = Raw;
+    for (u32 Pass = 0;
+         Pass < (Layout->Interlaced ? 7u : 1u);
+         ++Pass)
+    {
+        i32 StartX, StartY, StepX, StepY, PassWidth, PassHeight;
+        if (!GetPNGPass(Layout, Pass, &StartX, &StartY, &StepX, &StepY, &PassWidth, &PassHeight))
+        {
+            continue;
+        }
+
+        memory_index RowBytes = GetPNGRowBytes(Layout, PassWidth);
+        u8 *PriorRow = 0;
+        for (i32 PassY = 0;
+             PassY < PassHeight;
+             ++PassY)
+        {
+            u8 *Row = PassRaw + PassY*(1 + RowBytes);
+            if (!UnfilterPNGRow(Row, PriorRow, RowBytes, FilterBytes))
+            {
+                return false;
+            }
+
+            // NOTE: PNG rows are top-down, texture rows bottom-up
+            i32 Y = StartY + PassY*StepY;
+            u32 *Dest = Pixels + (Layout->Height - 1 - Y)*Layout->Width;
+            for (i32 PassX = 0;
+                 PassX < PassWidth;
+                 ++PassX)
+            {
+                Dest[StartX + PassX*StepX] = GetPNGPixel(Layout, Row + 1, (u32)PassX);
+            }
+            PriorRow = Row;
+        }
+        PassRaw += PassHeight*(1 + RowBytes);
+    }
+
+    return true;
+}
+
+//
+// NOTE: Either format
+//
+
+internal image_info
+InspectImage(u8 *Data, u32 Size)
+{
+    // NOTE: Format Unknown if the headers don't parse
+    image_info Result = {};
+    bmp_layout BMP;
+    png_layout PNG;
+    if (ParseBMP(Data, Size, &BMP))
+    {
+        Result.Format = ImageFormat_BMP;
+        Result.Width = BMP.Width;
+        Result.Height = BMP.Height;
+    }
+    else if (ParsePNG(Data, Size, &PNG))
+    {
+        Result.Format = ImageFormat_PNG;
+        Result.Width = PNG.Width;
+        Result.Height = PNG.Height;
+        Result.ScratchSize = PNG.CompressedSize + PNG.RawSize;
+    }
+    return Result;
+}
+
+internal bool32
+DecodeImage(image_info *Info, u8 *Data, u32 Size, u32 *Pixels, u8 *Scratch)
+{
+    // NOTE: Pixels is Width*Height, Scratch is Info->ScratchSize
+    bool32 Result = false;
+    if (Info->Format == ImageFormat_BMP)
+    {
+        bmp_layout BMP;
+        if (ParseBMP(Data, Size, &BMP))
+        {
+            DecodeBMP(&BMP, Pixels);
+            Result = true;
+        }
+    }
+    else if (Info->Format == ImageFormat_PNG)
+    {
+        png_layout PNG;
+        if (ParsePNG(Data, Size, &PNG))
+        {
+            Result = DecodePNG(&PNG, Data, Size, Pixels, Scratch);
+        }
+    }
+    return Result;
+}
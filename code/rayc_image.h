@@ -0,0 +1,30 @@
+// NOTE: Image decoding for textures. BMP (1/2/4/8-bit palettized, RLE4 and
+// RLE8, 16/24/32-bit with or without bitfield masks, either row order) and
+// PNG (every colour type and bit depth, tRNS, Adam7). Everything decodes to
+// the engine's texture layout: 32-bit 0xAARRGGBB, rows bottom-up like a BMP,
+// Pitch = Width*4.
+//
+// Decoding is split in two so a batch can be spread over worker threads
+// without any of them allocating: InspectImage reads just the headers and
+// says how big the output and scratch are, the caller hands out the memory,
+// and DecodeImage fills it in.
+
+// NOTE: Anything bigger is taken to be a corrupt header
+#define IMAGE_MAX_DIMENSION 16384
+
+enum image_format
+{
+    ImageFormat_Unknown,
+    ImageFormat_BMP,
+    ImageFormat_PNG,
+};
+
+struct image_info
+{
+    image_format Format;
+    i32 Width;
+    i32 Height;
+
+    // NOTE: Bytes of scratch DecodeImage needs on top of the output pixels
+    memory_index ScratchSize;
+};
@@ -0,0 +1,94 @@
+// NOTE: Compiler-specific atomics and CPU hints. On x86 plain aligned loads and
+// stores are already acquire/release at the hardware level; these only have to
+// stop the compiler from reordering around them.
+
+#if defined(_MSC_VER)
+
+#include <intrin.h>
+
+inline u32
+AtomicLoadU32(u32 volatile *Value)
+{
+    u32 Result = *Value;
+    _ReadWriteBarrier();
+    return Result;
+}
+
+inline void
+AtomicStoreU32(u32 volatile *Dest, u32 Value)
+{
+    _ReadWriteBarrier();
+    *Dest = Value;
+}
+
+inline u32
+AtomicExchangeU32(u32 volatile *Dest, u32 Value)
+{
+    u32 Result = (u32)_InterlockedExchange((long volatile *)Dest, (long)Value);
+    return Result;
+}
+
+inline u32
+AtomicAddU32(u32 volatile *Dest, u32 Addend)
+{
+    // NOTE: Returns the value before the add
+    u32 Result = (u32)_InterlockedExchangeAdd((long volatile *)Dest, (long)Addend);
+    return Result;
+}
+
+inline u32
+AtomicCompareExchangeU32(u32 volatile *Dest, u32 Value, u32 Expected)
+{
+    // NOTE: Returns the value before; the exchange happened if that's Expected
+    u32 Result = (u32)_InterlockedCompareExchange((long volatile *)Dest, (long)Value, (long)Expected);
+    return Result;
+}
+
+#else
+
+#include <x86intrin.h>
+
+inline u32
+AtomicLoadU32(u32 volatile *Value)
+{
+    u32 Result = __atomic_load_n(Value, __ATOMIC_ACQUIRE);
+    return Result;
+}
+
+inline void
+AtomicStoreU32(u32 volatile *Dest, u32 Value)
+{
+    __atomic_store_n(Dest, Value, __ATOMIC_RELEASE);
+}
+
+inline u32
+AtomicExchangeU32(u32 volatile *Dest, u32 Value)
+{
+    u32 Result = __atomic_exchange_n(Dest, Value, __ATOMIC_ACQ_REL);
+    return Result;
+}
+
+inline u32
+AtomicAddU32(u32 volatile *Dest, u32 Addend)
+{
+    // NOTE: Returns the value before the add
+    u32 Result = __atomic_fetch_add(Dest, Addend, __ATOMIC_ACQ_REL);
+    return Result;
+}
+
+inline u32
+AtomicCompareExchangeU32(u32 volatile *Dest, u32 Value, u32 Expected)
+{
+    // NOTE: Returns the value before; the exchange happened if that's Expected
+    u32 Result = Expected;
+    __atomic_compare_exchange_n(Dest, &Result, Value, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    return Result;
+}
+
+#endif
+
+inline void
+CPUPause()
+{
+    _mm_pause();
+}
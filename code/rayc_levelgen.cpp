@@ -0,0 +1,665 @@
+inline u32
+LevelHash(u32 Seed, u32 X, u32 Y, u32 Salt)
+{
+    // NOTE: The inputs folded together and run through a lowbias32 finaliser
+    u32 Result = Seed ^ (X*0x9E3779B1) ^ (Y*0x85EBCA77) ^ (Salt*0xC2B2AE3D);
+    Result ^= Result >> 16;
+    Result *= 0x7FEB352D;
+    Result ^= Result >> 15;
+    Result *= 0x846CA68B;
+    Result ^= Result >> 16;
+    return Result;
+}
+
+inline i32
+GetLastMazeCell(i32 Size)
+{
+    // NOTE: Maze cells sit on odd coordinates inside the border
+    i32 Result = ((Size - 2) & 1) ? (Size - 2) : (Size - 3);
+    return Result;
+}
+
+inline bool32
+MazeCarvesEast(u32 Seed, i32 X, i32 Y)
+{
+    // NOTE: The top row is one long corridor, as sidewinder needs. Anywhere
+    // else a cell either carries its run on east or closes it.
+    bool32 Result = ((Y == 1) ||
+                     ((LevelHash(Seed, X, Y, LevelSalt_MazeEast) % 100) < LEVEL_MAZE_EAST_PERCENT));
+    return Result;
+}
+
+inline bool32
+IsMazeRoom(u32 Seed, i32 X, i32 Y, i32 LastCellX, i32 LastCellY)
+{
+    // NOTE: A 9x9 room in the middle of some plots, lined up with the cells
+    i32 LocalX = X & (LEVEL_PLOT_SIZE - 1);
+    i32 LocalY = Y & (LEVEL_PLOT_SIZE - 1);
+    bool32 Result = ((LocalX >= 3) && (LocalX <= 11) &&
+                     (LocalY >= 3) && (LocalY <= 11) &&
+                     (X <= LastCellX) && (Y <= LastCellY) &&
+                     ((LevelHash(Seed, X / LEVEL_PLOT_SIZE, Y / LEVEL_PLOT_SIZE, LevelSalt_MazeRoom) % 100) <
+                      LEVEL_MAZE_ROOM_PERCENT));
+    return Result;
+}
+
+internal void
+LayoutMazeRow(level_gen_context *Context, i32 Y, u8 *Row)
+{
+    game_map *Map = Context->Map;
+    u32 Seed = Context->Params.Seed;
+    i32 LastCellX = GetLastMazeCell(Map->Width);
+    i32 LastCellY = GetLastMazeCell(Map->Height);
+
+    memset(Row, MapTile_Wall, Map->Width);
+    if ((Y < 1) || (Y > LastCellY))
+    {
+        return;
+    }
+
+    if (Y & 1)
+    {
+        for (i32 X = 1;
+             X <= LastCellX;
+             X += 2)
+        {
+            Row[X] = MapTile_Empty;
+            if ((X < LastCellX) && MazeCarvesEast(Seed, X, Y))
+            {
+                Row[X + 1] = MapTile_Empty;
+            }
+        }
+    }
+    else
+    {
+        // NOTE: The wall row between cell rows Y - 1 and Y + 1. Row Y + 1's
+        // runs are replayed here, and each opens north from one of its cells,
+        // so no row ever writes into another.
+        i32 CellY = Y + 1;
+        i32 RunStart = 1;
+        for (i32 X = 1;
+             X <= LastCellX;
+             X += 2)
+        {
+            if ((X == LastCellX) || !MazeCarvesEast(Seed, X, CellY))
+            {
+                u32 RunLength = (u32)((X - RunStart)/2 + 1);
+                i32 NorthX = RunStart + 2*(i32)(LevelHash(Seed, RunStart, CellY, LevelSalt_MazeNorth) % RunLength);
+                Row[NorthX] = MapTile_Empty;
+                RunStart = X + 2;
+            }
+        }
+    }
+
+    for (i32 X = 1;
+         X <= LastCellX;
+         ++X)
+    {
+        if (Row[X] == MapTile_Wall)
+        {
+            // NOTE: Only walls between two cells are knocked through for
+            // loops, never the posts at the corners
+            bool32 BetweenCells = (Y & 1) ? !(X & 1) : (X & 1);
+            if ((BetweenCells && ((LevelHash(Seed, X, Y, LevelSalt_MazeLoop) % 100) < LEVEL_MAZE_LOOP_PERCENT)) ||
+                IsMazeRoom(Seed, X, Y, LastCellX, LastCellY))
+            {
+                Row[X] = MapTile_Empty;
+            }
+        }
+    }
+}
+
+internal void
+LayoutCaveRow(level_gen_context *Context, i32 Y, u8 *Row)
+{
+    game_map *Map = Context->Map;
+    u32 Seed = Context->Params.Seed;
+    i32 Width = Map->Width;
+    bool32 BorderRow = ((Y == 0) || (Y == Map->Height - 1));
+    for (i32 X = 0;
+         X < Width;
+         ++X)
+    {
+        bool32 Wall = (BorderRow || (X == 0) || (X == Width - 1) ||
+                       ((LevelHash(Seed, X, Y, LevelSalt_CaveNoise) % 100) < LEVEL_CAVE_FILL_PERCENT));
+        Row[X] = Wall ? 1 : 0;
+    }
+}
+
+internal void
+SmoothCaveRow(level_gen_context *Context, i32 Y)
+{
+    // NOTE: A cell is wall if at least five of the nine in its 3x3 are. The
+    // column sums slide along so each cell costs three loads, not nine.
+    game_map *Map = Context->Map;
+    i32 Width = Map->Width;
+    u8 *Dest = Context->Dest + (memory_index)Y*Width;
+    if ((Y == 0) || (Y == Map->Height - 1))
+    {
+        memset(Dest, 1, Width);
+        return;
+    }
+
+    u8 *Above = Context->Source + (memory_index)(Y - 1)*Width;
+    u8 *Here = Above + Width;
+    u8 *Below = Here + Width;
+    u32 Left = Above[0] + Here[0] + Below[0];
+    u32 Middle = Above[1] + Here[1] + Below[1];
+    for (i32 X = 1;
+         X < Width - 1;
+         ++X)
+    {
+        u32 Right = Above[X + 1] + Here[X + 1] + Below[X + 1];
+        Dest[X] = ((Left + Middle + Right) >= 5) ? 1 : 0;
+        Left = Middle;
+        Middle = Right;
+    }
+    Dest[0] = 1;
+    Dest[Width - 1] = 1;
+}
+
+internal void
+DecodeArenaPlot(u32 Seed, i32 PlotX, i32 PlotY, level_arena_plot *Plot)
+{
+    // NOTE: Everything stays inside local cells 2 to 13, which leaves a
+    // corridor at least four wide between neighbouring plots. None of the
+    // shapes closes anything off.
+    u32 Hash = LevelHash(Seed, PlotX, PlotY, LevelSalt_ArenaPlot);
+    u32 Shape = Hash % 8;
+    i32 Length = 4 + (i32)((Hash >> 3) % 9);
+    i32 Along = 2 + (i32)((Hash >> 8) % (u32)(13 - Length));
+    i32 Across = 2 + (i32)((Hash >> 14) % 12);
+    i32 Size = 2 + (i32)((Hash >> 20) % 3);
+    i32 BlockX = 2 + (i32)((Hash >> 23) % (u32)(13 - Size));
+    i32 BlockY = 2 + (i32)((Hash >> 27) % (u32)(13 - Size));
+
+    Plot->Tile = MapTile_Wall;
+    Plot->RectCount = 0;
+    switch (Shape)
+    {
+        case 3:
+        {
+            Plot->RectCount = 1;
+            Plot->MinX[0] = BlockX;
+            Plot->MinY[0] = BlockY;
+            Plot->MaxX[0] = BlockX + Size - 1;
+            Plot->MaxY[0] = BlockY + Size - 1;
+        } break;
+
+        case 4:
+        case 5:
+        case 7:
+        {
+            // NOTE: A straight wall, or a grate fence
+            bool32 Vertical = ((Shape == 5) || ((Shape == 7) && (Hash >> 31)));
+            Plot->RectCount = 1;
+            Plot->MinX[0] = Vertical ? Across : Along;
+            Plot->MinY[0] = Vertical ? Along : Across;
+            Plot->MaxX[0] = Vertical ? Across : (Along + Length - 1);
+            Plot->MaxY[0] = Vertical ? (Along + Length - 1) : Across;
+            if (Shape == 7)
+            {
+                Plot->Tile = MapTile_Grate;
+            }
+        } break;
+
+        case 6:
+        {
+            // NOTE: A corner, both arms running from (Along, Across)
+            i32 ArmEnd = Across + Length - 1;
+            Plot->RectCount = 2;
+            Plot->MinX[0] = Along;
+            Plot->MinY[0] = Across;
+            Plot->MaxX[0] = Along + Length - 1;
+            Plot->MaxY[0] = Across;
+            Plot->MinX[1] = Along;
+            Plot->MinY[1] = Across;
+            Plot->MaxX[1] = Along;
+            Plot->MaxY[1] = (ArmEnd < 13) ? ArmEnd : 13;
+        } break;
+
+        default:
+        {
+            // NOTE: Open floor
+        } break;
+    }
+}
+
+internal void
+LayoutArenaRow(level_gen_context *Context, i32 Y, u8 *Row)
+{
+    game_map *Map = Context->Map;
+    u32 Seed = Context->Params.Seed;
+    i32 Width = Map->Width;
+    if ((Y == 0) || (Y == Map->Height - 1))
+    {
+        memset(Row, MapTile_Wall, Width);
+        return;
+    }
+
+    memset(Row, MapTile_Empty, Width);
+    Row[0] = MapTile_Wall;
+    Row[Width - 1] = MapTile_Wall;
+
+    // NOTE: Plots the map edge cuts into stay empty, so nothing ever touches
+    // the border
+    i32 PlotY = Y / LEVEL_PLOT_SIZE;
+    i32 LocalY = Y - PlotY*LEVEL_PLOT_SIZE;
+    if ((PlotY*LEVEL_PLOT_SIZE + 14) > (Map->Height - 2))
+    {
+        return;
+    }
+
+    for (i32 PlotX = 0;
+         (PlotX*LEVEL_PLOT_SIZE + 14) <= (Width - 2);
+         ++PlotX)
+    {
+        level_arena_plot Plot;
+        DecodeArenaPlot(Seed, PlotX, PlotY, &Plot);
+        for (u32 RectIndex = 0;
+             RectIndex < Plot.RectCount;
+             ++RectIndex)
+        {
+            if ((LocalY >= Plot.MinY[RectIndex]) && (LocalY <= Plot.MaxY[RectIndex]))
+            {
+                u8 *Cell = Row + PlotX*LEVEL_PLOT_SIZE;
+                for (i32 LocalX = Plot.MinX[RectIndex];
+                     LocalX <= Plot.MaxX[RectIndex];
+                     ++LocalX)
+                {
+                    Cell[LocalX] = Plot.Tile;
+                }
+            }
+        }
+    }
+}
+
+inline bool32
+IsLevelSpawnable(level_gen_context *Context, i32 X, i32 Y)
+{
+    bool32 Result = ((AbsoluteI32(X - Context->PlazaX) > LEVEL_SPAWN_CLEARANCE) ||
+                     (AbsoluteI32(Y - Context->PlazaY) > LEVEL_SPAWN_CLEARANCE));
+    return Result;
+}
+
+internal void
+FinishLevelRow(level_gen_context *Context, i32 Y, level_strip *Strip)
+{
+    // NOTE: Settles cave pockets, then dresses every cell: colour, textures
+    // and heights
+    u32 WallColors[] = {0xFF808080, 0xFF8C7A6A, 0xFF6A7A8C, 0xFF7A8C6A};
+    game_map *Map = Context->Map;
+    level_kind Kind = Context->Params.Kind;
+    u32 Seed = Context->Params.Seed;
+    i32 Width = Map->Width;
+    i32 LastCellX = GetLastMazeCell(Width);
+    i32 LastCellY = GetLastMazeCell(Map->Height);
+    memory_index RowStart = (memory_index)Y*Width;
+
+    for (i32 X = 0;
+         X < Width;
+         ++X)
+    {
+        memory_index CellIndex = RowStart + X;
+        u8 Tile = Map->Tiles[CellIndex];
+        if (Kind == LevelKind_Cave)
+        {
+            // NOTE: Anything the flood didn't reach is a sealed pocket
+            Tile = (Tile == LEVEL_TILE_REACHED) ? MapTile_Empty : MapTile_Wall;
+            Map->Tiles[CellIndex] = Tile;
+        }
+
+        u32 Hash = LevelHash(Seed, X, Y, LevelSalt_Dress);
+        u16 TextureId = ((Hash & 7) == 0) ? WallTexture_Pumpkin : WallTexture_Brick;
+        u32 Color = WallColors[(Hash >> 3) & 3];
+        if (Tile == MapTile_Grate)
+        {
+            TextureId = WallTexture_Grate;
+            Color = 0xFF4060A0;
+        }
+        for (u32 Face = 0;
+             Face < MapFace_Count;
+             ++Face)
+        {
+            Map->FaceTextures[CellIndex*MapFace_Count + Face] = TextureId;
+        }
+        Map->Colors[CellIndex] = Color;
+
+        f32 CeilingHeight = 1.0f;
+        switch (Kind)
+        {
+            case LevelKind_Maze:
+            {
+                if (IsMazeRoom(Seed, X, Y, LastCellX, LastCellY))
+                {
+                    CeilingHeight = 1.5f;
+                }
+            } break;
+
+            case LevelKind_Cave:
+            {
+                CeilingHeight = 1.0f + 0.125f*(f32)((Hash >> 5) & 3);
+            } break;
+
+            case LevelKind_Arena:
+            {
+                CeilingHeight = 2.0f;
+            } break;
+
+            default:
+            {
+                Assert(!"Unknown level kind");
+            } break;
+        }
+        Map->FloorHeights[CellIndex] = 0.0f;
+        Map->CeilingHeights[CellIndex] = CeilingHeight;
+
+        if (Tile == MapTile_Empty)
+        {
+            ++Strip->OpenCount;
+            if (IsLevelSpawnable(Context, X, Y))
+            {
+                ++Strip->SpawnableCount;
+            }
+        }
+    }
+}
+
+internal void
+SpawnLevelStrip(level_gen_context *Context, u32 StripIndex, i32 MinY, i32 OnePastMaxY)
+{
+    // NOTE: Throws darts at the strip until its share of robots land on
+    // spawnable cells. The strip has at least one or it wouldn't have a share.
+    game_map *Map = Context->Map;
+    u32 Seed = Context->Params.Seed;
+    level_strip *Strip = &Context->Strips[StripIndex];
+    if (MinY < 1)
+    {
+        MinY = 1;
+    }
+    if (OnePastMaxY > Map->Height - 1)
+    {
+        OnePastMaxY = Map->Height - 1;
+    }
+
+    u32 SpawnIndex = Strip->FirstSpawn;
+    u32 OnePastLastSpawn = Strip->FirstSpawn + Strip->SpawnCount;
+    for (u32 Attempt = 0;
+         SpawnIndex < OnePastLastSpawn;
+         ++Attempt)
+    {
+        u32 HashX = LevelHash(Seed, StripIndex, Attempt, LevelSalt_SpawnX);
+        u32 HashY = LevelHash(Seed, StripIndex, Attempt, LevelSalt_SpawnY);
+        i32 X = 1 + (i32)(HashX % (u32)(Map->Width - 2));
+        i32 Y = MinY + (i32)(HashY % (u32)(OnePastMaxY - MinY));
+        if ((Map->Tiles[(memory_index)Y*Map->Width + X] == MapTile_Empty) &&
+            IsLevelSpawnable(Context, X, Y))
+        {
+            level_spawn *Spawn = &Context->Spawns[SpawnIndex++];
+            Spawn->X = (f32)X + 0.25f + 0.5f*(f32)(HashX >> 8) / 16777216.0f;
+            Spawn->Y = (f32)Y + 0.25f + 0.5f*(f32)(HashY >> 8) / 16777216.0f;
+        }
+    }
+}
+
+internal void
+LevelGenWork(void *Data)
+{
+    level_gen_job *Job = (level_gen_job *)Data;
+    level_gen_context *Context = Job->Context;
+    game_map *Map = Context->Map;
+    for (u32 StripIndex = Job->FirstStrip;
+         StripIndex < Job->OnePastLastStrip;
+         ++StripIndex)
+    {
+        i32 MinY = (i32)StripIndex*LEVEL_STRIP_ROWS;
+        i32 OnePastMaxY = MinY + LEVEL_STRIP_ROWS;
+        if (OnePastMaxY > Map->Height)
+        {
+            OnePastMaxY = Map->Height;
+        }
+
+        switch (Context->Pass)
+        {
+            case LevelGenPass_Layout:
+            {
+                for (i32 Y = MinY;
+                     Y < OnePastMaxY;
+                     ++Y)
+                {
+                    u8 *Row = Map->Tiles + (memory_index)Y*Map->Width;
+                    switch (Context->Params.Kind)
+                    {
+                        case LevelKind_Maze: LayoutMazeRow(Context, Y, Row); break;
+                        case LevelKind_Cave: LayoutCaveRow(Context, Y, Row); break;
+                        case LevelKind_Arena: LayoutArenaRow(Context, Y, Row); break;
+                        default: Assert(!"Unknown level kind"); break;
+                    }
+                }
+            } break;
+
+            case LevelGenPass_Smooth:
+            {
+                for (i32 Y = MinY;
+                     Y < OnePastMaxY;
+                     ++Y)
+                {
+                    SmoothCaveRow(Context, Y);
+                }
+            } break;
+
+            case LevelGenPass_Finish:
+            {
+                level_strip *Strip = &Context->Strips[StripIndex];
+                Strip->OpenCount = 0;
+                Strip->SpawnableCount = 0;
+                for (i32 Y = MinY;
+                     Y < OnePastMaxY;
+                     ++Y)
+                {
+                    FinishLevelRow(Context, Y, Strip);
+                }
+            } break;
+
+            case LevelGenPass_Spawn:
+            {
+                SpawnLevelStrip(Context, StripIndex, MinY, OnePastMaxY);
+            } break;
+
+            default:
+            {
+                Assert(!"Unknown level pass");
+            } break;
+        }
+    }
+}
+
+internal void
+RunLevelGenPass(level_gen_context *Context, level_gen_job *Jobs, u32 JobCount, level_gen_pass Pass)
+{
+    Context->Pass = Pass;
+    for (u32 JobIndex = 0;
+         JobIndex < JobCount;
+         ++JobIndex)
+    {
+        PLATFORMAddWork(LevelGenWork, &Jobs[JobIndex]);
+    }
+    PLATFORMCompleteAllWork();
+}
+
+internal void
+FloodLevelFromPlaza(game_map *Map, i32 StartX, i32 StartY, u32 *Queue)
+{
+    // NOTE: Breadth first from the clearing over open cells, marking them
+    // LEVEL_TILE_REACHED. The only serial pass: it's one load and compare a
+    // cell, and every cell is queued at most once, so the queue is a flat
+    // array. The border is solid, so neighbours never leave the map.
+    u8 *Tiles = Map->Tiles;
+    u32 Width = (u32)Map->Width;
+    u32 Head = 0;
+    u32 Tail = 0;
+
+    u32 Start = (u32)StartY*Width + (u32)StartX;
+    Tiles[Start] = LEVEL_TILE_REACHED;
+    Queue[Tail++] = Start;
+    while (Head < Tail)
+    {
+        u32 CellIndex = Queue[Head++];
+        u32 Neighbours[4] = {CellIndex - 1, CellIndex + 1, CellIndex - Width, CellIndex + Width};
+        for (u32 NeighbourIndex = 0;
+             NeighbourIndex < ArrayCount(Neighbours);
+             ++NeighbourIndex)
+        {
+            u32 Neighbour = Neighbours[NeighbourIndex];
+            if (Tiles[Neighbour] == MapTile_Empty)
+            {
+                Tiles[Neighbour] = LEVEL_TILE_REACHED;
+                Queue[Tail++] = Neighbour;
+            }
+        }
+    }
+}
+
+// NOTE: Fills in Map and pushes everything it needs on Arena, spawns
+// included. Bookkeeping, and the cave's second buffer and flood queue, are
+// borrowed from the arena's free space and never pushed; a cave wants four
+// bytes a cell of it.
+internal generated_level
+GenerateLevel(game_map *Map, level_params *Params, memory_arena *Arena)
+{
+    Assert((Params->Width >= LEVEL_PLOT_SIZE) && (Params->Height >= LEVEL_PLOT_SIZE));
+    Assert((u64)Params->Width*(u64)Params->Height <= 0xFFFFFFFF);
+    generated_level Result = {};
+
+    i32 Width = Params->Width;
+    i32 Height = Params->Height;
+    memory_index CellCount = (memory_index)Width*Height;
+    Map->Width = Width;
+    Map->Height = Height;
+    Map->Tiles = PushArray(Arena, CellCount, u8);
+    Map->Colors = PushArray(Arena, CellCount, u32);
+    Map->FaceTextures = PushArray(Arena, CellCount*MapFace_Count, u16);
+    Map->FloorHeights = PushArray(Arena, CellCount, f32);
+    Map->CeilingHeights = PushArray(Arena, CellCount, f32);
+    Result.Spawns = PushArray(Arena, Params->RobotCount, level_spawn);
+
+    level_gen_context Context = {};
+    Context.Params = *Params;
+    Context.Map = Map;
+    Context.PlazaX = Width / 2;
+    Context.PlazaY = Height / 2;
+    Context.Spawns = Result.Spawns;
+    Context.StripCount = (u32)((Height + LEVEL_STRIP_ROWS - 1) / LEVEL_STRIP_ROWS);
+
+    u32 StripsPerJob = (Params->StripsPerJob > 0) ? Params->StripsPerJob : 1;
+    u32 JobCount = (Context.StripCount + StripsPerJob - 1) / StripsPerJob;
+
+    u8 *ScratchBase = (u8 *)(((memory_index)(Arena->Base + Arena->Used) + 63) & ~(memory_index)63);
+    memory_index ScratchUsed = 0;
+    Context.Strips = (level_strip *)ScratchBase;
+    ScratchUsed += (Context.StripCount*sizeof(level_strip) + 63) & ~(memory_index)63;
+    level_gen_job *Jobs = (level_gen_job *)(ScratchBase + ScratchUsed);
+    ScratchUsed += (JobCount*sizeof(level_gen_job) + 63) & ~(memory_index)63;
+    u8 *CaveScratch = ScratchBase + ScratchUsed;
+    if (Params->Kind == LevelKind_Cave)
+    {
+        ScratchUsed += CellCount*sizeof(u32);
+    }
+    Assert(ScratchBase + ScratchUsed <= Arena->Base + Arena->Size);
+
+    for (u32 JobIndex = 0;
+         JobIndex < JobCount;
+         ++JobIndex)
+    {
+        level_gen_job *Job = &Jobs[JobIndex];
+        Job->Context = &Context;
+        Job->FirstStrip = JobIndex*StripsPerJob;
+        Job->OnePastLastStrip = Job->FirstStrip + StripsPerJob;
+        if (Job->OnePastLastStrip > Context.StripCount)
+        {
+            Job->OnePastLastStrip = Context.StripCount;
+        }
+    }
+
+    RunLevelGenPass(&Context, Jobs, JobCount, LevelGenPass_Layout);
+
+    if (Params->Kind == LevelKind_Cave)
+    {
+        Context.Source = Map->Tiles;
+        Context.Dest = CaveScratch;
+        for (u32 SmoothPass = 0;
+             SmoothPass < LEVEL_CAVE_SMOOTH_PASSES;
+             ++SmoothPass)
+        {
+            RunLevelGenPass(&Context, Jobs, JobCount, LevelGenPass_Smooth);
+            u8 *Swap = Context.Source;
+            Context.Source = Context.Dest;
+            Context.Dest = Swap;
+        }
+        if (Context.Source != Map->Tiles)
+        {
+            memcpy(Map->Tiles, Context.Source, CellCount);
+        }
+    }
+
+    // NOTE: Somewhere clear to start, whatever the layout put there
+    for (i32 Y = Context.PlazaY - LEVEL_PLAZA_RADIUS;
+         Y <= Context.PlazaY + LEVEL_PLAZA_RADIUS;
+         ++Y)
+    {
+        for (i32 X = Context.PlazaX - LEVEL_PLAZA_RADIUS;
+             X <= Context.PlazaX + LEVEL_PLAZA_RADIUS;
+             ++X)
+        {
+            if ((X > 0) && (Y > 0) && (X < Width - 1) && (Y < Height - 1))
+            {
+                Map->Tiles[(memory_index)Y*Width + X] = MapTile_Empty;
+            }
+        }
+    }
+
+    if (Params->Kind == LevelKind_Cave)
+    {
+        FloodLevelFromPlaza(Map, Context.PlazaX, Context.PlazaY, (u32 *)CaveScratch);
+    }
+
+    RunLevelGenPass(&Context, Jobs, JobCount, LevelGenPass_Finish);
+
+    // NOTE: Each strip's share of robots goes by its share of spawnable
+    // cells, rounded off from the running totals so the shares add up
+    u64 SpawnableCount = 0;
+    for (u32 StripIndex = 0;
+         StripIndex < Context.StripCount;
+         ++StripIndex)
+    {
+        Result.OpenCellCount += Context.Strips[StripIndex].OpenCount;
+        SpawnableCount += Context.Strips[StripIndex].SpawnableCount;
+    }
+
+    if (SpawnableCount > 0)
+    {
+        u64 RobotCount = Params->RobotCount;
+        u64 SpawnableSoFar = 0;
+        for (u32 StripIndex = 0;
+             StripIndex < Context.StripCount;
+             ++StripIndex)
+        {
+            level_strip *Strip = &Context.Strips[StripIndex];
+            u32 FirstSpawn = (u32)(RobotCount*SpawnableSoFar / SpawnableCount);
+            SpawnableSoFar += Strip->SpawnableCount;
+            Strip->FirstSpawn = FirstSpawn;
+            Strip->SpawnCount = (u32)(RobotCount*SpawnableSoFar / SpawnableCount) - FirstSpawn;
+        }
+        Result.SpawnCount = Params->RobotCount;
+
+        RunLevelGenPass(&Context, Jobs, JobCount, LevelGenPass_Spawn);
+    }
+
+    InitializeMapOccupancy(Map, Arena);
+    UpdateMapOccupancy(Map);
+
+    Result.PlayerX = (f32)Context.PlazaX + 0.5f;
+    Result.PlayerY = (f32)Context.PlazaY + 0.5f;
+    Result.JobCount = JobCount;
+    return Result;
+}
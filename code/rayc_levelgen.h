@@ -0,0 +1,139 @@
+// NOTE: Procedural levels for stress runs: mazes, caves and open arenas with
+// robot spawns, from a seed, at anything up to tens of millions of cells.
+//
+// The map is cut into strips of LEVEL_STRIP_ROWS rows and each pass over it
+// goes out on the work queue a few strips a job. Every random choice is a
+// hash of the seed and the cell (or run, or plot) it's for, never a running
+// generator, so a level comes out identical however many jobs or threads
+// built it and in whatever order they ran.
+//
+// Maze: a sidewinder maze on the odd cells, with a few extra openings so
+// there's more than one way round, and the odd room knocked through. Cave:
+// hashed noise smoothed by a few passes of a cellular automaton, then every
+// pocket the centre can't reach filled in. Arena: open floor cut into plots,
+// each with at most one block, wall, corner or grate fence well clear of its
+// edges. All three are connected, and the player starts in a small clearing
+// in the middle with no robots close by.
+
+#define LEVEL_STRIP_ROWS 64
+#define LEVEL_PLAZA_RADIUS 2
+// NOTE: Robots don't spawn within this many cells of the player
+#define LEVEL_SPAWN_CLEARANCE 8
+#define LEVEL_PLOT_SIZE 16
+#define LEVEL_MAZE_EAST_PERCENT 50
+#define LEVEL_MAZE_LOOP_PERCENT 4
+#define LEVEL_MAZE_ROOM_PERCENT 8
+#define LEVEL_CAVE_FILL_PERCENT 45
+#define LEVEL_CAVE_SMOOTH_PASSES 4
+// NOTE: Marks cave cells the flood from the centre got to, until the finish
+// pass turns them back into floor
+#define LEVEL_TILE_REACHED 0x80
+
+enum level_kind
+{
+    LevelKind_Maze,
+    LevelKind_Cave,
+    LevelKind_Arena,
+
+    LevelKind_Count,
+};
+
+struct level_params
+{
+    level_kind Kind;
+    i32 Width;
+    i32 Height;
+    u32 Seed;
+    u32 RobotCount;
+
+    // NOTE: How many strips each job takes, 0 for one. Only changes how the
+    // work is split, never the level.
+    u32 StripsPerJob;
+};
+
+struct level_spawn
+{
+    f32 X;
+    f32 Y;
+};
+
+struct generated_level
+{
+    f32 PlayerX;
+    f32 PlayerY;
+    u64 OpenCellCount;
+
+    // NOTE: Spread over the open cells in proportion, RobotCount of them
+    // unless the level has nowhere to put any
+    u32 SpawnCount;
+    level_spawn *Spawns;
+
+    u32 JobCount;
+};
+
+// NOTE: Keeps each kind of choice's hashes apart from the others'
+enum level_salt
+{
+    LevelSalt_MazeEast,
+    LevelSalt_MazeNorth,
+    LevelSalt_MazeLoop,
+    LevelSalt_MazeRoom,
+    LevelSalt_CaveNoise,
+    LevelSalt_ArenaPlot,
+    LevelSalt_Dress,
+    LevelSalt_SpawnX,
+    LevelSalt_SpawnY,
+};
+
+enum level_gen_pass
+{
+    LevelGenPass_Layout,
+    LevelGenPass_Smooth,
+    LevelGenPass_Finish,
+    LevelGenPass_Spawn,
+};
+
+struct level_strip
+{
+    u64 OpenCount;
+    // NOTE: Open and outside LEVEL_SPAWN_CLEARANCE of the player
+    u64 SpawnableCount;
+    u32 FirstSpawn;
+    u32 SpawnCount;
+};
+
+// NOTE: At most two rectangles in plot-local cells, inclusive
+struct level_arena_plot
+{
+    u8 Tile;
+    u32 RectCount;
+    i32 MinX[2];
+    i32 MinY[2];
+    i32 MaxX[2];
+    i32 MaxY[2];
+};
+
+struct level_gen_context
+{
+    level_params Params;
+    game_map *Map;
+    level_gen_pass Pass;
+
+    // NOTE: What a smoothing pass reads and writes, whole maps of 0 or 1
+    u8 *Source;
+    u8 *Dest;
+
+    i32 PlazaX;
+    i32 PlazaY;
+
+    u32 StripCount;
+    level_strip *Strips;
+    level_spawn *Spawns;
+};
+
+struct level_gen_job
+{
+    level_gen_context *Context;
+    u32 FirstStrip;
+    u32 OnePastLastStrip;
+};
@@ -0,0 +1,386 @@
+// NOTE: Where each face's luxels sit. The face lies on one edge of its cell
+// and is seen from the neighbouring cell on that side; U runs along the world
+// axis the face lies on, the same way the wall drawer's TextureU does.
+global_variable i32 GlobalFaceViewerDX[MapFace_Count] = {1, 0, -1, 0};
+global_variable i32 GlobalFaceViewerDY[MapFace_Count] = {0, -1, 0, 1};
+
+inline bool32
+IsLightingRegionEmpty(lighting_region Region)
+{
+    bool32 Result = ((Region.MinX > Region.MaxX) || (Region.MinY > Region.MaxY));
+    return Result;
+}
+
+inline lighting_region
+GetLightRegion(point_light *Light, i32 Width, i32 Height)
+{
+    // NOTE: Every cell with a face the light can reach. Faces lie on cell
+    // edges, hence the extra cell each way.
+    lighting_region Result;
+    Result.MinX = (i32)floorf(Light->X - Light->Radius) - 1;
+    Result.MinY = (i32)floorf(Light->Y - Light->Radius) - 1;
+    Result.MaxX = (i32)floorf(Light->X + Light->Radius) + 1;
+    Result.MaxY = (i32)floorf(Light->Y + Light->Radius) + 1;
+    if (Result.MinX < 0) Result.MinX = 0;
+    if (Result.MinY < 0) Result.MinY = 0;
+    if (Result.MaxX > Width - 1) Result.MaxX = Width - 1;
+    if (Result.MaxY > Height - 1) Result.MaxY = Height - 1;
+    return Result;
+}
+
+internal void
+AddLightingDirtyRegion(face_lighting *Lighting, lighting_region Region)
+{
+    if (IsLightingRegionEmpty(Region))
+    {
+        return;
+    }
+
+    if (Lighting->DirtyCount < LIGHTMAP_MAX_DIRTY_REGIONS)
+    {
+        Lighting->Dirty[Lighting->DirtyCount++] = Region;
+    }
+    else
+    {
+        // NOTE: Too many to keep apart; relight everything they cover
+        lighting_region *Bounds = &Lighting->Dirty[0];
+        for (u32 DirtyIndex = 1;
+             DirtyIndex < Lighting->DirtyCount;
+             ++DirtyIndex)
+        {
+            lighting_region *Dirty = &Lighting->Dirty[DirtyIndex];
+            if (Dirty->MinX < Bounds->MinX) Bounds->MinX = Dirty->MinX;
+            if (Dirty->MinY < Bounds->MinY) Bounds->MinY = Dirty->MinY;
+            if (Dirty->MaxX > Bounds->MaxX) Bounds->MaxX = Dirty->MaxX;
+            if (Dirty->MaxY > Bounds->MaxY) Bounds->MaxY = Dirty->MaxY;
+        }
+        if (Region.MinX < Bounds->MinX) Bounds->MinX = Region.MinX;
+        if (Region.MinY < Bounds->MinY) Bounds->MinY = Region.MinY;
+        if (Region.MaxX > Bounds->MaxX) Bounds->MaxX = Region.MaxX;
+        if (Region.MaxY > Bounds->MaxY) Bounds->MaxY = Region.MaxY;
+        Lighting->DirtyCount = 1;
+    }
+}
+
+internal void
+MarkLightingCellsChanged(face_lighting *Lighting, lighting_region Changed)
+{
+    // NOTE: For after editing Tiles or heights in Changed (and updating the
+    // occupancy grids). Any light that reaches the edit may now reach more or
+    // less of its surroundings, and the faces on and around the edited cells
+    // may have appeared or gone.
+    if (!Lighting->Luxels)
+    {
+        return;
+    }
+
+    for (u32 LightIndex = 0;
+         LightIndex < Lighting->LightCount;
+         ++LightIndex)
+    {
+        point_light *Light = &Lighting->Lights[LightIndex];
+        lighting_region Reach = GetLightRegion(Light, Lighting->Width, Lighting->Height);
+        if (Light->On &&
+            (Reach.MinX <= Changed.MaxX) && (Reach.MaxX >= Changed.MinX) &&
+            (Reach.MinY <= Changed.MaxY) && (Reach.MaxY >= Changed.MinY))
+        {
+            AddLightingDirtyRegion(Lighting, Reach);
+        }
+    }
+
+    lighting_region Around = Changed;
+    Around.MinX = (Changed.MinX > 0) ? (Changed.MinX - 1) : 0;
+    Around.MinY = (Changed.MinY > 0) ? (Changed.MinY - 1) : 0;
+    Around.MaxX = (Changed.MaxX < Lighting->Width - 1) ? (Changed.MaxX + 1) : (Lighting->Width - 1);
+    Around.MaxY = (Changed.MaxY < Lighting->Height - 1) ? (Changed.MaxY + 1) : (Lighting->Height - 1);
+    AddLightingDirtyRegion(Lighting, Around);
+}
+
+internal bool32
+HasLightLineOfSight(game_map *Map, f32 SourceX, f32 SourceY, f32 TargetX, f32 TargetY)
+{
+    // NOTE: Grid DDA from the light to a point just in front of a face,
+    // stopping at the first opaque cell. Unlike robots' line of sight, light
+    // goes through grates.
+    f32 DirX = TargetX - SourceX;
+    f32 DirY = TargetY - SourceY;
+    i32 CellX = (i32)floorf(SourceX);
+    i32 CellY = (i32)floorf(SourceY);
+    i32 TargetCellX = (i32)floorf(TargetX);
+    i32 TargetCellY = (i32)floorf(TargetY);
+    i32 StepX = (DirX > 0.0f) ? 1 : -1;
+    i32 StepY = (DirY > 0.0f) ? 1 : -1;
+    f32 NoCrossing = 1.0e30f;
+    f32 TDeltaX = (DirX != 0.0f) ? AbsoluteF32(1.0f / DirX) : NoCrossing;
+    f32 TDeltaY = (DirY != 0.0f) ? AbsoluteF32(1.0f / DirY) : NoCrossing;
+    f32 TMaxX = (DirX != 0.0f) ? (((DirX > 0.0f) ? ((f32)(CellX + 1) - SourceX) : (SourceX - (f32)CellX))*TDeltaX) : NoCrossing;
+    f32 TMaxY = (DirY != 0.0f) ? (((DirY > 0.0f) ? ((f32)(CellY + 1) - SourceY) : (SourceY - (f32)CellY))*TDeltaY) : NoCrossing;
+
+    // NOTE: Can't take more steps than cells between the two; the bound only
+    // matters when rounding puts the walk a cell off the target
+    i32 StepsLeft = AbsoluteI32(TargetCellX - CellX) + AbsoluteI32(TargetCellY - CellY);
+    bool32 Result = !IsTileOpaque(Map, CellX, CellY);
+    while (Result && (StepsLeft-- > 0))
+    {
+        if (TMaxX < TMaxY)
+        {
+            TMaxX += TDeltaX;
+            CellX += StepX;
+        }
+        else
+        {
+            TMaxY += TDeltaY;
+            CellY += StepY;
+        }
+        Result = !IsTileOpaque(Map, CellX, CellY);
+    }
+    return Result;
+}
+
+inline u32
+PackLuxelChannel(f32 Value)
+{
+    i32 Level = (i32)(Value*128.0f + 0.5f);
+    if (Level < 0) Level = 0;
+    if (Level > 255) Level = 255;
+    u32 Result = (u32)Level;
+    return Result;
+}
+
+internal u32
+ComputeLuxel(face_lighting *Lighting, game_map *Map, f32 X, f32 Y, f32 Z, f32 NormalX, f32 NormalY)
+{
+    f32 Red = Lighting->Ambient;
+    f32 Green = Lighting->Ambient;
+    f32 Blue = Lighting->Ambient;
+    for (u32 LightIndex = 0;
+         LightIndex < Lighting->LightCount;
+         ++LightIndex)
+    {
+        point_light *Light = &Lighting->Lights[LightIndex];
+        if (!Light->On)
+        {
+            continue;
+        }
+
+        f32 DX = Light->X - X;
+        f32 DY = Light->Y - Y;
+        f32 DZ = Light->Z - Z;
+        f32 DistanceSq = DX*DX + DY*DY + DZ*DZ;
+        f32 FacingDistance = DX*NormalX + DY*NormalY;
+        if ((DistanceSq >= Light->Radius*Light->Radius) || (FacingDistance <= 0.0f))
+        {
+            continue;
+        }
+
+        // NOTE: The point the shadow walk ends at is nudged off the face into
+        // the cell it's seen from
+        f32 Nudge = 1.0e-3f;
+        if (!HasLightLineOfSight(Map, Light->X, Light->Y, X + NormalX*Nudge, Y + NormalY*Nudge))
+        {
+            continue;
+        }
+
+        f32 Distance = sqrtf(DistanceSq);
+        f32 Falloff = 1.0f - Distance / Light->Radius;
+        f32 Scale = Falloff*Falloff*FacingDistance / Distance;
+        Red += Light->Red*Scale;
+        Green += Light->Green*Scale;
+        Blue += Light->Blue*Scale;
+    }
+
+    u32 Result = ((0x80u << 24) | (PackLuxelChannel(Red) << 16) |
+                  (PackLuxelChannel(Green) << 8) | PackLuxelChannel(Blue));
+    return Result;
+}
+
+internal bool32
+RelightFace(face_lighting *Lighting, game_map *Map, i32 CellX, i32 CellY, u32 Face)
+{
+    // NOTE: Returns false for faces nothing ever draws (their viewing cell is
+    // opaque or off the map, or the two cells meet flush), which are left unlit
+    u32 CellIndex = (u32)(CellY*Map->Width + CellX);
+    u32 *Luxels = Lighting->Luxels + (CellIndex*MapFace_Count + Face)*LIGHTMAP_LUXELS;
+    i32 ViewerX = CellX + GlobalFaceViewerDX[Face];
+    i32 ViewerY = CellY + GlobalFaceViewerDY[Face];
+
+    bool32 Result = false;
+    if (IsTileInMap(Map, ViewerX, ViewerY) && !IsTileOpaque(Map, ViewerX, ViewerY))
+    {
+        u32 ViewerIndex = (u32)(ViewerY*Map->Width + ViewerX);
+        f32 ViewerFloor = Map->FloorHeights[ViewerIndex];
+        f32 ViewerCeiling = Map->CeilingHeights[ViewerIndex];
+        Result = (IsTileOpaque(Map, CellX, CellY) ||
+                  (IsTileSeeThrough(Map, CellX, CellY) != IsTileSeeThrough(Map, ViewerX, ViewerY)) ||
+                  (Map->FloorHeights[CellIndex] > ViewerFloor) ||
+                  (Map->CeilingHeights[CellIndex] < ViewerCeiling));
+        if (Result)
+        {
+            // NOTE: Lit at the middle of the opening it's seen from
+            f32 NormalX = (f32)GlobalFaceViewerDX[Face];
+            f32 NormalY = (f32)GlobalFaceViewerDY[Face];
+            f32 FaceX = (f32)CellX + ((NormalX > 0.0f) ? 1.0f : 0.0f);
+            f32 FaceY = (f32)CellY + ((NormalY > 0.0f) ? 1.0f : 0.0f);
+            f32 Z = 0.5f*(ViewerFloor + ViewerCeiling);
+            for (u32 U = 0;
+                 U < LIGHTMAP_LUXELS;
+                 ++U)
+            {
+                f32 Along = ((f32)U + 0.5f) / (f32)LIGHTMAP_LUXELS;
+                f32 X = (NormalX != 0.0f) ? FaceX : (FaceX + Along);
+                f32 Y = (NormalY != 0.0f) ? FaceY : (FaceY + Along);
+                Luxels[U] = ComputeLuxel(Lighting, Map, X, Y, Z, NormalX, NormalY);
+            }
+        }
+    }
+
+    if (!Result)
+    {
+        for (u32 U = 0;
+             U < LIGHTMAP_LUXELS;
+             ++U)
+        {
+            Luxels[U] = LIGHTMAP_UNLIT;
+        }
+    }
+    return Result;
+}
+
+inline bool32
+AreLightsEqual(point_light *A, point_light *B)
+{
+    bool32 Result = ((A->X == B->X) && (A->Y == B->Y) && (A->Z == B->Z) &&
+                     (A->Radius == B->Radius) && (A->Red == B->Red) &&
+                     (A->Green == B->Green) && (A->Blue == B->Blue) &&
+                     (A->On == B->On) && (A->BlinkSeconds == B->BlinkSeconds));
+    return Result;
+}
+
+internal void
+UpdateFaceLighting(face_lighting *Lighting, game_map *Map, f32 Ambient,
+                   point_light *Lights, u32 LightCount, memory_arena *Arena)
+{
+    // NOTE: Called by the render stage each frame with the view's lights.
+    // The lightmaps are pushed on Arena the first time there are any lights.
+    Lighting->FacesRelit = 0;
+    if (LightCount > GAME_MAX_LIGHTS)
+    {
+        LightCount = GAME_MAX_LIGHTS;
+    }
+
+    if (!Lighting->Luxels)
+    {
+        if (LightCount == 0)
+        {
+            return;
+        }
+
+        Lighting->Width = Map->Width;
+        Lighting->Height = Map->Height;
+        Lighting->Luxels = PushArray(Arena, (memory_index)Map->Width*Map->Height*MapFace_Count*LIGHTMAP_LUXELS, u32);
+        Lighting->Ambient = Ambient;
+        Lighting->LightCount = 0;
+        Lighting->DirtyCount = 0;
+        lighting_region Everything = {0, 0, Map->Width - 1, Map->Height - 1};
+        AddLightingDirtyRegion(Lighting, Everything);
+    }
+
+    if (Ambient != Lighting->Ambient)
+    {
+        Lighting->Ambient = Ambient;
+        lighting_region Everything = {0, 0, Lighting->Width - 1, Lighting->Height - 1};
+        AddLightingDirtyRegion(Lighting, Everything);
+    }
+
+    // NOTE: Lights are matched up by index. Wherever one differs, both where
+    // it was and where it is now need relighting.
+    u32 MaxLightCount = (LightCount > Lighting->LightCount) ? LightCount : Lighting->LightCount;
+    for (u32 LightIndex = 0;
+         LightIndex < MaxLightCount;
+         ++LightIndex)
+    {
+        point_light *Old = (LightIndex < Lighting->LightCount) ? &Lighting->Lights[LightIndex] : 0;
+        point_light *New = (LightIndex < LightCount) ? &Lights[LightIndex] : 0;
+        if (Old && New && AreLightsEqual(Old, New))
+        {
+            continue;
+        }
+        if (Old && Old->On)
+        {
+            AddLightingDirtyRegion(Lighting, GetLightRegion(Old, Lighting->Width, Lighting->Height));
+        }
+        if (New && New->On)
+        {
+            AddLightingDirtyRegion(Lighting, GetLightRegion(New, Lighting->Width, Lighting->Height));
+        }
+        if (New)
+        {
+            Lighting->Lights[LightIndex] = *New;
+        }
+    }
+    Lighting->LightCount = LightCount;
+
+    // NOTE: Overlapping regions get relit more than once; they're small and
+    // a frame rarely has more than one or two
+    for (u32 DirtyIndex = 0;
+         DirtyIndex < Lighting->DirtyCount;
+         ++DirtyIndex)
+    {
+        lighting_region *Dirty = &Lighting->Dirty[DirtyIndex];
+        for (i32 CellY = Dirty->MinY;
+             CellY <= Dirty->MaxY;
+             ++CellY)
+        {
+            for (i32 CellX = Dirty->MinX;
+                 CellX <= Dirty->MaxX;
+                 ++CellX)
+            {
+                for (u32 Face = 0;
+                     Face < MapFace_Count;
+                     ++Face)
+                {
+                    if (RelightFace(Lighting, Map, CellX, CellY, Face))
+                    {
+                        ++Lighting->FacesRelit;
+                    }
+                }
+            }
+        }
+    }
+    Lighting->DirtyCount = 0;
+    Lighting->TotalFacesRelit += Lighting->FacesRelit;
+}
+
+inline u32
+SampleFaceLight(face_lighting *Lighting, i32 CellX, i32 CellY, u32 Face, f32 TextureU)
+{
+    // NOTE: Linear between luxel centres, clamped at the face's ends
+    u32 Result = LIGHTMAP_UNLIT;
+    if (Lighting->Luxels &&
+        ((u32)CellX < (u32)Lighting->Width) && ((u32)CellY < (u32)Lighting->Height))
+    {
+        u32 *Luxels = Lighting->Luxels + ((u32)(CellY*Lighting->Width + CellX)*MapFace_Count + Face)*LIGHTMAP_LUXELS;
+        f32 Position = TextureU*(f32)LIGHTMAP_LUXELS - 0.5f;
+        if (Position < 0.0f) Position = 0.0f;
+        if (Position > (f32)(LIGHTMAP_LUXELS - 1)) Position = (f32)(LIGHTMAP_LUXELS - 1);
+        i32 Index = TruncateF32ToI32(Position);
+        i32 NextIndex = (Index < LIGHTMAP_LUXELS - 1) ? (Index + 1) : Index;
+        u32 Weight = (u32)((Position - (f32)Index)*256.0f);
+
+        u32 A = Luxels[Index];
+        u32 B = Luxels[NextIndex];
+        if (A == B)
+        {
+            Result = A;
+        }
+        else
+        {
+            // NOTE: Red and blue lerp together in one multiply, green on its
+            // own; the alpha byte is 0x80 in both
+            u32 RedBlue = ((A & 0x00FF00FF)*(256 - Weight) + (B & 0x00FF00FF)*Weight) >> 8;
+            u32 Green = ((A & 0x0000FF00)*(256 - Weight) + (B & 0x0000FF00)*Weight) >> 8;
+            Result = 0x80000000 | (RedBlue & 0x00FF00FF) | (Green & 0x0000FF00);
+        }
+    }
+    return Result;
+}
@@ -0,0 +1,75 @@
+// NOTE: Wall lighting. Point lights placed in the level are baked into a
+// small lightmap per wall face: LIGHTMAP_LUXELS luxels across the face, each
+// the ambient level plus every light that reaches it, with shadows from a
+// line-of-sight walk over the map grid (grates let light through). The wall
+// drawer takes one light value per column, interpolated between the luxels,
+// and scales each texel it writes by it; nothing about lighting is worked out
+// per pixel.
+//
+// A luxel is 0x80RRGGBB where 0x80 in a channel is full texture brightness,
+// so lights can brighten a wall up to twice over. The alpha byte is always
+// 0x80 so modulating a texel leaves its alpha alone.
+//
+// The sim owns the lights and the render stage owns the lightmaps. Each
+// frame the render stage compares the view's lights against the ones it last
+// baked, and only relights the faces inside the reach of a light that was
+// added, removed, moved or changed (its old reach and its new one). A wall
+// edit marks the reach of every light that could see across it.
+
+#define LIGHTMAP_LUXELS_LOG2 3
+#define LIGHTMAP_LUXELS (1 << LIGHTMAP_LUXELS_LOG2)
+#define LIGHTMAP_UNLIT 0x80808080
+#define LIGHTMAP_MAX_DIRTY_REGIONS 32
+
+#define GAME_MAX_LIGHTS 16
+
+struct point_light
+{
+    f32 X;
+    f32 Y;
+    f32 Z;
+    // NOTE: In tiles; the light falls off to nothing at this distance
+    f32 Radius;
+    // NOTE: Linear; 1.0 is full texture brightness right next to the light
+    f32 Red;
+    f32 Green;
+    f32 Blue;
+    bool32 On;
+    // NOTE: Nonzero for a light the sim switches on and off every this many
+    // seconds
+    f32 BlinkSeconds;
+};
+
+// NOTE: Inclusive cell bounds
+struct lighting_region
+{
+    i32 MinX;
+    i32 MinY;
+    i32 MaxX;
+    i32 MaxY;
+};
+
+struct face_lighting
+{
+    // NOTE: Zero until the first light shows up. Until then every face is
+    // drawn unlit, the way walls always were.
+    i32 Width;
+    i32 Height;
+    // NOTE: Luxels[(CellIndex*MapFace_Count + Face)*LIGHTMAP_LUXELS + U], the
+    // same face numbering as game_map.FaceTextures
+    u32 *Luxels;
+
+    // NOTE: The lights as of the last relight
+    f32 Ambient;
+    u32 LightCount;
+    point_light Lights[GAME_MAX_LIGHTS];
+
+    // NOTE: Waiting for the next relight. Past LIGHTMAP_MAX_DIRTY_REGIONS
+    // they fold into one bounding region.
+    u32 DirtyCount;
+    lighting_region Dirty[LIGHTMAP_MAX_DIRTY_REGIONS];
+
+    // NOTE: Faces relit by the last UpdateFaceLighting, and ever
+    u32 FacesRelit;
+    u64 TotalFacesRelit;
+};
@@ -0,0 +1,329 @@
+// NOTE: The log every thread appends to. Null until the platform layer sets
+// one up, in which case LogPrint costs a load and a branch.
+global_variable log_state *GlobalLog;
+global_variable thread_local log_ring *GlobalLogThreadRing;
+
+internal void
+InitializeLog(log_state *Log, u32 MaxRings, memory_arena *Arena)
+{
+    // NOTE: Rings are claimed on first use and never handed back, so MaxRings
+    // bounds the number of threads that ever log. Arena memory comes back
+    // zeroed, which is an empty ring.
+    Log->RingCount = 0;
+    Log->MaxRings = MaxRings;
+    Log->Rings = PushArray(Arena, MaxRings, log_ring);
+
+    GlobalLog = Log;
+}
+
+internal log_ring *
+LogClaimRing(log_state *Log)
+{
+    log_ring *Result = 0;
+    if (AtomicLoadU32(&Log->RingCount) < Log->MaxRings)
+    {
+        u32 RingIndex = AtomicAddU32(&Log->RingCount, 1);
+        if (RingIndex < Log->MaxRings)
+        {
+            Result = &Log->Rings[RingIndex];
+            GlobalLogThreadRing = Result;
+        }
+    }
+    return Result;
+}
+
+internal u32
+LogStoreArgs(log_record *Record, const char *Format, va_list Args)
+{
+    // NOTE: Takes each argument off the list as the type its conversion says
+    // it was passed as, after promotion, and returns how many it stored
+    u32 ArgCount = 0;
+    for (const char *At = Format;
+         *At;
+         ++At)
+    {
+        if (At[0] != '%')
+        {
+            continue;
+        }
+        ++At;
+        if (*At == '%')
+        {
+            continue;
+        }
+
+        while (*At && strchr("-+ #0123456789.", *At))
+        {
+            ++At;
+        }
+        u32 LongCount = 0;
+        bool32 PointerSized = false;
+        while (*At && strchr("hlLqjzt", *At))
+        {
+            if (*At == 'l')
+            {
+                ++LongCount;
+            }
+            else if ((*At == 'q') || (*At == 'j'))
+            {
+                LongCount = 2;
+            }
+            else if ((*At == 'z') || (*At == 't'))
+            {
+                PointerSized = true;
+            }
+            ++At;
+        }
+        char Conversion = *At;
+        if (!Conversion)
+        {
+            break;
+        }
+
+        Assert(ArgCount < LOG_MAX_ARGS);
+        if (ArgCount == LOG_MAX_ARGS)
+        {
+            break;
+        }
+
+        // NOTE: long is 32 bits on Windows and 64 on Linux
+        bool32 Wide = ((LongCount >= 2) ||
+                       ((LongCount == 1) && (sizeof(long) == sizeof(u64))) ||
+                       (PointerSized && (sizeof(memory_index) == sizeof(u64))));
+        log_arg *Arg = &Record->Args[ArgCount];
+        u8 *Type = &Record->ArgTypes[ArgCount];
+        if (strchr("dic", Conversion))
+        {
+            *Type = LogArg_Signed;
+            Arg->Signed = Wide ? va_arg(Args, i64) : va_arg(Args, int);
+        }
+        else if (strchr("ouxX", Conversion))
+        {
+            *Type = LogArg_Unsigned;
+            Arg->Unsigned = Wide ? va_arg(Args, u64) : va_arg(Args, unsigned int);
+        }
+        else if (strchr("fFeEgGaA", Conversion))
+        {
+            *Type = LogArg_Float;
+            Arg->Float = va_arg(Args, f64);
+        }
+        else if (Conversion == 's')
+        {
+            *Type = LogArg_String;
+            Arg->String = va_arg(Args, const char *);
+        }
+        else
+        {
+            // NOTE: No way to know how big it was, so nothing after it can be
+            // taken either
+            Assert(!"Unsupported log conversion");
+            break;
+        }
+        ++ArgCount;
+    }
+
+    return ArgCount;
+}
+
+internal void
+LogPrint(const char *Format, ...)
+{
+    log_state *Log = GlobalLog;
+    if (Log)
+    {
+        log_ring *Ring = GlobalLogThreadRing;
+        if (!Ring)
+        {
+            Ring = LogClaimRing(Log);
+        }
+
+        if (Ring)
+        {
+            u32 WriteIndex = Ring->WriteIndex;
+            if ((WriteIndex - Ring->CachedReadIndex) >= LOG_RING_RECORD_COUNT)
+            {
+                Ring->CachedReadIndex = AtomicLoadU32(&Ring->ReadIndex);
+            }
+
+            if ((WriteIndex - Ring->CachedReadIndex) < LOG_RING_RECORD_COUNT)
+            {
+                log_record *Record = &Ring->Records[WriteIndex & (LOG_RING_RECORD_COUNT - 1)];
+                Record->Format = Format;
+                Record->Timestamp = __rdtsc();
+                va_list Args;
+                va_start(Args, Format);
+                Record->ArgCount = (u8)LogStoreArgs(Record, Format, Args);
+                va_end(Args);
+                AtomicStoreU32(&Ring->WriteIndex, WriteIndex + 1);
+            }
+            else
+            {
+                AtomicStoreU32(&Ring->DroppedCount, Ring->DroppedCount + 1);
+            }
+        }
+    }
+}
+
+//
+// NOTE: Drain side, only ever run by one thread
+//
+
+internal memory_index
+LogFormatRecord(log_record *Record, char *Dest, memory_index DestSize)
+{
+    // NOTE: Walks the format and hands each conversion to snprintf on its own
+    // with the argument widened to what was stored. Length modifiers in the
+    // format are dropped and replaced to match.
+    memory_index Used = 0;
+    u32 ArgIndex = 0;
+    const char *At = Record->Format;
+    while (*At && (Used + 1 < DestSize))
+    {
+        if (At[0] != '%')
+        {
+            Dest[Used++] = *At++;
+        }
+        else if (At[1] == '%')
+        {
+            Dest[Used++] = '%';
+            At += 2;
+        }
+        else
+        {
+            char Spec[32];
+            u32 SpecLength = 0;
+            Spec[SpecLength++] = *At++;
+            while (*At && strchr("-+ #0123456789.", *At) && (SpecLength < sizeof(Spec) - 4))
+            {
+                Spec[SpecLength++] = *At++;
+            }
+            while (*At && strchr("hlLqjzt", *At))
+            {
+                ++At;
+            }
+            char Conversion = *At;
+            if (Conversion)
+            {
+                ++At;
+            }
+
+            int Written = 0;
+            memory_index Remaining = DestSize - Used;
+            if ((ArgIndex < Record->ArgCount) && Conversion)
+            {
+                u32 Type = Record->ArgTypes[ArgIndex];
+                log_arg Arg = Record->Args[ArgIndex];
+                ++ArgIndex;
+
+                if (strchr("diouxXc", Conversion) && (Type != LogArg_String))
+                {
+                    Spec[SpecLength++] = 'l';
+                    Spec[SpecLength++] = 'l';
+                    Spec[SpecLength++] = Conversion;
+                    Spec[SpecLength] = 0;
+                    long long Value = ((Type == LogArg_Float) ? (long long)Arg.Float :
+                                       (Type == LogArg_Signed) ? (long long)Arg.Signed :
+                                       (long long)Arg.Unsigned);
+                    Written = snprintf(Dest + Used, Remaining, Spec, Value);
+                }
+                else if (strchr("fFeEgGaA", Conversion) && (Type != LogArg_String))
+                {
+                    Spec[SpecLength++] = Conversion;
+                    Spec[SpecLength] = 0;
+                    f64 Value = ((Type == LogArg_Float) ? Arg.Float :
+                                 (Type == LogArg_Signed) ? (f64)Arg.Signed :
+                                 (f64)Arg.Unsigned);
+                    Written = snprintf(Dest + Used, Remaining, Spec, Value);
+                }
+                else if ((Conversion == 's') && (Type == LogArg_String))
+                {
+                    Spec[SpecLength++] = Conversion;
+                    Spec[SpecLength] = 0;
+                    Written = snprintf(Dest + Used, Remaining, Spec, Arg.String ? Arg.String : "(null)");
+                }
+                else
+                {
+                    Written = snprintf(Dest + Used, Remaining, "<?%c>", Conversion);
+                }
+            }
+            else
+            {
+                Written = snprintf(Dest + Used, Remaining, "<missing>");
+            }
+
+            if (Written > 0)
+            {
+                Used += ((memory_index)Written < Remaining) ? (memory_index)Written : Remaining - 1;
+            }
+        }
+    }
+
+    Dest[Used] = 0;
+    return Used;
+}
+
+internal memory_index
+LogFormatPending(log_state *Log, char *Dest, memory_index DestSize)
+{
+    // NOTE: Formats whatever the rings hold into Dest, oldest record first
+    // across all of them, and returns the number of bytes written. Stops
+    // early when Dest can't be sure of holding another line, so call it again
+    // until it returns 0. Records published after this starts are left for
+    // the next call; a thread that was preempted between stamping and
+    // publishing a record can still land slightly out of order.
+    Assert(DestSize > LOG_MAX_LINE);
+    memory_index Used = 0;
+
+    u32 RingCount = AtomicLoadU32(&Log->RingCount);
+    if (RingCount > Log->MaxRings)
+    {
+        RingCount = Log->MaxRings;
+    }
+
+    for (u32 RingIndex = 0;
+         RingIndex < RingCount;
+         ++RingIndex)
+    {
+        log_ring *Ring = &Log->Rings[RingIndex];
+        u32 Dropped = AtomicLoadU32(&Ring->DroppedCount);
+        if ((Dropped != Ring->DroppedReported) && (Used + LOG_MAX_LINE < DestSize))
+        {
+            int Written = snprintf(Dest + Used, DestSize - Used, "log: ring %u dropped %u records\n",
+                                   RingIndex, Dropped - Ring->DroppedReported);
+            Used += (memory_index)Written;
+            Ring->DroppedReported = Dropped;
+        }
+    }
+
+    while (Used + LOG_MAX_LINE < DestSize)
+    {
+        log_ring *Oldest = 0;
+        log_record *OldestRecord = 0;
+        for (u32 RingIndex = 0;
+             RingIndex < RingCount;
+             ++RingIndex)
+        {
+            log_ring *Ring = &Log->Rings[RingIndex];
+            u32 ReadIndex = Ring->ReadIndex;
+            if (ReadIndex != AtomicLoadU32(&Ring->WriteIndex))
+            {
+                log_record *Record = &Ring->Records[ReadIndex & (LOG_RING_RECORD_COUNT - 1)];
+                if (!OldestRecord || (Record->Timestamp < OldestRecord->Timestamp))
+                {
+                    Oldest = Ring;
+                    OldestRecord = Record;
+                }
+            }
+        }
+
+        if (!Oldest)
+        {
+            break;
+        }
+
+        Used += LogFormatRecord(OldestRecord, Dest + Used, LOG_MAX_LINE);
+        AtomicStoreU32(&Oldest->ReadIndex, Oldest->ReadIndex + 1);
+    }
+
+    return Used;
+}
@@ -0,0 +1,72 @@
+// NOTE: Binary logging. The calling thread never formats anything: LogPrint
+// copies the format string's address and the raw arguments into a fixed-size
+// record on the thread's own ring, and a background thread on the platform
+// side drains every ring, formats the records in timestamp order and writes
+// them out. Each ring has exactly one producer and one consumer, so an append
+// is a handful of plain stores and one release store of the write index. A
+// full ring drops the record and counts it rather than ever waiting.
+//
+// LogPrint is plain varargs, so it does read the format on the calling
+// thread, but only for the conversions: they say what type each argument was
+// passed as, and that's all it needs to take it off the list.
+//
+// The format string's address is its ID, so formats must be string literals.
+// %s arguments are kept as pointers and read at drain time, so they have to
+// outlive the call too (literals again, in practice). Width and precision
+// must be written into the format; '*' isn't supported, nor is %p or %n.
+// Arguments past LOG_MAX_ARGS are dropped.
+
+#define LOG_MAX_ARGS 5
+#define LOG_RING_RECORD_COUNT 4096
+#define LOG_MAX_LINE 512
+
+enum log_arg_type
+{
+    LogArg_Signed,
+    LogArg_Unsigned,
+    LogArg_Float,
+    LogArg_String,
+};
+
+union log_arg
+{
+    i64 Signed;
+    u64 Unsigned;
+    f64 Float;
+    const char *String;
+};
+
+// NOTE: One cache line
+struct log_record
+{
+    const char *Format;
+    u64 Timestamp;
+    u8 ArgCount;
+    u8 ArgTypes[LOG_MAX_ARGS];
+    log_arg Args[LOG_MAX_ARGS];
+};
+
+struct log_ring
+{
+    // NOTE: Producer side. Indices are free-running and wrap through the
+    // mask. CachedReadIndex saves the producer from reading the consumer's
+    // line until the ring looks full.
+    u32 volatile WriteIndex;
+    u32 CachedReadIndex;
+    u32 volatile DroppedCount;
+    u8 ProducerPad[52];
+
+    // NOTE: Consumer side
+    u32 volatile ReadIndex;
+    u32 DroppedReported;
+    u8 ConsumerPad[56];
+
+    log_record Records[LOG_RING_RECORD_COUNT];
+};
+
+struct log_state
+{
+    u32 volatile RingCount;
+    u32 MaxRings;
+    log_ring *Rings;
+};
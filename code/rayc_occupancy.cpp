@@ -0,0 +1,79 @@
+// NOTE: The three bits of a coordinate within its tile, spread to every
+// other bit
+global_variable u8 GlobalOccupancySpread[OCCUPANCY_TILE_SIZE] = {0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15};
+
+inline u32
+GetOccupancyBitIndex(i32 X, i32 Y)
+{
+    // NOTE: Morton order within the tile, X in the even bits
+    u32 Result = ((u32)GlobalOccupancySpread[X & (OCCUPANCY_TILE_SIZE - 1)] |
+                  ((u32)GlobalOccupancySpread[Y & (OCCUPANCY_TILE_SIZE - 1)] << 1));
+    return Result;
+}
+
+inline bool32
+IsCellOccupied(occupancy_grid *Grid, i32 X, i32 Y)
+{
+    // NOTE: X and Y have to be in the map
+    u64 Tile = Grid->Tiles[(Y >> OCCUPANCY_TILE_SHIFT)*Grid->TileCountX + (X >> OCCUPANCY_TILE_SHIFT)];
+    bool32 Result = (bool32)((Tile >> GetOccupancyBitIndex(X, Y)) & 1);
+    return Result;
+}
+
+internal void
+InitializeOccupancyGrid(occupancy_grid *Grid, i32 Width, i32 Height, memory_arena *Arena)
+{
+    Grid->TileCountX = (Width + OCCUPANCY_TILE_SIZE - 1) >> OCCUPANCY_TILE_SHIFT;
+    Grid->TileCountY = (Height + OCCUPANCY_TILE_SIZE - 1) >> OCCUPANCY_TILE_SHIFT;
+    Grid->Tiles = PushArray(Arena, Grid->TileCountX*Grid->TileCountY, u64);
+}
+
+internal void
+InitializeMapOccupancy(game_map *Map, memory_arena *Arena)
+{
+    InitializeOccupancyGrid(&Map->Solid, Map->Width, Map->Height, Arena);
+    InitializeOccupancyGrid(&Map->Opaque, Map->Width, Map->Height, Arena);
+}
+
+internal void
+UpdateMapOccupancy(game_map *Map)
+{
+    // NOTE: Rebuilds both grids from Tiles; call it after editing the map.
+    // Bits past the map's right and bottom edges are never looked at.
+    for (i32 TileY = 0;
+         TileY < Map->Solid.TileCountY;
+         ++TileY)
+    {
+        for (i32 TileX = 0;
+             TileX < Map->Solid.TileCountX;
+             ++TileX)
+        {
+            u64 Solid = 0;
+            u64 Opaque = 0;
+            i32 MinX = TileX*OCCUPANCY_TILE_SIZE;
+            i32 MinY = TileY*OCCUPANCY_TILE_SIZE;
+            for (i32 Y = MinY;
+                 (Y < MinY + OCCUPANCY_TILE_SIZE) && (Y < Map->Height);
+                 ++Y)
+            {
+                for (i32 X = MinX;
+                     (X < MinX + OCCUPANCY_TILE_SIZE) && (X < Map->Width);
+                     ++X)
+                {
+                    u8 Tile = Map->Tiles[Y*Map->Width + X];
+                    u64 Bit = 1ull << GetOccupancyBitIndex(X, Y);
+                    if (Tile != MapTile_Empty)
+                    {
+                        Solid |= Bit;
+                    }
+                    if ((Tile != MapTile_Empty) && (Tile != MapTile_Grate))
+                    {
+                        Opaque |= Bit;
+                    }
+                }
+            }
+            Map->Solid.Tiles[TileY*Map->Solid.TileCountX + TileX] = Solid;
+            Map->Opaque.Tiles[TileY*Map->Opaque.TileCountX + TileX] = Opaque;
+        }
+    }
+}
@@ -0,0 +1,20 @@
+// NOTE: Packed occupancy. One bit per cell, cut into 8x8 tiles of cells that
+// each fit a u64, with the cells inside a tile in Z (Morton) order and the
+// tiles themselves row-major. A step in any direction stays inside the same
+// u64 seven times out of eight, and a tile row of a 1024-wide map is 1KB, so
+// a walk down a column costs what a walk along a row does. A 16k-square map
+// is 32MB of bits where it's 256MB of tiles.
+//
+// These are only the answers the hot loops ask for. Everything else about a
+// cell (its tile type, colours, textures, heights) stays in the full arrays
+// in game_map.
+
+#define OCCUPANCY_TILE_SHIFT 3
+#define OCCUPANCY_TILE_SIZE 8
+
+struct occupancy_grid
+{
+    i32 TileCountX;
+    i32 TileCountY;
+    u64 *Tiles;
+};
@@ -0,0 +1,430 @@
+//
+// NOTE: Cell-to-cell visibility is Duerig's precise permissive field of view:
+// a cell is visible if any point of the source cell sees any point of it past
+// whole opaque cells. Each quadrant is swept in diagonals moving out from the
+// source, keeping the wedges of sight lines still open ("views") between a
+// shallow and a steep bounding line. Opaque cells bend a line in (a "bump")
+// or split a view in two. Coordinates are quadrant-relative, with the source
+// cell spanning (0,0)-(1,1).
+//
+
+struct pvs_line
+{
+    i32 XI;
+    i32 YI;
+    i32 XF;
+    i32 YF;
+};
+
+struct pvs_bump
+{
+    i32 X;
+    i32 Y;
+    i32 Parent;
+};
+
+struct pvs_view
+{
+    pvs_line Shallow;
+    pvs_line Steep;
+    // NOTE: Heads of persistent lists in the bump pool, so copying a view
+    // shares them
+    i32 ShallowBump;
+    i32 SteepBump;
+};
+
+inline i64
+RelativeSlope(pvs_line *Line, i32 X, i32 Y)
+{
+    // NOTE: Positive when the line passes below the point, negative above
+    i64 Result = ((i64)(Line->YF - Line->YI)*(Line->XF - X) -
+                  (i64)(Line->XF - Line->XI)*(Line->YF - Y));
+    return Result;
+}
+
+struct pvs_build_scratch
+{
+    // NOTE: The set being built, as a full bitset over every block
+    u64 *Dense;
+    u32 MinBlock;
+    u32 MaxBlock;
+
+    pvs_view *Views;
+    u32 ViewCount;
+    pvs_bump *Bumps;
+    u32 BumpCount;
+
+    // NOTE: Open addressing on set contents, holding set index + 1
+    u32 HashMask;
+    u32 *HashSlots;
+    u32 *SetHashes;
+    pvs_set *Sets;
+};
+
+inline void
+MarkPotentiallyVisible(potentially_visible_sets *PVS, pvs_build_scratch *Scratch, i32 CellX, i32 CellY)
+{
+    u32 Block = (u32)((CellY >> PVS_BLOCK_SHIFT)*PVS->BlocksWide + (CellX >> PVS_BLOCK_SHIFT));
+    u32 Bit = (u32)(((CellY & (PVS_BLOCK_SIZE - 1)) << PVS_BLOCK_SHIFT) | (CellX & (PVS_BLOCK_SIZE - 1)));
+    Scratch->Dense[Block] |= (1ULL << Bit);
+    if (Block < Scratch->MinBlock) Scratch->MinBlock = Block;
+    if (Block > Scratch->MaxBlock) Scratch->MaxBlock = Block;
+}
+
+internal void
+AddShallowBump(pvs_build_scratch *Scratch, pvs_view *View, i32 X, i32 Y)
+{
+    View->Shallow.XF = X;
+    View->Shallow.YF = Y;
+    pvs_bump *Bump = &Scratch->Bumps[Scratch->BumpCount];
+    Bump->X = X;
+    Bump->Y = Y;
+    Bump->Parent = View->ShallowBump;
+    View->ShallowBump = (i32)Scratch->BumpCount++;
+
+    for (i32 BumpIndex = View->SteepBump;
+         BumpIndex >= 0;
+         BumpIndex = Scratch->Bumps[BumpIndex].Parent)
+    {
+        pvs_bump *SteepBump = &Scratch->Bumps[BumpIndex];
+        if (RelativeSlope(&View->Shallow, SteepBump->X, SteepBump->Y) < 0)
+        {
+            View->Shallow.XI = SteepBump->X;
+            View->Shallow.YI = SteepBump->Y;
+        }
+    }
+}
+
+internal void
+AddSteepBump(pvs_build_scratch *Scratch, pvs_view *View, i32 X, i32 Y)
+{
+    View->Steep.XF = X;
+    View->Steep.YF = Y;
+    pvs_bump *Bump = &Scratch->Bumps[Scratch->BumpCount];
+    Bump->X = X;
+    Bump->Y = Y;
+    Bump->Parent = View->SteepBump;
+    View->SteepBump = (i32)Scratch->BumpCount++;
+
+    for (i32 BumpIndex = View->ShallowBump;
+         BumpIndex >= 0;
+         BumpIndex = Scratch->Bumps[BumpIndex].Parent)
+    {
+        pvs_bump *ShallowBump = &Scratch->Bumps[BumpIndex];
+        if (RelativeSlope(&View->Steep, ShallowBump->X, ShallowBump->Y) > 0)
+        {
+            View->Steep.XI = ShallowBump->X;
+            View->Steep.YI = ShallowBump->Y;
+        }
+    }
+}
+
+inline void
+RemoveView(pvs_build_scratch *Scratch, u32 ViewIndex)
+{
+    memmove(Scratch->Views + ViewIndex, Scratch->Views + ViewIndex + 1,
+            (Scratch->ViewCount - ViewIndex - 1)*sizeof(pvs_view));
+    --Scratch->ViewCount;
+}
+
+internal bool32
+CheckView(pvs_build_scratch *Scratch, u32 ViewIndex)
+{
+    // NOTE: A view whose lines have collapsed onto each other through a corner
+    // of the source cell has nothing left to see
+    pvs_view *View = &Scratch->Views[ViewIndex];
+    pvs_line *Shallow = &View->Shallow;
+    bool32 Result = true;
+    if ((RelativeSlope(Shallow, View->Steep.XI, View->Steep.YI) == 0) &&
+        (RelativeSlope(Shallow, View->Steep.XF, View->Steep.YF) == 0) &&
+        ((RelativeSlope(Shallow, 0, 1) == 0) || (RelativeSlope(Shallow, 1, 0) == 0)))
+    {
+        RemoveView(Scratch, ViewIndex);
+        Result = false;
+    }
+    return Result;
+}
+
+internal void
+SweepVisibleQuadrant(potentially_visible_sets *PVS, pvs_build_scratch *Scratch, game_map *Map,
+                     i32 SourceX, i32 SourceY, i32 DX, i32 DY)
+{
+    i32 ExtentX = (DX > 0) ? (Map->Width - 1 - SourceX) : SourceX;
+    i32 ExtentY = (DY > 0) ? (Map->Height - 1 - SourceY) : SourceY;
+
+    Scratch->BumpCount = 0;
+    Scratch->ViewCount = 1;
+    pvs_view *First = &Scratch->Views[0];
+    First->Shallow = {0, 1, ExtentX, 0};
+    First->Steep = {1, 0, 0, ExtentY};
+    First->ShallowBump = -1;
+    First->SteepBump = -1;
+
+    for (i32 I = 1;
+         (I <= ExtentX + ExtentY) && Scratch->ViewCount;
+         ++I)
+    {
+        i32 StartJ = (I - ExtentX > 0) ? (I - ExtentX) : 0;
+        i32 MaxJ = (I < ExtentY) ? I : ExtentY;
+        u32 ViewIndex = 0;
+        for (i32 J = StartJ;
+             (J <= MaxJ) && (ViewIndex < Scratch->ViewCount);
+             ++J)
+        {
+            i32 X = I - J;
+            i32 Y = J;
+
+            // NOTE: Skip views the cell is entirely above; stop if it's below
+            // the next one
+            while ((ViewIndex < Scratch->ViewCount) &&
+                   (RelativeSlope(&Scratch->Views[ViewIndex].Steep, X + 1, Y) >= 0))
+            {
+                ++ViewIndex;
+            }
+            if ((ViewIndex == Scratch->ViewCount) ||
+                (RelativeSlope(&Scratch->Views[ViewIndex].Shallow, X, Y + 1) <= 0))
+            {
+                continue;
+            }
+
+            i32 MapX = SourceX + X*DX;
+            i32 MapY = SourceY + Y*DY;
+            if (!IsTileOpaque(Map, MapX, MapY))
+            {
+                MarkPotentiallyVisible(PVS, Scratch, MapX, MapY);
+                continue;
+            }
+
+            pvs_view *View = &Scratch->Views[ViewIndex];
+            bool32 ShallowCrosses = (RelativeSlope(&View->Shallow, X + 1, Y) < 0);
+            bool32 SteepCrosses = (RelativeSlope(&View->Steep, X, Y + 1) > 0);
+            if (ShallowCrosses && SteepCrosses)
+            {
+                // NOTE: The cell fills the whole view
+                RemoveView(Scratch, ViewIndex);
+            }
+            else if (ShallowCrosses)
+            {
+                AddShallowBump(Scratch, View, X, Y + 1);
+                CheckView(Scratch, ViewIndex);
+            }
+            else if (SteepCrosses)
+            {
+                AddSteepBump(Scratch, View, X + 1, Y);
+                CheckView(Scratch, ViewIndex);
+            }
+            else
+            {
+                // NOTE: The cell sits inside the view; split it around the
+                // cell, shallow half first
+                memmove(Scratch->Views + ViewIndex + 1, Scratch->Views + ViewIndex,
+                        (Scratch->ViewCount - ViewIndex)*sizeof(pvs_view));
+                ++Scratch->ViewCount;
+
+                u32 ShallowIndex = ViewIndex;
+                u32 SteepIndex = ViewIndex + 1;
+                AddSteepBump(Scratch, &Scratch->Views[ShallowIndex], X + 1, Y);
+                if (!CheckView(Scratch, ShallowIndex))
+                {
+                    --SteepIndex;
+                }
+                AddShallowBump(Scratch, &Scratch->Views[SteepIndex], X, Y + 1);
+                CheckView(Scratch, SteepIndex);
+                ViewIndex = SteepIndex;
+            }
+        }
+    }
+}
+
+internal void
+BuildPotentiallyVisibleSets(potentially_visible_sets *PVS, game_map *Map, memory_arena *Arena)
+{
+    // NOTE: One field-of-view sweep per open cell, four quadrants each. Cost
+    // follows how much each cell sees, so mazes are cheap and huge open maps
+    // are not.
+    i32 Width = Map->Width;
+    i32 Height = Map->Height;
+    u32 CellCount = (u32)(Width*Height);
+    i32 BlocksWide = (Width + PVS_BLOCK_SIZE - 1) >> PVS_BLOCK_SHIFT;
+    i32 BlocksHigh = (Height + PVS_BLOCK_SIZE - 1) >> PVS_BLOCK_SHIFT;
+    u32 DenseCount = (u32)(BlocksWide*BlocksHigh);
+
+    PVS->Width = Width;
+    PVS->Height = Height;
+    PVS->BlocksWide = BlocksWide;
+    PVS->CellSets = PushArray(Arena, CellCount, u32);
+
+    // NOTE: Scratch is borrowed from the far end of the arena's free space and
+    // never pushed. The blocks are the last thing pushed while building, so
+    // they grow in place up toward it; the sets go in after them at the end.
+    // A sweep adds at most one view and two bumps per cell it visits.
+    u32 HashCount = 1;
+    while (HashCount < 2*CellCount)
+    {
+        HashCount <<= 1;
+    }
+    memory_index ScratchSize = (CellCount*sizeof(pvs_set) + DenseCount*sizeof(u64) +
+                                (CellCount + 1)*sizeof(pvs_view) + 2*CellCount*sizeof(pvs_bump) +
+                                CellCount*sizeof(u32) + HashCount*sizeof(u32) + 64);
+    Assert(Arena->Used + ScratchSize <= Arena->Size);
+    u8 *ScratchAt = (u8 *)(((memory_index)(Arena->Base + Arena->Size - ScratchSize) + 7) & ~(memory_index)7);
+    pvs_build_scratch Scratch;
+    Scratch.Sets = (pvs_set *)ScratchAt;        ScratchAt += CellCount*sizeof(pvs_set);
+    Scratch.Dense = (u64 *)ScratchAt;           ScratchAt += DenseCount*sizeof(u64);
+    Scratch.Views = (pvs_view *)ScratchAt;      ScratchAt += (CellCount + 1)*sizeof(pvs_view);
+    Scratch.Bumps = (pvs_bump *)ScratchAt;      ScratchAt += 2*CellCount*sizeof(pvs_bump);
+    Scratch.SetHashes = (u32 *)ScratchAt;       ScratchAt += CellCount*sizeof(u32);
+    Scratch.HashSlots = (u32 *)ScratchAt;
+    Scratch.HashMask = HashCount - 1;
+    memset(Scratch.Dense, 0, DenseCount*sizeof(u64));
+    memset(Scratch.HashSlots, 0, HashCount*sizeof(u32));
+    u8 *ScratchBase = (u8 *)Scratch.Sets;
+
+    PVS->Blocks = (pvs_block *)PushSize_(Arena, 0);
+    PVS->BlockCount = 0;
+    PVS->SetCount = 0;
+
+    for (u32 SourceCell = 0;
+         SourceCell < CellCount;
+         ++SourceCell)
+    {
+        i32 SourceX = (i32)SourceCell % Width;
+        i32 SourceY = (i32)SourceCell / Width;
+        if (IsTileSolid(Map, SourceX, SourceY))
+        {
+            PVS->CellSets[SourceCell] = PVS_NO_SET;
+            continue;
+        }
+
+        Scratch.MinBlock = 0xFFFFFFFF;
+        Scratch.MaxBlock = 0;
+        MarkPotentiallyVisible(PVS, &Scratch, SourceX, SourceY);
+        SweepVisibleQuadrant(PVS, &Scratch, Map, SourceX, SourceY, 1, 1);
+        SweepVisibleQuadrant(PVS, &Scratch, Map, SourceX, SourceY, -1, 1);
+        SweepVisibleQuadrant(PVS, &Scratch, Map, SourceX, SourceY, 1, -1);
+        SweepVisibleQuadrant(PVS, &Scratch, Map, SourceX, SourceY, -1, -1);
+
+        // NOTE: Append the set's blocks, clearing the bitset as they're read
+        pvs_block *Blocks = PVS->Blocks + PVS->BlockCount;
+        u32 BlockCount = 0;
+        u64 Hash = 14695981039346656037ULL;
+        for (u32 Block = Scratch.MinBlock;
+             Block <= Scratch.MaxBlock;
+             ++Block)
+        {
+            u64 Mask = Scratch.Dense[Block];
+            if (Mask)
+            {
+                Assert((u8 *)(Blocks + BlockCount + 1) <= ScratchBase);
+                Blocks[BlockCount].Mask = Mask;
+                Blocks[BlockCount].Index = Block;
+                ++BlockCount;
+                Scratch.Dense[Block] = 0;
+
+                Hash = (Hash ^ Mask)*1099511628211ULL;
+                Hash = (Hash ^ Block)*1099511628211ULL;
+            }
+        }
+        u32 SetHash = (u32)(Hash ^ (Hash >> 32));
+
+        // NOTE: Reuse an identical set if there is one; the blocks just
+        // written are then simply overwritten by the next set
+        u32 SetIndex = PVS_NO_SET;
+        u32 Slot = SetHash & Scratch.HashMask;
+        while (Scratch.HashSlots[Slot])
+        {
+            u32 Candidate = Scratch.HashSlots[Slot] - 1;
+            pvs_set *Existing = &Scratch.Sets[Candidate];
+            if ((Scratch.SetHashes[Candidate] == SetHash) && (Existing->BlockCount == BlockCount))
+            {
+                pvs_block *ExistingBlocks = PVS->Blocks + Existing->FirstBlock;
+                bool32 Same = true;
+                for (u32 BlockIndex = 0;
+                     Same && (BlockIndex < BlockCount);
+                     ++BlockIndex)
+                {
+                    Same = ((ExistingBlocks[BlockIndex].Mask == Blocks[BlockIndex].Mask) &&
+                            (ExistingBlocks[BlockIndex].Index == Blocks[BlockIndex].Index));
+                }
+                if (Same)
+                {
+                    SetIndex = Candidate;
+                    break;
+                }
+            }
+            Slot = (Slot + 1) & Scratch.HashMask;
+        }
+
+        if (SetIndex == PVS_NO_SET)
+        {
+            SetIndex = PVS->SetCount++;
+            Scratch.Sets[SetIndex].FirstBlock = PVS->BlockCount;
+            Scratch.Sets[SetIndex].BlockCount = BlockCount;
+            Scratch.SetHashes[SetIndex] = SetHash;
+            Scratch.HashSlots[Slot] = SetIndex + 1;
+            PVS->BlockCount += BlockCount;
+        }
+        PVS->CellSets[SourceCell] = SetIndex;
+    }
+
+    Arena->Used = (memory_index)((u8 *)(PVS->Blocks + PVS->BlockCount) - Arena->Base);
+    PVS->Sets = PushArray(Arena, PVS->SetCount, pvs_set);
+    memmove(PVS->Sets, Scratch.Sets, PVS->SetCount*sizeof(pvs_set));
+}
+
+inline pvs_set *
+GetPotentiallyVisibleSet(potentially_visible_sets *PVS, f32 X, f32 Y)
+{
+    // NOTE: Null when there's nothing to go on: no sets built, or a point
+    // outside the map or inside a wall. Null means everything is visible.
+    pvs_set *Result = 0;
+    i32 CellX = TruncateF32ToI32(X);
+    i32 CellY = TruncateF32ToI32(Y);
+    if (PVS->CellSets &&
+        (CellX >= 0) && (CellX < PVS->Width) && (CellY >= 0) && (CellY < PVS->Height))
+    {
+        u32 SetIndex = PVS->CellSets[CellY*PVS->Width + CellX];
+        if (SetIndex != PVS_NO_SET)
+        {
+            Result = PVS->Sets + SetIndex;
+        }
+    }
+    return Result;
+}
+
+inline bool32
+IsInPotentiallyVisibleSet(potentially_visible_sets *PVS, pvs_set *Set, f32 X, f32 Y)
+{
+    bool32 Result = true;
+    if (Set)
+    {
+        Result = false;
+        i32 CellX = TruncateF32ToI32(X);
+        i32 CellY = TruncateF32ToI32(Y);
+        if ((CellX >= 0) && (CellX < PVS->Width) && (CellY >= 0) && (CellY < PVS->Height))
+        {
+            u32 Block = (u32)((CellY >> PVS_BLOCK_SHIFT)*PVS->BlocksWide + (CellX >> PVS_BLOCK_SHIFT));
+            u32 Bit = (u32)(((CellY & (PVS_BLOCK_SIZE - 1)) << PVS_BLOCK_SHIFT) | (CellX & (PVS_BLOCK_SIZE - 1)));
+
+            // NOTE: Blocks are sorted by index
+            pvs_block *Blocks = PVS->Blocks + Set->FirstBlock;
+            u32 Low = 0;
+            u32 High = Set->BlockCount;
+            while (Low < High)
+            {
+                u32 Middle = (Low + High) >> 1;
+                if (Blocks[Middle].Index < Block)
+                {
+                    Low = Middle + 1;
+                }
+                else
+                {
+                    High = Middle;
+                }
+            }
+            Result = ((Low < Set->BlockCount) && (Blocks[Low].Index == Block) &&
+                      (Blocks[Low].Mask & (1ULL << Bit)));
+        }
+    }
+    return Result;
+}
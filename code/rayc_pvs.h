@@ -0,0 +1,43 @@
+// NOTE: Potentially visible sets. Built once when a map loads: for every open
+// cell, every open cell that can be seen from anywhere inside it. Grates
+// count as see-through, so the sets cover everything the line-of-sight
+// queries (which stop at any solid cell) can report.
+//
+// Sets are stored sparse. The map is cut into PVS_BLOCK_SIZE-square blocks
+// of cells, one u64 bit per cell, and a set only lists the blocks it has any
+// bits in, sorted by block index. Neighbouring cells usually see exactly the
+// same cells (anywhere in one room, say), so identical sets are stored once
+// and shared.
+
+#define PVS_BLOCK_SIZE 8
+#define PVS_BLOCK_SHIFT 3
+#define PVS_NO_SET 0xFFFFFFFF
+
+struct pvs_block
+{
+    u64 Mask;
+    u32 Index;
+};
+
+struct pvs_set
+{
+    u32 FirstBlock;
+    u32 BlockCount;
+};
+
+struct potentially_visible_sets
+{
+    // NOTE: Zero when no sets have been built; every cell then counts as visible
+    i32 Width;
+    i32 Height;
+    i32 BlocksWide;
+
+    // NOTE: Row-major, Width*Height. PVS_NO_SET for solid cells.
+    u32 *CellSets;
+
+    u32 SetCount;
+    pvs_set *Sets;
+
+    u32 BlockCount;
+    pvs_block *Blocks;
+};
@@ -0,0 +1,270 @@
+internal void
+InitializeEventScheduler(event_scheduler *Scheduler, u32 Capacity, u64 StartTick, memory_arena *Arena)
+{
+    Scheduler->CurrentTick = StartTick;
+    Scheduler->Capacity = Capacity;
+    Scheduler->PendingCount = 0;
+    Scheduler->DroppedCount = 0;
+    Scheduler->Nodes = PushArray(Arena, EVENT_SENTINEL_COUNT + Capacity, scheduled_event);
+
+    for (u32 Level = 0;
+         Level < EVENT_WHEEL_LEVELS;
+         ++Level)
+    {
+        Scheduler->SlotMasks[Level] = 0;
+    }
+
+    for (u32 SentinelIndex = 0;
+         SentinelIndex < EVENT_SENTINEL_COUNT;
+         ++SentinelIndex)
+    {
+        scheduled_event *Sentinel = &Scheduler->Nodes[SentinelIndex];
+        *Sentinel = {};
+        Sentinel->Next = SentinelIndex;
+        Sentinel->Prev = SentinelIndex;
+        Sentinel->List = (u16)SentinelIndex;
+    }
+
+    // NOTE: Hand out low nodes first, so a small load stays in a few cache
+    // lines
+    Scheduler->FirstFree = EVENT_NO_NODE;
+    for (u32 EventIndex = Capacity;
+         EventIndex > 0;
+         --EventIndex)
+    {
+        u32 NodeIndex = EVENT_SENTINEL_COUNT + EventIndex - 1;
+        scheduled_event *Node = &Scheduler->Nodes[NodeIndex];
+        *Node = {};
+        Node->List = EVENT_FREE_LIST;
+        Node->Next = Scheduler->FirstFree;
+        Scheduler->FirstFree = NodeIndex;
+    }
+}
+
+internal void
+LinkScheduledEvent(event_scheduler *Scheduler, u32 NodeIndex, u32 List)
+{
+    scheduled_event *Node = &Scheduler->Nodes[NodeIndex];
+    scheduled_event *Sentinel = &Scheduler->Nodes[List];
+
+    Node->List = (u16)List;
+    Node->Next = List;
+    Node->Prev = Sentinel->Prev;
+    Scheduler->Nodes[Sentinel->Prev].Next = NodeIndex;
+    Sentinel->Prev = NodeIndex;
+
+    if (List < EVENT_DUE_LIST)
+    {
+        Scheduler->SlotMasks[List >> EVENT_WHEEL_BITS] |= (1ULL << (List & (EVENT_WHEEL_SLOTS - 1)));
+    }
+}
+
+internal void
+UnlinkScheduledEvent(event_scheduler *Scheduler, u32 NodeIndex)
+{
+    scheduled_event *Node = &Scheduler->Nodes[NodeIndex];
+    Scheduler->Nodes[Node->Prev].Next = Node->Next;
+    Scheduler->Nodes[Node->Next].Prev = Node->Prev;
+
+    u32 List = Node->List;
+    if ((List < EVENT_DUE_LIST) &&
+        (Scheduler->Nodes[List].Next == List))
+    {
+        Scheduler->SlotMasks[List >> EVENT_WHEEL_BITS] &= ~(1ULL << (List & (EVENT_WHEEL_SLOTS - 1)));
+    }
+}
+
+internal void
+FreeScheduledEvent(event_scheduler *Scheduler, u32 NodeIndex)
+{
+    scheduled_event *Node = &Scheduler->Nodes[NodeIndex];
+    // NOTE: Any handle to the event goes stale here
+    ++Node->Generation;
+    Node->List = EVENT_FREE_LIST;
+    Node->Type = GameEvent_None;
+    Node->Next = Scheduler->FirstFree;
+    Scheduler->FirstFree = NodeIndex;
+    --Scheduler->PendingCount;
+}
+
+// NOTE: Puts an event in the finest slot that its fire tick is still ahead of
+// the wheel in: the lowest level where it's less than a full turn of slots
+// away. An event that's due this very tick (only ever from a cascade) goes on
+// level 0's current slot, which Advance empties right after cascading.
+internal void
+PlaceScheduledEvent(event_scheduler *Scheduler, u32 NodeIndex)
+{
+    scheduled_event *Node = &Scheduler->Nodes[NodeIndex];
+    u64 FireTick = Node->FireTick;
+    u64 CurrentTick = Scheduler->CurrentTick;
+
+    u32 List = 0;
+    u32 Level = 0;
+    for (;
+         Level < EVENT_WHEEL_LEVELS;
+         ++Level)
+    {
+        u32 Shift = Level*EVENT_WHEEL_BITS;
+        if (((FireTick >> Shift) - (CurrentTick >> Shift)) < EVENT_WHEEL_SLOTS)
+        {
+            List = Level*EVENT_WHEEL_SLOTS + (u32)((FireTick >> Shift) & (EVENT_WHEEL_SLOTS - 1));
+            break;
+        }
+    }
+
+    if (Level == EVENT_WHEEL_LEVELS)
+    {
+        // NOTE: Further off than the wheel reaches. Park it in the top-level
+        // slot the wheel gets to last, and it'll be placed again from there.
+        u32 Shift = (EVENT_WHEEL_LEVELS - 1)*EVENT_WHEEL_BITS;
+        List = ((EVENT_WHEEL_LEVELS - 1)*EVENT_WHEEL_SLOTS +
+                (u32)(((CurrentTick >> Shift) + EVENT_WHEEL_SLOTS - 1) & (EVENT_WHEEL_SLOTS - 1)));
+    }
+
+    LinkScheduledEvent(Scheduler, NodeIndex, List);
+}
+
+// NOTE: Fires Delay ticks after the wheel's current tick; a delay of zero
+// means the next tick, since this one has already been run. The handle is
+// only needed to cancel the event, and is invalid (Index EVENT_NO_NODE) if the
+// pool was full.
+internal event_handle
+ScheduleEvent(event_scheduler *Scheduler, u64 Delay, game_event_type Type, u32 Target, u32 Param)
+{
+    event_handle Result = {EVENT_NO_NODE, 0};
+
+    u32 NodeIndex = Scheduler->FirstFree;
+    if (NodeIndex != EVENT_NO_NODE)
+    {
+        scheduled_event *Node = &Scheduler->Nodes[NodeIndex];
+        Scheduler->FirstFree = Node->Next;
+        ++Scheduler->PendingCount;
+
+        Node->FireTick = Scheduler->CurrentTick + ((Delay > 0) ? Delay : 1);
+        Node->Type = (u16)Type;
+        Node->Target = Target;
+        Node->Param = Param;
+        PlaceScheduledEvent(Scheduler, NodeIndex);
+
+        Result.Index = NodeIndex;
+        Result.Generation = Node->Generation;
+    }
+    else
+    {
+        ++Scheduler->DroppedCount;
+    }
+
+    return Result;
+}
+
+internal bool32
+IsEventPending(event_scheduler *Scheduler, event_handle Handle)
+{
+    bool32 Result = ((Handle.Index >= EVENT_SENTINEL_COUNT) &&
+                     (Handle.Index < EVENT_SENTINEL_COUNT + Scheduler->Capacity) &&
+                     (Scheduler->Nodes[Handle.Index].Generation == Handle.Generation) &&
+                     (Scheduler->Nodes[Handle.Index].List != EVENT_FREE_LIST));
+    return Result;
+}
+
+// NOTE: Safe on an event that has already fired or been cancelled; that just
+// returns false
+internal bool32
+CancelEvent(event_scheduler *Scheduler, event_handle Handle)
+{
+    bool32 Result = IsEventPending(Scheduler, Handle);
+    if (Result)
+    {
+        UnlinkScheduledEvent(Scheduler, Handle.Index);
+        FreeScheduledEvent(Scheduler, Handle.Index);
+    }
+    return Result;
+}
+
+// NOTE: Detaches a whole slot's list from its sentinel and returns the first
+// node, or the sentinel itself if the slot was empty. The detached chain still
+// ends by pointing back at the sentinel.
+internal u32
+DetachEventSlot(event_scheduler *Scheduler, u32 List)
+{
+    scheduled_event *Sentinel = &Scheduler->Nodes[List];
+    u32 Result = Sentinel->Next;
+    Sentinel->Next = List;
+    Sentinel->Prev = List;
+    Scheduler->SlotMasks[List >> EVENT_WHEEL_BITS] &= ~(1ULL << (List & (EVENT_WHEEL_SLOTS - 1)));
+    return Result;
+}
+
+internal void
+AdvanceEventSchedulerOneTick(event_scheduler *Scheduler)
+{
+    u64 Tick = ++Scheduler->CurrentTick;
+
+    // NOTE: Cascade from the top down, so an event coming down two levels at
+    // once lands in a slot that still gets looked at this tick
+    for (u32 Level = EVENT_WHEEL_LEVELS - 1;
+         Level > 0;
+         --Level)
+    {
+        u32 Shift = Level*EVENT_WHEEL_BITS;
+        if ((Tick & ((1ULL << Shift) - 1)) == 0)
+        {
+            u32 Slot = (u32)((Tick >> Shift) & (EVENT_WHEEL_SLOTS - 1));
+            if (Scheduler->SlotMasks[Level] & (1ULL << Slot))
+            {
+                u32 List = Level*EVENT_WHEEL_SLOTS + Slot;
+                u32 NodeIndex = DetachEventSlot(Scheduler, List);
+                while (NodeIndex != List)
+                {
+                    u32 NextIndex = Scheduler->Nodes[NodeIndex].Next;
+                    PlaceScheduledEvent(Scheduler, NodeIndex);
+                    NodeIndex = NextIndex;
+                }
+            }
+        }
+    }
+
+    u32 Slot = (u32)(Tick & (EVENT_WHEEL_SLOTS - 1));
+    if (Scheduler->SlotMasks[0] & (1ULL << Slot))
+    {
+        u32 NodeIndex = DetachEventSlot(Scheduler, Slot);
+        while (NodeIndex != Slot)
+        {
+            u32 NextIndex = Scheduler->Nodes[NodeIndex].Next;
+            Assert(Scheduler->Nodes[NodeIndex].FireTick == Tick);
+            LinkScheduledEvent(Scheduler, NodeIndex, EVENT_DUE_LIST);
+            NodeIndex = NextIndex;
+        }
+    }
+}
+
+// NOTE: Moves the wheel up to Tick, queueing everything due on the way. Call
+// PopDueEvent until it runs dry to fire them.
+internal void
+AdvanceEventScheduler(event_scheduler *Scheduler, u64 Tick)
+{
+    while (Scheduler->CurrentTick < Tick)
+    {
+        AdvanceEventSchedulerOneTick(Scheduler);
+    }
+}
+
+// NOTE: Hands back the next due event, in the order they were queued, and
+// frees its node. Events are popped one at a time so whatever handles one can
+// schedule new events or cancel due ones.
+internal bool32
+PopDueEvent(event_scheduler *Scheduler, scheduled_event *Event)
+{
+    bool32 Result = false;
+
+    u32 NodeIndex = Scheduler->Nodes[EVENT_DUE_LIST].Next;
+    if (NodeIndex != EVENT_DUE_LIST)
+    {
+        *Event = Scheduler->Nodes[NodeIndex];
+        UnlinkScheduledEvent(Scheduler, NodeIndex);
+        FreeScheduledEvent(Scheduler, NodeIndex);
+        Result = true;
+    }
+
+    return Result;
+}
@@ -0,0 +1,74 @@
+// NOTE: Game event scheduler: a hierarchical timing wheel driven by the sim
+// tick. Level 0 has a slot per tick for the next EVENT_WHEEL_SLOTS ticks;
+// each level up has slots EVENT_WHEEL_SLOTS times as long. An event goes in
+// the level its delay fits, and each time the level below wraps around, the
+// next slot up is emptied back down into finer slots (a cascade). Inserting,
+// cancelling and firing are all constant time, and an event cascades at most
+// EVENT_WHEEL_LEVELS - 1 times however long it waits.
+//
+// Every slot is a circular doubly linked list threaded through the node pool,
+// with a sentinel node of its own, so cancelling unlinks a node without
+// knowing where it is. A bitmask per level says which slots have anything in
+// them; a tick where nothing fires costs one bit test, and there's no scan
+// over pending events ever.
+//
+// Delays beyond the top level simply ride round it again until they fit.
+// Nodes are addressed by index, so the whole scheduler snapshots with the
+// arena it lives in.
+
+#define EVENT_WHEEL_BITS 6
+#define EVENT_WHEEL_SLOTS (1 << EVENT_WHEEL_BITS)
+#define EVENT_WHEEL_LEVELS 4
+#define EVENT_SENTINEL_COUNT (EVENT_WHEEL_LEVELS*EVENT_WHEEL_SLOTS + 1)
+// NOTE: Sentinel of the list events due this tick sit on until popped
+#define EVENT_DUE_LIST (EVENT_WHEEL_LEVELS*EVENT_WHEEL_SLOTS)
+#define EVENT_FREE_LIST 0xFFFF
+#define EVENT_NO_NODE 0xFFFFFFFF
+
+enum game_event_type
+{
+    GameEvent_None,
+    // NOTE: Target is a light index; the light switches and reschedules itself
+    GameEvent_ToggleLight,
+
+    GameEvent_Count,
+};
+
+struct event_handle
+{
+    u32 Index;
+    u32 Generation;
+};
+
+struct scheduled_event
+{
+    u32 Next;
+    u32 Prev;
+    u64 FireTick;
+    // NOTE: Which list the node is on: a wheel slot (Level*EVENT_WHEEL_SLOTS
+    // + Slot), EVENT_DUE_LIST, or EVENT_FREE_LIST
+    u16 List;
+    u16 Type;
+    u32 Generation;
+
+    // NOTE: Whatever the event type wants, usually an entity slot or index
+    u32 Target;
+    u32 Param;
+};
+
+struct event_scheduler
+{
+    // NOTE: The last tick the wheel was advanced to
+    u64 CurrentTick;
+
+    u64 SlotMasks[EVENT_WHEEL_LEVELS];
+
+    // NOTE: EVENT_SENTINEL_COUNT sentinels, then Capacity event nodes
+    u32 Capacity;
+    u32 PendingCount;
+    u32 FirstFree;
+    scheduled_event *Nodes;
+
+    // NOTE: Events that couldn't be scheduled because the pool was full
+    u32 DroppedCount;
+};
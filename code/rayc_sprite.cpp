@@ -0,0 +1,215 @@
+internal sprite
+LoadSprite(texture *Texture, memory_arena *Arena)
+{
+    sprite Result = {};
+    if (Texture->Pixels)
+    {
+        i32 Width = Texture->Width;
+        i32 Height = Texture->Height;
+        Assert(Height <= 0xFFFF);
+
+        Result.Width = Width;
+        Result.Height = Height;
+        Result.Texels = PushArray(Arena, Width*Height, u32);
+        Result.ColumnRunStart = PushArray(Arena, Width + 1, u32);
+        // NOTE: Worst case is a column alternating opaque and transparent
+        Result.Runs = PushArray(Arena, Width*((Height + 1)/2), sprite_run);
+
+        for (i32 X = 0;
+             X < Width;
+             ++X)
+        {
+            Result.ColumnRunStart[X] = Result.RunCount;
+            bool32 InRun = false;
+            for (i32 Y = 0;
+                 Y < Height;
+                 ++Y)
+            {
+                // NOTE: BMP rows are stored bottom-up
+                u32 Texel = *(u32 *)((u8 *)Texture->Pixels + (Height - 1 - Y)*Texture->Pitch + X*sizeof(u32));
+                Result.Texels[X*Height + Y] = Texel;
+
+                bool32 Opaque = ((Texel >> 24) >= 0x80);
+                if (Opaque)
+                {
+                    if (!InRun)
+                    {
+                        Result.Runs[Result.RunCount].Start = (u16)Y;
+                        Result.Runs[Result.RunCount].Count = 0;
+                        InRun = true;
+                    }
+                    ++Result.Runs[Result.RunCount].Count;
+                    ++Result.OpaqueTexelCount;
+                }
+                else if (InRun)
+                {
+                    ++Result.RunCount;
+                    InRun = false;
+                }
+            }
+            if (InRun)
+            {
+                ++Result.RunCount;
+            }
+        }
+        Result.ColumnRunStart[Width] = Result.RunCount;
+    }
+
+    return Result;
+}
+
+inline i32
+SpriteRowForTexel(i32 TexelRow, i32 StepV)
+{
+    // NOTE: First destination row, relative to the sprite's top, whose sample
+    // lands on or past TexelRow. Samples are taken at pixel centers.
+    i64 Numerator = ((i64)TexelRow << 16) - (StepV >> 1);
+    i32 Result = 0;
+    if (Numerator > 0)
+    {
+        Result = (i32)((Numerator + StepV - 1) / StepV);
+    }
+    return Result;
+}
+
+inline bool32
+SpriteColumnNextRun(sprite *Sprite, bool32 Unscaled, i32 StepV, i32 RelMinY, i32 RelMaxY,
+                    u32 *Run, u32 RunEnd, i32 *RowMin, i32 *RowMax)
+{
+    // NOTE: Moves a column to its next run that has any rows left after clipping
+    while (*Run < RunEnd)
+    {
+        sprite_run *SpriteRun = &Sprite->Runs[(*Run)++];
+        i32 Start = SpriteRun->Start;
+        i32 End = Start + SpriteRun->Count;
+        i32 Min = Unscaled ? Start : SpriteRowForTexel(Start, StepV);
+        i32 Max = Unscaled ? End : SpriteRowForTexel(End, StepV);
+        if (Min < RelMinY) Min = RelMinY;
+        if (Max > RelMaxY) Max = RelMaxY;
+        if (Min < Max)
+        {
+            *RowMin = Min;
+            *RowMax = Max;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <sprite_blit_mode Mode>
+internal void
+DrawSpriteColumns(column_buffer *Buffer, sprite *Sprite,
+                  i32 Left, i32 Top, i32 DestWidth, i32 DestHeight,
+                  f32 Depth, ray_data *Rays, i32 RayCount)
+{
+    // NOTE: One destination column at a time. Each run of opaque texels is a
+    // contiguous stretch of the source column and of the destination column,
+    // so unscaled runs are straight copies and scaled ones a strided read
+    // into a sequential write.
+    bool32 Unscaled = (Mode == SpriteBlit_Unscaled);
+
+    // NOTE: 16.16 texels per destination pixel
+    i32 StepU = Unscaled ? (1 << 16) : (i32)(((i64)Sprite->Width << 16) / DestWidth);
+    i32 StepV = Unscaled ? (1 << 16) : (i32)(((i64)Sprite->Height << 16) / DestHeight);
+
+    // NOTE: Destination rectangle relative to Left, Top after clipping
+    i32 RelMinX = 0;
+    i32 RelMaxX = DestWidth;
+    i32 RelMinY = 0;
+    i32 RelMaxY = DestHeight;
+    if (Mode == SpriteBlit_Clipped)
+    {
+        if (Left < 0) RelMinX = -Left;
+        if (Top < 0) RelMinY = -Top;
+        if (Left + DestWidth > Buffer->Width) RelMaxX = Buffer->Width - Left;
+        if (Top + DestHeight > Buffer->Height) RelMaxY = Buffer->Height - Top;
+    }
+
+    for (i32 X = RelMinX;
+         X < RelMaxX;
+         ++X)
+    {
+        bool32 Visible = true;
+        if (Rays)
+        {
+            i32 RayIndex = (Left + X)*RayCount / Buffer->Width;
+            Visible = (Depth < Rays[RayIndex].Distance);
+        }
+
+        if (Visible)
+        {
+            i32 U = Unscaled ? X : ((X*StepU + (StepU >> 1)) >> 16);
+            u32 *SourceColumn = Sprite->Texels + U*Sprite->Height;
+            u32 *DestColumn = GetColumn(Buffer, Left + X) + Top;
+            u32 Run = Sprite->ColumnRunStart[U];
+            u32 RunEnd = Sprite->ColumnRunStart[U + 1];
+            i32 RowMin;
+            i32 RowMax;
+            while (SpriteColumnNextRun(Sprite, Unscaled, StepV, RelMinY, RelMaxY,
+                                       &Run, RunEnd, &RowMin, &RowMax))
+            {
+                CountColumnWrites(Buffer, Left + X, Left + X + 1, Top + RowMin, Top + RowMax);
+                if (Unscaled)
+                {
+                    for (i32 Row = RowMin;
+                         Row < RowMax;
+                         ++Row)
+                    {
+                        DestColumn[Row] = SourceColumn[Row];
+                    }
+                }
+                else
+                {
+                    u32 V = (u32)(RowMin*StepV + (StepV >> 1));
+                    for (i32 Row = RowMin;
+                         Row < RowMax;
+                         ++Row)
+                    {
+                        DestColumn[Row] = SourceColumn[V >> 16];
+                        V += (u32)StepV;
+                    }
+                }
+            }
+        }
+    }
+}
+
+internal void
+DrawSprite(column_buffer *Buffer, sprite *Sprite,
+           f32 RealCenterX, f32 RealMinY, f32 RealWidth, f32 RealHeight,
+           f32 Depth, ray_data *Rays, i32 RayCount)
+{
+    // NOTE: Rays is optional. When given, a column is only drawn where the
+    // sprite is nearer than the wall its ray hit.
+    if (Sprite->Texels)
+    {
+        i32 DestWidth = RoundF32ToI32(RealWidth);
+        i32 DestHeight = RoundF32ToI32(RealHeight);
+        i32 Left = (i32)floorf(RealCenterX - RealWidth/2.0f + 0.5f);
+        i32 Top = (i32)floorf(RealMinY + 0.5f);
+
+        if ((DestWidth > 0) && (DestHeight > 0) &&
+            (Left < Buffer->Width) && (Left + DestWidth > 0) &&
+            (Top < Buffer->Height) && (Top + DestHeight > 0))
+        {
+            bool32 OnScreen = ((Left >= 0) && (Left + DestWidth <= Buffer->Width) &&
+                               (Top >= 0) && (Top + DestHeight <= Buffer->Height));
+            if (OnScreen && (DestWidth == Sprite->Width) && (DestHeight == Sprite->Height))
+            {
+                DrawSpriteColumns<SpriteBlit_Unscaled>(Buffer, Sprite, Left, Top, DestWidth, DestHeight,
+                                                       Depth, Rays, RayCount);
+            }
+            else if (OnScreen)
+            {
+                DrawSpriteColumns<SpriteBlit_Unclipped>(Buffer, Sprite, Left, Top, DestWidth, DestHeight,
+                                                        Depth, Rays, RayCount);
+            }
+            else
+            {
+                DrawSpriteColumns<SpriteBlit_Clipped>(Buffer, Sprite, Left, Top, DestWidth, DestHeight,
+                                                      Depth, Rays, RayCount);
+            }
+        }
+    }
+}
@@ -0,0 +1,43 @@
+// NOTE: Alpha-tested sprites. At load time each texture column is scanned for
+// runs of opaque texels; drawing walks only those runs, so transparent texels
+// cost nothing. Texels are copied out column-major (top row first) so a run is
+// contiguous in memory.
+
+struct sprite_run
+{
+    // NOTE: Texel rows [Start, Start + Count), top-down
+    u16 Start;
+    u16 Count;
+};
+
+struct sprite
+{
+    i32 Width;
+    i32 Height;
+
+    // NOTE: Column-major, Width*Height
+    u32 *Texels;
+
+    // NOTE: Runs for column X are Runs[ColumnRunStart[X]] up to
+    // Runs[ColumnRunStart[X + 1]]
+    u32 *ColumnRunStart;
+    sprite_run *Runs;
+    u32 RunCount;
+    u32 OpaqueTexelCount;
+};
+
+enum sprite_blit_mode
+{
+    // NOTE: 1:1 texels to pixels and entirely on screen
+    SpriteBlit_Unscaled,
+    // NOTE: Scaled, but entirely on screen
+    SpriteBlit_Unclipped,
+    SpriteBlit_Clipped,
+};
+
+struct sprite_draw
+{
+    u32 EntityIndex;
+    f32 Depth;
+    f32 ScreenX;
+};
@@ -0,0 +1,183 @@
+// NOTE: Batched line-of-sight queries. Each query walks the grid cells its
+// segment crosses (Amanatides & Woo DDA) and stops at the first solid cell or
+// at the target. Queries run four to a SIMD register; only the tile fetch is
+// done per lane, since SSE2 has no gather.
+//
+// All arrays are caller-owned and Count long. Outputs:
+//   Occluded    - nonzero if a wall is in the way
+//   HitDistance - distance from source to where the segment enters the first
+//                 solid cell, or the full source-target distance if visible
+
+struct visibility_query_batch
+{
+    u32 Count;
+
+    f32 *SourceX;
+    f32 *SourceY;
+    f32 *TargetX;
+    f32 *TargetY;
+
+    u8 *Occluded;
+    f32 *HitDistance;
+};
+
+// NOTE: Stands in for an infinite parametric step along an axis the segment
+// doesn't move in
+#define VISIBILITY_NO_CROSSING 1.0e30f
+
+internal void
+QueryLineOfSight4(game_map *Map,
+                  f32 *SourceXs, f32 *SourceYs, f32 *TargetXs, f32 *TargetYs,
+                  u8 *OccludedOut, f32 *HitDistanceOut)
+{
+    __m128 Zero = _mm_setzero_ps();
+    __m128 One = _mm_set1_ps(1.0f);
+    __m128 NoCrossing = _mm_set1_ps(VISIBILITY_NO_CROSSING);
+    __m128i OneI = _mm_set1_epi32(1);
+
+    __m128 SourceX = _mm_loadu_ps(SourceXs);
+    __m128 SourceY = _mm_loadu_ps(SourceYs);
+    __m128 DirX = _mm_sub_ps(_mm_loadu_ps(TargetXs), SourceX);
+    __m128 DirY = _mm_sub_ps(_mm_loadu_ps(TargetYs), SourceY);
+    __m128 Length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(DirX, DirX), _mm_mul_ps(DirY, DirY)));
+
+    // NOTE: Positions inside the map are never negative, so truncation is floor
+    __m128i CellX = _mm_cvttps_epi32(SourceX);
+    __m128i CellY = _mm_cvttps_epi32(SourceY);
+
+    __m128 PositiveX = _mm_cmpgt_ps(DirX, Zero);
+    __m128 PositiveY = _mm_cmpgt_ps(DirY, Zero);
+    __m128 MovesX = _mm_cmpneq_ps(DirX, Zero);
+    __m128 MovesY = _mm_cmpneq_ps(DirY, Zero);
+
+    // NOTE: Step is +1 where the direction is positive, -1 otherwise
+    __m128i StepX = _mm_sub_epi32(_mm_and_si128(_mm_castps_si128(PositiveX), _mm_set1_epi32(2)), OneI);
+    __m128i StepY = _mm_sub_epi32(_mm_and_si128(_mm_castps_si128(PositiveY), _mm_set1_epi32(2)), OneI);
+
+    // NOTE: Parametric distance (0 at source, 1 at target) to the first cell
+    // boundary on each axis, and between successive boundaries
+    __m128 CellMinX = _mm_cvtepi32_ps(CellX);
+    __m128 CellMinY = _mm_cvtepi32_ps(CellY);
+    __m128 BoundaryX = _mm_add_ps(CellMinX, _mm_and_ps(PositiveX, One));
+    __m128 BoundaryY = _mm_add_ps(CellMinY, _mm_and_ps(PositiveY, One));
+    __m128 InvDirX = _mm_div_ps(One, _mm_or_ps(_mm_and_ps(MovesX, DirX), _mm_andnot_ps(MovesX, One)));
+    __m128 InvDirY = _mm_div_ps(One, _mm_or_ps(_mm_and_ps(MovesY, DirY), _mm_andnot_ps(MovesY, One)));
+    __m128 TMaxX = _mm_mul_ps(_mm_sub_ps(BoundaryX, SourceX), InvDirX);
+    __m128 TMaxY = _mm_mul_ps(_mm_sub_ps(BoundaryY, SourceY), InvDirY);
+    __m128 AbsMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 TDeltaX = _mm_and_ps(InvDirX, AbsMask);
+    __m128 TDeltaY = _mm_and_ps(InvDirY, AbsMask);
+    TMaxX = _mm_or_ps(_mm_and_ps(MovesX, TMaxX), _mm_andnot_ps(MovesX, NoCrossing));
+    TMaxY = _mm_or_ps(_mm_and_ps(MovesY, TMaxY), _mm_andnot_ps(MovesY, NoCrossing));
+
+    __m128 HitT = One;
+    __m128i Occluded = _mm_setzero_si128();
+    __m128i Active = _mm_set1_epi32(-1);
+
+    alignas(16) i32 LaneCellX[4];
+    alignas(16) i32 LaneCellY[4];
+    alignas(16) i32 LaneSolid[4];
+
+    // NOTE: The source cell itself may be solid (e.g. a query from inside a wall)
+    __m128 T = Zero;
+    for (;;)
+    {
+        _mm_store_si128((__m128i *)LaneCellX, CellX);
+        _mm_store_si128((__m128i *)LaneCellY, CellY);
+        for (u32 Lane = 0;
+             Lane < 4;
+             ++Lane)
+        {
+            LaneSolid[Lane] = IsTileSolid(Map, LaneCellX[Lane], LaneCellY[Lane]) ? -1 : 0;
+        }
+        __m128i Solid = _mm_and_si128(_mm_load_si128((__m128i *)LaneSolid), Active);
+        HitT = _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(Solid), T),
+                         _mm_andnot_ps(_mm_castsi128_ps(Solid), HitT));
+        Occluded = _mm_or_si128(Occluded, Solid);
+        Active = _mm_andnot_si128(Solid, Active);
+
+        // NOTE: Step whichever axis crosses a boundary first
+        __m128 StepAlongX = _mm_cmplt_ps(TMaxX, TMaxY);
+        T = _mm_min_ps(TMaxX, TMaxY);
+
+        // NOTE: Past the target means nothing was in the way
+        __m128i Reached = _mm_castps_si128(_mm_cmpge_ps(T, One));
+        Active = _mm_andnot_si128(Reached, Active);
+
+        if (_mm_movemask_epi8(Active) == 0)
+        {
+            break;
+        }
+
+        __m128i StepAlongXI = _mm_and_si128(_mm_castps_si128(StepAlongX), Active);
+        __m128i StepAlongYI = _mm_andnot_si128(_mm_castps_si128(StepAlongX), Active);
+        CellX = _mm_add_epi32(CellX, _mm_and_si128(StepAlongXI, StepX));
+        CellY = _mm_add_epi32(CellY, _mm_and_si128(StepAlongYI, StepY));
+        TMaxX = _mm_add_ps(TMaxX, _mm_and_ps(_mm_castsi128_ps(StepAlongXI), TDeltaX));
+        TMaxY = _mm_add_ps(TMaxY, _mm_and_ps(_mm_castsi128_ps(StepAlongYI), TDeltaY));
+    }
+
+    _mm_storeu_ps(HitDistanceOut, _mm_mul_ps(HitT, Length));
+    i32 OccludedBits = _mm_movemask_ps(_mm_castsi128_ps(Occluded));
+    for (u32 Lane = 0;
+         Lane < 4;
+         ++Lane)
+    {
+        OccludedOut[Lane] = (u8)((OccludedBits >> Lane) & 1);
+    }
+}
+
+internal void
+QueryLineOfSight(game_map *Map, visibility_query_batch *Batch)
+{
+    u32 QueryIndex = 0;
+    for (;
+         QueryIndex + 4 <= Batch->Count;
+         QueryIndex += 4)
+    {
+        QueryLineOfSight4(Map,
+                          Batch->SourceX + QueryIndex, Batch->SourceY + QueryIndex,
+                          Batch->TargetX + QueryIndex, Batch->TargetY + QueryIndex,
+                          Batch->Occluded + QueryIndex, Batch->HitDistance + QueryIndex);
+    }
+
+    u32 Remaining = Batch->Count - QueryIndex;
+    if (Remaining)
+    {
+        // NOTE: Pad the last group by repeating its final query
+        f32 SourceX[4], SourceY[4], TargetX[4], TargetY[4], HitDistance[4];
+        u8 Occluded[4];
+        for (u32 Lane = 0;
+             Lane < 4;
+             ++Lane)
+        {
+            u32 Source = QueryIndex + ((Lane < Remaining) ? Lane : (Remaining - 1));
+            SourceX[Lane] = Batch->SourceX[Source];
+            SourceY[Lane] = Batch->SourceY[Source];
+            TargetX[Lane] = Batch->TargetX[Source];
+            TargetY[Lane] = Batch->TargetY[Source];
+        }
+
+        QueryLineOfSight4(Map, SourceX, SourceY, TargetX, TargetY, Occluded, HitDistance);
+
+        for (u32 Lane = 0;
+             Lane < Remaining;
+             ++Lane)
+        {
+            Batch->Occluded[QueryIndex + Lane] = Occluded[Lane];
+            Batch->HitDistance[QueryIndex + Lane] = HitDistance[Lane];
+        }
+    }
+}
+
+internal bool32
+HasLineOfSight(game_map *Map, f32 SourceX, f32 SourceY, f32 TargetX, f32 TargetY)
+{
+    u8 Occluded;
+    f32 HitDistance;
+    visibility_query_batch Batch = {1, &SourceX, &SourceY, &TargetX, &TargetY, &Occluded, &HitDistance};
+    QueryLineOfSight(Map, &Batch);
+
+    bool32 Result = !Occluded;
+    return Result;
+}
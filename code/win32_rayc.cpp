@@ -3,9 +3,14 @@
 #include <windows.h>
 #include <windowsx.h>
 
-global_variable bool32 GlobalRunning;
+// NOTE: Only the main thread reads or writes it; the sim thread stops on the
+// pipeline's own quit word
+global_variable u32 volatile GlobalRunning;
 global_variable bool32 GlobalSleepIsGranular;
 global_variable bool32 GlobalShouldCaptureMouse;
+// NOTE: Set by the R key; the main loop switches the render engine
+global_variable bool32 GlobalSwitchRenderEngine;
+global_variable bool32 GlobalSwitchHeatmap;
 global_variable i64 GlobalPerfCountFrequency;
 global_variable HWND GlobalWindow;
 global_variable game_input GlobalGameInput;
@@ -72,6 +77,50 @@ PLATFORMReadEntireFile(char *Filename)
     return Result;
 }
 
+internal bool32
+PLATFORMWriteEntireFile(char *Filename, u32 MemorySize, void *Memory)
+{
+    // NOTE: Written under a name of its own and moved over the real one, so
+    // other threads and processes see the old file or the new one, never
+    // half of either. A missing directory is made on the way.
+    bool32 Result = false;
+
+    char TempFilename[MAX_PATH];
+    _snprintf_s(TempFilename, sizeof(TempFilename), _TRUNCATE, "%s.%lu.%lu.tmp", Filename,
+                GetCurrentProcessId(), GetCurrentThreadId());
+    HANDLE FileHandle = CreateFileA(TempFilename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+    if ((FileHandle == INVALID_HANDLE_VALUE) && (GetLastError() == ERROR_PATH_NOT_FOUND))
+    {
+        char Directory[MAX_PATH];
+        _snprintf_s(Directory, sizeof(Directory), _TRUNCATE, "%s", Filename);
+        char *Slash = strrchr(Directory, '/');
+        if (Slash)
+        {
+            *Slash = 0;
+            CreateDirectoryA(Directory, 0);
+            FileHandle = CreateFileA(TempFilename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+        }
+    }
+
+    if (FileHandle != INVALID_HANDLE_VALUE)
+    {
+        DWORD BytesWritten;
+        bool32 Written = (WriteFile(FileHandle, Memory, MemorySize, &BytesWritten, 0) &&
+                          (BytesWritten == MemorySize));
+        CloseHandle(FileHandle);
+        if (Written && MoveFileExA(TempFilename, Filename, MOVEFILE_REPLACE_EXISTING))
+        {
+            Result = true;
+        }
+        else
+        {
+            DeleteFileA(TempFilename);
+        }
+    }
+
+    return Result;
+}
+
 inline void
 Win32SetMouseCursorVisibile(bool32 Enabled)
 {
@@ -97,12 +146,12 @@ Win32MainWindowCallback(HWND Window,
     {
         case WM_CLOSE:
         {
-            GlobalRunning = false;
+            AtomicStoreU32(&GlobalRunning, false);
         } break;
 
         case WM_DESTROY:
         {
-            GlobalRunning = false;
+            AtomicStoreU32(&GlobalRunning, false);
         } break;
 
         case WM_MOUSEMOVE:
@@ -158,7 +207,7 @@ Win32ProcessPendingMessage(game_input *InputData)
         {
             case WM_QUIT:
             {
-                GlobalRunning = false;
+                AtomicStoreU32(&GlobalRunning, false);
             } break;
 
             case WM_SYSKEYDOWN:
@@ -214,12 +263,33 @@ Win32ProcessPendingMessage(game_input *InputData)
                             InputData->StrafeRight = IsDown;
                         } break;
 
+                        case VK_SPACE:
+                        {
+                            InputData->Jump = IsDown;
+                        } break;
+
                         case VK_F4:
                         {
                             bool32 AltKeyWasDown = Message.lParam & (1 << 29);
                             if (AltKeyWasDown)
                             {
-                                GlobalRunning = false;
+                                AtomicStoreU32(&GlobalRunning, false);
+                            }
+                        } break;
+
+                        case 'R':
+                        {
+                            if (IsDown)
+                            {
+                                GlobalSwitchRenderEngine = true;
+                            }
+                        } break;
+
+                        case 'H':
+                        {
+                            if (IsDown)
+                            {
+                                GlobalSwitchHeatmap = true;
                             }
                         } break;
 
@@ -276,7 +346,7 @@ Win32PauseUntilFrameTime(LARGE_INTEGER LastCounter, f32 SecondsElapsed, f32 Targ
             SecondsElapsed = Win32GetSecondsElapsed(LastCounter, Win32GetWallClock());
             if (SecondsElapsed > TargetSeconds)
             {
-                DEBUGPrintString("Missed frame - sleep.\n");
+                LogPrint("Missed frame - sleep.\n");
             }
         }
 
@@ -288,10 +358,309 @@ Win32PauseUntilFrameTime(LARGE_INTEGER LastCounter, f32 SecondsElapsed, f32 Targ
     }
     else
     {
-        DEBUGPrintString("Missed frame - work.\n");
+        LogPrint("Missed frame - work.\n");
+    }
+}
+
+// NOTE: Waiting on a pipeline counter. Spin for a short while since the other
+// stage is usually close to done, then park with WaitOnAddress so an idle stage
+// costs no CPU.
+internal void
+Win32WaitWhileEqual(u32 volatile *Address, u32 Value)
+{
+    for (i32 SpinIndex = 0;
+         SpinIndex < 1024;
+         ++SpinIndex)
+    {
+        if (AtomicLoadU32(Address) != Value)
+        {
+            return;
+        }
+        CPUPause();
+    }
+
+    while (AtomicLoadU32(Address) == Value)
+    {
+        WaitOnAddress(Address, &Value, sizeof(Value), INFINITE);
+    }
+}
+
+inline void
+Win32WakeWaiters(u32 volatile *Address)
+{
+    WakeByAddressAll((void *)Address);
+}
+
+struct win32_sim_thread_context
+{
+    frame_pipeline *Pipeline;
+    game_state *State;
+};
+
+DWORD WINAPI
+Win32SimThreadProc(LPVOID Parameter)
+{
+    win32_sim_thread_context *Context = (win32_sim_thread_context *)Parameter;
+    frame_pipeline *Pipeline = Context->Pipeline;
+
+    while (!PipelineQuitRequested(Pipeline))
+    {
+        Win32WaitWhileEqual(&Pipeline->SimFramesRequested, Pipeline->SimFramesCompleted);
+        if (PipelineRunSimStage(Pipeline, Context->State))
+        {
+            Win32WakeWaiters(&Pipeline->SimFramesCompleted);
+        }
+    }
+
+    return 0;
+}
+
+internal void
+Win32SubmitSimFrame(frame_pipeline *Pipeline, game_input *Input)
+{
+    PipelineSubmitSimFrame(Pipeline, Input);
+    Win32WakeWaiters(&Pipeline->SimFramesRequested);
+}
+
+internal void
+Win32WaitForSimFrame(frame_pipeline *Pipeline)
+{
+    Win32WaitWhileEqual(&Pipeline->SimFramesCompleted, Pipeline->SimFramesRequested - 1);
+}
+
+// NOTE: The platform work queue. A ring of entries filled by the main thread
+// and drained by one worker per spare core; see linux_rayc_work_queue.cpp,
+// which this mirrors with WaitOnAddress in place of the futex.
+#define WIN32_WORK_QUEUE_SIZE 256
+#define WIN32_WORK_QUEUE_MAX_THREADS 32
+
+struct win32_work_queue_entry
+{
+    platform_work_callback *Callback;
+    void *Data;
+};
+
+struct win32_work_queue
+{
+    u32 volatile NextEntryToWrite;
+    u32 volatile NextEntryToRead;
+    u32 volatile CompletionGoal;
+    u32 volatile CompletionCount;
+
+    u32 ThreadCount;
+    win32_work_queue_entry Entries[WIN32_WORK_QUEUE_SIZE];
+};
+
+global_variable win32_work_queue GlobalWorkQueue;
+
+internal bool32
+Win32DoNextWorkQueueEntry(win32_work_queue *Queue)
+{
+    // NOTE: Returns false if the ring was empty
+    bool32 Result = false;
+    u32 OriginalNextEntryToRead = AtomicLoadU32(&Queue->NextEntryToRead);
+    if (OriginalNextEntryToRead != AtomicLoadU32(&Queue->NextEntryToWrite))
+    {
+        // NOTE: Copied before the claim: once the read index moves on, the
+        // main thread is free to reuse the slot
+        Result = true;
+        win32_work_queue_entry Entry = Queue->Entries[OriginalNextEntryToRead & (WIN32_WORK_QUEUE_SIZE - 1)];
+        if (AtomicCompareExchangeU32(&Queue->NextEntryToRead, OriginalNextEntryToRead + 1,
+                                     OriginalNextEntryToRead) == OriginalNextEntryToRead)
+        {
+            Entry.Callback(Entry.Data);
+
+            u32 Completed = AtomicAddU32(&Queue->CompletionCount, 1) + 1;
+            if (Completed == AtomicLoadU32(&Queue->CompletionGoal))
+            {
+                WakeByAddressSingle((void *)&Queue->CompletionCount);
+            }
+        }
+    }
+    return Result;
+}
+
+DWORD WINAPI
+Win32WorkQueueThreadProc(LPVOID Parameter)
+{
+    win32_work_queue *Queue = (win32_work_queue *)Parameter;
+    for (;;)
+    {
+        u32 NextEntryToWrite = AtomicLoadU32(&Queue->NextEntryToWrite);
+        if (!Win32DoNextWorkQueueEntry(Queue))
+        {
+            WaitOnAddress(&Queue->NextEntryToWrite, &NextEntryToWrite, sizeof(NextEntryToWrite), INFINITE);
+        }
+    }
+}
+
+internal void
+Win32StartWorkQueue(win32_work_queue *Queue)
+{
+    // NOTE: One worker per core but this one; they live as long as the process
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+    u32 ThreadCount = (SystemInfo.dwNumberOfProcessors > 1) ? (u32)SystemInfo.dwNumberOfProcessors - 1 : 0;
+    if (ThreadCount > WIN32_WORK_QUEUE_MAX_THREADS)
+    {
+        ThreadCount = WIN32_WORK_QUEUE_MAX_THREADS;
+    }
+
+    Queue->ThreadCount = 0;
+    for (u32 ThreadIndex = 0;
+         ThreadIndex < ThreadCount;
+         ++ThreadIndex)
+    {
+        HANDLE Thread = CreateThread(0, 0, Win32WorkQueueThreadProc, Queue, 0, 0);
+        if (Thread)
+        {
+            CloseHandle(Thread);
+            ++Queue->ThreadCount;
+        }
+    }
+}
+
+internal void
+PLATFORMAddWork(platform_work_callback *Callback, void *Data)
+{
+    win32_work_queue *Queue = &GlobalWorkQueue;
+    u32 NextEntryToWrite = Queue->NextEntryToWrite;
+    if (NextEntryToWrite - AtomicLoadU32(&Queue->NextEntryToRead) >= WIN32_WORK_QUEUE_SIZE)
+    {
+        // NOTE: Ring full; the main thread may as well do this one itself
+        Callback(Data);
+        return;
+    }
+
+    win32_work_queue_entry *Entry = &Queue->Entries[NextEntryToWrite & (WIN32_WORK_QUEUE_SIZE - 1)];
+    Entry->Callback = Callback;
+    Entry->Data = Data;
+    AtomicStoreU32(&Queue->CompletionGoal, Queue->CompletionGoal + 1);
+    AtomicStoreU32(&Queue->NextEntryToWrite, NextEntryToWrite + 1);
+    WakeByAddressSingle((void *)&Queue->NextEntryToWrite);
+}
+
+internal void
+PLATFORMCompleteAllWork(void)
+{
+    win32_work_queue *Queue = &GlobalWorkQueue;
+    u32 CompletionGoal = Queue->CompletionGoal;
+    for (;;)
+    {
+        u32 CompletionCount = AtomicLoadU32(&Queue->CompletionCount);
+        if (CompletionCount == CompletionGoal)
+        {
+            break;
+        }
+        if (!Win32DoNextWorkQueueEntry(Queue))
+        {
+            // NOTE: Everything's claimed; wait for the stragglers
+            WaitOnAddress(&Queue->CompletionCount, &CompletionCount, sizeof(CompletionCount), INFINITE);
+        }
+    }
+}
+
+// NOTE: Log writer. Wakes every couple of milliseconds, formats whatever the
+// main and sim threads have appended, and writes it to rayc.log and the
+// debugger, so the frame loop never formats or calls OutputDebugStringA.
+#define WIN32_LOG_MAX_RINGS 8
+#define WIN32_LOG_TEXT_SIZE Kilobytes(64)
+#define WIN32_LOG_POLL_MS 2
+
+struct win32_log_writer
+{
+    log_state Log;
+    HANDLE FileHandle;
+    u32 volatile Running;
+    HANDLE Thread;
+
+    char Text[WIN32_LOG_TEXT_SIZE];
+};
+
+internal void
+Win32FlushLog(win32_log_writer *Writer)
+{
+    for (;;)
+    {
+        memory_index Size = LogFormatPending(&Writer->Log, Writer->Text, sizeof(Writer->Text));
+        if (Size == 0)
+        {
+            break;
+        }
+
+        DWORD BytesWritten;
+        WriteFile(Writer->FileHandle, Writer->Text, (DWORD)Size, &BytesWritten, 0);
+        OutputDebugStringA(Writer->Text);
     }
 }
 
+DWORD WINAPI
+Win32LogThreadProc(LPVOID Parameter)
+{
+    win32_log_writer *Writer = (win32_log_writer *)Parameter;
+
+    while (AtomicLoadU32(&Writer->Running))
+    {
+        Win32FlushLog(Writer);
+        Sleep(WIN32_LOG_POLL_MS);
+    }
+    Win32FlushLog(Writer);
+
+    return 0;
+}
+
+internal bool32
+Win32StartLogWriter(win32_log_writer *Writer, char *Filename)
+{
+    bool32 Result = false;
+
+    Writer->FileHandle = CreateFileA(Filename, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, 0, 0);
+    memory_index RingsSize = WIN32_LOG_MAX_RINGS*sizeof(log_ring) + 64;
+    void *RingsMemory = VirtualAlloc(0, RingsSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    if ((Writer->FileHandle != INVALID_HANDLE_VALUE) && RingsMemory)
+    {
+        memory_arena Arena;
+        InitializeArena(&Arena, RingsSize, RingsMemory);
+        InitializeLog(&Writer->Log, WIN32_LOG_MAX_RINGS, &Arena);
+
+        Writer->Running = true;
+        Writer->Thread = CreateThread(0, 0, Win32LogThreadProc, Writer, 0, 0);
+        if (Writer->Thread)
+        {
+            Result = true;
+        }
+        else
+        {
+            GlobalLog = 0;
+        }
+    }
+
+    if (!Result)
+    {
+        // NOTE: Give back whichever of the two was acquired
+        if (RingsMemory)
+        {
+            VirtualFree(RingsMemory, 0, MEM_RELEASE);
+        }
+        if (Writer->FileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(Writer->FileHandle);
+            Writer->FileHandle = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    return Result;
+}
+
+internal void
+Win32StopLogWriter(win32_log_writer *Writer)
+{
+    AtomicStoreU32(&Writer->Running, false);
+    WaitForSingleObject(Writer->Thread, INFINITE);
+    GlobalLog = 0;
+    CloseHandle(Writer->FileHandle);
+}
+
 int CALLBACK
 WinMain(HINSTANCE Instance,
         HINSTANCE PrevInstance,
@@ -300,6 +669,9 @@ WinMain(HINSTANCE Instance,
 {
     int ClientWidth = 1600;
     int ClientHeight = 900;
+
+    local_persist win32_log_writer LogWriter;
+    bool32 Logging = Win32StartLogWriter(&LogWriter, "rayc.log");
     
     WNDCLASSA WindowClass = {};
     WindowClass.style = CS_HREDRAW|CS_VREDRAW;
@@ -352,8 +724,17 @@ WinMain(HINSTANCE Instance,
             BitmapInfo.bmiHeader.biBitCount = 32;
             BitmapInfo.bmiHeader.biCompression = BI_RGB;
             
-            game_state GameState = {};
-            GameStateInit(&GameState);
+            game_memory GameMemory = {};
+            GameMemory.PermanentStorageSize = Megabytes(256);
+            GameMemory.TransientStorageSize = Megabytes(64);
+            u64 TotalStorageSize = GameMemory.PermanentStorageSize + GameMemory.TransientStorageSize;
+            GameMemory.PermanentStorage = VirtualAlloc(0, (size_t)TotalStorageSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+            GameMemory.TransientStorage = (u8 *)GameMemory.PermanentStorage + GameMemory.PermanentStorageSize;
+
+            Win32StartWorkQueue(&GlobalWorkQueue);
+
+            game_state *GameState = GameStateInit(&GameMemory);
+            render_state *RenderState = RenderStateInit(&GameMemory);
 
             LARGE_INTEGER LastCounter = Win32GetWallClock();
             f32 SecondsElapsedForFrame = 0.0f;
@@ -367,12 +748,36 @@ WinMain(HINSTANCE Instance,
             GlobalSleepIsGranular = (timeBeginPeriod(DesiredSchedulerMS) == TIMERR_NOERROR);
 
             f32 TargetSecondsPerFrame = 1 / 60.0f; // 60FPS
-            GlobalGameInput.SecondsPerFrame = TargetSecondsPerFrame;
+            // NOTE: Game steps its simulation by measured time; seed with the target
+            GlobalGameInput.SecondsElapsed = TargetSecondsPerFrame;
 
             Win32SetMouseCursorVisibile(!GlobalShouldCaptureMouse);
 
-            GlobalRunning = true;
-            while (GlobalRunning)
+            AtomicStoreU32(&GlobalRunning, true);
+
+            frame_pipeline Pipeline = {};
+            InitializeFramePipeline(&Pipeline, GameState, RenderState);
+
+            // NOTE: Restart snapshot. Linux remaps a memfd copy-on-write; here
+            // it's a plain copy of the run, which for the game's own state is
+            // a few hundred KB
+            memory_index StateSnapshotSize = GameStateSnapshotSize(GameState);
+            void *StateSnapshot = VirtualAlloc(0, StateSnapshotSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+            if (StateSnapshot)
+            {
+                memcpy(StateSnapshot, GameState, StateSnapshotSize);
+            }
+
+            win32_sim_thread_context SimThreadContext = {&Pipeline, GameState};
+            HANDLE SimThread = CreateThread(0, 0, Win32SimThreadProc, &SimThreadContext, 0, 0);
+            if (SimThread)
+            {
+                // NOTE: Prime the pipeline so there's a snapshot to draw on frame 0
+                Win32SubmitSimFrame(&Pipeline, &GlobalGameInput);
+                Win32WaitForSimFrame(&Pipeline);
+            }
+
+            while (AtomicLoadU32(&GlobalRunning))
             {
                 // game_input ZeroGameInput = {0};
                 // GlobalGameInput = ZeroGameInput;
@@ -380,8 +785,42 @@ WinMain(HINSTANCE Instance,
                 GlobalGameInput.MouseLeft = GetKeyState(VK_LBUTTON) & (1 << 15);
                 GlobalGameInput.MouseRight = GetKeyState(VK_RBUTTON) & (1 << 15);
                 Win32ProcessPendingMessage(&GlobalGameInput);
+                if (GlobalSwitchRenderEngine)
+                {
+                    RenderState->Engine = (render_engine)((RenderState->Engine + 1) % RenderEngine_Count);
+                    GlobalSwitchRenderEngine = false;
+                }
+                if (GlobalSwitchHeatmap)
+                {
+                    heatmap_mode *Mode = &RenderState->Heatmap.Mode;
+                    *Mode = (heatmap_mode)((*Mode + 1) % HeatmapMode_Count);
+                    GlobalSwitchHeatmap = false;
+                }
                 
-                GameUpdateAndRender(&GameState, &GlobalGameInput, &GameBuffer);
+                if (SimThread)
+                {
+                    Win32SubmitSimFrame(&Pipeline, &GlobalGameInput);
+                    render_snapshot *Snapshot = PipelineGetRenderSnapshot(&Pipeline);
+                    GameRender(GameState, RenderState, &Snapshot->View, &GameBuffer);
+                    Win32WaitForSimFrame(&Pipeline);
+                }
+                else
+                {
+                    GameUpdateAndRender(GameState, RenderState, &GlobalGameInput, &GameBuffer);
+                }
+
+                // NOTE: The sim stage is idle here, in either mode
+                if (StateSnapshot && GameState->PlayerCaught)
+                {
+                    LARGE_INTEGER RestartStart = Win32GetWallClock();
+                    memcpy(GameState, StateSnapshot, StateSnapshotSize);
+                    if (SimThread)
+                    {
+                        PipelineRefreshRenderSnapshot(&Pipeline, GameState);
+                    }
+                    LogPrint("Caught; restarted in %.1fus\n",
+                             Win32GetSecondsElapsed(RestartStart, Win32GetWallClock())*1000000.0f);
+                }
 
                 LARGE_INTEGER WorkCounter = Win32GetWallClock();
                 f32 WorkSecondsElapsed = Win32GetSecondsElapsed(LastCounter, WorkCounter);
@@ -389,6 +828,7 @@ WinMain(HINSTANCE Instance,
                 LARGE_INTEGER EndCounter = Win32GetWallClock();
                 SecondsElapsedForFrame = Win32GetSecondsElapsed(LastCounter, EndCounter);
                 LastCounter = EndCounter;
+                GlobalGameInput.SecondsElapsed = SecondsElapsedForFrame;
                 
                 HDC DeviceContext = GetDC(GlobalWindow);
                 StretchDIBits(DeviceContext,
@@ -403,12 +843,19 @@ WinMain(HINSTANCE Instance,
                 if (WorkPercent > 0.0f)
                 {
                     
-                    DEBUGPrintString("Frame=%.2fms; Work=%.2fms(%.0f%%)\n",
-                                     SecondsElapsedForFrame * 1000.0f,
-                                     WorkSecondsElapsed * 1000.0f,
-                                     WorkPercent);
+                    LogPrint("Frame=%.2fms; Work=%.2fms(%.0f%%)\n",
+                             SecondsElapsedForFrame * 1000.0f,
+                             WorkSecondsElapsed * 1000.0f,
+                             WorkPercent);
                 }
             }
+
+            if (SimThread)
+            {
+                PipelineRequestQuit(&Pipeline);
+                Win32WakeWaiters(&Pipeline.SimFramesRequested);
+                WaitForSingleObject(SimThread, INFINITE);
+            }
         }
         else
         {
@@ -420,5 +867,10 @@ WinMain(HINSTANCE Instance,
         // TODO: Logging
     }
 
+    if (Logging)
+    {
+        Win32StopLogWriter(&LogWriter);
+    }
+
     return 0;
 }